@@ -9,6 +9,7 @@
 #include <AnKi/Collision/Plane.h>
 #include <AnKi/Collision/Ray.h>
 #include <AnKi/Collision/Aabb.h>
+#include <AnKi/Util/WeakArray.h>
 
 namespace anki {
 
@@ -44,6 +45,17 @@ inline F32 testPlane(const Plane& plane, const Vec4& point)
 	return plane.getNormal().dot(point) - plane.getOffset();
 }
 
+/// Batch version of testPlane for AABBs. It only checks if every AABB is in front or collides with all the planes, like
+/// a frustum test does. The AABBs are in SoA form and they are tested 4 at a time.
+/// @param planes The planes.
+/// @param aabbMins The min X, Y and Z of the AABBs. Every array should be aligned to 16 bytes and its size should be
+///                 count rounded up to 4. The values of the padding are ignored but they should be initialized.
+/// @param aabbMaxs Same as aabbMins for the max.
+/// @param count The number of AABBs.
+/// @param[out] visibleMask One bit per AABB. It should have (count + 63) / 64 elements.
+void testPlanes(ConstWeakArray<Plane> planes, const Array<const F32*, 3>& aabbMins,
+				const Array<const F32*, 3>& aabbMaxs, U32 count, WeakArray<U64> visibleMask);
+
 /// @copydoc computeAabb(const ConvexHullShape&)
 Aabb computeAabb(const Sphere& sphere);
 
@@ -150,6 +150,100 @@ F32 testPlane(const Plane& plane, const ConvexHullShape& hull)
 	}
 }
 
+void testPlanes(ConstWeakArray<Plane> planes, const Array<const F32*, 3>& aabbMins,
+				const Array<const F32*, 3>& aabbMaxs, U32 count, WeakArray<U64> visibleMask)
+{
+	const U32 maskCount = (count + 63) / 64;
+	ANKI_ASSERT(visibleMask.getSize() >= maskCount);
+	memset(visibleMask.getBegin(), 0, maskCount * sizeof(U64));
+
+#if ANKI_SIMD_SSE || ANKI_SIMD_NEON
+	using Simd = MathSimd<F32, 4>::Type;
+	for(U32 i = 0; i < 3; ++i)
+	{
+		ANKI_ASSERT(isAligned(16, aabbMins[i]) && isAligned(16, aabbMaxs[i]));
+	}
+
+	for(U32 first = 0; first < count; first += 4)
+	{
+		Array<Simd, 3> mins, maxs;
+		for(U32 i = 0; i < 3; ++i)
+		{
+#	if ANKI_SIMD_SSE
+			mins[i] = _mm_load_ps(aabbMins[i] + first);
+			maxs[i] = _mm_load_ps(aabbMaxs[i] + first);
+#	else
+			mins[i] = vld1q_f32(aabbMins[i] + first);
+			maxs[i] = vld1q_f32(aabbMaxs[i] + first);
+#	endif
+		}
+
+#	if ANKI_SIMD_SSE
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+#	else
+		uint32x4_t inside = vdupq_n_u32(kMaxU32);
+#	endif
+		for(const Plane& plane : planes)
+		{
+			// Test the corner that is furthest along the normal
+			const Vec4& n = plane.getNormal();
+			const Simd& x = (n.x() >= 0.0f) ? maxs[0] : mins[0];
+			const Simd& y = (n.y() >= 0.0f) ? maxs[1] : mins[1];
+			const Simd& z = (n.z() >= 0.0f) ? maxs[2] : mins[2];
+
+#	if ANKI_SIMD_SSE
+			__m128 dist = _mm_mul_ps(x, _mm_set1_ps(n.x()));
+			dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(n.y())));
+			dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(n.z())));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_set1_ps(plane.getOffset())));
+#	else
+			float32x4_t dist = vmulq_n_f32(x, n.x());
+			dist = vmlaq_n_f32(dist, y, n.y());
+			dist = vmlaq_n_f32(dist, z, n.z());
+			inside = vandq_u32(inside, vcgeq_f32(dist, vdupq_n_f32(plane.getOffset())));
+#	endif
+		}
+
+#	if ANKI_SIMD_SSE
+		const U64 bits = U64(_mm_movemask_ps(inside));
+#	else
+		const U64 bits = U64(vaddvq_u32(vandq_u32(inside, uint32x4_t{1, 2, 4, 8})));
+#	endif
+
+		// The 4 bits never cross the U64 boundary because "first" is a multiple of 4
+		visibleMask[first / 64] |= bits << U64(first % 64);
+	}
+
+	// Clear the bits of the padding
+	if(count % 64)
+	{
+		visibleMask[maskCount - 1] &= (U64(1) << U64(count % 64)) - 1;
+	}
+#else
+	for(U32 idx = 0; idx < count; ++idx)
+	{
+		Bool inside = true;
+		for(const Plane& plane : planes)
+		{
+			const Vec4& n = plane.getNormal();
+			const F32 x = (n.x() >= 0.0f) ? aabbMaxs[0][idx] : aabbMins[0][idx];
+			const F32 y = (n.y() >= 0.0f) ? aabbMaxs[1][idx] : aabbMins[1][idx];
+			const F32 z = (n.z() >= 0.0f) ? aabbMaxs[2][idx] : aabbMins[2][idx];
+			if(n.x() * x + n.y() * y + n.z() * z < plane.getOffset())
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if(inside)
+		{
+			visibleMask[idx / 64] |= U64(1) << U64(idx % 64);
+		}
+	}
+#endif
+}
+
 F32 testPlane(const Plane& plane, const LineSegment& ls)
 {
 	const Vec4& p0 = ls.getOrigin();
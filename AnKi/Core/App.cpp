@@ -27,6 +27,8 @@
 #include <AnKi/Script/ScriptManager.h>
 #include <AnKi/Resource/ResourceFilesystem.h>
 #include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Resource/ResourceStreamer.h>
+#include <AnKi/Resource/ShaderProgramResourceSystem.h>
 #include <AnKi/Core/GpuMemoryPools.h>
 #include <AnKi/Ui/UiManager.h>
 #include <AnKi/Ui/Canvas.h>
@@ -126,6 +128,17 @@ void App::cleanup()
 	MainRenderer::freeSingleton();
 	UiManager::freeSingleton();
 	GpuSceneMicroPatcher::freeSingleton();
+
+	if(ResourceManager::isAllocated() && ConfigSet::getSingleton().getRsrcShaderVariantPrewarm())
+	{
+		CoreString filename;
+		filename.sprintf("%s/ShaderVariants.ankiprewarm", m_cacheDir.cstr());
+		if(ResourceManager::getSingleton().getShaderProgramResourceSystem().saveVariantList(filename))
+		{
+			ANKI_CORE_LOGW("Failed to save the shader variant list");
+		}
+	}
+
 	ResourceManager::freeSingleton();
 	PhysicsWorld::freeSingleton();
 	RebarStagingGpuMemoryPool::freeSingleton();
@@ -259,7 +272,10 @@ Error App::initInternal()
 	// ThreadPool
 	//
 	const Bool pinThreads = !ANKI_OS_ANDROID;
-	CoreThreadHive::allocateSingleton(ConfigSet::getSingleton().getCoreJobThreadCount(), pinThreads);
+	CoreThreadHive::allocateSingleton(ConfigSet::getSingleton().getCoreJobThreadCount(), pinThreads,
+									  (ConfigSet::getSingleton().getCoreJobWorkStealing())
+										  ? ThreadHiveMode::kWorkStealing
+										  : ThreadHiveMode::kSharedQueue);
 
 	//
 	// Graphics API
@@ -309,6 +325,17 @@ Error App::initInternal()
 
 	ANKI_CHECK(ResourceManager::allocateSingleton().init(allocCb, allocCbUserData));
 
+	if(ConfigSet::getSingleton().getRsrcShaderVariantPrewarm())
+	{
+		// Create the shader variants of the previous run in the background
+		CoreString filename;
+		filename.sprintf("%s/ShaderVariants.ankiprewarm", m_cacheDir.cstr());
+		if(fileExists(filename) && ResourceManager::getSingleton().getShaderProgramResourceSystem().prewarm(filename))
+		{
+			ANKI_CORE_LOGW("Failed to pre-warm the shader variants");
+		}
+	}
+
 	//
 	// UI
 	//
@@ -429,6 +456,9 @@ Error App::mainLoop()
 			// User update
 			ANKI_CHECK(userMainLoop(quit, crntTime - prevUpdateTime));
 
+			// Stream the resources that the previous frame asked for
+			ResourceManager::getSingleton().getResourceStreamer().update();
+
 			ANKI_CHECK(SceneGraph::getSingleton().update(prevUpdateTime, crntTime));
 
 			RenderQueue rqueue;
@@ -471,9 +501,12 @@ Error App::mainLoop()
 			GpuSceneMemoryPool::getSingleton().endFrame();
 
 			// Update the trace info with some async loader stats
-			U64 asyncTaskCount = ResourceManager::getSingleton().getAsyncLoader().getCompletedTaskCount();
+			AsyncLoader& asyncLoader = ResourceManager::getSingleton().getAsyncLoader();
+			U64 asyncTaskCount = asyncLoader.getCompletedTaskCount();
 			ANKI_TRACE_INC_COUNTER(RsrcAsyncTasks, asyncTaskCount - m_resourceCompletedAsyncTaskCount);
 			m_resourceCompletedAsyncTaskCount = asyncTaskCount;
+			ANKI_TRACE_INC_COUNTER(RsrcAsyncIoQueueDepth, asyncLoader.getQueuedTaskCount(AsyncLoaderTaskType::kIo));
+			ANKI_TRACE_INC_COUNTER(RsrcAsyncCpuQueueDepth, asyncLoader.getQueuedTaskCount(AsyncLoaderTaskType::kCpu));
 
 			// Now resume the loader
 			ResourceManager::getSingleton().getAsyncLoader().resume();
@@ -542,6 +575,13 @@ Error App::mainLoop()
 				in.m_gpuDeviceMemoryInUse = grStats.m_deviceMemoryInUse;
 				in.m_reBar = rebarMemUsed;
 
+				const ResourceManager& resources = ResourceManager::getSingleton();
+				in.m_loadedImageCount = resources.getLoadedResourceCount<ImageResource>();
+				in.m_loadedMeshCount = resources.getLoadedResourceCount<MeshResource>();
+				in.m_loadedMaterialCount = resources.getLoadedResourceCount<MaterialResource>();
+				in.m_loadedModelCount = resources.getLoadedResourceCount<ModelResource>();
+				in.m_loadedShaderProgramCount = resources.getLoadedResourceCount<ShaderProgramResource>();
+
 				in.m_drawableCount = rqueue.countAllRenderables();
 				in.m_vkCommandBufferCount = grStats.m_commandBufferCount;
 
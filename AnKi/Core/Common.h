@@ -25,7 +25,7 @@ class CoreMemoryPool : public HeapMemoryPool, public MakeSingleton<CoreMemoryPoo
 
 private:
 	CoreMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData)
-		: HeapMemoryPool(allocCb, allocCbUserData, "CoreMemPool")
+		: HeapMemoryPool(allocCb, allocCbUserData, "CoreMemPool", true)
 	{
 	}
 
@@ -38,8 +38,8 @@ class CoreThreadHive : public ThreadHive, public MakeSingleton<CoreThreadHive>
 	friend class MakeSingleton;
 
 public:
-	CoreThreadHive(U32 threadCount, Bool pinToCores = false)
-		: ThreadHive(threadCount, pinToCores)
+	CoreThreadHive(U32 threadCount, Bool pinToCores = false, ThreadHiveMode mode = ThreadHiveMode::kSharedQueue)
+		: ThreadHive(threadCount, pinToCores, mode)
 	{
 	}
 };
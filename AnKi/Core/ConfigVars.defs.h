@@ -17,9 +17,16 @@ ANKI_CONFIG_VAR_U32(WindowFullscreen, 1, 0, 2, "0: windowed, 1: borderless fulls
 
 ANKI_CONFIG_VAR_U32(CoreTargetFps, 60u, 1u, kMaxU32, "Target FPS")
 ANKI_CONFIG_VAR_U32(CoreJobThreadCount, max(2u, getCpuCoresCount() / 2u), 2u, 1024u, "Number of job thread")
+ANKI_CONFIG_VAR_BOOL(CoreJobWorkStealing, true, "Schedule the jobs with per-thread work-stealing queues")
 ANKI_CONFIG_VAR_U32(CoreDisplayStats, 0, 0, 2, "Display stats, 0: None, 1: Simple, 2: Detailed")
 ANKI_CONFIG_VAR_BOOL(CoreClearCaches, false, "Clear all caches")
 ANKI_CONFIG_VAR_BOOL(CoreVerboseLog, false, "Verbose logging")
 ANKI_CONFIG_VAR_BOOL(CoreBenchmarkMode, false, "Run in a benchmark mode. Fixed timestep, unlimited target FPS")
 ANKI_CONFIG_VAR_U32(CoreBenchmarkModeFrameCount, 60 * 60 * 2, 1, kMaxU32,
 					"How many frames the benchmark will run before it quits")
+
+ANKI_CONFIG_VAR_BOOL(CoreTracerFlightRecorder, false,
+					 "Keep only the latest trace events of every thread in a ring buffer. It also enables tracing")
+ANKI_CONFIG_VAR_PTR_SIZE(CoreTracerFlightRecorderSize, 256_KB, 8_KB, 64_MB, "The ring buffer size of every thread")
+ANKI_CONFIG_VAR_F32(CoreTracerFlightRecorderSpikeTime, 0.0f, 0.0f, 10000.0f,
+					"Dump the flight recorder if a frame takes more ms than that. 0 disables it")
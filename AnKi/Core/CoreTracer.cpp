@@ -4,9 +4,11 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/Core/CoreTracer.h>
+#include <AnKi/Core/ConfigSet.h>
 #include <AnKi/Util/DynamicArray.h>
 #include <AnKi/Util/Tracer.h>
 #include <AnKi/Util/System.h>
+#include <AnKi/Util/HighRezTimer.h>
 #include <AnKi/Math/Functions.h>
 
 namespace anki {
@@ -90,7 +92,16 @@ CoreTracer::~CoreTracer()
 Error CoreTracer::init(CString directory)
 {
 	Tracer::allocateSingleton();
-	const Bool enableTracer = getenv("ANKI_CORE_TRACER_ENABLED") && getenv("ANKI_CORE_TRACER_ENABLED")[0] == '1';
+
+	const Bool flightRecorder = ConfigSet::getSingleton().getCoreTracerFlightRecorder();
+	if(flightRecorder)
+	{
+		Tracer::getSingleton().setFlightRecorder(ConfigSet::getSingleton().getCoreTracerFlightRecorderSize());
+		ANKI_CORE_LOGI("Tracer flight recorder is enabled");
+	}
+
+	const Bool enableTracer = flightRecorder
+							  || (getenv("ANKI_CORE_TRACER_ENABLED") && getenv("ANKI_CORE_TRACER_ENABLED")[0] == '1');
 	Tracer::getSingleton().setEnabled(enableTracer);
 	ANKI_CORE_LOGI("Tracing is %s from the beginning", (enableTracer) ? "enabled" : "disabled");
 
@@ -102,6 +113,13 @@ Error CoreTracer::init(CString directory)
 	CoreString fname;
 	fname.sprintf("%s/%d%02d%02d-%02d%02d_", directory.cstr(), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
 				  tm.tm_min);
+	m_filenamePrefix = fname;
+
+	if(flightRecorder)
+	{
+		// Nothing will be flushed, don't create the files
+		return Error::kNone;
+	}
 
 	ANKI_CHECK(m_traceJsonFile.open(CoreString().sprintf("%strace.json", fname.cstr()), FileOpenFlag::kWrite));
 	ANKI_CHECK(m_traceJsonFile.writeText("[\n"));
@@ -274,6 +292,25 @@ void CoreTracer::gatherCounters(ThreadWorkItem& item)
 
 void CoreTracer::flushFrame(U64 frame)
 {
+	if(Tracer::getSingleton().getFlightRecorderEnabled())
+	{
+		const Second now = HighRezTimer::getCurrentTime();
+		const Second frameTime = now - m_prevFlushTime;
+		const Second spikeTime = ConfigSet::getSingleton().getCoreTracerFlightRecorderSpikeTime() / 1000.0;
+		if(spikeTime > 0.0 && m_prevFlushTime > 0.0 && frameTime > spikeTime
+		   && now - m_lastDumpTime > kMinTimeBetweenSpikeDumps)
+		{
+			ANKI_CORE_LOGI("Frame %" PRIu64 " took %fms. Will dump the flight recorder", frame, frameTime * 1000.0);
+			[[maybe_unused]] const Error err = dumpFlightRecorder();
+			m_lastDumpTime = now;
+		}
+
+		m_prevFlushTime = now;
+
+		// The flight recorder keeps everything, nothing to flush
+		return;
+	}
+
 	struct Ctx
 	{
 		U64 m_frame;
@@ -312,6 +349,15 @@ void CoreTracer::flushFrame(U64 frame)
 		&ctx);
 }
 
+Error CoreTracer::dumpFlightRecorder()
+{
+	CoreString filename;
+	filename.sprintf("%sflight%u.ankitrace", m_filenamePrefix.cstr(), m_dumpCount++);
+	ANKI_CHECK(Tracer::getSingleton().dumpFlightRecorder(filename));
+	ANKI_CORE_LOGI("Flight recorder dumped to: %s", filename.cstr());
+	return Error::kNone;
+}
+
 Error CoreTracer::writeCountersForReal()
 {
 	if(!m_countersCsvFile.isOpen() || m_frameCounters.getSize() == 0)
@@ -25,10 +25,16 @@ public:
 	/// @param directory The directory to store the trace and counters.
 	Error init(CString directory);
 
-	/// It will flush everything.
+	/// It will flush everything. If the flight recorder is enabled it will dump it when the frame took too long.
 	void flushFrame(U64 frame);
 
+	/// Write the flight recorder to a file in the trace directory. Use the TraceConverter tool to view it.
+	Error dumpFlightRecorder();
+
 private:
+	/// Don't flood the disk with dumps if all frames are slow.
+	static constexpr Second kMinTimeBetweenSpikeDumps = 5.0;
+
 	class ThreadWorkItem;
 	class PerFrameCounters;
 
@@ -44,6 +50,11 @@ private:
 	File m_countersCsvFile;
 	Bool m_quit = false;
 
+	CoreString m_filenamePrefix;
+	Second m_prevFlushTime = 0.0;
+	Second m_lastDumpTime = 0.0;
+	U32 m_dumpCount = 0;
+
 	CoreTracer();
 
 	~CoreTracer();
@@ -126,6 +126,9 @@ PtrSize RebarStagingGpuMemoryPool::endFrame()
 	return usedMemory;
 }
 
+thread_local GpuSceneMicroPatcher::ThreadLocal* GpuSceneMicroPatcher::m_threadLocal = nullptr;
+thread_local U64 GpuSceneMicroPatcher::m_threadLocalPatcherUuid = 0;
+
 /// It packs the source and destination offsets as well as the size of the patch itself.
 class GpuSceneMicroPatcher::PatchHeader
 {
@@ -134,13 +137,68 @@ public:
 	U32 m_dstDwordOffset;
 };
 
+/// The patches of a single thread. The data of the patches are written straight to ReBAR memory.
+class alignas(ANKI_CACHE_LINE_SIZE) GpuSceneMicroPatcher::ThreadLocal
+{
+public:
+	/// A piece of ReBAR memory.
+	class Chunk
+	{
+	public:
+		U32 m_rebarDwordOffset;
+		U32 m_dwordCount; ///< The used part of the chunk.
+		U32 m_dispatch; ///< Scratch value used in patchGpuScene.
+	};
+
+	class Patch
+	{
+	public:
+		U32 m_chunk;
+		U32 m_rebarDwordOffset;
+		U32 m_dstDwordOffset;
+		U32 m_dwordCount;
+	};
+
+	// Don't shrink the arrays every frame. Keep the sizes separately
+	CoreDynamicArray<Chunk> m_chunks;
+	CoreDynamicArray<Patch> m_patches;
+	U32 m_chunkCount = 0;
+	U32 m_patchCount = 0;
+
+	Chunk& newChunk()
+	{
+		if(m_chunkCount == m_chunks.getSize())
+		{
+			m_chunks.resize(max(4u, m_chunkCount * 2));
+		}
+
+		return m_chunks[m_chunkCount++];
+	}
+
+	Patch& newPatch()
+	{
+		if(m_patchCount == m_patches.getSize())
+		{
+			m_patches.resize(max(64u, m_patchCount * 2));
+		}
+
+		return m_patches[m_patchCount++];
+	}
+};
+
 GpuSceneMicroPatcher::GpuSceneMicroPatcher()
+	: m_uuid(m_nextUuid.fetchAdd(1))
 {
 }
 
 GpuSceneMicroPatcher::~GpuSceneMicroPatcher()
 {
 	static_assert(sizeof(PatchHeader) == 8);
+
+	for(ThreadLocal* threadLocal : m_allThreadLocals)
+	{
+		deleteInstance(CoreMemoryPool::getSingleton(), threadLocal);
+	}
 }
 
 Error GpuSceneMicroPatcher::init()
@@ -154,87 +212,217 @@ Error GpuSceneMicroPatcher::init()
 	return Error::kNone;
 }
 
-void GpuSceneMicroPatcher::newCopy(StackMemoryPool& frameCpuPool, PtrSize gpuSceneDestOffset, PtrSize dataSize,
-								   const void* data)
+GpuSceneMicroPatcher::ThreadLocal& GpuSceneMicroPatcher::getThreadLocal()
+{
+	if(m_threadLocalPatcherUuid != m_uuid) [[unlikely]]
+	{
+		m_threadLocal = newInstance<ThreadLocal>(CoreMemoryPool::getSingleton());
+		m_threadLocalPatcherUuid = m_uuid;
+
+		LockGuard<Mutex> lock(m_allThreadLocalsMtx);
+		m_allThreadLocals.emplaceBack(m_threadLocal);
+	}
+
+	return *m_threadLocal;
+}
+
+void GpuSceneMicroPatcher::newCopy(PtrSize gpuSceneDestOffset, PtrSize dataSize, const void* data)
 {
 	ANKI_ASSERT(dataSize > 0 && (dataSize % 4) == 0);
 	ANKI_ASSERT((ptrToNumber(data) % 4) == 0);
 	ANKI_ASSERT((gpuSceneDestOffset % 4) == 0 && gpuSceneDestOffset / 4 < kMaxU32);
 
-	const U32 dataDwords = U32(dataSize / 4);
-	U32 gpuSceneDestDwordOffset = U32(gpuSceneDestOffset / 4);
+	ThreadLocal& threadLocal = getThreadLocal();
+	U32* const rebar = reinterpret_cast<U32*>(RebarStagingGpuMemoryPool::getSingleton().getBufferMappedAddress());
 
-	const U32* patchIt = static_cast<const U32*>(data);
-	const U32* const patchEnd = patchIt + dataDwords;
+	const U32* src = static_cast<const U32*>(data);
+	U32 dstDwordOffset = U32(gpuSceneDestOffset / 4);
+	U32 dwordsLeft = U32(dataSize / 4);
 
-	// Break the data into multiple copies
-	LockGuard lock(m_mtx);
-
-	if(m_crntFramePatchHeaders.getSize() == 0)
+	while(dwordsLeft)
 	{
-		m_crntFramePatchHeaders = DynamicArray<PatchHeader, MemoryPoolPtrWrapper<StackMemoryPool>>(&frameCpuPool);
-		m_crntFramePatchData = DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>>(&frameCpuPool);
+		// Try to extend or overwrite the previous patch of this thread. It's possible if the destination ranges overlap
+		// or are adjacent and the data of the previous patch are at the end of the last chunk
+		if(threadLocal.m_patchCount)
+		{
+			ThreadLocal::Patch& prev = threadLocal.m_patches[threadLocal.m_patchCount - 1];
+			ThreadLocal::Chunk& chunk = threadLocal.m_chunks[prev.m_chunk];
+
+			if(prev.m_chunk == threadLocal.m_chunkCount - 1
+			   && prev.m_rebarDwordOffset + prev.m_dwordCount == chunk.m_rebarDwordOffset + chunk.m_dwordCount
+			   && dstDwordOffset >= prev.m_dstDwordOffset
+			   && dstDwordOffset <= prev.m_dstDwordOffset + prev.m_dwordCount)
+			{
+				const U32 offsetInPatch = dstDwordOffset - prev.m_dstDwordOffset;
+				const U32 maxPatchDwords = min(kDwordsPerPatch, prev.m_dwordCount + kChunkDwords - chunk.m_dwordCount);
+				const U32 dwords = min(dwordsLeft, maxPatchDwords - offsetInPatch);
+
+				if(dwords)
+				{
+					memcpy(rebar + prev.m_rebarDwordOffset + offsetInPatch, src, dwords * 4);
+
+					const U32 newPatchDwords = max(prev.m_dwordCount, offsetInPatch + dwords);
+					chunk.m_dwordCount += newPatchDwords - prev.m_dwordCount;
+					prev.m_dwordCount = newPatchDwords;
+
+					src += dwords;
+					dstDwordOffset += dwords;
+					dwordsLeft -= dwords;
+					continue;
+				}
+			}
+		}
+
+		// New patch
+		const U32 patchDwords = min(kDwordsPerPatch, dwordsLeft);
+
+		if(threadLocal.m_chunkCount == 0
+		   || threadLocal.m_chunks[threadLocal.m_chunkCount - 1].m_dwordCount + patchDwords > kChunkDwords)
+		{
+			RebarGpuMemoryToken token;
+			RebarStagingGpuMemoryPool::getSingleton().allocateFrame(kChunkDwords * 4, token);
+
+			ThreadLocal::Chunk& chunk = threadLocal.newChunk();
+			chunk.m_rebarDwordOffset = U32(token.m_offset / 4);
+			chunk.m_dwordCount = 0;
+		}
+
+		ThreadLocal::Chunk& chunk = threadLocal.m_chunks[threadLocal.m_chunkCount - 1];
+
+		ThreadLocal::Patch& patch = threadLocal.newPatch();
+		patch.m_chunk = threadLocal.m_chunkCount - 1;
+		patch.m_rebarDwordOffset = chunk.m_rebarDwordOffset + chunk.m_dwordCount;
+		patch.m_dstDwordOffset = dstDwordOffset;
+		patch.m_dwordCount = patchDwords;
+
+		memcpy(rebar + patch.m_rebarDwordOffset, src, patchDwords * 4);
+		chunk.m_dwordCount += patchDwords;
+
+		src += patchDwords;
+		dstDwordOffset += patchDwords;
+		dwordsLeft -= patchDwords;
 	}
+}
 
-	while(patchIt < patchEnd)
+Bool GpuSceneMicroPatcher::patchingIsNeeded() const
+{
+	for(const ThreadLocal* threadLocal : m_allThreadLocals)
 	{
-		const U32 patchDwords = min(kDwordsPerPatch, U32(patchEnd - patchIt));
-
-		PatchHeader& header = *m_crntFramePatchHeaders.emplaceBack();
-		ANKI_ASSERT(((patchDwords - 1) & 0b111111) == (patchDwords - 1));
-		header.m_dwordCountAndSrcDwordOffsetPack = patchDwords - 1;
-		header.m_dwordCountAndSrcDwordOffsetPack <<= 26;
-		ANKI_ASSERT((m_crntFramePatchData.getSize() & 0x3FFFFFF) == m_crntFramePatchData.getSize());
-		header.m_dwordCountAndSrcDwordOffsetPack |= m_crntFramePatchData.getSize();
-		header.m_dstDwordOffset = gpuSceneDestDwordOffset;
-
-		const U32 srcOffset = m_crntFramePatchData.getSize();
-		m_crntFramePatchData.resize(srcOffset + patchDwords);
-		memcpy(&m_crntFramePatchData[srcOffset], patchIt, patchDwords * 4);
-
-		patchIt += patchDwords;
-		gpuSceneDestDwordOffset += patchDwords;
+		if(threadLocal->m_patchCount)
+		{
+			return true;
+		}
 	}
+
+	return false;
 }
 
 void GpuSceneMicroPatcher::patchGpuScene(CommandBuffer& cmdb)
 {
-	if(m_crntFramePatchHeaders.getSize() == 0)
+	// A dispatch binds a part of the ReBAR buffer as the source. Group the chunks of all threads into dispatches that
+	// fit in that part. Most of the time there will be a single dispatch, two if the ReBAR buffer wrapped around
+	class Dispatch
+	{
+	public:
+		U32 m_baseRebarDwordOffset;
+		U32 m_endRebarDwordOffset;
+		U32 m_patchCount = 0;
+		PatchHeader* m_headers = nullptr;
+		RebarGpuMemoryToken m_headersToken;
+	};
+
+	CoreDynamicArray<ThreadLocal::Chunk*> chunks;
+	for(ThreadLocal* threadLocal : m_allThreadLocals)
+	{
+		for(U32 i = 0; i < threadLocal->m_chunkCount; ++i)
+		{
+			chunks.emplaceBack(&threadLocal->m_chunks[i]);
+		}
+	}
+
+	if(chunks.getSize() == 0)
 	{
 		return;
 	}
 
-	ANKI_ASSERT(m_crntFramePatchData.getSize() > 0);
+	std::sort(chunks.getBegin(), chunks.getEnd(), [](const ThreadLocal::Chunk* a, const ThreadLocal::Chunk* b) {
+		return a->m_rebarDwordOffset < b->m_rebarDwordOffset;
+	});
 
-	ANKI_TRACE_INC_COUNTER(GpuSceneMicroPatches, m_crntFramePatchHeaders.getSize());
-	ANKI_TRACE_INC_COUNTER(GpuSceneMicroPatchUploadData, m_crntFramePatchData.getSizeInBytes());
+	CoreDynamicArray<Dispatch> dispatches;
+	U32 dataDwords = 0;
+	for(ThreadLocal::Chunk* chunk : chunks)
+	{
+		const U32 chunkEnd = chunk->m_rebarDwordOffset + chunk->m_dwordCount;
+		if(dispatches.getSize() == 0 || chunkEnd - dispatches.getBack().m_baseRebarDwordOffset > kMaxSrcBufferDwords)
+		{
+			Dispatch& dispatch = *dispatches.emplaceBack();
+			dispatch.m_baseRebarDwordOffset = chunk->m_rebarDwordOffset;
+		}
+
+		dispatches.getBack().m_endRebarDwordOffset = chunkEnd;
+		chunk->m_dispatch = dispatches.getSize() - 1;
+		dataDwords += chunk->m_dwordCount;
+	}
 
-	RebarGpuMemoryToken headersToken;
-	void* mapped =
-		RebarStagingGpuMemoryPool::getSingleton().allocateFrame(m_crntFramePatchHeaders.getSizeInBytes(), headersToken);
-	memcpy(mapped, &m_crntFramePatchHeaders[0], m_crntFramePatchHeaders.getSizeInBytes());
+	// Merge the headers of all threads
+	U32 patchCount = 0;
+	for(const ThreadLocal* threadLocal : m_allThreadLocals)
+	{
+		for(U32 i = 0; i < threadLocal->m_patchCount; ++i)
+		{
+			const ThreadLocal::Patch& patch = threadLocal->m_patches[i];
+			++dispatches[threadLocal->m_chunks[patch.m_chunk].m_dispatch].m_patchCount;
+		}
 
-	RebarGpuMemoryToken dataToken;
-	mapped = RebarStagingGpuMemoryPool::getSingleton().allocateFrame(m_crntFramePatchData.getSizeInBytes(), dataToken);
-	memcpy(mapped, &m_crntFramePatchData[0], m_crntFramePatchData.getSizeInBytes());
+		patchCount += threadLocal->m_patchCount;
+	}
 
-	cmdb.bindStorageBuffer(0, 0, RebarStagingGpuMemoryPool::getSingleton().getBuffer(), headersToken.m_offset,
-						   headersToken.m_range);
-	cmdb.bindStorageBuffer(0, 1, RebarStagingGpuMemoryPool::getSingleton().getBuffer(), dataToken.m_offset,
-						   dataToken.m_range);
-	cmdb.bindStorageBuffer(0, 2, GpuSceneMemoryPool::getSingleton().getBuffer(), 0, kMaxPtrSize);
+	for(Dispatch& dispatch : dispatches)
+	{
+		dispatch.m_headers = static_cast<PatchHeader*>(RebarStagingGpuMemoryPool::getSingleton().allocateFrame(
+			dispatch.m_patchCount * sizeof(PatchHeader), dispatch.m_headersToken));
+		dispatch.m_patchCount = 0;
+	}
+
+	for(ThreadLocal* threadLocal : m_allThreadLocals)
+	{
+		for(U32 i = 0; i < threadLocal->m_patchCount; ++i)
+		{
+			const ThreadLocal::Patch& patch = threadLocal->m_patches[i];
+			Dispatch& dispatch = dispatches[threadLocal->m_chunks[patch.m_chunk].m_dispatch];
+
+			const U32 srcDwordOffset = patch.m_rebarDwordOffset - dispatch.m_baseRebarDwordOffset;
+			ANKI_ASSERT((srcDwordOffset & 0x3FFFFFF) == srcDwordOffset);
+			ANKI_ASSERT(patch.m_dwordCount > 0 && patch.m_dwordCount <= kDwordsPerPatch);
+
+			PatchHeader header;
+			header.m_dwordCountAndSrcDwordOffsetPack = ((patch.m_dwordCount - 1) << 26) | srcDwordOffset;
+			header.m_dstDwordOffset = patch.m_dstDwordOffset;
+			dispatch.m_headers[dispatch.m_patchCount++] = header;
+		}
+
+		// Prepare for the next frame
+		threadLocal->m_patchCount = 0;
+		threadLocal->m_chunkCount = 0;
+	}
+
+	ANKI_TRACE_INC_COUNTER(GpuSceneMicroPatches, patchCount);
+	ANKI_TRACE_INC_COUNTER(GpuSceneMicroPatchUploadData, dataDwords * 4);
 
+	cmdb.bindStorageBuffer(0, 2, GpuSceneMemoryPool::getSingleton().getBuffer(), 0, kMaxPtrSize);
 	cmdb.bindShaderProgram(m_grProgram);
 
-	const U32 workgroupCountX = m_crntFramePatchHeaders.getSize();
-	cmdb.dispatchCompute(workgroupCountX, 1, 1);
+	for(const Dispatch& dispatch : dispatches)
+	{
+		cmdb.bindStorageBuffer(0, 0, RebarStagingGpuMemoryPool::getSingleton().getBuffer(),
+							   dispatch.m_headersToken.m_offset, dispatch.m_headersToken.m_range);
+		cmdb.bindStorageBuffer(0, 1, RebarStagingGpuMemoryPool::getSingleton().getBuffer(),
+							   PtrSize(dispatch.m_baseRebarDwordOffset) * 4,
+							   PtrSize(dispatch.m_endRebarDwordOffset - dispatch.m_baseRebarDwordOffset) * 4);
 
-	// Cleanup to prepare for the new frame
-	U32* data;
-	U32 size, storage;
-	m_crntFramePatchData.moveAndReset(data, size, storage);
-	PatchHeader* datah;
-	m_crntFramePatchHeaders.moveAndReset(datah, size, storage);
+		cmdb.dispatchCompute(dispatch.m_patchCount, 1, 1);
+	}
 }
 
 } // end namespace anki
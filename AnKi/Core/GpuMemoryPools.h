@@ -195,15 +195,12 @@ public:
 	Error init();
 
 	/// Copy data for the GPU scene to a staging buffer.
-	/// @note It's thread-safe.
-	void newCopy(StackMemoryPool& frameCpuPool, PtrSize gpuSceneDestOffset, PtrSize dataSize, const void* data);
+	/// @note It's thread-safe and lock-free. Every thread records to its own part of the ReBAR memory.
+	void newCopy(PtrSize gpuSceneDestOffset, PtrSize dataSize, const void* data);
 
 	/// Check if there is a need to call patchGpuScene or if no copies are needed.
 	/// @note Not thread-safe. Nothing else should be happening before calling it.
-	Bool patchingIsNeeded() const
-	{
-		return m_crntFramePatchHeaders.getSize() > 0;
-	}
+	Bool patchingIsNeeded() const;
 
 	/// Copy the data to the GPU scene buffer.
 	/// @note Not thread-safe. Nothing else should be happening before calling it.
@@ -211,16 +208,25 @@ public:
 
 private:
 	static constexpr U32 kDwordsPerPatch = 64;
+	static constexpr U32 kChunkDwords = 4 * 1024; ///< Threads allocate ReBAR memory in chunks of that size.
+	static constexpr U32 kMaxSrcBufferDwords = 1u << 25; ///< Max range of the source buffer of a single dispatch.
 
 	class PatchHeader;
+	class ThreadLocal;
 
-	DynamicArray<PatchHeader, MemoryPoolPtrWrapper<StackMemoryPool>> m_crntFramePatchHeaders;
-	DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>> m_crntFramePatchData;
-	Mutex m_mtx;
+	static thread_local ThreadLocal* m_threadLocal;
+	static thread_local U64 m_threadLocalPatcherUuid; ///< Guards against a m_threadLocal of a destroyed patcher.
+	static inline Atomic<U64> m_nextUuid = {1};
+
+	U64 m_uuid = 0;
+	CoreDynamicArray<ThreadLocal*> m_allThreadLocals;
+	Mutex m_allThreadLocalsMtx;
 
 	ShaderProgramResourcePtr m_copyProgram;
 	ShaderProgramPtr m_grProgram;
 
+	ThreadLocal& getThreadLocal();
+
 	GpuSceneMicroPatcher();
 
 	~GpuSceneMicroPatcher();
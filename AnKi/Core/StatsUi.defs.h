@@ -32,6 +32,13 @@ ANKI_STATS_UI_VALUE(PtrSize, gpuSceneTotal, "GPU scene total", ValueFlag::kNone
 ANKI_STATS_UI_VALUE(F32, gpuSceneExternalFragmentation, "GPU scene ext fragmentation", ValueFlag::kNone)
 ANKI_STATS_UI_VALUE(PtrSize, reBar, "ReBAR", ValueFlag::kBytes)
 
+ANKI_STATS_UI_BEGIN_GROUP("Loaded resources")
+ANKI_STATS_UI_VALUE(U32, loadedImageCount, "Images", ValueFlag::kNone)
+ANKI_STATS_UI_VALUE(U32, loadedMeshCount, "Meshes", ValueFlag::kNone)
+ANKI_STATS_UI_VALUE(U32, loadedMaterialCount, "Materials", ValueFlag::kNone)
+ANKI_STATS_UI_VALUE(U32, loadedModelCount, "Models", ValueFlag::kNone)
+ANKI_STATS_UI_VALUE(U32, loadedShaderProgramCount, "Shader programs", ValueFlag::kNone)
+
 ANKI_STATS_UI_BEGIN_GROUP("Other")
 ANKI_STATS_UI_VALUE(U32, drawableCount, "Render queue drawbles", ValueFlag::kNone)
 ANKI_STATS_UI_VALUE(U32, vkCommandBufferCount, "VK command buffers", ValueFlag::kNone)
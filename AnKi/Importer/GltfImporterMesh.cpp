@@ -246,6 +246,203 @@ static void decimateSubmesh(F32 factor, SubMesh& submesh, BaseMemoryPool* pool)
 	submesh.m_verts = std::move(newVerts);
 }
 
+/// Get the point of the triangle that is closest to p.
+static Vec3 closestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+{
+	// Check if p is in a vertex region
+	const Vec3 ab = b - a;
+	const Vec3 ac = c - a;
+	const Vec3 ap = p - a;
+	const F32 d1 = ab.dot(ap);
+	const F32 d2 = ac.dot(ap);
+	if(d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return a;
+	}
+
+	const Vec3 bp = p - b;
+	const F32 d3 = ab.dot(bp);
+	const F32 d4 = ac.dot(bp);
+	if(d3 >= 0.0f && d4 <= d3)
+	{
+		return b;
+	}
+
+	const Vec3 cp = p - c;
+	const F32 d5 = ab.dot(cp);
+	const F32 d6 = ac.dot(cp);
+	if(d6 >= 0.0f && d5 <= d6)
+	{
+		return c;
+	}
+
+	// Check if p is in an edge region
+	const F32 vc = d1 * d4 - d3 * d2;
+	if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	const F32 vb = d5 * d2 - d1 * d6;
+	if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	const F32 va = d3 * d6 - d5 * d4;
+	if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	// Inside the face
+	const F32 denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+/// Compute how far the surface of the simplified mesh goes from the original surface. The vertices of the simplified
+/// mesh are vertices of the original so test the centers and the edge midpoints of the simplified triangles.
+static F32 computeSimplificationError(ConstWeakArray<Vec3> positions, ConstWeakArray<U32> indices,
+									  ConstWeakArray<U32> simplifiedIndices, BaseMemoryPool* pool)
+{
+	// Compute the AABBs of the original triangles to skip the far ones
+	ImporterDynamicArray<std::pair<Vec3, Vec3>> aabbs(pool);
+	aabbs.resize(indices.getSize() / 3);
+	for(U32 t = 0; t < aabbs.getSize(); ++t)
+	{
+		const Vec3& a = positions[indices[t * 3 + 0]];
+		const Vec3& b = positions[indices[t * 3 + 1]];
+		const Vec3& c = positions[indices[t * 3 + 2]];
+		aabbs[t] = {a.min(b).min(c), a.max(b).max(c)};
+	}
+
+	F32 maxDistSquared = 0.0f;
+	for(U32 t = 0; t < simplifiedIndices.getSize(); t += 3)
+	{
+		const Vec3& a = positions[simplifiedIndices[t + 0]];
+		const Vec3& b = positions[simplifiedIndices[t + 1]];
+		const Vec3& c = positions[simplifiedIndices[t + 2]];
+		const Array<Vec3, 4> samples = {(a + b + c) / 3.0f, (a + b) / 2.0f, (b + c) / 2.0f, (c + a) / 2.0f};
+
+		for(const Vec3& sample : samples)
+		{
+			F32 minDistSquared = kMaxF32;
+			for(U32 o = 0; o < aabbs.getSize(); ++o)
+			{
+				const Vec3 delta = (aabbs[o].first - sample).max(sample - aabbs[o].second).max(Vec3(0.0f));
+				if(delta.dot(delta) >= minDistSquared)
+				{
+					continue;
+				}
+
+				const Vec3 closest =
+					closestPointOnTriangle(sample, positions[indices[o * 3 + 0]], positions[indices[o * 3 + 1]],
+										   positions[indices[o * 3 + 2]]);
+				minDistSquared = min(minDistSquared, (closest - sample).dot(closest - sample));
+			}
+
+			maxDistSquared = max(maxDistSquared, minDistSquared);
+		}
+	}
+
+	return sqrt(maxDistSquared);
+}
+
+/// Merge all submeshes into a single position-only mesh and simplify it aggressively. The result is used as an occluder
+/// in CPU occlusion culling. An occluder that sticks out of the real surface hides objects that are visible so the
+/// simplification error is kept small.
+static void generateOccluder(const ImporterList<SubMesh>& submeshes, ImporterDynamicArray<U16>& outIndices,
+							 ImporterDynamicArray<Vec3>& outPositions, BaseMemoryPool* pool)
+{
+	constexpr U32 kMaxOccluderTriangleCount = 256;
+	constexpr F32 kOccluderTriangleFactor = 0.1f;
+	constexpr F32 kMaxOccluderError = 5e-3f; ///< Relative to the size of the mesh.
+
+	outIndices.destroy();
+	outPositions.destroy();
+
+	// Merge the submeshes
+	ImporterDynamicArray<Vec3> positions(pool);
+	ImporterDynamicArray<U32> indices(pool);
+	for(const SubMesh& submesh : submeshes)
+	{
+		const U32 firstVertex = positions.getSize();
+		for(const TempVertex& vert : submesh.m_verts)
+		{
+			positions.emplaceBack(vert.m_position);
+		}
+
+		for(U32 idx : submesh.m_indices)
+		{
+			indices.emplaceBack(idx + firstVertex);
+		}
+	}
+
+	// Weld the positions. Other attributes don't matter and seams would stop the simplification
+	ImporterDynamicArray<U32> remap(pool);
+	remap.resize(positions.getSize());
+	const U32 uniqueVertCount = U32(meshopt_generateVertexRemap(&remap[0], &indices[0], indices.getSize(),
+																 &positions[0], positions.getSize(), sizeof(Vec3)));
+
+	ImporterDynamicArray<Vec3> weldedPositions(pool);
+	weldedPositions.resize(uniqueVertCount);
+	meshopt_remapVertexBuffer(&weldedPositions[0], &positions[0], positions.getSize(), sizeof(Vec3), &remap[0]);
+	meshopt_remapIndexBuffer(&indices[0], &indices[0], indices.getSize(), &remap[0]);
+
+	// Simplify
+	const U32 triangleCount = indices.getSize() / 3;
+	const PtrSize targetIndexCount =
+		PtrSize(min(kMaxOccluderTriangleCount, max(1u, U32(F32(triangleCount) * kOccluderTriangleFactor)))) * 3;
+
+	ImporterDynamicArray<U32> newIndices(pool);
+	newIndices.resize(indices.getSize());
+	newIndices.resize(U32(meshopt_simplify(&newIndices[0], &indices[0], indices.getSize(), &weldedPositions[0].x(),
+										   weldedPositions.getSize(), sizeof(Vec3), targetIndexCount,
+										   kMaxOccluderError)));
+
+	// Don't bother if it didn't simplify enough. It will cost more than it will save
+	if(newIndices.getSize() == 0 || newIndices.getSize() / 3 > kMaxOccluderTriangleCount * 2)
+	{
+		return;
+	}
+
+	// The error of the simplifier is approximate. Measure the real one and drop the occluder if it's too big
+	Vec3 aabbMin(kMaxF32);
+	Vec3 aabbMax(kMinF32);
+	for(const Vec3& pos : weldedPositions)
+	{
+		aabbMin = aabbMin.min(pos);
+		aabbMax = aabbMax.max(pos);
+	}
+
+	const Vec3 extent = aabbMax - aabbMin;
+	const F32 maxError = kMaxOccluderError * max(extent.x(), max(extent.y(), extent.z()));
+	if(computeSimplificationError(weldedPositions, indices, newIndices, pool) > maxError)
+	{
+		return;
+	}
+
+	// Re-pack
+	ImporterHashMap<U32, U32> vertexStored(pool);
+	for(U32 idx : newIndices)
+	{
+		U32 newIdx;
+		auto it = vertexStored.find(idx);
+		if(it == vertexStored.getEnd())
+		{
+			outPositions.emplaceBack(weldedPositions[idx]);
+			newIdx = outPositions.getSize() - 1;
+			vertexStored.emplace(idx, newIdx);
+		}
+		else
+		{
+			newIdx = *it;
+		}
+
+		outIndices.emplaceBack(U16(newIdx));
+	}
+}
+
 /// If normal A and normal B have the same position then try to merge them. Do that before optimizations.
 static void fixNormals(const F32 normalsMergeAngle, SubMesh& submesh)
 {
@@ -652,6 +849,29 @@ Error GltfImporter::writeMesh(const cgltf_mesh& mesh) const
 	{
 		header.m_flags |= MeshBinaryFlag::kConvex;
 	}
+
+	// Skinned meshes can't be occluders because their positions change. The occluder covers all the primitives so one
+	// transparent or alpha tested material is enough to skip it. The materials with alpha in their textures are
+	// checked when the model is loaded
+	Bool opaque = true;
+	for(const cgltf_primitive* primitive = mesh.primitives; primitive < mesh.primitives + mesh.primitives_count;
+		++primitive)
+	{
+		const cgltf_material* mtl = primitive->material;
+		opaque = opaque && (!mtl || (mtl->alpha_mode == cgltf_alpha_mode_opaque && !mtl->has_transmission));
+	}
+
+	ImporterDynamicArray<U16> occluderIndices(m_pool);
+	ImporterDynamicArray<Vec3> occluderPositions(m_pool);
+	if(!hasBoneWeights && opaque)
+	{
+		generateOccluder(submeshes[0], occluderIndices, occluderPositions, m_pool);
+		if(occluderIndices.getSize())
+		{
+			header.m_flags |= MeshBinaryFlag::kOccluder;
+		}
+	}
+
 	header.m_indexType = IndexType::kU16;
 	header.m_subMeshCount = U32(submeshes[0].getSize());
 	header.m_aabbMin = aabbMin;
@@ -819,6 +1039,18 @@ Error GltfImporter::writeMesh(const cgltf_mesh& mesh) const
 		}
 	}
 
+	// Write the occluder
+	if(!!(header.m_flags & MeshBinaryFlag::kOccluder))
+	{
+		MeshBinaryOccluder occluder;
+		occluder.m_indexCount = occluderIndices.getSize();
+		occluder.m_vertexCount = occluderPositions.getSize();
+
+		ANKI_CHECK(file.write(&occluder, sizeof(occluder)));
+		ANKI_CHECK(file.write(&occluderIndices[0], occluderIndices.getSizeInBytes()));
+		ANKI_CHECK(file.write(&occluderPositions[0], occluderPositions.getSizeInBytes()));
+	}
+
 	return Error::kNone;
 }
 
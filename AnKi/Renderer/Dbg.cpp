@@ -104,8 +104,10 @@ void Dbg::run(RenderPassWorkContext& rgraphCtx, const RenderingContext& ctx)
 	// Forward shaded renderables
 	if(threadId == 0)
 	{
-		for(const RenderableQueueElement& el : ctx.m_renderQueue->m_forwardShadingRenderables)
+		const RenderableQueueElementArray& forwardShadingRenderables = ctx.m_renderQueue->m_forwardShadingRenderables;
+		for(U32 i = 0; i < forwardShadingRenderables.getSize(); ++i)
 		{
+			const RenderableQueueElement& el = forwardShadingRenderables[i];
 			const Vec3 tsl = (el.m_aabbMin + el.m_aabbMax) / 2.0f;
 			constexpr F32 kMargin = 0.1f;
 			const Vec3 scale = (el.m_aabbMax - el.m_aabbMin + kMargin) / 2.0f;
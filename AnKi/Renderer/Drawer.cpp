@@ -29,11 +29,8 @@ RenderableDrawer::~RenderableDrawer()
 {
 }
 
-void RenderableDrawer::drawRange(const RenderableDrawerArguments& args, const RenderableQueueElement* begin,
-								 const RenderableQueueElement* end, CommandBufferPtr& cmdb)
+void RenderableDrawer::setupGlobals(const RenderableDrawerArguments& args, CommandBufferPtr& cmdb)
 {
-	ANKI_ASSERT(begin && end && begin < end);
-
 	// Allocate, set and bind global uniforms
 	{
 		RebarGpuMemoryToken globalUniformsToken;
@@ -68,15 +65,20 @@ void RenderableDrawer::drawRange(const RenderableDrawerArguments& args, const Re
 	// Misc
 	cmdb->setVertexAttribute(0, 0, Format::kR32G32B32A32_Uint, 0);
 	cmdb->bindIndexBuffer(UnifiedGeometryMemoryPool::getSingleton().getBuffer(), 0, IndexType::kU16);
+}
+
+void RenderableDrawer::drawRange(const RenderableDrawerArguments& args, const RenderableQueueElementArray& renderables,
+								 U32 begin, U32 end, CommandBufferPtr& cmdb)
+{
+	setupGlobals(args, cmdb);
 
 	// Set a few things
 	Context ctx;
 	ctx.m_commandBuffer = cmdb;
 
-	for(; begin != end; ++begin)
-	{
-		drawSingle(begin, ctx);
-	}
+	iterateRange(renderables, begin, end, [&](const RenderableQueueElement& el) {
+		drawSingle(&el, ctx);
+	});
 
 	// Flush the last drawcall
 	flushDrawcall(ctx);
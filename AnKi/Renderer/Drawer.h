@@ -6,6 +6,7 @@
 #pragma once
 
 #include <AnKi/Renderer/Common.h>
+#include <AnKi/Renderer/RenderQueue.h>
 #include <AnKi/Resource/RenderingKey.h>
 #include <AnKi/Gr.h>
 
@@ -13,7 +14,6 @@ namespace anki {
 
 // Forward
 class Renderer;
-class RenderableQueueElement;
 
 /// @addtogroup renderer
 /// @{
@@ -41,12 +41,30 @@ public:
 
 	~RenderableDrawer();
 
-	void drawRange(const RenderableDrawerArguments& args, const RenderableQueueElement* begin,
-				   const RenderableQueueElement* end, CommandBufferPtr& cmdb);
+	/// Draw a range of renderables.
+	/// @param renderables All the renderables of a RenderQueue array.
+	/// @param begin The first renderable (in draw order) to draw.
+	/// @param end One past the last renderable to draw.
+	void drawRange(const RenderableDrawerArguments& args, const RenderableQueueElementArray& renderables, U32 begin,
+				   U32 end, CommandBufferPtr& cmdb);
+
+	/// Visit the renderables the same way drawRange() does. The arguments are the same as in drawRange().
+	/// @param func A functor with signature void(const RenderableQueueElement&).
+	template<typename TFunc>
+	static void iterateRange(const RenderableQueueElementArray& renderables, U32 begin, U32 end, TFunc func)
+	{
+		ANKI_ASSERT(begin < end && end <= renderables.getSize());
+		for(U32 i = begin; i < end; ++i)
+		{
+			func(renderables[i]);
+		}
+	}
 
 private:
 	class Context;
 
+	void setupGlobals(const RenderableDrawerArguments& args, CommandBufferPtr& cmdb);
+
 	void flushDrawcall(Context& ctx);
 
 	void drawSingle(const RenderableQueueElement* renderEl, Context& ctx);
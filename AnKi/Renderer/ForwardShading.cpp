@@ -62,9 +62,8 @@ void ForwardShading::run(const RenderingContext& ctx, RenderPassWorkContext& rgr
 		args.m_sampler = getRenderer().getSamplers().m_trilinearRepeatAnisoResolutionScalingBias;
 
 		// Start drawing
-		getRenderer().getSceneDrawer().drawRange(args,
-												 ctx.m_renderQueue->m_forwardShadingRenderables.getBegin() + start,
-												 ctx.m_renderQueue->m_forwardShadingRenderables.getBegin() + end, cmdb);
+		getRenderer().getSceneDrawer().drawRange(args, ctx.m_renderQueue->m_forwardShadingRenderables, start, end,
+												 cmdb);
 
 		// Restore state
 		cmdb->setDepthWrite(true);
@@ -140,8 +140,8 @@ void GBuffer::runInThread(const RenderingContext& ctx, RenderPassWorkContext& rg
 		}
 
 		ANKI_ASSERT(earlyZStart < earlyZEnd && earlyZEnd <= I32(earlyZCount));
-		getRenderer().getSceneDrawer().drawRange(args, ctx.m_renderQueue->m_earlyZRenderables.getBegin() + earlyZStart,
-												 ctx.m_renderQueue->m_earlyZRenderables.getBegin() + earlyZEnd, cmdb);
+		getRenderer().getSceneDrawer().drawRange(args, ctx.m_renderQueue->m_earlyZRenderables, U32(earlyZStart),
+												 U32(earlyZEnd), cmdb);
 
 		// Restore state for the color write
 		if(colorStart < colorEnd)
@@ -159,8 +159,8 @@ void GBuffer::runInThread(const RenderingContext& ctx, RenderPassWorkContext& rg
 		cmdb->setDepthCompareOperation(CompareOperation::kLessEqual);
 
 		ANKI_ASSERT(colorStart < colorEnd && colorEnd <= I32(ctx.m_renderQueue->m_renderables.getSize()));
-		getRenderer().getSceneDrawer().drawRange(args, ctx.m_renderQueue->m_renderables.getBegin() + colorStart,
-												 ctx.m_renderQueue->m_renderables.getBegin() + colorEnd, cmdb);
+		getRenderer().getSceneDrawer().drawRange(args, ctx.m_renderQueue->m_renderables, U32(colorStart),
+												 U32(colorEnd), cmdb);
 	}
 }
 
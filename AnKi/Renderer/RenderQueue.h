@@ -81,6 +81,40 @@ public:
 };
 static_assert(std::is_trivially_destructible<RenderableQueueElement>::value == true);
 
+/// The renderables of a RenderQueue in draw order. The visibility threads gather the renderables in a few arrays (runs)
+/// and they stay there, they are never concatenated. Combining and sorting only touch a small array of indices that
+/// pack the run and the element of the run.
+class RenderableQueueElementArray
+{
+public:
+	static constexpr U32 kRunBits = 6;
+	static constexpr U32 kMaxRunCount = 1u << kRunBits;
+	static constexpr U32 kElementBits = 32 - kRunBits;
+	static constexpr U32 kElementMask = (1u << kElementBits) - 1;
+
+	WeakArray<const RenderableQueueElement*> m_runs; ///< The first element of each run.
+	WeakArray<U32> m_order; ///< The draw order. See packIndex().
+
+	static U32 packIndex(U32 run, U32 element)
+	{
+		ANKI_ASSERT(run < kMaxRunCount && element <= kElementMask);
+		return (run << kElementBits) | element;
+	}
+
+	/// Get the i-th renderable in draw order.
+	const RenderableQueueElement& operator[](U32 i) const
+	{
+		const U32 idx = m_order[i];
+		return m_runs[idx >> kElementBits][idx & kElementMask];
+	}
+
+	U32 getSize() const
+	{
+		return m_order.getSize();
+	}
+};
+static_assert(std::is_trivially_destructible<RenderableQueueElementArray>::value == true);
+
 /// Context that contains variables for the GenericGpuComputeJobQueueElement.
 class GenericGpuComputeJobQueueElementContext final : public RenderingMatrices
 {
@@ -387,9 +421,10 @@ static_assert(std::is_trivially_destructible<SkyboxQueueElement>::value == true)
 class RenderQueue : public RenderingMatrices
 {
 public:
-	WeakArray<RenderableQueueElement> m_renderables; ///< Deferred shading or shadow renderables.
-	WeakArray<RenderableQueueElement> m_earlyZRenderables; ///< Some renderables that will be used for Early Z pass.
-	WeakArray<RenderableQueueElement> m_forwardShadingRenderables;
+	RenderableQueueElementArray m_renderables; ///< Deferred shading or shadow renderables.
+	RenderableQueueElementArray m_earlyZRenderables; ///< Some renderables that will be used for Early Z pass.
+	RenderableQueueElementArray m_forwardShadingRenderables;
+
 	WeakArray<PointLightQueueElement> m_pointLights; ///< Those who cast shadows are first.
 	WeakArray<SpotLightQueueElement> m_spotLights; ///< Those who cast shadows are first.
 	DirectionalLightQueueElement m_directionalLight;
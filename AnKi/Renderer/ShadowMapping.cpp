@@ -613,11 +613,8 @@ void ShadowMapping::runShadowMapping(RenderPassWorkContext& rgraphCtx)
 		args.m_previousViewProjectionMatrix = Mat4::getIdentity(); // Don't care
 		args.m_sampler = getRenderer().getSamplers().m_trilinearRepeatAniso;
 
-		getRenderer().getSceneDrawer().drawRange(
-			args, work.m_renderQueue->m_renderables.getBegin() + work.m_firstRenderableElement,
-			work.m_renderQueue->m_renderables.getBegin() + work.m_firstRenderableElement
-				+ work.m_renderableElementCount,
-			cmdb);
+		getRenderer().getSceneDrawer().drawRange(args, work.m_renderQueue->m_renderables, work.m_firstRenderableElement,
+												 work.m_firstRenderableElement + work.m_renderableElementCount, cmdb);
 	}
 }
 
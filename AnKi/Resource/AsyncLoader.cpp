@@ -6,30 +6,78 @@
 #include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/Util/Logger.h>
 #include <AnKi/Util/Tracer.h>
+#include <AnKi/Util/HighRezTimer.h>
 
 namespace anki {
 
-AsyncLoader::AsyncLoader()
-	: m_thread("AsyncLoad")
+#if ANKI_EXTRA_CHECKS
+static thread_local Bool g_insideAsyncLoaderThread = false;
+#endif
+
+/// A thread of the AsyncLoader.
+class AsyncLoader::Worker
+{
+public:
+	Thread m_thread;
+	AsyncLoader* m_loader;
+	AsyncLoaderTaskType m_type;
+	AsyncLoaderTaskId m_runningTaskId = 0; ///< Protected by AsyncLoader::m_mtx.
+
+	Worker(AsyncLoader* loader, AsyncLoaderTaskType type)
+		: m_thread((type == AsyncLoaderTaskType::kIo) ? "AsyncLoadIo" : "AsyncLoadCpu")
+		, m_loader(loader)
+		, m_type(type)
+	{
+	}
+};
+
+AsyncLoader::AsyncLoader(U32 ioThreadCount, U32 cpuThreadCount)
 {
-	m_thread.start(this, threadCallback);
+	ANKI_ASSERT(ioThreadCount > 0 && cpuThreadCount > 0);
+
+	m_workerCount = ioThreadCount + cpuThreadCount;
+	m_barrier = newInstance<Barrier>(ResourceMemoryPool::getSingleton(), m_workerCount + 1);
+
+	m_workers = static_cast<Worker*>(
+		ResourceMemoryPool::getSingleton().allocate(sizeof(Worker) * m_workerCount, alignof(Worker)));
+	for(U32 i = 0; i < m_workerCount; ++i)
+	{
+		::new(&m_workers[i]) Worker(this, (i < ioThreadCount) ? AsyncLoaderTaskType::kIo : AsyncLoaderTaskType::kCpu);
+		m_workers[i].m_thread.start(&m_workers[i], threadCallback);
+	}
 }
 
 AsyncLoader::~AsyncLoader()
 {
 	stop();
 
-	if(!m_taskQueue.isEmpty())
+	Bool warned = false;
+	for(AsyncLoaderTaskType type : EnumIterable<AsyncLoaderTaskType>())
 	{
-		ANKI_RESOURCE_LOGW("Stoping loading thread while there is work to do");
-
-		while(!m_taskQueue.isEmpty())
+		for(AsyncLoaderTaskPriority priority : EnumIterable<AsyncLoaderTaskPriority>())
 		{
-			AsyncLoaderTask* task = &m_taskQueue.getFront();
-			m_taskQueue.popFront();
-			deleteInstance(ResourceMemoryPool::getSingleton(), task);
+			IntrusiveList<AsyncLoaderTask>& queue = m_taskQueues[type][priority];
+			if(!queue.isEmpty() && !warned)
+			{
+				ANKI_RESOURCE_LOGW("Stoping loading threads while there is work to do");
+				warned = true;
+			}
+
+			while(!queue.isEmpty())
+			{
+				AsyncLoaderTask* task = queue.popFront();
+				deleteInstance(ResourceMemoryPool::getSingleton(), task);
+			}
 		}
 	}
+
+	for(U32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workers[i].~Worker();
+	}
+	ResourceMemoryPool::getSingleton().free(m_workers);
+
+	deleteInstance(ResourceMemoryPool::getSingleton(), m_barrier);
 }
 
 void AsyncLoader::stop()
@@ -37,10 +85,16 @@ void AsyncLoader::stop()
 	{
 		LockGuard<Mutex> lock(m_mtx);
 		m_quit = true;
-		m_condVar.notifyOne();
+		for(ConditionVariable& condVar : m_condVars)
+		{
+			condVar.notifyAll();
+		}
 	}
 
-	[[maybe_unused]] Error err = m_thread.join();
+	for(U32 i = 0; i < m_workerCount; ++i)
+	{
+		[[maybe_unused]] Error err = m_workers[i].m_thread.join();
+	}
 }
 
 void AsyncLoader::pause()
@@ -48,29 +102,86 @@ void AsyncLoader::pause()
 	{
 		LockGuard<Mutex> lock(m_mtx);
 		m_paused = true;
-		m_sync = true;
-		m_condVar.notifyOne();
+		m_syncCount = m_workerCount;
+		for(ConditionVariable& condVar : m_condVars)
+		{
+			condVar.notifyAll();
+		}
 	}
 
-	m_barrier.wait();
+	m_barrier->wait();
 }
 
 void AsyncLoader::resume()
 {
 	LockGuard<Mutex> lock(m_mtx);
 	m_paused = false;
-	m_condVar.notifyOne();
+	for(ConditionVariable& condVar : m_condVars)
+	{
+		condVar.notifyAll();
+	}
 }
 
 Error AsyncLoader::threadCallback(ThreadCallbackInfo& info)
 {
-	AsyncLoader& self = *reinterpret_cast<AsyncLoader*>(info.m_userData);
-	return self.threadWorker();
+	Worker& worker = *static_cast<Worker*>(info.m_userData);
+#if ANKI_EXTRA_CHECKS
+	g_insideAsyncLoaderThread = true;
+#endif
+	return worker.m_loader->threadWorker(worker);
+}
+
+AsyncLoaderTask* AsyncLoader::popTask(AsyncLoaderTaskType type)
+{
+	// Iterate from the highest priority to the lowest
+	for(U32 i = U32(AsyncLoaderTaskPriority::kCount); i > 0; --i)
+	{
+		IntrusiveList<AsyncLoaderTask>& queue = m_taskQueues[type][i - 1];
+		if(!queue.isEmpty())
+		{
+			m_queuedTaskCounts[type].fetchSub(1);
+			return queue.popFront();
+		}
+	}
+
+	return nullptr;
+}
+
+void AsyncLoader::pushTask(AsyncLoaderTask* task)
+{
+	m_taskQueues[task->m_type][task->m_priority].pushBack(task);
+	m_queuedTaskCounts[task->m_type].fetchAdd(1);
+
+	if(!m_paused)
+	{
+		// Wake up a thread if it's not paused
+		m_condVars[task->m_type].notifyOne();
+	}
+}
+
+AsyncLoaderTask* AsyncLoader::findQueuedTask(AsyncLoaderTaskId taskId)
+{
+	for(AsyncLoaderTaskType type : EnumIterable<AsyncLoaderTaskType>())
+	{
+		for(AsyncLoaderTaskPriority priority : EnumIterable<AsyncLoaderTaskPriority>())
+		{
+			for(AsyncLoaderTask& task : m_taskQueues[type][priority])
+			{
+				if(task.m_id == taskId)
+				{
+					return &task;
+				}
+			}
+		}
+	}
+
+	return nullptr;
 }
 
-Error AsyncLoader::threadWorker()
+Error AsyncLoader::threadWorker(Worker& worker)
 {
 	Error err = Error::kNone;
+	const AsyncLoaderTaskType type = worker.m_type;
 
 	while(!err)
 	{
@@ -81,9 +192,9 @@ Error AsyncLoader::threadWorker()
 		{
 			// Wait for something
 			LockGuard<Mutex> lock(m_mtx);
-			while((m_taskQueue.isEmpty() || m_paused) && !m_quit && !m_sync)
+			while((m_queuedTaskCounts[type].load() == 0 || m_paused) && !m_quit && m_syncCount == 0)
 			{
-				m_condVar.wait(m_mtx);
+				m_condVars[type].wait(m_mtx);
 			}
 
 			// Do some work
@@ -91,15 +202,16 @@ Error AsyncLoader::threadWorker()
 			{
 				quit = true;
 			}
-			else if(m_sync)
+			else if(m_syncCount > 0)
 			{
+				// Every worker takes one sync. The ones that synced will not take more because the loader is paused
 				sync = true;
-				m_sync = false;
+				--m_syncCount;
 			}
 			else
 			{
-				task = &m_taskQueue.getFront();
-				m_taskQueue.popFront();
+				task = popTask(type);
+				worker.m_runningTaskId = task->m_id;
 			}
 		}
 
@@ -109,7 +221,7 @@ Error AsyncLoader::threadWorker()
 		}
 		else if(sync)
 		{
-			m_barrier.wait();
+			m_barrier->wait();
 		}
 		else
 		{
@@ -125,27 +237,36 @@ Error AsyncLoader::threadWorker()
 			if(!err)
 			{
 				m_completedTaskCount.fetchAdd(1);
+
+				const U64 latencyUs = U64((HighRezTimer::getCurrentTime() - task->m_submitTime) * 1000000.0);
+				m_totalTaskLatencyUs.fetchAdd(latencyUs);
+				ANKI_TRACE_INC_COUNTER(RsrcAsyncTaskLatencyUs, latencyUs);
 			}
 			else
 			{
 				ANKI_RESOURCE_LOGE("Async loader task failed");
 			}
 
-			// Do other stuff
-			if(ctx.m_resubmitTask)
+			// Delete the task outside the lock. Its destructor might release resources that call back into the loader
+			if(!ctx.m_resubmitTask)
 			{
-				LockGuard<Mutex> lock(m_mtx);
-				m_taskQueue.pushBack(task);
+				deleteInstance(ResourceMemoryPool::getSingleton(), task);
+				task = nullptr;
 			}
-			else
+
+			// Do other stuff
+			LockGuard<Mutex> lock(m_mtx);
+
+			worker.m_runningTaskId = 0;
+			m_taskDoneCondVar.notifyAll();
+
+			if(task)
 			{
-				// Delete the task
-				deleteInstance(ResourceMemoryPool::getSingleton(), task);
+				pushTask(task);
 			}
 
 			if(ctx.m_pause)
 			{
-				LockGuard<Mutex> lock(m_mtx);
 				m_paused = true;
 			}
 		}
@@ -154,19 +275,80 @@ Error AsyncLoader::threadWorker()
 	return err;
 }
 
-void AsyncLoader::submitTask(AsyncLoaderTask* task)
+AsyncLoaderTaskId AsyncLoader::submitTask(AsyncLoaderTask* task, AsyncLoaderTaskPriority priority,
+										  AsyncLoaderTaskType type)
 {
-	ANKI_ASSERT(task);
+	ANKI_ASSERT(task && task->m_id == 0 && "Can't submit a task twice");
+	task->m_priority = priority;
+	task->m_type = type;
+	task->m_submitTime = HighRezTimer::getCurrentTime();
 
-	// Append task to the list
+	// Append task to the queue
 	LockGuard<Mutex> lock(m_mtx);
-	m_taskQueue.pushBack(task);
+	task->m_id = m_nextTaskId++;
+	pushTask(task);
 
-	if(!m_paused)
+	return task->m_id;
+}
+
+void AsyncLoader::setTaskPriority(AsyncLoaderTaskId taskId, AsyncLoaderTaskPriority priority)
+{
+	ANKI_ASSERT(taskId != 0);
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	AsyncLoaderTask* task = findQueuedTask(taskId);
+	if(task && task->m_priority != priority)
 	{
-		// Wake up the thread if it's not paused
-		m_condVar.notifyOne();
+		m_taskQueues[task->m_type][task->m_priority].erase(task);
+		m_queuedTaskCounts[task->m_type].fetchSub(1);
+
+		task->m_priority = priority;
+		pushTask(task);
 	}
 }
 
+Bool AsyncLoader::cancelTask(AsyncLoaderTaskId taskId)
+{
+	ANKI_ASSERT(taskId != 0);
+#if ANKI_EXTRA_CHECKS
+	ANKI_ASSERT(!g_insideAsyncLoaderThread && "Can't cancel from an async task");
+#endif
+
+	AsyncLoaderTask* task = nullptr;
+	{
+		LockGuard<Mutex> lock(m_mtx);
+
+		while(true)
+		{
+			task = findQueuedTask(taskId);
+			if(task)
+			{
+				m_taskQueues[task->m_type][task->m_priority].erase(task);
+				m_queuedTaskCounts[task->m_type].fetchSub(1);
+				break;
+			}
+
+			Bool running = false;
+			for(U32 i = 0; i < m_workerCount; ++i)
+			{
+				running = running || m_workers[i].m_runningTaskId == taskId;
+			}
+
+			if(!running)
+			{
+				// Already done
+				return false;
+			}
+
+			// Wait for it to finish. It might get resubmitted so check the queue again
+			m_taskDoneCondVar.wait(m_mtx);
+		}
+	}
+
+	// Delete outside the lock for the same reason as in threadWorker
+	deleteInstance(ResourceMemoryPool::getSingleton(), task);
+	return true;
+}
+
 } // end namespace anki
@@ -17,6 +17,34 @@ class AsyncLoader;
 /// @addtogroup resource
 /// @{
 
+/// The priority of an AsyncLoaderTask. Tasks with higher priority are executed first. Tasks with the same priority are
+/// executed in submission order.
+enum class AsyncLoaderTaskPriority : U8
+{
+	kLow,
+	kMedium,
+	kHigh,
+
+	kCount,
+	kFirst = 0
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(AsyncLoaderTaskPriority)
+
+/// The kind of work an AsyncLoaderTask does. Every type has its own pool of threads so long tasks of one type don't
+/// block the other.
+enum class AsyncLoaderTaskType : U8
+{
+	kIo, ///< Mostly reads files.
+	kCpu, ///< Mostly processes data and submits GPU work.
+
+	kCount,
+	kFirst = 0
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(AsyncLoaderTaskType)
+
+/// Identifies a submitted task. It's safe to use it after the task is done or deleted. 0 is an invalid ID.
+using AsyncLoaderTaskId = U64;
+
 class AsyncLoaderTaskContext
 {
 public:
@@ -30,24 +58,37 @@ public:
 /// Interface for tasks for the AsyncLoader.
 class AsyncLoaderTask : public IntrusiveListEnabled<AsyncLoaderTask>
 {
+	friend class AsyncLoader;
+
 public:
 	virtual ~AsyncLoaderTask()
 	{
 	}
 
 	virtual Error operator()(AsyncLoaderTaskContext& ctx) = 0;
+
+private:
+	AsyncLoaderTaskId m_id = 0;
+	Second m_submitTime = 0.0;
+	AsyncLoaderTaskPriority m_priority = AsyncLoaderTaskPriority::kMedium;
+	AsyncLoaderTaskType m_type = AsyncLoaderTaskType::kIo;
 };
 
-/// Asynchronous resource loader.
+/// Asynchronous resource loader. It has a pool of threads for every AsyncLoaderTaskType.
 class AsyncLoader
 {
 public:
-	AsyncLoader();
+	/// @param ioThreadCount The number of threads that execute AsyncLoaderTaskType::kIo tasks.
+	/// @param cpuThreadCount The number of threads that execute AsyncLoaderTaskType::kCpu tasks.
+	AsyncLoader(U32 ioThreadCount = 1, U32 cpuThreadCount = 1);
 
 	~AsyncLoader();
 
 	/// Submit a task.
-	void submitTask(AsyncLoaderTask* task);
+	/// @return An ID that can be used to change the priority of the task or cancel it.
+	AsyncLoaderTaskId submitTask(AsyncLoaderTask* task,
+								 AsyncLoaderTaskPriority priority = AsyncLoaderTaskPriority::kMedium,
+								 AsyncLoaderTaskType type = AsyncLoaderTaskType::kIo);
 
 	/// Create a new asynchronous loading task.
 	template<typename TTask, typename... TArgs>
@@ -58,12 +99,22 @@ public:
 
 	/// Create and submit a new asynchronous loading task.
 	template<typename TTask, typename... TArgs>
-	void submitNewTask(TArgs&&... args)
+	AsyncLoaderTaskId submitNewTask(TArgs&&... args)
 	{
-		submitTask(newTask<TTask>(std::forward<TArgs>(args)...));
+		return submitTask(newTask<TTask>(std::forward<TArgs>(args)...));
 	}
 
-	/// Pause the loader. This method will block the caller for the current async task to finish. The rest of the
+	/// Change the priority of a task that is still in the queue. The task will be executed after the tasks that already
+	/// have the same priority. If the task is running or done it does nothing.
+	void setTaskPriority(AsyncLoaderTaskId taskId, AsyncLoaderTaskPriority priority);
+
+	/// Remove a task from the queue and delete it. If the task is running it blocks until it's done. Use it when the
+	/// resource the task is working on is about to be deleted.
+	/// @note Don't call it from an async task.
+	/// @return True if the task was removed before it got executed.
+	Bool cancelTask(AsyncLoaderTaskId taskId);
+
+	/// Pause the loader. This method will block the caller for the current async tasks to finish. The rest of the
 	/// tasks in the queue will not be executed until resume is called.
 	void pause();
 
@@ -76,23 +127,51 @@ public:
 		return m_completedTaskCount.load();
 	}
 
+	/// Get the number of tasks that wait in the queue of a type.
+	U32 getQueuedTaskCount(AsyncLoaderTaskType type) const
+	{
+		return m_queuedTaskCounts[type].load();
+	}
+
+	/// Get the sum of the time that the completed tasks spent from submission to completion.
+	Second getTotalTaskLatency() const
+	{
+		return Second(m_totalTaskLatencyUs.load()) / 1000000.0;
+	}
+
 private:
-	Thread m_thread;
-	Barrier m_barrier = {2};
+	class Worker;
+
+	Worker* m_workers = nullptr;
+	U32 m_workerCount = 0;
+	Barrier* m_barrier = nullptr;
 
 	Mutex m_mtx;
-	ConditionVariable m_condVar;
-	IntrusiveList<AsyncLoaderTask> m_taskQueue;
+	Array<ConditionVariable, U32(AsyncLoaderTaskType::kCount)> m_condVars;
+	ConditionVariable m_taskDoneCondVar;
+	Array2d<IntrusiveList<AsyncLoaderTask>, U32(AsyncLoaderTaskType::kCount), U32(AsyncLoaderTaskPriority::kCount)>
+		m_taskQueues;
+	AsyncLoaderTaskId m_nextTaskId = 1;
+	U32 m_syncCount = 0; ///< The number of workers that haven't synced yet.
 	Bool m_quit = false;
 	Bool m_paused = false;
-	Bool m_sync = false;
 
+	Array<Atomic<U32>, U32(AsyncLoaderTaskType::kCount)> m_queuedTaskCounts = {0u, 0u};
 	Atomic<U64> m_completedTaskCount = {0};
+	Atomic<U64> m_totalTaskLatencyUs = {0};
 
 	/// Thread callback
 	static Error threadCallback(ThreadCallbackInfo& info);
 
-	Error threadWorker();
+	Error threadWorker(Worker& worker);
+
+	/// Pop the task with the highest priority.
+	AsyncLoaderTask* popTask(AsyncLoaderTaskType type);
+
+	/// Find a task that is in the queue.
+	AsyncLoaderTask* findQueuedTask(AsyncLoaderTaskId taskId);
+
+	void pushTask(AsyncLoaderTask* task);
 
 	void stop();
 };
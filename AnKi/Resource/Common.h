@@ -37,7 +37,7 @@ class ResourceMemoryPool : public HeapMemoryPool, public MakeSingleton<ResourceM
 
 private:
 	ResourceMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData)
-		: HeapMemoryPool(allocCb, allocCbUserData, "ResourceMemPool")
+		: HeapMemoryPool(allocCb, allocCbUserData, "ResourceMemPool", true)
 	{
 	}
 
@@ -15,3 +15,18 @@ ANKI_CONFIG_VAR_STRING(RsrcDataPathExcludedStrings, "AndroidProject",
 ANKI_CONFIG_VAR_PTR_SIZE(RsrcTransferScratchMemorySize, 256_MB, 1_MB, 4_GB,
 						 "Memory that is used fot texture and buffer uploads")
 ANKI_CONFIG_VAR_BOOL(RsrcForceFullFpPrecision, false, "Force full floating point precision")
+ANKI_CONFIG_VAR_U32(RsrcAsyncLoaderIoThreadCount, 2, 1, 16, "Number of async loader threads that mostly read files")
+ANKI_CONFIG_VAR_U32(RsrcAsyncLoaderCpuThreadCount, 1, 1, 16,
+					"Number of async loader threads that mostly process data and upload it to the GPU")
+ANKI_CONFIG_VAR_BOOL(RsrcTextureStreaming, false,
+					 "Load only the small mipmaps of the material images and stream the rest depending on visibility")
+ANKI_CONFIG_VAR_U32(RsrcTextureStreamingInitialSize, 128, 4, kMaxU32,
+					"The max size of the mipmaps that are loaded before the image is streamed")
+ANKI_CONFIG_VAR_PTR_SIZE(RsrcTextureStreamingBudget, 1_GB, 1_MB, 32_GB,
+						 "GPU memory of the streamed images. Above that unused mipmaps will be evicted")
+ANKI_CONFIG_VAR_BOOL(RsrcMeshStreaming, false,
+					 "Load only the coarsest LOD of the meshes and stream the rest depending on visibility")
+ANKI_CONFIG_VAR_PTR_SIZE(RsrcMeshStreamingBudget, 512_MB, 1_MB, 32_GB,
+						 "GPU memory of the streamed meshes. Above that unused LODs will be evicted")
+ANKI_CONFIG_VAR_BOOL(RsrcShaderVariantPrewarm, true,
+					 "Record the shader variants that are created and create them in the background on the next run")
@@ -189,6 +189,12 @@ public:
 		ANKI_ASSERT(!"Not Implemented");
 		return kMaxPtrSize;
 	}
+
+	/// Map the whole file to memory. Returns nullptr if that's not possible.
+	virtual const U8* map()
+	{
+		return nullptr;
+	}
 };
 
 class ImageLoader::RsrcFile : public FileInterface
@@ -210,6 +216,11 @@ public:
 	{
 		return m_rfile->getSize();
 	}
+
+	const U8* map() final
+	{
+		return m_rfile->map();
+	}
 };
 
 class ImageLoader::SystemFile : public FileInterface
@@ -231,6 +242,12 @@ public:
 	{
 		return m_file.getSize();
 	}
+
+	const U8* map() final
+	{
+		const void* ptr;
+		return (m_file.map(ptr)) ? nullptr : static_cast<const U8*>(ptr);
+	}
 };
 
 Error ImageLoader::loadUncompressedTga(FileInterface& fs, U32& width, U32& height, U32& bpp,
@@ -393,7 +410,7 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize,
 								 DynamicArray<ImageLoaderSurface, MemoryPoolPtrWrapper<BaseMemoryPool>>& surfaces,
 								 DynamicArray<ImageLoaderVolume, MemoryPoolPtrWrapper<BaseMemoryPool>>& volumes,
 								 U32& width, U32& height, U32& depth, U32& layerCount, U32& mipCount,
-								 ImageBinaryType& imageType, ImageBinaryColorFormat& colorFormat, UVec2& astcBlockSize)
+								 U32& skippedMipCount, ImageBinaryType& imageType, ImageBinaryColorFormat& colorFormat, UVec2& astcBlockSize)
 {
 	//
 	// Read and check the header
@@ -551,6 +568,36 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize,
 	// It's time to read
 	//
 
+	// If the file can be mapped the surfaces will point to its memory instead of copying the data
+	const U8* mappedFile = file.map();
+	PtrSize fileOffset = sizeof(ImageBinaryHeader) + skipSize;
+	auto readOrMap = [&](PtrSize dataSize, DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize>& data,
+						 ConstWeakArray<U8, PtrSize>& mappedData) -> Error {
+		if(mappedFile)
+		{
+			if(fileOffset + dataSize > file.getSize())
+			{
+				ANKI_RESOURCE_LOGE("Unexpected file size");
+				return Error::kUserData;
+			}
+
+			mappedData = ConstWeakArray<U8, PtrSize>(mappedFile + fileOffset, dataSize);
+		}
+		else
+		{
+			data.resize(dataSize);
+			ANKI_CHECK(file.read(&data[0], dataSize));
+		}
+
+		fileOffset += dataSize;
+		return Error::kNone;
+	};
+
+	auto skip = [&](PtrSize dataSize) -> Error {
+		fileOffset += dataSize;
+		return (mappedFile) ? Error::kNone : file.seek(dataSize, FileSeekOrigin::kCurrent);
+	};
+
 	// Allocate the surfaces
 	mipCount = 0;
 	if(header.m_type != ImageBinaryType::k3D)
@@ -575,14 +622,13 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize,
 						surf.m_width = mipWidth;
 						surf.m_height = mipHeight;
 
-						surf.m_data.resize(dataSize);
-						ANKI_CHECK(file.read(&surf.m_data[0], dataSize));
+						ANKI_CHECK(readOrMap(dataSize, surf.m_data, surf.m_mappedData));
 
 						mipCount = max(header.m_mipmapCount - mip, mipCount);
 					}
 					else
 					{
-						ANKI_CHECK(file.seek(dataSize, FileSeekOrigin::kCurrent));
+						ANKI_CHECK(skip(dataSize));
 					}
 				}
 			}
@@ -613,14 +659,13 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize,
 				vol.m_height = mipHeight;
 				vol.m_depth = mipDepth;
 
-				vol.m_data.resize(dataSize);
-				ANKI_CHECK(file.read(&vol.m_data[0], dataSize));
+				ANKI_CHECK(readOrMap(dataSize, vol.m_data, vol.m_mappedData));
 
 				mipCount = max(header.m_mipmapCount - mip, mipCount);
 			}
 			else
 			{
-				ANKI_CHECK(file.seek(dataSize, FileSeekOrigin::kCurrent));
+				ANKI_CHECK(skip(dataSize));
 			}
 
 			mipWidth /= 2;
@@ -633,6 +678,8 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize,
 		depth = volumes[0].m_depth;
 	}
 
+	skippedMipCount = header.m_mipmapCount - mipCount;
+
 	return Error::kNone;
 }
 
@@ -687,6 +734,10 @@ Error ImageLoader::load(ResourceFilePtr rfile, const CString& filename, U32 maxI
 	{
 		ANKI_RESOURCE_LOGE("Failed to read image: %s", filename.cstr());
 	}
+	else
+	{
+		m_mappedRsrcFile = std::move(file.m_rfile);
+	}
 
 	return err;
 }
@@ -701,6 +752,10 @@ Error ImageLoader::load(const CString& filename, U32 maxImageSize)
 	{
 		ANKI_RESOURCE_LOGE("Failed to read image: %s", filename.cstr());
 	}
+	else
+	{
+		m_mappedSystemFile = std::move(file.m_file);
+	}
 
 	return err;
 }
@@ -722,6 +777,7 @@ Error ImageLoader::loadInternal(FileInterface& file, const CString& filename, U3
 	// load from this extension
 	m_imageType = ImageBinaryType::k2D;
 	m_compression = ImageBinaryDataCompression::kRaw;
+	m_skippedMipmapCount = 0;
 
 	if(ext == "tga")
 	{
@@ -758,7 +814,8 @@ Error ImageLoader::loadInternal(FileInterface& file, const CString& filename, U3
 #endif
 
 		ANKI_CHECK(loadAnkiImage(file, maxImageSize, m_compression, m_surfaces, m_volumes, m_width, m_height, m_depth,
-								 m_layerCount, m_mipmapCount, m_imageType, m_colorFormat, m_astcBlockSize));
+								 m_layerCount, m_mipmapCount, m_skippedMipmapCount, m_imageType, m_colorFormat,
+								 m_astcBlockSize));
 	}
 	else if(ext == "png" || ext == "jpg")
 	{
@@ -8,6 +8,7 @@
 #include <AnKi/Resource/Common.h>
 #include <AnKi/Resource/ResourceFilesystem.h>
 #include <AnKi/Resource/ImageBinary.h>
+#include <AnKi/Util/WeakArray.h>
 
 namespace anki {
 
@@ -19,11 +20,18 @@ public:
 	U32 m_width;
 	U32 m_height;
 	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data;
+	ConstWeakArray<U8, PtrSize> m_mappedData; ///< If the file was mapped it points to its memory and m_data is empty.
 
 	ImageLoaderSurface(MemoryPoolPtrWrapper<BaseMemoryPool> pool)
 		: m_data(pool)
 	{
 	}
+
+	/// Get the data of the surface no matter where they are stored.
+	ConstWeakArray<U8, PtrSize> getData() const
+	{
+		return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8, PtrSize>(m_data);
+	}
 };
 
 /// An image volume
@@ -35,11 +43,18 @@ public:
 	U32 m_height;
 	U32 m_depth;
 	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data;
+	ConstWeakArray<U8, PtrSize> m_mappedData; ///< If the file was mapped it points to its memory and m_data is empty.
 
 	ImageLoaderVolume(MemoryPoolPtrWrapper<BaseMemoryPool> pool)
 		: m_data(pool)
 	{
 	}
+
+	/// Get the data of the volume no matter where they are stored.
+	ConstWeakArray<U8, PtrSize> getData() const
+	{
+		return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8, PtrSize>(m_data);
+	}
 };
 
 /// Loads bitmaps from regular system files or resource files. Supported formats are .tga and .ankitex.
@@ -108,6 +123,12 @@ public:
 		return m_astcBlockSize;
 	}
 
+	/// Get the number of mipmaps of the file that were not loaded because they were bigger than the maxImageSize.
+	U32 getSkippedMipmapCount() const
+	{
+		return m_skippedMipmapCount;
+	}
+
 	const ImageLoaderSurface& getSurface(U32 level, U32 face, U32 layer) const;
 
 	const ImageLoaderVolume& getVolume(U32 level) const;
@@ -130,6 +151,7 @@ private:
 	DynamicArray<ImageLoaderVolume, MemoryPoolPtrWrapper<BaseMemoryPool>> m_volumes;
 
 	U32 m_mipmapCount = 0;
+	U32 m_skippedMipmapCount = 0;
 	U32 m_width = 0;
 	U32 m_height = 0;
 	U32 m_depth = 0;
@@ -139,6 +161,10 @@ private:
 	ImageBinaryColorFormat m_colorFormat = ImageBinaryColorFormat::kNone;
 	ImageBinaryType m_imageType = ImageBinaryType::kNone;
 
+	/// If the surfaces point to a mapped file keep it alive.
+	ResourceFilePtr m_mappedRsrcFile;
+	File m_mappedSystemFile;
+
 	void destroy();
 
 	static Error loadUncompressedTga(FileInterface& fs, U32& width, U32& height, U32& bpp,
@@ -157,7 +183,7 @@ private:
 							   DynamicArray<ImageLoaderSurface, MemoryPoolPtrWrapper<BaseMemoryPool>>& surfaces,
 							   DynamicArray<ImageLoaderVolume, MemoryPoolPtrWrapper<BaseMemoryPool>>& volumes,
 							   U32& width, U32& height, U32& depth, U32& layerCount, U32& mipCount,
-							   ImageBinaryType& imageType, ImageBinaryColorFormat& colorFormat, UVec2& astcBlockSize);
+							   U32& skippedMipCount, ImageBinaryType& imageType, ImageBinaryColorFormat& colorFormat, UVec2& astcBlockSize);
 
 	Error loadInternal(FileInterface& file, const CString& filename, U32 maxImageSize);
 };
@@ -7,6 +7,7 @@
 #include <AnKi/Resource/ImageLoader.h>
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Resource/ResourceStreamer.h>
 #include <AnKi/Core/ConfigSet.h>
 #include <AnKi/Util/Filesystem.h>
 
@@ -34,11 +35,46 @@ public:
 	}
 };
 
+/// Loads bigger or smaller mipmaps of a streamed image.
+class ImageResource::StreamTask : public AsyncLoaderTask
+{
+public:
+	ImageResource* m_image = nullptr;
+	U32 m_maxImageSize = 0;
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		if(m_image->loadStreamedMip(m_maxImageSize))
+		{
+			// Don't return the error, it will kill the loader thread. Let the streamer know
+			ANKI_RESOURCE_LOGE("Failed to stream image: %s", m_image->getFilename().cstr());
+			m_image->m_streamedTexReady.store(kStreamFailed);
+		}
+
+		return Error::kNone;
+	}
+};
+
 ImageResource::~ImageResource()
 {
+	if(m_streamerIndex != kMaxU32)
+	{
+		ResourceManager::getSingleton().getResourceStreamer().unregisterImage(this);
+	}
+
+	if(m_streamTaskId)
+	{
+		ResourceManager::getSingleton().getAsyncLoader().cancelTask(m_streamTaskId);
+	}
+
+	if(m_uploadTaskId)
+	{
+		// Nobody references the image any more, don't bother uploading it
+		ResourceManager::getSingleton().getAsyncLoader().cancelTask(m_uploadTaskId);
+	}
 }
 
-Error ImageResource::load(const ResourceFilename& filename, Bool async)
+Error ImageResource::load(const ResourceFilename& filename, Bool async, Bool streamable)
 {
 	TexUploadTask* task;
 	LoadingContext* ctx;
@@ -59,14 +95,75 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 	String filenameExt;
 	getFilepathFilename(filename, filenameExt);
 
-	TextureInitInfo init(filenameExt);
-	init.m_usage = TextureUsageBit::kAllSampled | TextureUsageBit::kTransferDestination;
-	U32 faces = 0;
-
 	ResourceFilePtr file;
 	ANKI_CHECK(openFile(filename, file));
 
-	ANKI_CHECK(loader.load(file, filename, ConfigSet::getSingleton().getRsrcMaxImageSize()));
+	// If the image is streamable load only the small mipmaps. The rest will be streamed when they are needed
+	const U32 maxImageSize = ConfigSet::getSingleton().getRsrcMaxImageSize();
+	const Bool streamingCandidate = async && streamable;
+	m_streamable = streamingCandidate;
+	const U32 initialMaxImageSize =
+		(streamingCandidate) ? min(maxImageSize, ConfigSet::getSingleton().getRsrcTextureStreamingInitialSize())
+							 : maxImageSize;
+
+	ANKI_CHECK(loader.load(file, filename, initialMaxImageSize));
+	const U32 skippedMipCount = loader.getSkippedMipmapCount();
+
+	TextureInitInfo init(filenameExt);
+	ANKI_CHECK(createTexture(loader, *ctx, init));
+	m_tex = ctx->m_tex;
+
+	// Upload the data
+	if(async)
+	{
+		// Large uploads go to the CPU threads so they don't block the loading of small files
+		m_uploadTaskId = ResourceManager::getSingleton().getAsyncLoader().submitTask(
+			task, AsyncLoaderTaskPriority::kMedium, AsyncLoaderTaskType::kCpu);
+	}
+	else
+	{
+		ANKI_CHECK(load(*ctx));
+	}
+
+	m_size = UVec3(init.m_width, init.m_height, init.m_depth);
+	m_layerCount = init.m_layerCount;
+
+	// Create the texture view
+	TextureViewInitInfo viewInit(m_tex, "Rsrc");
+	m_texView = GrManager::getSingleton().newTextureView(viewInit);
+
+	// Only 2D textures that have skipped mipmaps are worth streaming
+	if(streamingCandidate && init.m_type == TextureType::k2D && skippedMipCount > 0)
+	{
+		m_streamed = true;
+		m_residentMip = U8(skippedMipCount);
+		m_initialMip = m_residentMip;
+		m_wantedMip = m_residentMip;
+
+		// Find the biggest mipmap that respects the RsrcMaxImageSize
+		m_minStreamableMip = m_residentMip;
+		while(m_minStreamableMip > 0 && computeMaxImageSizeForMip(m_minStreamableMip - 1) <= maxImageSize)
+		{
+			--m_minStreamableMip;
+		}
+
+		if(m_minStreamableMip < m_residentMip)
+		{
+			ResourceManager::getSingleton().getResourceStreamer().registerImage(this);
+		}
+		else
+		{
+			m_streamed = false;
+		}
+	}
+
+	return Error::kNone;
+}
+
+Error ImageResource::createTexture(const ImageLoader& loader, LoadingContext& ctx, TextureInitInfo& init)
+{
+	init.m_usage = TextureUsageBit::kAllSampled | TextureUsageBit::kTransferDestination;
+	U32 faces = 0;
 
 	// Various sizes
 	init.m_width = loader.getWidth();
@@ -192,7 +289,7 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 	init.m_mipmapCount = U8(loader.getMipmapCount());
 
 	// Create the texture
-	m_tex = GrManager::getSingleton().newTexture(init);
+	ctx.m_tex = GrManager::getSingleton().newTexture(init);
 
 	// Transition it. TODO remove that eventually
 	{
@@ -205,7 +302,7 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 		subresource.m_layerCount = init.m_layerCount;
 		subresource.m_mipmapCount = init.m_mipmapCount;
 
-		const TextureBarrierInfo barrier = {m_tex.get(), TextureUsageBit::kNone, TextureUsageBit::kAllSampled,
+		const TextureBarrierInfo barrier = {ctx.m_tex.get(), TextureUsageBit::kNone, TextureUsageBit::kAllSampled,
 											subresource};
 		cmdb->setPipelineBarrier({&barrier, 1}, {}, {});
 
@@ -215,29 +312,132 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 	}
 
 	// Set the context
-	ctx->m_faces = faces;
-	ctx->m_layerCount = init.m_layerCount;
-	ctx->m_texType = init.m_type;
-	ctx->m_tex = m_tex;
+	ctx.m_faces = faces;
+	ctx.m_layerCount = init.m_layerCount;
+	ctx.m_texType = init.m_type;
 
-	// Upload the data
-	if(async)
+	return Error::kNone;
+}
+
+void ImageResource::submitStreamTask(U32 mip)
+{
+	ANKI_ASSERT(m_streamed && m_streamTaskId == 0 && mip != m_residentMip);
+
+	StreamTask* task = ResourceManager::getSingleton().getAsyncLoader().newTask<StreamTask>();
+	task->m_image = this;
+	task->m_maxImageSize = computeMaxImageSizeForMip(mip);
+
+	m_streamTaskId = ResourceManager::getSingleton().getAsyncLoader().submitTask(task, AsyncLoaderTaskPriority::kLow,
+																				   AsyncLoaderTaskType::kIo);
+}
+
+Error ImageResource::loadStreamedMip(U32 maxImageSize)
+{
+	ANKI_ASSERT(m_streamed);
+	LoadingContext ctx;
+
+	ResourceFilePtr file;
+	ANKI_CHECK(openFile(getFilename(), file));
+	ANKI_CHECK(ctx.m_loader.load(file, getFilename(), maxImageSize));
+	const U32 mip = ctx.m_loader.getSkippedMipmapCount();
+
+	String filenameExt;
+	getFilepathFilename(getFilename(), filenameExt);
+
+	TextureInitInfo init(filenameExt);
+	ANKI_CHECK(createTexture(ctx.m_loader, ctx, init));
+	ANKI_CHECK(load(ctx));
+
+	// Publish the result. The ResourceStreamer will pick it up. The loaded mipmap might not be the one that was asked
+	// because of the rounding of the mipmap sizes
+	m_streamedTex = std::move(ctx.m_tex);
+	m_streamedMip = U8(mip);
+	m_streamedTexReady.store(kStreamReady);
+
+	return Error::kNone;
+}
+
+Bool ImageResource::finishStreaming()
+{
+	ANKI_ASSERT(m_streamedTexReady.load() != kStreamPending);
+	const Bool failed = m_streamedTexReady.load() == kStreamFailed;
+	m_streamedTexReady.store(kStreamPending);
+	m_streamTaskId = 0;
+
+	if(failed || m_streamedMip == m_residentMip)
+	{
+		// Don't try to go beyond that mipmap again
+		m_minStreamableMip = max(m_minStreamableMip, m_residentMip);
+		m_streamedTex.reset(nullptr);
+		return false;
+	}
+
+	m_tex = std::move(m_streamedTex);
+	m_residentMip = m_streamedMip;
+
+	m_size = UVec3(m_tex->getWidth(), m_tex->getHeight(), 1);
+
+	TextureViewInitInfo viewInit(m_tex, "Rsrc");
+	m_texView = GrManager::getSingleton().newTextureView(viewInit);
+
+	return true;
+}
+
+U32 ImageResource::computeMaxImageSizeForMip(U32 mip) const
+{
+	// The size of the file's mipmaps is not known, only the size of the resident one. The sizes of the others have a
+	// range because of the rounding. Return the biggest of the range, it's guaranteed to be smaller than the previous
+	// mipmap
+	const U32 residentSize = max(m_size.x(), m_size.y());
+	if(mip >= m_residentMip)
 	{
-		ResourceManager::getSingleton().getAsyncLoader().submitTask(task);
+		return max(1u, residentSize >> (mip - m_residentMip));
 	}
 	else
 	{
-		ANKI_CHECK(load(*ctx));
+		return ((residentSize + 1) << (m_residentMip - mip)) - 1;
 	}
+}
 
-	m_size = UVec3(init.m_width, init.m_height, init.m_depth);
-	m_layerCount = init.m_layerCount;
+U32 ImageResource::computeMipForResolution(U32 pixels) const
+{
+	U32 mip = m_residentMip;
+	U32 size = max(m_size.x(), m_size.y());
 
-	// Create the texture view
-	TextureViewInitInfo viewInit(m_tex, "Rsrc");
-	m_texView = GrManager::getSingleton().newTextureView(viewInit);
+	// Go up while the mipmap is smaller than the resolution
+	while(mip > m_minStreamableMip && size < pixels)
+	{
+		--mip;
+		size *= 2;
+	}
 
-	return Error::kNone;
+	// Go down while the next mipmap is big enough
+	while(mip < m_initialMip && size / 2 >= pixels)
+	{
+		++mip;
+		size /= 2;
+	}
+
+	return mip;
+}
+
+PtrSize ImageResource::estimateMemory(U32 mip) const
+{
+	U32 width = m_size.x();
+	U32 height = m_size.y();
+	if(mip < m_residentMip)
+	{
+		width <<= m_residentMip - mip;
+		height <<= m_residentMip - mip;
+	}
+	else
+	{
+		width = max(1u, width >> (mip - m_residentMip));
+		height = max(1u, height >> (mip - m_residentMip));
+	}
+
+	// The mipmap chain adds about a 3rd
+	return computeSurfaceSize(width, height, m_tex->getFormat()) * 4 / 3;
 }
 
 Error ImageResource::load(LoadingContext& ctx)
@@ -291,18 +491,18 @@ Error ImageResource::load(LoadingContext& ctx)
 
 			if(ctx.m_texType == TextureType::k3D)
 			{
-				const auto& vol = ctx.m_loader.getVolume(mip);
-				surfOrVolSize = vol.m_data.getSize();
-				surfOrVolData = &vol.m_data[0];
+				const ConstWeakArray<U8, PtrSize> volData = ctx.m_loader.getVolume(mip).getData();
+				surfOrVolSize = volData.getSize();
+				surfOrVolData = volData.getBegin();
 
 				allocationSize = computeVolumeSize(ctx.m_tex->getWidth() >> mip, ctx.m_tex->getHeight() >> mip,
 												   ctx.m_tex->getDepth() >> mip, ctx.m_tex->getFormat());
 			}
 			else
 			{
-				const auto& surf = ctx.m_loader.getSurface(mip, face, layer);
-				surfOrVolSize = surf.m_data.getSize();
-				surfOrVolData = &surf.m_data[0];
+				const ConstWeakArray<U8, PtrSize> surfData = ctx.m_loader.getSurface(mip, face, layer).getData();
+				surfOrVolSize = surfData.getSize();
+				surfOrVolData = surfData.getBegin();
 
 				allocationSize = computeSurfaceSize(ctx.m_tex->getWidth() >> mip, ctx.m_tex->getHeight() >> mip,
 													ctx.m_tex->getFormat());
@@ -314,6 +514,7 @@ Error ImageResource::load(LoadingContext& ctx)
 			void* data = handle.getMappedMemory();
 			ANKI_ASSERT(data);
 
+			// If the image file is mapped this copies straight from the file's pages
 			memcpy(data, surfOrVolData, surfOrVolSize);
 
 			// Create temp tex view
@@ -6,10 +6,14 @@
 #pragma once
 
 #include <AnKi/Resource/ResourceObject.h>
+#include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/Gr.h>
 
 namespace anki {
 
+// Forward
+class ImageLoader;
+
 /// @addtogroup resource
 /// @{
 
@@ -25,7 +29,9 @@ public:
 	~ImageResource();
 
 	/// Load an image.
-	Error load(const ResourceFilename& filename, Bool async);
+	/// @param streamable Load only the small mipmaps and let the ResourceStreamer load the rest on demand. It's ignored
+	///                   if async is false. See ResourceManager::loadStreamableImage().
+	Error load(const ResourceFilename& filename, Bool async, Bool streamable = false);
 
 	/// Get the texture.
 	const TexturePtr& getTexture() const
@@ -63,10 +69,41 @@ public:
 		return m_layerCount;
 	}
 
+	/// True if the big mipmaps of the image are loaded on demand. See ResourceStreamer.
+	Bool isStreamed() const
+	{
+		return m_streamed;
+	}
+
+	/// True if it was loaded with ResourceManager::loadStreamableImage() while streaming was on. Small images that
+	/// are streamable might still not be streamed.
+	Bool isStreamable() const
+	{
+		return m_streamable;
+	}
+
+	/// Ask for the image to have at least that resolution. If the image is streamed the ResourceStreamer will load the
+	/// mipmaps that are needed. The texture and the texture view will change when that happens.
+	/// @note It's thread-safe and cheap to call it multiple times per frame.
+	void requestResolution(U32 pixels) const
+	{
+		if(m_streamed)
+		{
+			m_requestedResolution.max(pixels);
+		}
+	}
+
 private:
+	friend class ResourceStreamer;
+
 	static constexpr U32 kMaxCopiesBeforeFlush = 4;
 
+	static constexpr U32 kStreamPending = 0;
+	static constexpr U32 kStreamReady = 1;
+	static constexpr U32 kStreamFailed = 2;
+
 	class TexUploadTask;
+	class StreamTask;
 	class LoadingContext;
 
 	TexturePtr m_tex;
@@ -74,7 +111,46 @@ private:
 	UVec3 m_size = UVec3(0u);
 	U32 m_layerCount = 0;
 
+	AsyncLoaderTaskId m_uploadTaskId = 0;
+
+	// Streaming. The mipmaps are the mipmaps of the file
+	Bool m_streamable = false;
+	Bool m_streamed = false;
+	U8 m_residentMip = 0; ///< The mipmap of the file that is the 1st mipmap of the texture.
+	U8 m_initialMip = 0; ///< Never go smaller than that.
+	U8 m_wantedMip = 0;
+	U8 m_minStreamableMip = 0; ///< Bigger mipmaps are bigger than the RsrcMaxImageSize.
+	U32 m_streamerIndex = kMaxU32; ///< Index in ResourceStreamer's array.
+	U64 m_lastRequestFrame = 0;
+	mutable Atomic<U32> m_requestedResolution = {0};
+
+	AsyncLoaderTaskId m_streamTaskId = 0;
+	TexturePtr m_streamedTex; ///< Written by the StreamTask.
+	U8 m_streamedMip = 0; ///< Written by the StreamTask.
+	Atomic<U32> m_streamedTexReady = {kStreamPending};
+
 	[[nodiscard]] static Error load(LoadingContext& ctx);
+
+	[[nodiscard]] static Error createTexture(const ImageLoader& loader, LoadingContext& ctx, TextureInitInfo& init);
+
+	/// Start loading a different mipmap chain. Called by the ResourceStreamer.
+	void submitStreamTask(U32 mip);
+
+	/// Load the mipmaps that are not bigger than maxImageSize into a new texture. Called by the StreamTask.
+	Error loadStreamedMip(U32 maxImageSize);
+
+	/// Called by the ResourceStreamer when the StreamTask is done. It switches to the new texture.
+	/// @return True if the texture changed.
+	Bool finishStreaming();
+
+	/// Compute a mipmap of the file that has enough resolution.
+	U32 computeMipForResolution(U32 pixels) const;
+
+	/// Compute the maxImageSize of the ImageLoader that will make it load a specific mipmap of the file.
+	U32 computeMaxImageSizeForMip(U32 mip) const;
+
+	/// Estimate the GPU memory of a texture that starts from a specific mipmap of the file.
+	PtrSize estimateMemory(U32 mip) const;
 };
 /// @}
 
@@ -6,6 +6,7 @@
 #include <AnKi/Resource/MaterialResource.h>
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/ImageResource.h>
+#include <AnKi/Resource/ResourceStreamer.h>
 #include <AnKi/Util/Xml.h>
 
 namespace anki {
@@ -121,6 +122,11 @@ MaterialResource::MaterialResource()
 
 MaterialResource::~MaterialResource()
 {
+	if(m_streamerIndex != kMaxU32)
+	{
+		ResourceManager::getSingleton().getResourceStreamer().unregisterMaterial(this);
+	}
+
 	ResourceMemoryPool::getSingleton().free(m_prefilledLocalUniforms);
 }
 
@@ -183,9 +189,42 @@ Error MaterialResource::load(const ResourceFilename& filename, Bool async)
 
 	prefillLocalUniforms();
 
+	// Gather the streamed images. The material needs to know when their textures change
+	for(const MaterialVariable& var : m_vars)
+	{
+		if(var.m_image.isCreated() && var.m_image->isStreamed())
+		{
+			m_streamedImages.emplaceBack(var.m_image.get());
+		}
+	}
+
+	if(m_streamedImages.getSize())
+	{
+		ResourceManager::getSingleton().getResourceStreamer().registerMaterial(this);
+	}
+
 	return Error::kNone;
 }
 
+void MaterialResource::refreshStreamedTextures()
+{
+	m_textures.destroy();
+	for(MaterialVariable& var : m_vars)
+	{
+		if(var.isBoundableTexture())
+		{
+			m_textures.emplaceBack(var.m_image->getTexture());
+		}
+		else if(var.isBindlessTexture() && var.m_image->isStreamed())
+		{
+			var.m_U32 = var.m_image->getTextureView()->getOrCreateBindlessTextureIndex();
+			memcpy(static_cast<U8*>(m_prefilledLocalUniforms) + var.m_offsetInLocalUniforms, &var.m_U32, sizeof(U32));
+		}
+	}
+
+	++m_prefilledLocalUniformsVersion;
+}
+
 Error MaterialResource::parseShaderProgram(XmlElement shaderProgramEl, Bool async)
 {
 	// name
@@ -488,6 +527,12 @@ Error MaterialResource::parseMutators(XmlElement mutatorsEl, Program& prog)
 			return Error::kUserData;
 		}
 
+		// The alpha tested materials have holes
+		if(mutatorName == "ALPHA_TEST" && pmutation.m_value != 0)
+		{
+			m_alphaTested = true;
+		}
+
 		// Advance
 		++mutatorCount;
 		ANKI_CHECK(mutatorEl.getNextSiblingElement("mutator", mutatorEl));
@@ -629,7 +674,7 @@ Error MaterialResource::parseInput(XmlElement inputEl, Bool async, BitSet<128>&
 	{
 		CString texfname;
 		ANKI_CHECK(inputEl.getAttributeText("value", texfname));
-		ANKI_CHECK(ResourceManager::getSingleton().loadResource(texfname, foundVar->m_image, async));
+		ANKI_CHECK(ResourceManager::getSingleton().loadStreamableImage(texfname, foundVar->m_image, async));
 
 		m_textures.emplaceBack(foundVar->m_image->getTexture());
 	}
@@ -654,7 +699,7 @@ Error MaterialResource::parseInput(XmlElement inputEl, Bool async, BitSet<128>&
 		// If it has letters it's a texture
 		if(containsAlpharithmetic)
 		{
-			ANKI_CHECK(ResourceManager::getSingleton().loadResource(value, foundVar->m_image, async));
+			ANKI_CHECK(ResourceManager::getSingleton().loadStreamableImage(value, foundVar->m_image, async));
 
 			foundVar->m_U32 = foundVar->m_image->getTextureView()->getOrCreateBindlessTextureIndex();
 		}
@@ -715,7 +760,7 @@ void MaterialResource::prefillLocalUniforms()
 	}
 }
 
-const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey& key_) const
+Bool MaterialResource::tryGetOrCreateVariant(const RenderingKey& key_, const MaterialVariant*& outVariant) const
 {
 	RenderingKey key = key_;
 	ANKI_ASSERT(m_techniqueToProgram[key.getRenderingTechnique()] != kMaxU8);
@@ -732,25 +777,17 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	ANKI_ASSERT(!key.getVelocity() || !!(prog.m_presentBuildinMutators & U32(1 << BuiltinMutatorId::kVelocity)));
 
 	MaterialVariant& variant = prog.m_variantMatrix[key.getRenderingTechnique()][key.getSkinned()][key.getVelocity()];
+	outVariant = &variant;
 
 	// Check if it's initialized
 	{
 		RLockGuard<RWMutex> lock(prog.m_variantMatrixMtx);
 		if(variant.m_prog.isCreated()) [[likely]]
 		{
-			return variant;
+			return true;
 		}
 	}
 
-	// Not initialized, init it
-	WLockGuard<RWMutex> lock(prog.m_variantMatrixMtx);
-
-	// Check again
-	if(variant.m_prog.isCreated())
-	{
-		return variant;
-	}
-
 	ShaderProgramResourceVariantInitInfo initInfo(prog.m_prog);
 
 	for(const PartialMutation& m : prog.m_partialMutation)
@@ -770,22 +807,33 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 		initInfo.addMutation(kBuiltinMutatorNames[BuiltinMutatorId::kVelocity], MutatorValue(key.getVelocity()));
 	}
 
+	// Don't hold the lock while asking for the variant. The creation happens in the AsyncLoader
 	const ShaderProgramResourceVariant* progVariant;
-	prog.m_prog->getOrCreateVariant(initInfo, progVariant);
+	if(!prog.m_prog->tryGetOrCreateVariant(initInfo, progVariant))
+	{
+		outVariant = nullptr;
+		return false;
+	}
 
 	if(!progVariant)
 	{
 		ANKI_RESOURCE_LOGF("Fetched skipped mutation on program %s", getFilename().cstr());
 	}
 
-	variant.m_prog = progVariant->getProgram();
+	WLockGuard<RWMutex> lock(prog.m_variantMatrixMtx);
 
-	if(!!(RenderingTechniqueBit(1 << key.getRenderingTechnique()) & RenderingTechniqueBit::kAllRt))
+	// Some other thread might have initialized it already
+	if(!variant.m_prog.isCreated())
 	{
-		variant.m_rtShaderGroupHandleIndex = progVariant->getShaderGroupHandleIndex();
+		if(!!(RenderingTechniqueBit(1 << key.getRenderingTechnique()) & RenderingTechniqueBit::kAllRt))
+		{
+			variant.m_rtShaderGroupHandleIndex = progVariant->getShaderGroupHandleIndex();
+		}
+
+		variant.m_prog = progVariant->getProgram();
 	}
 
-	return variant;
+	return true;
 }
 
 } // end namespace anki
@@ -216,6 +216,8 @@ private:
 /// (1): Only for non-builtins.
 class MaterialResource : public ResourceObject
 {
+	friend class ResourceStreamer;
+
 public:
 	MaterialResource();
 
@@ -239,6 +241,14 @@ public:
 		return m_supportsSkinning;
 	}
 
+	/// True if it's rendered in the GBuffer without holes. Transparent and alpha tested materials can't hide what's
+	/// behind them.
+	Bool isOpaque() const
+	{
+		return !!(m_techniquesMask & RenderingTechniqueBit::kGBuffer)
+			   && !(m_techniquesMask & RenderingTechniqueBit::kForward) && !m_alphaTested;
+	}
+
 	RenderingTechniqueBit getRenderingTechniques() const
 	{
 		ANKI_ASSERT(!!m_techniquesMask);
@@ -251,8 +261,11 @@ public:
 		return m_textures;
 	}
 
+	/// Get or create a variant. It never blocks. If the shader program variant is not ready it starts creating it in
+	/// the background and returns false.
 	/// @note It's thread-safe.
-	const MaterialVariant& getOrCreateVariant(const RenderingKey& key) const;
+	/// @return True if the variant is ready.
+	Bool tryGetOrCreateVariant(const RenderingKey& key, const MaterialVariant*& variant) const;
 
 	/// Get a buffer with prefilled uniforms.
 	ConstWeakArray<U8> getPrefilledLocalUniforms() const
@@ -260,6 +273,25 @@ public:
 		return ConstWeakArray<U8>(static_cast<const U8*>(m_prefilledLocalUniforms), m_localUniformsSize);
 	}
 
+	/// It changes every time the prefilled uniforms change. That happens when streamed textures change.
+	U32 getPrefilledLocalUniformsVersion() const
+	{
+		return m_prefilledLocalUniformsVersion;
+	}
+
+	/// Ask for the streamed textures of the material to have at least that resolution.
+	/// @note It's thread-safe.
+	void requestTextureResolution(U32 pixels) const
+	{
+		for(const ImageResource* image : m_streamedImages)
+		{
+			image->requestResolution(pixels);
+		}
+	}
+
+	/// Update the bindless texture indices after the ResourceStreamer changed some textures.
+	ANKI_INTERNAL void refreshStreamedTextures();
+
 private:
 	class PartialMutation
 	{
@@ -278,11 +310,16 @@ private:
 	ResourceDynamicArray<MaterialVariable> m_vars;
 
 	Bool m_supportsSkinning = false;
+	Bool m_alphaTested = false;
 
 	ResourceDynamicArray<TexturePtr> m_textures;
 
 	void* m_prefilledLocalUniforms = nullptr;
 	U32 m_localUniformsSize = 0;
+	U32 m_prefilledLocalUniformsVersion = 0;
+
+	ResourceDynamicArray<const ImageResource*> m_streamedImages;
+	U32 m_streamerIndex = kMaxU32; ///< Index in ResourceStreamer's array.
 
 	Error parseMutators(XmlElement mutatorsEl, Program& prog);
 	Error parseShaderProgram(XmlElement techniqueEl, Bool async);
@@ -23,8 +23,9 @@ enum class MeshBinaryFlag : U32
 	kNone = 0,
 	kQuad = 1 << 0,
 	kConvex = 1 << 1,
+	kOccluder = 1 << 2, ///< The file ends with a MeshBinaryOccluder followed by the occluder's indices and positions.
 
-	kAll = kQuad | kConvex,
+	kAll = kQuad | kConvex | kOccluder,
 };
 ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(MeshBinaryFlag)
 
@@ -132,6 +133,36 @@ public:
 	}
 };
 
+/// A simplified version of the mesh used in CPU occlusion culling.
+class MeshBinaryOccluder
+{
+public:
+	/// The count of the U16 indices.
+	U32 m_indexCount;
+
+	/// The count of the Vec3 positions. They are in object space.
+	U32 m_vertexCount;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doValue("m_indexCount", offsetof(MeshBinaryOccluder, m_indexCount), self.m_indexCount);
+		s.doValue("m_vertexCount", offsetof(MeshBinaryOccluder, m_vertexCount), self.m_vertexCount);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, MeshBinaryOccluder&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const MeshBinaryOccluder&>(serializer, *this);
+	}
+};
+
 /// The 1st things that appears in a mesh binary.
 class MeshBinaryHeader
 {
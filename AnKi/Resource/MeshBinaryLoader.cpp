@@ -12,10 +12,40 @@ Error MeshBinaryLoader::load(const ResourceFilename& filename)
 {
 	// Load header + submeshes
 	ANKI_CHECK(ResourceManager::getSingleton().getFilesystem().openFile(filename, m_file));
+	m_mappedFile = m_file->map();
 	ANKI_CHECK(m_file->read(&m_header, sizeof(m_header)));
 	ANKI_CHECK(checkHeader());
 	ANKI_CHECK(loadSubmeshes());
 
+	if(!!(m_header.m_flags & MeshBinaryFlag::kOccluder))
+	{
+		ANKI_CHECK(loadOccluder());
+	}
+
+	return Error::kNone;
+}
+
+Error MeshBinaryLoader::loadOccluder()
+{
+	const PtrSize offset = getOccluderOffset();
+	ANKI_CHECK(m_file->seek(offset, FileSeekOrigin::kBeginning));
+	ANKI_CHECK(m_file->read(&m_occluder, sizeof(m_occluder)));
+
+	if(m_occluder.m_indexCount == 0 || (m_occluder.m_indexCount % 3) != 0 || m_occluder.m_vertexCount == 0
+	   || m_occluder.m_vertexCount > kMaxU16 + 1)
+	{
+		ANKI_RESOURCE_LOGE("Wrong occluder index or vertex count");
+		return Error::kUserData;
+	}
+
+	const PtrSize totalSize = offset + sizeof(m_occluder) + PtrSize(m_occluder.m_indexCount) * sizeof(U16)
+							  + PtrSize(m_occluder.m_vertexCount) * sizeof(Vec3);
+	if(totalSize != m_file->getSize())
+	{
+		ANKI_RESOURCE_LOGE("Unexpected file size");
+		return Error::kUserData;
+	}
+
 	return Error::kNone;
 }
 
@@ -219,16 +249,11 @@ Error MeshBinaryLoader::checkHeader() const
 		}
 	}
 
-	// Check the file size
-	PtrSize totalSize = sizeof(m_header);
-	totalSize += sizeof(MeshBinarySubMesh) * m_header.m_subMeshCount;
-
-	for(U32 lod = 0; lod < h.m_lodCount; ++lod)
-	{
-		totalSize += getLodBuffersSize(lod);
-	}
-
-	if(totalSize != m_file->getSize())
+	// Check the file size. If there is an occluder the exact size will be checked after it's loaded
+	const PtrSize totalSize = getOccluderOffset();
+	const Bool hasOccluder = !!(h.m_flags & MeshBinaryFlag::kOccluder);
+	if((!hasOccluder && totalSize != m_file->getSize())
+	   || (hasOccluder && totalSize + sizeof(MeshBinaryOccluder) > m_file->getSize()))
 	{
 		ANKI_RESOURCE_LOGE("Unexpected file size");
 		return Error::kUserData;
@@ -244,16 +269,7 @@ Error MeshBinaryLoader::storeIndexBuffer(U32 lod, void* ptr, PtrSize size)
 	ANKI_ASSERT(lod < m_header.m_lodCount);
 	ANKI_ASSERT(size == getIndexBufferSize(lod));
 
-	PtrSize seek = sizeof(m_header) + m_subMeshes.getSizeInBytes();
-	for(U32 l = lod + 1; l < m_header.m_lodCount; ++l)
-	{
-		seek += getLodBuffersSize(l);
-	}
-
-	ANKI_CHECK(m_file->seek(seek, FileSeekOrigin::kBeginning));
-	ANKI_CHECK(m_file->read(ptr, size));
-
-	return Error::kNone;
+	return readAt(getIndexBufferOffset(lod), ptr, size);
 }
 
 Error MeshBinaryLoader::storeVertexBuffer(U32 lod, U32 bufferIdx, void* ptr, PtrSize size)
@@ -263,24 +279,7 @@ Error MeshBinaryLoader::storeVertexBuffer(U32 lod, U32 bufferIdx, void* ptr, Ptr
 	ANKI_ASSERT(size == getVertexBufferSize(lod, bufferIdx));
 	ANKI_ASSERT(lod < m_header.m_lodCount);
 
-	PtrSize seek = sizeof(m_header) + m_subMeshes.getSizeInBytes();
-
-	for(U32 l = lod + 1; l < m_header.m_lodCount; ++l)
-	{
-		seek += getLodBuffersSize(l);
-	}
-
-	seek += getIndexBufferSize(lod);
-
-	for(U32 i = 0; i < bufferIdx; ++i)
-	{
-		seek += getVertexBufferSize(lod, i);
-	}
-
-	ANKI_CHECK(m_file->seek(seek, FileSeekOrigin::kBeginning));
-	ANKI_CHECK(m_file->read(ptr, size));
-
-	return Error::kNone;
+	return readAt(getVertexBufferOffset(lod, bufferIdx), ptr, size);
 }
 
 Error MeshBinaryLoader::storeIndicesAndPosition(U32 lod, ResourceDynamicArray<U32>& indices,
@@ -293,33 +292,53 @@ Error MeshBinaryLoader::storeIndicesAndPosition(U32 lod, ResourceDynamicArray<U3
 	{
 		indices.resize(m_header.m_totalIndexCounts[lod]);
 
-		// Store to staging buff
+		// Store to staging buff if the file is not mapped
 		DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> staging(m_subMeshes.getMemoryPool());
-		staging.resize(getIndexBufferSize(lod));
-		ANKI_CHECK(storeIndexBuffer(lod, &staging[0], staging.getSizeInBytes()));
+		const U8* src;
+		if(m_mappedFile)
+		{
+			src = m_mappedFile + getIndexBufferOffset(lod);
+		}
+		else
+		{
+			staging.resize(getIndexBufferSize(lod));
+			ANKI_CHECK(storeIndexBuffer(lod, &staging[0], staging.getSizeInBytes()));
+			src = &staging[0];
+		}
 
 		// Copy from staging
 		ANKI_ASSERT(m_header.m_indexType == IndexType::kU16);
 		for(U32 i = 0; i < m_header.m_totalIndexCounts[lod]; ++i)
 		{
-			indices[i] = *reinterpret_cast<U16*>(&staging[PtrSize(i) * 2]);
+			indices[i] = *reinterpret_cast<const U16*>(&src[PtrSize(i) * 2]);
 		}
 	}
 
 	// Store positions
 	{
 		const MeshBinaryVertexAttribute& attrib = m_header.m_vertexAttributes[VertexStreamId::kPosition];
-		DynamicArray<U16Vec4, MemoryPoolPtrWrapper<BaseMemoryPool>> tempPositions(m_subMeshes.getMemoryPool());
-		tempPositions.resize(m_header.m_totalVertexCounts[lod]);
 		static_assert(kMeshRelatedVertexStreamFormats[VertexStreamId::kPosition] == Format::kR16G16B16A16_Unorm,
 					  "Incorrect format");
-		ANKI_CHECK(storeVertexBuffer(lod, attrib.m_bufferIndex, &tempPositions[0], tempPositions.getSizeInBytes()));
+
+		DynamicArray<U16Vec4, MemoryPoolPtrWrapper<BaseMemoryPool>> tempPositions(m_subMeshes.getMemoryPool());
+		const U16Vec4* src;
+		if(m_mappedFile)
+		{
+			src = reinterpret_cast<const U16Vec4*>(m_mappedFile + getVertexBufferOffset(lod, attrib.m_bufferIndex));
+		}
+		else
+		{
+			tempPositions.resize(m_header.m_totalVertexCounts[lod]);
+			ANKI_CHECK(
+				storeVertexBuffer(lod, attrib.m_bufferIndex, &tempPositions[0], tempPositions.getSizeInBytes()));
+			src = &tempPositions[0];
+		}
 
 		positions.resize(m_header.m_totalVertexCounts[lod]);
 
-		for(U32 i = 0; i < tempPositions.getSize(); ++i)
+		for(U32 i = 0; i < positions.getSize(); ++i)
 		{
-			positions[i] = Vec3(tempPositions[i].xyz()) / F32(kMaxU16);
+			positions[i] = Vec3(src[i].xyz()) / F32(kMaxU16);
 			positions[i] *= Vec3(&attrib.m_scale[0]);
 			positions[i] += Vec3(&attrib.m_translation[0]);
 		}
@@ -328,6 +347,83 @@ Error MeshBinaryLoader::storeIndicesAndPosition(U32 lod, ResourceDynamicArray<U3
 	return Error::kNone;
 }
 
+Error MeshBinaryLoader::storeOccluder(ResourceDynamicArray<U16>& indices, ResourceDynamicArray<Vec3>& positions)
+{
+	ANKI_ASSERT(isLoaded());
+	ANKI_ASSERT(hasOccluder());
+
+	indices.resize(m_occluder.m_indexCount);
+	positions.resize(m_occluder.m_vertexCount);
+
+	const PtrSize offset = getOccluderOffset() + sizeof(m_occluder);
+	ANKI_CHECK(readAt(offset, &indices[0], indices.getSizeInBytes()));
+	ANKI_CHECK(readAt(offset + indices.getSizeInBytes(), &positions[0], positions.getSizeInBytes()));
+
+	for(U16 idx : indices)
+	{
+		if(idx >= m_occluder.m_vertexCount)
+		{
+			ANKI_RESOURCE_LOGE("Occluder index out of bounds");
+			return Error::kUserData;
+		}
+	}
+
+	return Error::kNone;
+}
+
+PtrSize MeshBinaryLoader::getOccluderOffset() const
+{
+	PtrSize offset = sizeof(m_header) + sizeof(MeshBinarySubMesh) * m_header.m_subMeshCount;
+	for(U32 lod = 0; lod < m_header.m_lodCount; ++lod)
+	{
+		offset += getLodBuffersSize(lod);
+	}
+
+	return offset;
+}
+
+PtrSize MeshBinaryLoader::getIndexBufferOffset(U32 lod) const
+{
+	ANKI_ASSERT(lod < m_header.m_lodCount);
+
+	// The LODs are stored from the coarser to the finer
+	PtrSize offset = sizeof(m_header) + sizeof(MeshBinarySubMesh) * m_header.m_subMeshCount;
+	for(U32 l = lod + 1; l < m_header.m_lodCount; ++l)
+	{
+		offset += getLodBuffersSize(l);
+	}
+
+	return offset;
+}
+
+PtrSize MeshBinaryLoader::getVertexBufferOffset(U32 lod, U32 bufferIdx) const
+{
+	PtrSize offset = getIndexBufferOffset(lod) + getIndexBufferSize(lod);
+	for(U32 i = 0; i < bufferIdx; ++i)
+	{
+		offset += getVertexBufferSize(lod, i);
+	}
+
+	return offset;
+}
+
+Error MeshBinaryLoader::readAt(PtrSize offset, void* ptr, PtrSize size)
+{
+	// The file size is validated at load time so no need to check the bounds
+	ANKI_ASSERT(offset + size <= m_file->getSize());
+	if(m_mappedFile)
+	{
+		memcpy(ptr, m_mappedFile + offset, size);
+	}
+	else
+	{
+		ANKI_CHECK(m_file->seek(offset, FileSeekOrigin::kBeginning));
+		ANKI_CHECK(m_file->read(ptr, size));
+	}
+
+	return Error::kNone;
+}
+
 PtrSize MeshBinaryLoader::getLodBuffersSize(U32 lod) const
 {
 	ANKI_ASSERT(lod < m_header.m_lodCount);
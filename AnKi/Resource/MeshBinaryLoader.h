@@ -23,6 +23,7 @@ namespace anki {
 /// * Index buffer of max LOD
 /// * Vertex buffer #0 of max LOD
 /// * etc...
+/// * The MeshBinaryOccluder and the occluder's indices and positions if MeshBinaryFlag::kOccluder is set
 class MeshBinaryLoader
 {
 public:
@@ -43,6 +44,14 @@ public:
 	/// Instead of calling storeIndexBuffer and storeVertexBuffer use this method to get those buffers into the CPU.
 	Error storeIndicesAndPosition(U32 lod, ResourceDynamicArray<U32>& indices, ResourceDynamicArray<Vec3>& positions);
 
+	/// Get the indices and the object space positions of the simplified mesh that is used for CPU occlusion culling.
+	Error storeOccluder(ResourceDynamicArray<U16>& indices, ResourceDynamicArray<Vec3>& positions);
+
+	Bool hasOccluder() const
+	{
+		return !!(m_header.m_flags & MeshBinaryFlag::kOccluder);
+	}
+
 	const MeshBinaryHeader& getHeader() const
 	{
 		ANKI_ASSERT(isLoaded());
@@ -56,11 +65,14 @@ public:
 
 private:
 	ResourceFilePtr m_file;
+	const U8* m_mappedFile = nullptr; ///< If the file can be mapped the data are copied straight from its memory.
 
 	MeshBinaryHeader m_header;
 
 	DynamicArray<MeshBinarySubMesh, MemoryPoolPtrWrapper<BaseMemoryPool>> m_subMeshes;
 
+	MeshBinaryOccluder m_occluder = {};
+
 	Bool isLoaded() const
 	{
 		return m_file.get() != nullptr;
@@ -82,9 +94,20 @@ private:
 
 	PtrSize getLodBuffersSize(U32 lod) const;
 
+	PtrSize getIndexBufferOffset(U32 lod) const;
+
+	PtrSize getVertexBufferOffset(U32 lod, U32 bufferIdx) const;
+
+	/// The offset in the file where the LOD data end.
+	PtrSize getOccluderOffset() const;
+
 	Error checkHeader() const;
 	Error checkFormat(VertexStreamId stream, Bool isOptional, Bool canBeTransformed) const;
 	Error loadSubmeshes();
+	Error loadOccluder();
+
+	/// Read from the mapped memory or from the file.
+	Error readAt(PtrSize offset, void* ptr, PtrSize size);
 };
 /// @}
 
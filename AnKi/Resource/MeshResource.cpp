@@ -7,6 +7,8 @@
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/MeshBinaryLoader.h>
 #include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Resource/ResourceStreamer.h>
+#include <AnKi/Core/ConfigSet.h>
 #include <AnKi/Core/GpuMemoryPools.h>
 #include <AnKi/Util/Functions.h>
 #include <AnKi/Util/Filesystem.h>
@@ -16,8 +18,9 @@ namespace anki {
 class MeshResource::LoadContext
 {
 public:
-	MeshResourcePtr m_mesh;
+	MeshResource* m_mesh; ///< Non-owning. The mesh cancels or waits for the task in its destructor.
 	MeshBinaryLoader m_loader;
+	U32 m_firstLod = 0; ///< The first LOD to upload.
 
 	LoadContext(MeshResource* mesh)
 		: m_mesh(mesh)
@@ -39,7 +42,12 @@ public:
 
 	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
 	{
-		return m_ctx.m_mesh->loadAsync(m_ctx.m_loader);
+		MeshResource& mesh = *m_ctx.m_mesh;
+		const Error err = mesh.loadAsync(m_ctx.m_loader, m_ctx.m_firstLod, mesh.getLodCount());
+
+		// Last access of the mesh. After that the mesh's destructor doesn't have to wait for the task
+		mesh.m_loadTaskId.store(0);
+		return err;
 	}
 
 	static BaseMemoryPool& getMemoryPool()
@@ -48,21 +56,147 @@ public:
 	}
 };
 
+/// Loads the finer LODs of a streamed mesh.
+class MeshResource::StreamTask : public AsyncLoaderTask
+{
+public:
+	MeshResource* m_mesh = nullptr;
+	U32 m_firstLod = 0;
+	U32 m_endLod = 0;
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		MeshBinaryLoader loader(&ResourceMemoryPool::getSingleton());
+		if(loader.load(m_mesh->getFilename()) || m_mesh->loadAsync(loader, m_firstLod, m_endLod))
+		{
+			// Don't return the error, it will kill the loader thread. Let the streamer know
+			ANKI_RESOURCE_LOGE("Failed to stream mesh: %s", m_mesh->getFilename().cstr());
+			m_mesh->m_streamedLodsReady.store(kStreamFailed);
+		}
+		else
+		{
+			m_mesh->m_streamedLodsReady.store(kStreamReady);
+		}
+
+		return Error::kNone;
+	}
+};
+
 MeshResource::MeshResource()
 {
 }
 
 MeshResource::~MeshResource()
 {
-	for(Lod& lod : m_lods)
+	if(m_streamerIndex != kMaxU32)
 	{
-		UnifiedGeometryMemoryPool::getSingleton().deferredFree(lod.m_indexBufferAllocationToken);
+		ResourceManager::getSingleton().getResourceStreamer().unregisterMesh(this);
+	}
 
-		for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
+	if(m_streamTaskId)
+	{
+		ResourceManager::getSingleton().getAsyncLoader().cancelTask(m_streamTaskId);
+	}
+
+	const AsyncLoaderTaskId loadTaskId = m_loadTaskId.load();
+	if(loadTaskId)
+	{
+		// The task uses the mesh so remove it or wait for it
+		ResourceManager::getSingleton().getAsyncLoader().cancelTask(loadTaskId);
+	}
+
+	for(U32 l = 0; l < m_lods.getSize(); ++l)
+	{
+		freeLod(l);
+	}
+}
+
+void MeshResource::allocateLod(U32 l, CString basename)
+{
+	Lod& lod = m_lods[l];
+
+	// Index stuff
+	const PtrSize indexBufferSize = PtrSize(lod.m_indexCount) * getIndexSize(m_indexType);
+	UnifiedGeometryMemoryPool::getSingleton().allocate(indexBufferSize, getIndexSize(m_indexType),
+													   lod.m_indexBufferAllocationToken);
+
+	// Vertex stuff
+	for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
+	{
+		if(!isVertexStreamPresent(stream))
 		{
-			UnifiedGeometryMemoryPool::getSingleton().deferredFree(lod.m_vertexBuffersAllocationToken[stream]);
+			continue;
 		}
+
+		const U32 texelSize = getFormatInfo(kMeshRelatedVertexStreamFormats[stream]).m_texelSize;
+		const U32 alignment = max(4u, nextPowerOfTwo(texelSize));
+		const PtrSize vertexBufferSize = PtrSize(lod.m_vertexCount) * texelSize + alignment;
+
+		UnifiedGeometryMemoryPool::getSingleton().allocate(vertexBufferSize, alignment,
+														   lod.m_vertexBuffersAllocationToken[stream]);
+
+		// We need to align the actual offset to the texel size
+		const PtrSize remainder = lod.m_vertexBuffersAllocationToken[stream].m_offset % texelSize;
+		lod.m_fixedUnifiedGeometryBufferOffset[stream] = U8(texelSize - remainder);
+
+		ANKI_ASSERT(
+			(lod.m_vertexBuffersAllocationToken[stream].m_offset + lod.m_fixedUnifiedGeometryBufferOffset[stream])
+				% texelSize
+			== 0);
+		ANKI_ASSERT(lod.m_fixedUnifiedGeometryBufferOffset[stream] + PtrSize(lod.m_vertexCount) * texelSize
+					<= lod.m_vertexBuffersAllocationToken[stream].m_size);
 	}
+
+	// BLAS
+	if(GrManager::getSingleton().getDeviceCapabilities().m_rayTracingEnabled)
+	{
+		AccelerationStructureInitInfo inf(ResourceString().sprintf("%s_%s", "Blas", basename.cstr()));
+		inf.m_type = AccelerationStructureType::kBottomLevel;
+
+		inf.m_bottomLevel.m_indexBuffer = UnifiedGeometryMemoryPool::getSingleton().getBuffer();
+		inf.m_bottomLevel.m_indexBufferOffset = lod.m_indexBufferAllocationToken.m_offset;
+		inf.m_bottomLevel.m_indexCount = lod.m_indexCount;
+		inf.m_bottomLevel.m_indexType = m_indexType;
+		inf.m_bottomLevel.m_positionBuffer = UnifiedGeometryMemoryPool::getSingleton().getBuffer();
+		inf.m_bottomLevel.m_positionBufferOffset = lod.m_vertexBuffersAllocationToken[VertexStreamId::kPosition].m_offset
+												   + lod.m_fixedUnifiedGeometryBufferOffset[VertexStreamId::kPosition];
+		inf.m_bottomLevel.m_positionStride =
+			getFormatInfo(kMeshRelatedVertexStreamFormats[VertexStreamId::kPosition]).m_texelSize;
+		inf.m_bottomLevel.m_positionsFormat = kMeshRelatedVertexStreamFormats[VertexStreamId::kPosition];
+		inf.m_bottomLevel.m_positionCount = lod.m_vertexCount;
+
+		lod.m_blas = GrManager::getSingleton().newAccelerationStructure(inf);
+	}
+}
+
+void MeshResource::freeLod(U32 l)
+{
+	Lod& lod = m_lods[l];
+
+	UnifiedGeometryMemoryPool::getSingleton().deferredFree(lod.m_indexBufferAllocationToken);
+
+	for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
+	{
+		UnifiedGeometryMemoryPool::getSingleton().deferredFree(lod.m_vertexBuffersAllocationToken[stream]);
+	}
+
+	lod.m_blas.reset(nullptr);
+}
+
+PtrSize MeshResource::estimateLodMemory(U32 l) const
+{
+	const Lod& lod = m_lods[l];
+	PtrSize size = PtrSize(lod.m_indexCount) * getIndexSize(m_indexType);
+
+	for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
+	{
+		if(isVertexStreamPresent(stream))
+		{
+			size += PtrSize(lod.m_vertexCount) * getFormatInfo(kMeshRelatedVertexStreamFormats[stream]).m_texelSize;
+		}
+	}
+
+	return size;
 }
 
 Error MeshResource::load(const ResourceFilename& filename, Bool async)
@@ -74,8 +208,6 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	String basename;
 	getFilepathFilename(filename, basename);
 
-	const Bool rayTracingEnabled = GrManager::getSingleton().getDeviceCapabilities().m_rayTracingEnabled;
-
 	if(async)
 	{
 		task.reset(ResourceManager::getSingleton().getAsyncLoader().newTask<LoadTask>(this));
@@ -109,69 +241,50 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 		m_subMeshes[i].m_aabb.setMax(loader.getSubMeshes()[i].m_aabbMax);
 	}
 
-	// LODs
-	m_lods.resize(header.m_lodCount);
-	for(I32 l = I32(header.m_lodCount - 1); l >= 0; --l)
+	// Vertex streams
+	for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
 	{
-		Lod& lod = m_lods[l];
-
-		// Index stuff
-		lod.m_indexCount = header.m_totalIndexCounts[l];
-		ANKI_ASSERT((lod.m_indexCount % 3) == 0 && "Expecting triangles");
-		const PtrSize indexBufferSize = PtrSize(lod.m_indexCount) * getIndexSize(m_indexType);
-		UnifiedGeometryMemoryPool::getSingleton().allocate(indexBufferSize, getIndexSize(m_indexType),
-														   lod.m_indexBufferAllocationToken);
-
-		// Vertex stuff
-		lod.m_vertexCount = header.m_totalVertexCounts[l];
-		for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
+		if(header.m_vertexAttributes[stream].m_format != Format::kNone)
 		{
-			if(header.m_vertexAttributes[stream].m_format == Format::kNone)
-			{
-				continue;
-			}
-
 			m_presentVertStreams |= VertexStreamMask(1 << stream);
+		}
+	}
 
-			const U32 texelSize = getFormatInfo(kMeshRelatedVertexStreamFormats[stream]).m_texelSize;
-			const U32 alignment = max(4u, nextPowerOfTwo(texelSize));
-			const PtrSize vertexBufferSize = PtrSize(lod.m_vertexCount) * texelSize + alignment;
+	// LODs
+	m_lods.resize(header.m_lodCount);
+	for(U32 l = 0; l < header.m_lodCount; ++l)
+	{
+		m_lods[l].m_indexCount = header.m_totalIndexCounts[l];
+		ANKI_ASSERT((m_lods[l].m_indexCount % 3) == 0 && "Expecting triangles");
+		m_lods[l].m_vertexCount = header.m_totalVertexCounts[l];
+	}
 
-			UnifiedGeometryMemoryPool::getSingleton().allocate(vertexBufferSize, alignment,
-															   lod.m_vertexBuffersAllocationToken[stream]);
+	// If streaming is enabled load only the coarsest LOD. The rest will be streamed when they are needed
+	if(async && header.m_lodCount > 1 && ConfigSet::getSingleton().getRsrcMeshStreaming())
+	{
+		m_streamed = true;
+		m_firstResidentLod = U8(header.m_lodCount - 1);
+		m_wantedLod = m_firstResidentLod;
+	}
 
-			// We need to align the actual offset to the texel size
-			const PtrSize remainder = lod.m_vertexBuffersAllocationToken[stream].m_offset % texelSize;
-			lod.m_fixedUnifiedGeometryBufferOffset[stream] = U8(texelSize - remainder);
+	ctx->m_firstLod = m_firstResidentLod;
+	for(I32 l = I32(header.m_lodCount - 1); l >= I32(m_firstResidentLod); --l)
+	{
+		allocateLod(l, basename);
+	}
 
-			ANKI_ASSERT(
-				(lod.m_vertexBuffersAllocationToken[stream].m_offset + lod.m_fixedUnifiedGeometryBufferOffset[stream])
-					% texelSize
-				== 0);
-			ANKI_ASSERT(lod.m_fixedUnifiedGeometryBufferOffset[stream] + PtrSize(lod.m_vertexCount) * texelSize
-						<= lod.m_vertexBuffersAllocationToken[stream].m_size);
-		}
+	// Occluder. It's small so load it now
+	if(loader.hasOccluder())
+	{
+		ResourceDynamicArray<U16> indices;
+		ResourceDynamicArray<Vec3> positions;
+		ANKI_CHECK(loader.storeOccluder(indices, positions));
 
-		// BLAS
-		if(rayTracingEnabled)
+		// Expand it to a triangle list so it can be fed to the rasterizer as is
+		m_occluderTriangles.resize(indices.getSize());
+		for(U32 i = 0; i < indices.getSize(); ++i)
 		{
-			AccelerationStructureInitInfo inf(ResourceString().sprintf("%s_%s", "Blas", basename.cstr()));
-			inf.m_type = AccelerationStructureType::kBottomLevel;
-
-			inf.m_bottomLevel.m_indexBuffer = UnifiedGeometryMemoryPool::getSingleton().getBuffer();
-			inf.m_bottomLevel.m_indexBufferOffset = lod.m_indexBufferAllocationToken.m_offset;
-			inf.m_bottomLevel.m_indexCount = lod.m_indexCount;
-			inf.m_bottomLevel.m_indexType = m_indexType;
-			inf.m_bottomLevel.m_positionBuffer = UnifiedGeometryMemoryPool::getSingleton().getBuffer();
-			inf.m_bottomLevel.m_positionBufferOffset =
-				lod.m_vertexBuffersAllocationToken[VertexStreamId::kPosition].m_offset
-				+ lod.m_fixedUnifiedGeometryBufferOffset[VertexStreamId::kPosition];
-			inf.m_bottomLevel.m_positionStride =
-				getFormatInfo(kMeshRelatedVertexStreamFormats[VertexStreamId::kPosition]).m_texelSize;
-			inf.m_bottomLevel.m_positionsFormat = kMeshRelatedVertexStreamFormats[VertexStreamId::kPosition];
-			inf.m_bottomLevel.m_positionCount = lod.m_vertexCount;
-
-			lod.m_blas = GrManager::getSingleton().newAccelerationStructure(inf);
+			m_occluderTriangles[i] = positions[indices[i]];
 		}
 	}
 
@@ -182,8 +295,9 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 		cmdbinit.m_flags = CommandBufferFlag::kSmallBatch | CommandBufferFlag::kGeneralWork;
 		CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(cmdbinit);
 
-		for(const Lod& lod : m_lods)
+		for(U32 l = m_firstResidentLod; l < m_lods.getSize(); ++l)
 		{
+			const Lod& lod = m_lods[l];
 			cmdb->fillBuffer(UnifiedGeometryMemoryPool::getSingleton().getBuffer(),
 							 lod.m_indexBufferAllocationToken.m_offset,
 							 PtrSize(lod.m_indexCount) * getIndexSize(m_indexType), 0);
@@ -212,20 +326,34 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	// Submit the loading task
 	if(async)
 	{
-		ResourceManager::getSingleton().getAsyncLoader().submitTask(task.get());
+		// Meshes are small and their absence is very visible so load them first
 		LoadTask* pTask;
 		task.moveAndReset(pTask);
+
+		// Set the ID before submitting because the task might finish (and reset it) before submitTask returns
+		m_loadTaskId.store(kMaxU64);
+		const AsyncLoaderTaskId taskId = ResourceManager::getSingleton().getAsyncLoader().submitTask(
+			pTask, AsyncLoaderTaskPriority::kHigh, AsyncLoaderTaskType::kIo);
+		AsyncLoaderTaskId expected = kMaxU64;
+		m_loadTaskId.compareExchange(expected, taskId);
 	}
 	else
 	{
-		ANKI_CHECK(loadAsync(loader));
+		ANKI_CHECK(loadAsync(loader, m_firstResidentLod, m_lods.getSize()));
+	}
+
+	if(m_streamed)
+	{
+		ResourceManager::getSingleton().getResourceStreamer().registerMesh(this);
 	}
 
 	return Error::kNone;
 }
 
-Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
+Error MeshResource::loadAsync(MeshBinaryLoader& loader, U32 firstLod, U32 endLod) const
 {
+	ANKI_ASSERT(firstLod < endLod && endLod <= m_lods.getSize());
+
 	GrManager& gr = GrManager::getSingleton();
 	TransferGpuAllocator& transferAlloc = ResourceManager::getSingleton().getTransferGpuAllocator();
 
@@ -246,7 +374,7 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 	cmdb->setPipelineBarrier({}, {&barrier, 1}, {});
 
 	// Upload index and vertex buffers
-	for(U32 lodIdx = 0; lodIdx < m_lods.getSize(); ++lodIdx)
+	for(U32 lodIdx = firstLod; lodIdx < endLod; ++lodIdx)
 	{
 		const Lod& lod = m_lods[lodIdx];
 
@@ -305,30 +433,31 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 		bufferBarrier.m_nextUsage = unifiedGeometryBufferNonTransferUsage;
 
 		Array<AccelerationStructureBarrierInfo, kMaxLodCount> asBarriers;
-		for(U32 lodIdx = 0; lodIdx < m_lods.getSize(); ++lodIdx)
+		const U32 asBarrierCount = endLod - firstLod;
+		for(U32 lodIdx = firstLod; lodIdx < endLod; ++lodIdx)
 		{
-			asBarriers[lodIdx].m_as = m_lods[lodIdx].m_blas.get();
-			asBarriers[lodIdx].m_previousUsage = AccelerationStructureUsageBit::kNone;
-			asBarriers[lodIdx].m_nextUsage = AccelerationStructureUsageBit::kBuild;
+			asBarriers[lodIdx - firstLod].m_as = m_lods[lodIdx].m_blas.get();
+			asBarriers[lodIdx - firstLod].m_previousUsage = AccelerationStructureUsageBit::kNone;
+			asBarriers[lodIdx - firstLod].m_nextUsage = AccelerationStructureUsageBit::kBuild;
 		}
 
-		cmdb->setPipelineBarrier({}, {&bufferBarrier, 1}, {&asBarriers[0], m_lods.getSize()});
+		cmdb->setPipelineBarrier({}, {&bufferBarrier, 1}, {&asBarriers[0], asBarrierCount});
 
 		// Build BLASes
-		for(U32 lodIdx = 0; lodIdx < m_lods.getSize(); ++lodIdx)
+		for(U32 lodIdx = firstLod; lodIdx < endLod; ++lodIdx)
 		{
 			cmdb->buildAccelerationStructure(m_lods[lodIdx].m_blas);
 		}
 
 		// Barriers again
-		for(U32 lodIdx = 0; lodIdx < m_lods.getSize(); ++lodIdx)
+		for(U32 lodIdx = firstLod; lodIdx < endLod; ++lodIdx)
 		{
-			asBarriers[lodIdx].m_as = m_lods[lodIdx].m_blas.get();
-			asBarriers[lodIdx].m_previousUsage = AccelerationStructureUsageBit::kBuild;
-			asBarriers[lodIdx].m_nextUsage = AccelerationStructureUsageBit::kAllRead;
+			asBarriers[lodIdx - firstLod].m_as = m_lods[lodIdx].m_blas.get();
+			asBarriers[lodIdx - firstLod].m_previousUsage = AccelerationStructureUsageBit::kBuild;
+			asBarriers[lodIdx - firstLod].m_nextUsage = AccelerationStructureUsageBit::kAllRead;
 		}
 
-		cmdb->setPipelineBarrier({}, {}, {&asBarriers[0], m_lods.getSize()});
+		cmdb->setPipelineBarrier({}, {}, {&asBarriers[0], asBarrierCount});
 	}
 	else
 	{
@@ -355,4 +484,65 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 	return Error::kNone;
 }
 
+void MeshResource::submitStreamTask(U32 lod)
+{
+	ANKI_ASSERT(m_streamed && m_streamTaskId == 0 && lod < m_firstResidentLod);
+
+	// Allocate the memory now. Nobody will see it until finishStreaming()
+	String basename;
+	getFilepathFilename(getFilename(), basename);
+	for(U32 l = lod; l < m_firstResidentLod; ++l)
+	{
+		allocateLod(l, basename);
+	}
+
+	StreamTask* task = ResourceManager::getSingleton().getAsyncLoader().newTask<StreamTask>();
+	task->m_mesh = this;
+	task->m_firstLod = lod;
+	task->m_endLod = m_firstResidentLod;
+
+	m_streamTargetLod = U8(lod);
+	m_streamTaskId = ResourceManager::getSingleton().getAsyncLoader().submitTask(task, AsyncLoaderTaskPriority::kLow,
+																				   AsyncLoaderTaskType::kIo);
+}
+
+Bool MeshResource::finishStreaming()
+{
+	ANKI_ASSERT(m_streamedLodsReady.load() != kStreamPending);
+	const Bool failed = m_streamedLodsReady.load() == kStreamFailed;
+	m_streamedLodsReady.store(kStreamPending);
+	m_streamTaskId = 0;
+
+	if(failed)
+	{
+		// Don't try again
+		for(U32 l = m_streamTargetLod; l < m_firstResidentLod; ++l)
+		{
+			freeLod(l);
+		}
+
+		m_minStreamableLod = m_firstResidentLod;
+		return false;
+	}
+
+	m_firstResidentLod = m_streamTargetLod;
+	++m_lodsVersion;
+	return true;
+}
+
+void MeshResource::evictLods(U32 firstResidentLod)
+{
+	ANKI_ASSERT(m_streamed && m_streamTaskId == 0 && firstResidentLod > m_firstResidentLod
+				&& firstResidentLod < m_lods.getSize());
+
+	// The memory is freed in a deferred way so the GPU can keep using it for a few frames
+	for(U32 l = m_firstResidentLod; l < firstResidentLod; ++l)
+	{
+		freeLod(l);
+	}
+
+	m_firstResidentLod = U8(firstResidentLod);
+	++m_lodsVersion;
+}
+
 } // end namespace anki
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <AnKi/Resource/ResourceObject.h>
+#include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/Math.h>
 #include <AnKi/Gr.h>
 #include <AnKi/Collision/Aabb.h>
@@ -44,8 +45,10 @@ public:
 	}
 
 	/// Get submesh info.
+	/// @note If the LOD is not resident the closest coarser LOD is used. See requestLod().
 	void getSubMeshInfo(U32 lod, U32 subMeshId, U32& firstIndex, U32& indexCount, Aabb& aabb) const
 	{
+		lod = getResidentLod(lod);
 		const SubMesh& sm = m_subMeshes[subMeshId];
 		firstIndex = sm.m_firstIndices[lod];
 		indexCount = sm.m_indexCounts[lod];
@@ -53,8 +56,10 @@ public:
 	}
 
 	/// Get all info around vertex indices.
+	/// @note If the LOD is not resident the closest coarser LOD is used. See requestLod().
 	void getIndexBufferInfo(U32 lod, PtrSize& buffOffset, U32& indexCount, IndexType& indexType) const
 	{
+		lod = getResidentLod(lod);
 		buffOffset = m_lods[lod].m_indexBufferAllocationToken.m_offset;
 		ANKI_ASSERT(isAligned(getIndexSize(m_indexType), buffOffset));
 		indexCount = m_lods[lod].m_indexCount;
@@ -62,15 +67,19 @@ public:
 	}
 
 	/// Get vertex buffer info.
+	/// @note If the LOD is not resident the closest coarser LOD is used. See requestLod().
 	void getVertexStreamInfo(U32 lod, VertexStreamId stream, PtrSize& bufferOffset, U32& vertexCount) const
 	{
+		lod = getResidentLod(lod);
 		bufferOffset = m_lods[lod].m_vertexBuffersAllocationToken[stream].m_offset
 					   + m_lods[lod].m_fixedUnifiedGeometryBufferOffset[stream];
 		vertexCount = m_lods[lod].m_vertexCount;
 	}
 
+	/// @note If the LOD is not resident the closest coarser LOD is used. See requestLod().
 	const AccelerationStructurePtr& getBottomLevelAccelerationStructure(U32 lod) const
 	{
+		lod = getResidentLod(lod);
 		ANKI_ASSERT(m_lods[lod].m_blas);
 		return m_lods[lod].m_blas;
 	}
@@ -96,8 +105,43 @@ public:
 		return m_positionsTranslation;
 	}
 
+	/// Get the triangle list of the occluder in object space. It's empty if the mesh has no occluder.
+	ConstWeakArray<Vec3> getOccluderTriangles() const
+	{
+		return m_occluderTriangles;
+	}
+
+	/// True if the fine LODs of the mesh are loaded on demand. See ResourceStreamer.
+	Bool isStreamed() const
+	{
+		return m_streamed;
+	}
+
+	/// Ask for a LOD to be resident. If the mesh is streamed the ResourceStreamer will load it.
+	/// @note It's thread-safe and cheap to call it multiple times per frame.
+	void requestLod(U32 lod) const
+	{
+		if(m_streamed)
+		{
+			m_requestedLod.min(lod);
+		}
+	}
+
+	/// It changes every time the resident LODs change. The users need to query the geometry info again.
+	U32 getLodsVersion() const
+	{
+		return m_lodsVersion;
+	}
+
 private:
+	friend class ResourceStreamer;
+
+	static constexpr U32 kStreamPending = 0;
+	static constexpr U32 kStreamReady = 1;
+	static constexpr U32 kStreamFailed = 2;
+
 	class LoadTask;
+	class StreamTask;
 	class LoadContext;
 
 	class Lod
@@ -130,7 +174,51 @@ private:
 	F32 m_positionsScale = 0.0f;
 	Vec3 m_positionsTranslation = Vec3(0.0f);
 
-	Error loadAsync(MeshBinaryLoader& loader) const;
+	ResourceDynamicArray<Vec3> m_occluderTriangles;
+
+	Atomic<AsyncLoaderTaskId> m_loadTaskId = {0}; ///< Reset by the load task when it's done with the mesh.
+
+	// Streaming
+	Bool m_streamed = false;
+	U8 m_firstResidentLod = 0; ///< The LODs before that are not loaded.
+	U8 m_wantedLod = 0;
+	U8 m_minStreamableLod = 0; ///< Don't try to load LODs finer than that.
+	U32 m_lodsVersion = 0;
+	U32 m_streamerIndex = kMaxU32; ///< Index in ResourceStreamer's array.
+	U64 m_lastRequestFrame = 0;
+	mutable Atomic<U32> m_requestedLod = {kMaxU32};
+
+	AsyncLoaderTaskId m_streamTaskId = 0;
+	U8 m_streamTargetLod = 0;
+	Atomic<U32> m_streamedLodsReady = {kStreamPending};
+
+	U32 getResidentLod(U32 lod) const
+	{
+		ANKI_ASSERT(lod < m_lods.getSize());
+		return max<U32>(lod, m_firstResidentLod);
+	}
+
+	/// Allocate the GPU memory of a LOD.
+	void allocateLod(U32 lod, CString basename);
+
+	/// Free the GPU memory of a LOD.
+	void freeLod(U32 lod);
+
+	/// Estimate the GPU memory of a LOD.
+	PtrSize estimateLodMemory(U32 lod) const;
+
+	/// Upload the LODs in [firstLod, endLod).
+	Error loadAsync(MeshBinaryLoader& loader, U32 firstLod, U32 endLod) const;
+
+	/// Start loading finer LODs. Called by the ResourceStreamer.
+	void submitStreamTask(U32 lod);
+
+	/// Called by the ResourceStreamer when the StreamTask is done. It makes the LODs visible.
+	/// @return True if the resident LODs changed.
+	Bool finishStreaming();
+
+	/// Throw away the finest LODs. Called by the ResourceStreamer.
+	void evictLods(U32 firstResidentLod);
 };
 /// @}
 
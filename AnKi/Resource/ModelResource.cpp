@@ -11,30 +11,47 @@
 
 namespace anki {
 
-void ModelPatch::getRenderingInfo(const RenderingKey& key, ModelRenderingInfo& inf) const
+Bool ModelPatch::getRenderingInfo(const RenderingKey& key, ModelRenderingInfo& inf) const
 {
 	ANKI_ASSERT(!(!supportsSkinning() && key.getSkinned()));
 	const U32 meshLod = min<U32>(key.getLod(), m_meshLodCount - 1);
 
-	// Vertex attributes & bindings
+	// Vertex attributes & bindings. Don't cache them, the mesh might stream its LODs
 	{
-		inf.m_indexBufferOffset = m_lodInfos[meshLod].m_indexBufferOffset;
+		Aabb aabb;
+		m_mesh->getSubMeshInfo(meshLod, m_subMeshIndex, inf.m_firstIndex, inf.m_indexCount, aabb);
+
+		U32 totalIndexCount;
+		IndexType indexType;
+		m_mesh->getIndexBufferInfo(meshLod, inf.m_indexBufferOffset, totalIndexCount, indexType);
 		inf.m_indexType = IndexType::kU16;
-		inf.m_firstIndex = m_lodInfos[meshLod].m_firstIndex;
-		inf.m_indexCount = m_lodInfos[meshLod].m_indexCount;
 
 		for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
 		{
-			inf.m_vertexBufferOffsets[stream] = m_lodInfos[meshLod].m_vertexBufferOffsets[stream];
+			if(m_mesh->isVertexStreamPresent(stream))
+			{
+				U32 vertCount;
+				m_mesh->getVertexStreamInfo(meshLod, stream, inf.m_vertexBufferOffsets[stream], vertCount);
+			}
+			else
+			{
+				inf.m_vertexBufferOffsets[stream] = kMaxPtrSize;
+			}
 		}
 	}
 
 	// Get program
-	const MaterialVariant& variant = m_mtl->getOrCreateVariant(key);
-	inf.m_program = variant.getShaderProgram();
+	const MaterialVariant* variant;
+	if(!m_mtl->tryGetOrCreateVariant(key, variant))
+	{
+		return false;
+	}
+
+	inf.m_program = variant->getShaderProgram();
+	return true;
 }
 
-void ModelPatch::getRayTracingInfo(const RenderingKey& key, ModelRayTracingInfo& info) const
+Bool ModelPatch::getRayTracingInfo(const RenderingKey& key, ModelRayTracingInfo& info) const
 {
 	ANKI_ASSERT(!!(m_mtl->getRenderingTechniques() & RenderingTechniqueBit(1 << key.getRenderingTechnique())));
 
@@ -42,11 +59,25 @@ void ModelPatch::getRayTracingInfo(const RenderingKey& key, ModelRayTracingInfo&
 	const U32 meshLod = min<U32>(key.getLod(), m_meshLodCount - 1);
 	info.m_bottomLevelAccelerationStructure = m_mesh->getBottomLevelAccelerationStructure(meshLod);
 
-	info.m_indexBufferOffset = m_lodInfos[meshLod].m_indexBufferOffset + 2_PtrSize * m_lodInfos[meshLod].m_firstIndex;
+	U32 firstIndex, indexCount;
+	Aabb aabb;
+	m_mesh->getSubMeshInfo(meshLod, m_subMeshIndex, firstIndex, indexCount, aabb);
+
+	PtrSize indexBufferOffset;
+	IndexType indexType;
+	m_mesh->getIndexBufferInfo(meshLod, indexBufferOffset, indexCount, indexType);
+
+	info.m_indexBufferOffset = indexBufferOffset + 2_PtrSize * firstIndex;
 
 	// Material
-	const MaterialVariant& variant = m_mtl->getOrCreateVariant(key);
-	info.m_shaderGroupHandleIndex = variant.getRtShaderGroupHandleIndex();
+	const MaterialVariant* variant;
+	if(!m_mtl->tryGetOrCreateVariant(key, variant))
+	{
+		return false;
+	}
+
+	info.m_shaderGroupHandleIndex = variant->getRtShaderGroupHandleIndex();
+	return true;
 }
 
 Error ModelPatch::init([[maybe_unused]] ModelResource* model, CString meshFName, const CString& mtlFName,
@@ -79,33 +110,9 @@ Error ModelPatch::init([[maybe_unused]] ModelResource* model, CString meshFName,
 		m_mesh->getSubMeshInfo(0, subMeshIndex, firstIndex, indexCount, m_aabb);
 	}
 
+	m_subMeshIndex = (subMeshIndex == kMaxU32) ? 0 : subMeshIndex;
 	m_meshLodCount = m_mesh->getLodCount();
 
-	for(U32 l = 0; l < m_meshLodCount; ++l)
-	{
-		Lod& lod = m_lodInfos[l];
-		Aabb aabb;
-		m_mesh->getSubMeshInfo(l, (subMeshIndex == kMaxU32) ? 0 : subMeshIndex, lod.m_firstIndex, lod.m_indexCount,
-							   aabb);
-
-		U32 totalIndexCount;
-		IndexType indexType;
-		m_mesh->getIndexBufferInfo(l, lod.m_indexBufferOffset, totalIndexCount, indexType);
-
-		for(VertexStreamId stream : EnumIterable(VertexStreamId::kMeshRelatedFirst, VertexStreamId::kMeshRelatedCount))
-		{
-			if(m_mesh->isVertexStreamPresent(stream))
-			{
-				U32 vertCount;
-				m_mesh->getVertexStreamInfo(l, stream, lod.m_vertexBufferOffsets[stream], vertCount);
-			}
-			else
-			{
-				lod.m_vertexBufferOffsets[stream] = kMaxPtrSize;
-			}
-		}
-	}
-
 	return Error::kNone;
 }
 
@@ -181,6 +188,20 @@ Error ModelResource::load(const ResourceFilename& filename, Bool async)
 	} while(modelPatchEl);
 	ANKI_ASSERT(count == m_modelPatches.getSize());
 
+	// The occluder of a mesh covers all of its submeshes. If some patch of the mesh is not opaque the occluder would
+	// hide things that are visible through it
+	for(ModelPatch& patch : m_modelPatches)
+	{
+		patch.m_occluder = patch.m_mesh->getOccluderTriangles().getSize() > 0;
+		for(const ModelPatch& other : m_modelPatches)
+		{
+			if(other.m_mesh == patch.m_mesh && !other.m_mtl->isOpaque())
+			{
+				patch.m_occluder = false;
+			}
+		}
+	}
+
 	// Calculate compound bounding volume
 	m_boundingVolume = m_modelPatches[0].m_aabb;
 	for(auto it = m_modelPatches.getBegin() + 1; it != m_modelPatches.getEnd(); ++it)
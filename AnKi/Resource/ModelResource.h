@@ -65,32 +65,32 @@ public:
 		return m_aabb;
 	}
 
+	/// True if the occluder triangles of the mesh can be used for occlusion culling. The mesh should have them and all
+	/// the patches that share the mesh should have opaque materials.
+	Bool isOccluder() const
+	{
+		return m_occluder;
+	}
+
 	/// Get information for rendering.
-	void getRenderingInfo(const RenderingKey& key, ModelRenderingInfo& inf) const;
+	/// @return False if the shader program is still being created. Skip the drawcall in that case.
+	Bool getRenderingInfo(const RenderingKey& key, ModelRenderingInfo& inf) const;
 
 	/// Get the ray tracing info.
-	void getRayTracingInfo(const RenderingKey& key, ModelRayTracingInfo& info) const;
+	/// @return False if the shader program is still being created.
+	Bool getRayTracingInfo(const RenderingKey& key, ModelRayTracingInfo& info) const;
 
 private:
-	class Lod
-	{
-	public:
-		PtrSize m_indexBufferOffset = kMaxPtrSize;
-		U32 m_firstIndex = kMaxU32;
-		U32 m_indexCount = kMaxU32;
-
-		Array<PtrSize, U32(VertexStreamId::kMeshRelatedCount)> m_vertexBufferOffsets = {};
-	};
-
 #if ANKI_ENABLE_ASSERTIONS
 	ModelResource* m_model = nullptr;
 #endif
 	MaterialResourcePtr m_mtl;
 	MeshResourcePtr m_mesh; ///< Just keep the references.
 
-	Array<Lod, kMaxLodCount> m_lodInfos;
 	Aabb m_aabb;
+	U32 m_subMeshIndex = 0;
 	U32 m_meshLodCount = 0;
+	Bool m_occluder = false;
 
 	[[nodiscard]] Bool supportsSkinning() const
 	{
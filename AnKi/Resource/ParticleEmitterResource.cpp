@@ -132,12 +132,18 @@ Error ParticleEmitterResource::readVar(const XmlElement& rootEl, CString varName
 	return Error::kNone;
 }
 
-void ParticleEmitterResource::getRenderingInfo(const RenderingKey& key_, ShaderProgramPtr& prog) const
+Bool ParticleEmitterResource::getRenderingInfo(const RenderingKey& key_, ShaderProgramPtr& prog) const
 {
 	RenderingKey key = key_;
 	key.setLod(min<U32>(key.getLod(), m_lodCount - 1));
-	const MaterialVariant& variant = m_material->getOrCreateVariant(key);
-	prog = variant.getShaderProgram();
+	const MaterialVariant* variant;
+	if(!m_material->tryGetOrCreateVariant(key, variant))
+	{
+		return false;
+	}
+
+	prog = variant->getShaderProgram();
+	return true;
 }
 
 } // end namespace anki
@@ -118,7 +118,8 @@ public:
 	}
 
 	/// Get program for rendering.
-	void getRenderingInfo(const RenderingKey& key, ShaderProgramPtr& prog) const;
+	/// @return False if the shader program is still being created. Skip the drawcall in that case.
+	Bool getRenderingInfo(const RenderingKey& key, ShaderProgramPtr& prog) const;
 
 	/// Load it
 	Error load(const ResourceFilename& filename, Bool async);
@@ -7,7 +7,8 @@
 #include <AnKi/Util/Filesystem.h>
 #include <AnKi/Core/ConfigSet.h>
 #include <AnKi/Util/Tracer.h>
-#include <ZLib/contrib/minizip/unzip.h>
+#include <AnKi/Util/Thread.h>
+#include <ZLib/zlib.h>
 #if ANKI_OS_ANDROID
 #	include <android_native_app_glue.h>
 #endif
@@ -53,91 +54,140 @@ public:
 	{
 		return m_file.getSize();
 	}
+
+	const U8* map() override
+	{
+		const void* ptr;
+		return (m_file.map(ptr)) ? nullptr : static_cast<const U8*>(ptr);
+	}
 };
 
-/// ZIP file
+// Zip format constants. See the .ZIP File Format Specification
+constexpr U32 kZipEndOfCentralDirSignature = 0x06054b50;
+constexpr U32 kZip64EndOfCentralDirLocatorSignature = 0x07064b50;
+constexpr U32 kZip64EndOfCentralDirSignature = 0x06064b50;
+constexpr U32 kZipCentralDirFileHeaderSignature = 0x02014b50;
+constexpr U32 kZipLocalFileHeaderSignature = 0x04034b50;
+constexpr U32 kZipEndOfCentralDirSize = 22;
+constexpr U32 kZip64EndOfCentralDirLocatorSize = 20;
+constexpr U32 kZip64EndOfCentralDirSize = 56;
+constexpr U32 kZipCentralDirFileHeaderSize = 46;
+constexpr U32 kZipLocalFileHeaderSize = 30;
+constexpr U16 kZip64ExtraFieldId = 1;
+constexpr U16 kZipEncryptedFlag = 1 << 0;
+constexpr U16 kZipStoredMethod = 0;
+constexpr U16 kZipDeflatedMethod = 8;
+
+/// Zip is little endian. Assume the machine is as well.
+template<typename T>
+static T readZipValue(const U8* ptr)
+{
+	T out;
+	memcpy(&out, ptr, sizeof(T));
+	return out;
+}
+
+/// ZIP file. It reads directly from the archive's file that the ResourceFilesystem keeps open. Stored files are plain
+/// positional reads and deflated files are inflated with zlib.
 class ZipResourceFile final : public ResourceFile
 {
 public:
-	unzFile m_archive = nullptr;
-	PtrSize m_size = 0;
+	ResourceFilesystem::Path* m_archive = nullptr;
+	const ResourceFilesystem::ArchivedFile* m_file = nullptr;
+	PtrSize m_dataOffset = 0; ///< Where the file's data start in the archive.
+	PtrSize m_pos = 0; ///< The position in the uncompressed data.
+
+	// Only for deflated files
+	z_stream m_zstream = {};
+	Bool m_zstreamInitialized = false;
+	PtrSize m_compressedPos = 0;
+	Array<U8, 16 * 1024> m_compressedBuff;
 
 	~ZipResourceFile()
 	{
-		if(m_archive)
+		if(m_zstreamInitialized)
 		{
-			// It's open
-			unzClose(m_archive);
-			m_archive = nullptr;
-			m_size = 0;
+			inflateEnd(&m_zstream);
 		}
 	}
 
-	Error open(const CString& archive, const CString& archivedFname)
+	Error open(ResourceFilesystem::Path& archive, const ResourceFilesystem::ArchivedFile& file)
 	{
-		// Open archive
-		m_archive = unzOpen(&archive[0]);
-		if(m_archive == nullptr)
+		m_archive = &archive;
+		m_file = &file;
+
+		// Skip the local header to find the data. Its variable sized fields may differ from the central directory's
+		Array<U8, kZipLocalFileHeaderSize> header;
+		ANKI_CHECK(m_archive->readArchive(file.m_localHeaderOffset, &header[0], header.getSize()));
+		if(readZipValue<U32>(&header[0]) != kZipLocalFileHeaderSignature)
 		{
-			ANKI_RESOURCE_LOGE("Failed to open archive");
+			ANKI_RESOURCE_LOGE("Wrong local file header in archive: %s", archive.m_path.cstr());
 			return Error::kFileAccess;
 		}
 
-		// Locate archived
-		const int caseSensitive = 1;
-		if(unzLocateFile(m_archive, &archivedFname[0], caseSensitive) != UNZ_OK)
+		m_dataOffset = file.m_localHeaderOffset + kZipLocalFileHeaderSize + readZipValue<U16>(&header[26])
+					   + readZipValue<U16>(&header[28]);
+
+		// The central directory checked the data range against the local header's fixed size. Check it again now that
+		// the variable sized fields are known
+		if(m_dataOffset + file.m_compressedSize > archive.m_archive.getSize())
 		{
-			ANKI_RESOURCE_LOGE("Failed to locate file in archive");
+			ANKI_RESOURCE_LOGE("File data out of the archive's bounds: %s", archive.m_path.cstr());
 			return Error::kFileAccess;
 		}
 
-		// Open file
-		if(unzOpenCurrentFile(m_archive) != UNZ_OK)
+		if(file.m_compressionMethod == kZipDeflatedMethod)
+		{
+			// Raw deflate stream, no zlib header
+			if(inflateInit2(&m_zstream, -MAX_WBITS) != Z_OK)
+			{
+				ANKI_RESOURCE_LOGE("inflateInit2() failed");
+				return Error::kFunctionFailed;
+			}
+			m_zstreamInitialized = true;
+		}
+		else if(file.m_compressionMethod != kZipStoredMethod)
 		{
-			ANKI_RESOURCE_LOGE("unzOpenCurrentFile() failed");
+			ANKI_RESOURCE_LOGE("Unsupported compression method in archive: %s", archive.m_path.cstr());
 			return Error::kFileAccess;
 		}
 
-		// Get size just in case
-		unz_file_info zinfo;
-		zinfo.uncompressed_size = 0;
-		unzGetCurrentFileInfo(m_archive, &zinfo, nullptr, 0, nullptr, 0, nullptr, 0);
-		m_size = zinfo.uncompressed_size;
-		ANKI_ASSERT(m_size != 0);
-
 		return Error::kNone;
 	}
 
-	void close()
-	{
-		if(m_archive)
-		{
-			unzClose(m_archive);
-			m_archive = nullptr;
-			m_size = 0;
-		}
-	}
-
 	Error read(void* buff, PtrSize size) override
 	{
 		ANKI_TRACE_SCOPED_EVENT(RsrcFileRead);
 
-		I64 readSize = unzReadCurrentFile(m_archive, buff, U32(size));
-
-		if(I64(size) != readSize)
+		if(m_pos + size > m_file->m_uncompressedSize)
 		{
 			ANKI_RESOURCE_LOGE("File read failed");
 			return Error::kFileAccess;
 		}
 
+		if(size == 0)
+		{
+			return Error::kNone;
+		}
+
+		if(!m_zstreamInitialized)
+		{
+			ANKI_CHECK(m_archive->readArchive(m_dataOffset + m_pos, buff, size));
+		}
+		else
+		{
+			ANKI_CHECK(inflateData(buff, size));
+		}
+
+		m_pos += size;
 		return Error::kNone;
 	}
 
 	Error readAllText(ResourceString& out) override
 	{
-		ANKI_ASSERT(m_size);
-		out = ResourceString('?', m_size);
-		return read(&out[0], m_size);
+		ANKI_ASSERT(m_file->m_uncompressedSize);
+		out = ResourceString('?', m_file->m_uncompressedSize);
+		return read(&out[0], m_file->m_uncompressedSize);
 	}
 
 	Error readU32(U32& u) override
@@ -156,23 +206,50 @@ public:
 
 	Error seek(PtrSize offset, FileSeekOrigin origin) override
 	{
-		// Rewind if needed
+		PtrSize newPos;
 		if(origin == FileSeekOrigin::kBeginning)
 		{
-			if(unzCloseCurrentFile(m_archive) || unzOpenCurrentFile(m_archive))
+			newPos = offset;
+		}
+		else if(origin == FileSeekOrigin::kCurrent)
+		{
+			newPos = m_pos + offset;
+		}
+		else
+		{
+			newPos = m_file->m_uncompressedSize + offset;
+		}
+
+		if(newPos > m_file->m_uncompressedSize)
+		{
+			ANKI_RESOURCE_LOGE("Seek out of bounds");
+			return Error::kFunctionFailed;
+		}
+
+		if(!m_zstreamInitialized)
+		{
+			m_pos = newPos;
+			return Error::kNone;
+		}
+
+		// Deflated. Rewind if needed and then move forward by inflating dummy data
+		if(newPos < m_pos)
+		{
+			if(inflateReset(&m_zstream) != Z_OK)
 			{
 				ANKI_RESOURCE_LOGE("Rewind failed");
 				return Error::kFunctionFailed;
 			}
+
+			m_zstream.avail_in = 0;
+			m_compressedPos = 0;
+			m_pos = 0;
 		}
 
-		// Move forward by reading dummy data
-		Array<char, 128> buff;
-		while(offset != 0)
+		Array<U8, 1024> buff;
+		while(m_pos < newPos)
 		{
-			PtrSize toRead = min<PtrSize>(offset, sizeof(buff));
-			ANKI_CHECK(read(&buff[0], toRead));
-			offset -= toRead;
+			ANKI_CHECK(read(&buff[0], min<PtrSize>(newPos - m_pos, sizeof(buff))));
 		}
 
 		return Error::kNone;
@@ -180,11 +257,215 @@ public:
 
 	PtrSize getSize() const override
 	{
-		ANKI_ASSERT(m_size > 0);
-		return m_size;
+		ANKI_ASSERT(m_file->m_uncompressedSize > 0);
+		return m_file->m_uncompressedSize;
+	}
+
+	const U8* map() override
+	{
+		// Only stored files can point to the archive's memory
+		return (m_zstreamInitialized || !m_archive->m_archiveMemory) ? nullptr
+																	  : m_archive->m_archiveMemory + m_dataOffset;
+	}
+
+private:
+	Error inflateData(void* buff, PtrSize size)
+	{
+		m_zstream.next_out = static_cast<Bytef*>(buff);
+		m_zstream.avail_out = uInt(size);
+
+		while(m_zstream.avail_out > 0)
+		{
+			if(m_zstream.avail_in == 0)
+			{
+				const PtrSize readSize =
+					min<PtrSize>(m_compressedBuff.getSize(), m_file->m_compressedSize - m_compressedPos);
+				if(readSize == 0)
+				{
+					ANKI_RESOURCE_LOGE("Compressed data ended prematurely");
+					return Error::kFileAccess;
+				}
+
+				ANKI_CHECK(m_archive->readArchive(m_dataOffset + m_compressedPos, &m_compressedBuff[0], readSize));
+				m_compressedPos += readSize;
+
+				m_zstream.next_in = &m_compressedBuff[0];
+				m_zstream.avail_in = uInt(readSize);
+			}
+
+			const int ret = inflate(&m_zstream, Z_NO_FLUSH);
+			if(ret == Z_STREAM_END && m_zstream.avail_out > 0)
+			{
+				ANKI_RESOURCE_LOGE("Compressed data ended prematurely");
+				return Error::kFileAccess;
+			}
+			else if(ret != Z_OK && ret != Z_STREAM_END)
+			{
+				ANKI_RESOURCE_LOGE("inflate() failed");
+				return Error::kFileAccess;
+			}
+		}
+
+		return Error::kNone;
 	}
 };
 
+/// Walk the central directory of a zip archive.
+/// @param func A functor with signature Error(CString filename, const ResourceFilesystem::ArchivedFile&).
+template<typename TFunc>
+static Error walkZipCentralDirectory(File& archive, CString archiveFilename, TFunc func)
+{
+	auto corrupted = [&]() {
+		ANKI_RESOURCE_LOGE("Not a zip archive or corrupted: %s", archiveFilename.cstr());
+		return Error::kFileAccess;
+	};
+
+	// Find the end of central directory record. It's at the end of the file, followed by a comment of max 64K
+	const PtrSize fileSize = archive.getSize();
+	if(fileSize < kZipEndOfCentralDirSize)
+	{
+		return corrupted();
+	}
+
+	const PtrSize tailSize = min<PtrSize>(fileSize, kZipEndOfCentralDirSize + kMaxU16);
+	ResourceDynamicArray<U8, PtrSize> tail;
+	tail.resize(tailSize);
+	ANKI_CHECK(archive.readAt(fileSize - tailSize, &tail[0], tailSize));
+
+	PtrSize eocd = kMaxPtrSize;
+	for(PtrSize i = tailSize - kZipEndOfCentralDirSize + 1; i-- > 0;)
+	{
+		if(readZipValue<U32>(&tail[i]) == kZipEndOfCentralDirSignature)
+		{
+			eocd = i;
+			break;
+		}
+	}
+
+	if(eocd == kMaxPtrSize)
+	{
+		return corrupted();
+	}
+
+	U64 entryCount = readZipValue<U16>(&tail[eocd + 10]);
+	U64 dirSize = readZipValue<U32>(&tail[eocd + 12]);
+	U64 dirOffset = readZipValue<U32>(&tail[eocd + 16]);
+
+	if(entryCount == kMaxU16 || dirSize == kMaxU32 || dirOffset == kMaxU32)
+	{
+		// Zip64, the real values are in the zip64 end of central directory record
+		if(eocd < kZip64EndOfCentralDirLocatorSize
+		   || readZipValue<U32>(&tail[eocd - kZip64EndOfCentralDirLocatorSize])
+				  != kZip64EndOfCentralDirLocatorSignature)
+		{
+			return corrupted();
+		}
+
+		const U64 zip64EocdOffset = readZipValue<U64>(&tail[eocd - kZip64EndOfCentralDirLocatorSize + 8]);
+		if(zip64EocdOffset + kZip64EndOfCentralDirSize > fileSize)
+		{
+			return corrupted();
+		}
+
+		Array<U8, kZip64EndOfCentralDirSize> zip64Eocd;
+		ANKI_CHECK(archive.readAt(zip64EocdOffset, &zip64Eocd[0], zip64Eocd.getSize()));
+		if(readZipValue<U32>(&zip64Eocd[0]) != kZip64EndOfCentralDirSignature)
+		{
+			return corrupted();
+		}
+
+		entryCount = readZipValue<U64>(&zip64Eocd[32]);
+		dirSize = readZipValue<U64>(&zip64Eocd[40]);
+		dirOffset = readZipValue<U64>(&zip64Eocd[48]);
+	}
+
+	if(dirOffset + dirSize > fileSize)
+	{
+		return corrupted();
+	}
+
+	// Read the whole central directory at once
+	ResourceDynamicArray<U8, PtrSize> dir;
+	dir.resize(dirSize);
+	if(dirSize)
+	{
+		ANKI_CHECK(archive.readAt(dirOffset, &dir[0], dirSize));
+	}
+
+	PtrSize offset = 0;
+	for(U64 i = 0; i < entryCount; ++i)
+	{
+		if(offset + kZipCentralDirFileHeaderSize > dirSize
+		   || readZipValue<U32>(&dir[offset]) != kZipCentralDirFileHeaderSignature)
+		{
+			return corrupted();
+		}
+
+		const U8* header = &dir[offset];
+		const U16 flags = readZipValue<U16>(header + 8);
+		const U16 nameLength = readZipValue<U16>(header + 28);
+		const U16 extraLength = readZipValue<U16>(header + 30);
+		const U16 commentLength = readZipValue<U16>(header + 32);
+
+		ResourceFilesystem::ArchivedFile file;
+		file.m_compressionMethod = readZipValue<U16>(header + 10);
+		file.m_compressedSize = readZipValue<U32>(header + 20);
+		file.m_uncompressedSize = readZipValue<U32>(header + 24);
+		file.m_localHeaderOffset = readZipValue<U32>(header + 42);
+
+		const PtrSize entrySize = kZipCentralDirFileHeaderSize + nameLength + extraLength + commentLength;
+		if(offset + entrySize > dirSize)
+		{
+			return corrupted();
+		}
+
+		// The zip64 extra field holds the values that didn't fit
+		const U8* extra = header + kZipCentralDirFileHeaderSize + nameLength;
+		U32 extraOffset = 0;
+		while(extraOffset + 4 <= extraLength)
+		{
+			const U16 id = readZipValue<U16>(extra + extraOffset);
+			const U16 size = readZipValue<U16>(extra + extraOffset + 2);
+			const U8* data = extra + extraOffset + 4;
+			if(id == kZip64ExtraFieldId)
+			{
+				U32 dataOffset = 0;
+				for(U64* value : {&file.m_uncompressedSize, &file.m_compressedSize, &file.m_localHeaderOffset})
+				{
+					if(*value == kMaxU32 && dataOffset + 8 <= size)
+					{
+						*value = readZipValue<U64>(data + dataOffset);
+						dataOffset += 8;
+					}
+				}
+			}
+
+			extraOffset += 4 + size;
+		}
+
+		// Reject entries whose data go past the end of the archive. Readers and map() trust these values
+		if(file.m_localHeaderOffset > fileSize
+		   || fileSize - file.m_localHeaderOffset < kZipLocalFileHeaderSize + file.m_compressedSize
+		   || (file.m_compressionMethod == kZipStoredMethod && file.m_compressedSize != file.m_uncompressedSize))
+		{
+			return corrupted();
+		}
+
+		if(flags & kZipEncryptedFlag)
+		{
+			ANKI_RESOURCE_LOGE("Encrypted archives are not supported: %s", archiveFilename.cstr());
+			return Error::kFileAccess;
+		}
+
+		const Char* name = reinterpret_cast<const Char*>(header + kZipCentralDirFileHeaderSize);
+		ANKI_CHECK(func(ResourceString(name, name + nameLength).toCString(), file));
+
+		offset += entrySize;
+	}
+
+	return Error::kNone;
+}
+
 ResourceFilesystem::~ResourceFilesystem()
 {
 }
@@ -228,20 +509,75 @@ Error ResourceFilesystem::init()
 		return Error::kUserData;
 	}
 
-	for(auto& path : paths)
-	{
-		ANKI_CHECK(addNewPath(path.toCString(), excludedStrings));
-	}
-
 #if ANKI_OS_ANDROID
 	// Add the external storage
-	ANKI_CHECK(addNewPath(g_androidApp->activity->externalDataPath, excludedStrings));
+	paths.pushBack(g_androidApp->activity->externalDataPath);
 #endif
 
+	// Gather the files of all paths in parallel. It's I/O bound so use a thread per path
+	class ListPathContext
+	{
+	public:
+		CString m_filepath;
+		const ResourceStringList* m_excludedStrings;
+		Path m_path;
+	};
+
+	const U32 pathCount = U32(paths.getSize());
+	ResourceDynamicArray<ListPathContext> contexts;
+	contexts.resize(pathCount);
+	ResourceDynamicArray<Thread*> threads;
+	threads.resize(pathCount, nullptr);
+
+	U32 i = 0;
+	for(const ResourceString& path : paths)
+	{
+		contexts[i].m_filepath = path.toCString();
+		contexts[i].m_excludedStrings = &excludedStrings;
+		++i;
+	}
+
+	auto listPathCallback = [](ThreadCallbackInfo& info) -> Error {
+		ListPathContext& ctx = *static_cast<ListPathContext*>(info.m_userData);
+		return listPath(ctx.m_filepath, *ctx.m_excludedStrings, ctx.m_path);
+	};
+
+	for(i = 1; i < pathCount; ++i)
+	{
+		threads[i] = newInstance<Thread>(ResourceMemoryPool::getSingleton(), "RsrcFsIndex");
+		threads[i]->start(&contexts[i], listPathCallback);
+	}
+
+	ThreadCallbackInfo info = {&contexts[0], nullptr};
+	Error err = listPathCallback(info);
+
+	for(i = 1; i < pathCount; ++i)
+	{
+		const Error threadErr = threads[i]->join();
+		err = (err) ? err : threadErr;
+		deleteInstance(ResourceMemoryPool::getSingleton(), threads[i]);
+	}
+
+	ANKI_CHECK(err);
+
+	// Index them serially and in order so the paths that come last override the previous ones
+	for(ListPathContext& ctx : contexts)
+	{
+		indexPath(std::move(ctx.m_path));
+	}
+
 	return Error::kNone;
 }
 
 Error ResourceFilesystem::addNewPath(const CString& filepath, const ResourceStringList& excludedStrings)
+{
+	Path path;
+	ANKI_CHECK(listPath(filepath, excludedStrings, path));
+	indexPath(std::move(path));
+	return Error::kNone;
+}
+
+Error ResourceFilesystem::listPath(const CString& filepath, const ResourceStringList& excludedStrings, Path& path)
 {
 	ANKI_RESOURCE_LOGV("Adding new resource path: %s", filepath.cstr());
 
@@ -261,48 +597,30 @@ Error ResourceFilesystem::addNewPath(const CString& filepath, const ResourceStri
 	};
 
 	PtrSize pos;
-	Path path;
 	if((pos = filepath.find(extension)) != CString::kNpos && pos == filepath.getLength() - extension.getLength())
 	{
-		// It's an archive
+		// It's an archive. Keep it open, all its files will be read from that
+		ANKI_CHECK(path.m_archive.open(filepath, FileOpenFlag::kRead | FileOpenFlag::kBinary));
 
-		// Open
-		unzFile zfile = unzOpen(&filepath[0]);
-		if(!zfile)
+		// Also try to map it. The stored files will be accessed directly from there
+		const void* archiveMemory;
+		if(!path.m_archive.map(archiveMemory))
 		{
-			ANKI_RESOURCE_LOGE("Failed to open archive");
-			return Error::kFileAccess;
+			path.m_archiveMemory = static_cast<const U8*>(archiveMemory);
 		}
 
-		// List files
-		if(unzGoToFirstFile(zfile) != UNZ_OK)
-		{
-			unzClose(zfile);
-			ANKI_RESOURCE_LOGE("unzGoToFirstFile() failed. Empty archive?");
-			return Error::kFileAccess;
-		}
+		ANKI_CHECK(walkZipCentralDirectory(path.m_archive, filepath,
+										   [&](CString filename, const ArchivedFile& file) -> Error {
+											   const Bool itsADir = file.m_uncompressedSize == 0;
+											   if(!itsADir && !rejectPath(filename))
+											   {
+												   path.m_files.pushBack(filename);
+												   path.m_archivedFiles.emplaceBack(file);
+												   ++fileCount;
+											   }
 
-		do
-		{
-			Array<char, 1024> filename;
-
-			unz_file_info info;
-			if(unzGetCurrentFileInfo(zfile, &info, &filename[0], filename.getSize(), nullptr, 0, nullptr, 0) != UNZ_OK)
-			{
-				unzClose(zfile);
-				ANKI_RESOURCE_LOGE("unzGetCurrentFileInfo() failed");
-				return Error::kFileAccess;
-			}
-
-			const Bool itsADir = info.uncompressed_size == 0;
-			if(!itsADir && !rejectPath(&filename[0]))
-			{
-				path.m_files.pushBackSprintf("%s", &filename[0]);
-				++fileCount;
-			}
-		} while(unzGoToNextFile(zfile) == UNZ_OK);
-
-		unzClose(zfile);
+											   return Error::kNone;
+										   }));
 
 		path.m_isArchive = true;
 	}
@@ -322,27 +640,104 @@ Error ResourceFilesystem::addNewPath(const CString& filepath, const ResourceStri
 	}
 
 	ANKI_ASSERT(path.m_files.getSize() == fileCount);
+	path.m_path.sprintf("%s", &filepath[0]);
+
+	return Error::kNone;
+}
+
+void ResourceFilesystem::indexPath(Path&& newPath)
+{
+	const U32 fileCount = U32(newPath.m_files.getSize());
 	if(fileCount == 0)
 	{
-		ANKI_RESOURCE_LOGW("Ignoring empty resource path: %s", &filepath[0]);
+		ANKI_RESOURCE_LOGW("Ignoring empty resource path: %s", newPath.m_path.cstr());
+		return;
 	}
-	else
+
+	m_paths.emplaceFront(std::move(newPath));
+	Path& path = m_paths.getFront();
+
+	U32 overriddenCount = 0;
+	U32 fileIdx = 0;
+	for(const ResourceString& fname : path.m_files)
 	{
-		path.m_path.sprintf("%s", &filepath[0]);
-		m_paths.emplaceFront(std::move(path));
+		FileEntry newEntry;
+		newEntry.m_filename = fname.toCString();
+		newEntry.m_path = &path;
+		if(path.m_isArchive)
+		{
+			newEntry.m_archivedFile = &path.m_archivedFiles[fileIdx];
+		}
+		++fileIdx;
+
+		auto it = m_fileIndex.find(newEntry.m_filename);
+		if(it == m_fileIndex.getEnd())
+		{
+			m_fileIndex.emplace(newEntry.m_filename, m_fileEntries.getSize());
+			m_fileEntries.emplaceBack(newEntry);
+			continue;
+		}
+
+		// Walk the entries with the same hash. If the filename is there override it, else append to the chain
+		U32 entryIdx = *it;
+		while(true)
+		{
+			FileEntry& entry = m_fileEntries[entryIdx];
+			if(entry.m_filename == newEntry.m_filename)
+			{
+				newEntry.m_nextWithSameHash = entry.m_nextWithSameHash;
+				entry = newEntry;
+				++overriddenCount;
+				break;
+			}
 
-		ANKI_RESOURCE_LOGI("Added new data path \"%s\" that contains %u files", &filepath[0], fileCount);
+			if(entry.m_nextWithSameHash == kMaxU32)
+			{
+				entry.m_nextWithSameHash = m_fileEntries.getSize();
+				m_fileEntries.emplaceBack(newEntry);
+				break;
+			}
+
+			entryIdx = entry.m_nextWithSameHash;
+		}
 	}
 
-	if(false)
+	ANKI_RESOURCE_LOGI("Added new data path \"%s\" that contains %u files (%u of them override previous paths)",
+					   path.m_path.cstr(), fileCount, overriddenCount);
+}
+
+Error ResourceFilesystem::Path::readArchive(PtrSize offset, void* buff, PtrSize size)
+{
+	ANKI_ASSERT(m_isArchive);
+#if ANKI_POSIX
+	return m_archive.readAt(offset, buff, size);
+#else
+	LockGuard<Mutex> lock(m_archiveMtx);
+	return m_archive.readAt(offset, buff, size);
+#endif
+}
+
+const ResourceFilesystem::FileEntry* ResourceFilesystem::findFile(const CString& filename) const
+{
+	auto it = m_fileIndex.find(filename);
+	if(it == m_fileIndex.getEnd())
+	{
+		return nullptr;
+	}
+
+	U32 entryIdx = *it;
+	do
 	{
-		for(const ResourceString& s : m_paths.getFront().m_files)
+		const FileEntry& entry = m_fileEntries[entryIdx];
+		if(entry.m_filename == filename)
 		{
-			printf("%s\n", s.cstr());
+			return &entry;
 		}
-	}
 
-	return Error::kNone;
+		entryIdx = entry.m_nextWithSameHash;
+	} while(entryIdx != kMaxU32);
+
+	return nullptr;
 }
 
 Error ResourceFilesystem::openFile(const ResourceFilename& filename, ResourceFilePtr& filePtr)
@@ -368,44 +763,31 @@ Error ResourceFilesystem::openFileInternal(const ResourceFilename& filename, Res
 {
 	rfile = nullptr;
 
-	// Search for the fname in reverse order
-	for(const Path& p : m_paths)
+	const FileEntry* entry = findFile(filename);
+	if(entry)
 	{
-		for(const ResourceString& pfname : p.m_files)
+		Path& p = *entry->m_path;
+		if(p.m_isArchive)
 		{
-			if(pfname != filename)
-			{
-				continue;
-			}
+			ZipResourceFile* file = newInstance<ZipResourceFile>(ResourceMemoryPool::getSingleton());
+			rfile = file;
 
-			// Found
-			if(p.m_isArchive)
-			{
-				ZipResourceFile* file = newInstance<ZipResourceFile>(ResourceMemoryPool::getSingleton());
-				rfile = file;
-
-				ANKI_CHECK(file->open(p.m_path.toCString(), filename));
-			}
-			else
-			{
-				ResourceString newFname;
-				newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
+			ANKI_CHECK(file->open(p, *entry->m_archivedFile));
+		}
+		else
+		{
+			ResourceString newFname;
+			newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
 
-				CResourceFile* file = newInstance<CResourceFile>(ResourceMemoryPool::getSingleton());
-				rfile = file;
-				ANKI_CHECK(file->m_file.open(newFname, FileOpenFlag::kRead));
+			CResourceFile* file = newInstance<CResourceFile>(ResourceMemoryPool::getSingleton());
+			rfile = file;
+			ANKI_CHECK(file->m_file.open(newFname, FileOpenFlag::kRead));
 
 #if 0
-				printf("Opening asset %s\n", &newFname[0]);
+			printf("Opening asset %s\n", &newFname[0]);
 #endif
-			}
-		}
-
-		if(rfile)
-		{
-			break;
 		}
-	} // end for all paths
+	}
 
 	// File not found? On Win/Linux try to find it outside the resource dirs. On Android try the archive
 	if(!rfile)
@@ -10,6 +10,8 @@
 #include <AnKi/Util/StringList.h>
 #include <AnKi/Util/File.h>
 #include <AnKi/Util/Ptr.h>
+#include <AnKi/Util/HashMap.h>
+#include <AnKi/Util/Thread.h>
 
 namespace anki {
 
@@ -50,6 +52,14 @@ public:
 	/// Get the size of the file.
 	virtual PtrSize getSize() const = 0;
 
+	/// Map the whole file to memory. The memory is read-only and it stays valid for the lifetime of the ResourceFile.
+	/// It doesn't touch the position indicator. Some files can't be mapped (compressed archived files for example), in
+	/// that case it returns nullptr and read() should be used instead.
+	virtual const U8* map()
+	{
+		return nullptr;
+	}
+
 	void retain() const
 	{
 		m_refcount.fetchAdd(1);
@@ -76,9 +86,12 @@ public:
 
 using ResourceFilePtr = IntrusivePtr<ResourceFile, ResourceFileDeleter>;
 
-/// Resource filesystem.
+/// Resource filesystem. All the files of the paths are indexed in a single hash map so finding a file doesn't depend on
+/// the number of files.
 class ResourceFilesystem
 {
+	friend class ZipResourceFile;
+
 public:
 	ResourceFilesystem() = default;
 
@@ -110,11 +123,25 @@ public:
 #if !ANKI_TESTS
 private:
 #endif
+	/// A file inside an archive. Gathered from the archive's central directory when the archive is indexed.
+	class ArchivedFile
+	{
+	public:
+		U64 m_localHeaderOffset = 0;
+		U64 m_compressedSize = 0;
+		U64 m_uncompressedSize = 0;
+		U16 m_compressionMethod = 0;
+	};
+
 	class Path
 	{
 	public:
 		ResourceStringList m_files; ///< Files inside the directory.
+		ResourceDynamicArray<ArchivedFile> m_archivedFiles; ///< One for each of m_files if it's an archive.
 		ResourceString m_path; ///< A directory or an archive.
+		File m_archive; ///< If it's an archive it stays open for the lifetime of the filesystem.
+		const U8* m_archiveMemory = nullptr; ///< The archive mapped to memory. nullptr if it couldn't be mapped.
+		Mutex m_archiveMtx; ///< Serializes the archive reads on platforms without positional reads.
 		Bool m_isArchive = false;
 
 		Path() = default;
@@ -131,18 +158,45 @@ private:
 		Path& operator=(Path&& b)
 		{
 			m_files = std::move(b.m_files);
+			m_archivedFiles = std::move(b.m_archivedFiles);
 			m_path = std::move(b.m_path);
+			m_archive = std::move(b.m_archive);
+			m_archiveMemory = b.m_archiveMemory;
 			m_isArchive = b.m_isArchive;
 			return *this;
 		}
+
+		/// Read from the archive. It's thread-safe.
+		Error readArchive(PtrSize offset, void* buff, PtrSize size);
+	};
+
+	/// An entry of the file index.
+	class FileEntry
+	{
+	public:
+		CString m_filename; ///< Points to one of the strings of Path::m_files.
+		Path* m_path = nullptr;
+		const ArchivedFile* m_archivedFile = nullptr; ///< Points to one of Path::m_archivedFiles.
+		U32 m_nextWithSameHash = kMaxU32; ///< The next entry whose filename has the same hash.
 	};
 
 	ResourceList<Path> m_paths;
 	ResourceString m_cacheDir;
 
+	ResourceDynamicArray<FileEntry> m_fileEntries; ///< Holds a single entry for every unique filename.
+	ResourceHashMap<CString, U32> m_fileIndex; ///< Filename hash to the 1st entry of m_fileEntries with that hash.
+
 	/// Add a filesystem path or an archive. The path is read-only.
 	Error addNewPath(const CString& path, const ResourceStringList& excludedStrings);
 
+	/// Gather the files of a filesystem path or an archive. It's thread-safe.
+	static Error listPath(const CString& filepath, const ResourceStringList& excludedStrings, Path& path);
+
+	/// Add the files of a path to the index. They override the files of the paths that were indexed before.
+	void indexPath(Path&& path);
+
+	const FileEntry* findFile(const CString& filename) const;
+
 	Error openFileInternal(const ResourceFilename& filename, ResourceFile*& rfile);
 };
 /// @}
@@ -5,6 +5,7 @@
 
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Resource/ResourceStreamer.h>
 #include <AnKi/Resource/ShaderProgramResourceSystem.h>
 #include <AnKi/Resource/AnimationResource.h>
 #include <AnKi/Util/Logger.h>
@@ -33,8 +34,10 @@ ResourceManager::~ResourceManager()
 {
 	ANKI_RESOURCE_LOGI("Destroying resource manager");
 
-	deleteInstance(ResourceMemoryPool::getSingleton(), m_asyncLoader);
+	// The shader program system holds programs that might have tasks in the async loader. Delete it first
 	deleteInstance(ResourceMemoryPool::getSingleton(), m_shaderProgramSystem);
+	deleteInstance(ResourceMemoryPool::getSingleton(), m_asyncLoader);
+	deleteInstance(ResourceMemoryPool::getSingleton(), m_streamer);
 	deleteInstance(ResourceMemoryPool::getSingleton(), m_transferGpuAlloc);
 	deleteInstance(ResourceMemoryPool::getSingleton(), m_fs);
 
@@ -51,7 +54,11 @@ Error ResourceManager::init(AllocAlignedCallback allocCallback, void* allocCallb
 	ANKI_CHECK(m_fs->init());
 
 	// Init the thread
-	m_asyncLoader = newInstance<AsyncLoader>(ResourceMemoryPool::getSingleton());
+	m_asyncLoader = newInstance<AsyncLoader>(ResourceMemoryPool::getSingleton(),
+											 ConfigSet::getSingleton().getRsrcAsyncLoaderIoThreadCount(),
+											 ConfigSet::getSingleton().getRsrcAsyncLoaderCpuThreadCount());
+
+	m_streamer = newInstance<ResourceStreamer>(ResourceMemoryPool::getSingleton());
 
 	m_transferGpuAlloc = newInstance<TransferGpuAllocator>(ResourceMemoryPool::getSingleton());
 	ANKI_CHECK(m_transferGpuAlloc->init(ConfigSet::getSingleton().getRsrcTransferScratchMemorySize()));
@@ -68,15 +75,16 @@ U64 ResourceManager::getAsyncTaskCompletedCount() const
 	return m_asyncLoader->getCompletedTaskCount();
 }
 
-template<typename T>
-Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out, Bool async)
+template<typename T, typename TFilter, typename TLoadFunc>
+Error ResourceManager::loadResourceInternal(const CString& filename, ResourcePtr<T>& out, TFilter filter,
+											TLoadFunc loadFunc)
 {
 	ANKI_ASSERT(!out.isCreated() && "Already loaded");
 
 	Error err = Error::kNone;
 	++m_loadRequestCount;
 
-	T* const other = findLoadedResource<T>(filename);
+	T* const other = TypeResourceManager<T>::findLoadedResource(filename, filter);
 
 	if(other)
 	{
@@ -92,7 +100,7 @@ Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out
 		// Increment the refcount in that case where async jobs increment it and decrement it in the scope of a load()
 		ptr->retain();
 
-		err = ptr->load(filename, async);
+		err = loadFunc(*ptr);
 		if(err)
 		{
 			ANKI_RESOURCE_LOGE("Failed to load resource: %s", &filename[0]);
@@ -114,6 +122,39 @@ Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out
 	return err;
 }
 
+template<typename T>
+Error ResourceManager::loadResource(const CString& filename, ResourcePtr<T>& out, Bool async)
+{
+	auto filter = []([[maybe_unused]] const T& rsrc) {
+		if constexpr(std::is_same_v<T, ImageResource>)
+		{
+			return !rsrc.isStreamable();
+		}
+		else
+		{
+			return true;
+		}
+	};
+
+	return loadResourceInternal(filename, out, filter, [&](T& rsrc) {
+		return rsrc.load(filename, async);
+	});
+}
+
+Error ResourceManager::loadStreamableImage(const CString& filename, ImageResourcePtr& out, Bool async)
+{
+	// Without streaming it's a plain image that can be shared with loadResource()
+	const Bool streamable = async && ConfigSet::getSingleton().getRsrcTextureStreaming();
+
+	auto filter = [streamable](const ImageResource& image) {
+		return image.isStreamable() == streamable;
+	};
+
+	return loadResourceInternal(filename, out, filter, [&](ImageResource& image) {
+		return image.load(filename, async, streamable);
+	});
+}
+
 // Instansiate the ResourceManager::loadResource()
 #define ANKI_INSTANTIATE_RESOURCE(rsrc_, ptr_) \
 	template Error ResourceManager::loadResource<rsrc_>(const CString& filename, ResourcePtr<rsrc_>& out, Bool async);
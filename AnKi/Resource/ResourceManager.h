@@ -8,6 +8,7 @@
 #include <AnKi/Resource/TransferGpuAllocator.h>
 #include <AnKi/Resource/ResourceFilesystem.h>
 #include <AnKi/Util/List.h>
+#include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/Functions.h>
 #include <AnKi/Util/String.h>
 
@@ -18,6 +19,7 @@ class GrManager;
 class PhysicsWorld;
 class ResourceManager;
 class AsyncLoader;
+class ResourceStreamer;
 class ResourceManagerModel;
 class ShaderCompilerCache;
 class ShaderProgramResourceSystem;
@@ -26,8 +28,10 @@ class UnifiedGeometryMemoryPool;
 /// @addtogroup resource
 /// @{
 
-/// Manage resources of a certain type
-template<typename Type>
+/// Manage resources of a certain type. The resources are indexed by the hash of their filename so all operations are
+/// O(1) no matter how many resources are loaded.
+/// @tparam THasher The hash function of the filenames. Only the tests change it.
+template<typename Type, typename THasher = DefaultHasher<CString>>
 class TypeResourceManager
 {
 protected:
@@ -37,48 +41,110 @@ protected:
 
 	~TypeResourceManager()
 	{
-		ANKI_ASSERT(m_ptrs.isEmpty() && "Forgot to delete some resources");
+		ANKI_ASSERT(m_ptrs.isEmpty() && m_hashCollisions.isEmpty() && "Forgot to delete some resources");
 		m_ptrs.destroy();
+		m_hashCollisions.destroy();
 	}
 
 	Type* findLoadedResource(const CString& filename)
 	{
-		auto it = find(filename);
-		return (it != m_ptrs.end()) ? *it : nullptr;
+		return findLoadedResource(filename, []([[maybe_unused]] const Type& rsrc) {
+			return true;
+		});
 	}
 
-	void registerResource(Type* ptr)
+	/// Find a resource with that filename that also passes the filter. Resources of the same file that were loaded in
+	/// different ways (eg streamable images) are different resources.
+	template<typename TFilter>
+	Type* findLoadedResource(const CString& filename, TFilter filter)
 	{
-		ANKI_ASSERT(find(ptr->getFilename()) == m_ptrs.getEnd());
-		m_ptrs.pushBack(ptr);
-	}
+		auto it = m_ptrs.find(filename);
+		if(it == m_ptrs.getEnd())
+		{
+			return nullptr;
+		}
 
-	void unregisterResource(Type* ptr)
-	{
-		auto it = find(ptr->getFilename());
-		ANKI_ASSERT(it != m_ptrs.end());
-		m_ptrs.erase(it);
+		if((*it)->getFilename() == filename && filter(**it))
+		{
+			return *it;
+		}
+
+		// Some other resource has the same hash, search the collisions
+		for(Type* ptr : m_hashCollisions)
+		{
+			if(ptr->getFilename() == filename && filter(*ptr))
+			{
+				return ptr;
+			}
+		}
+
+		return nullptr;
 	}
 
-private:
-	using Container = ResourceList<Type*>;
+	void registerResource(Type* ptr)
+	{
+		ANKI_ASSERT(findLoadedResource(ptr->getFilename(), [ptr](const Type& other) {
+						return &other == ptr;
+					}) == nullptr);
 
-	Container m_ptrs;
+		auto it = m_ptrs.find(ptr->getFilename());
+		if(it == m_ptrs.getEnd()) [[likely]]
+		{
+			m_ptrs.emplace(ptr->getFilename(), ptr);
+		}
+		else
+		{
+			m_hashCollisions.pushBack(ptr);
+		}
+	}
 
-	typename Container::Iterator find(const CString& filename)
+	void unregisterResource(Type* ptr)
 	{
-		typename Container::Iterator it;
+		auto it = m_ptrs.find(ptr->getFilename());
+		ANKI_ASSERT(it != m_ptrs.getEnd());
 
-		for(it = m_ptrs.getBegin(); it != m_ptrs.getEnd(); ++it)
+		if(*it == ptr) [[likely]]
 		{
-			if((*it)->getFilename() == filename)
+			// Move a resource with the same hash (if any) to the map
+			const U64 hash = THasher()(ptr->getFilename());
+			for(auto cit = m_hashCollisions.getBegin(); cit != m_hashCollisions.getEnd(); ++cit)
 			{
-				break;
+				if(THasher()((*cit)->getFilename()) == hash)
+				{
+					*it = *cit;
+					m_hashCollisions.erase(cit);
+					return;
+				}
 			}
+
+			m_ptrs.erase(it);
 		}
+		else
+		{
+			auto cit = m_hashCollisions.getBegin();
+			while(cit != m_hashCollisions.getEnd() && *cit != ptr)
+			{
+				++cit;
+			}
+
+			ANKI_ASSERT(cit != m_hashCollisions.getEnd());
+			m_hashCollisions.erase(cit);
+		}
+	}
+
+	U32 getLoadedResourceCount() const
+	{
+		return U32(m_ptrs.getSize() + m_hashCollisions.getSize());
+	}
 
-		return it;
+	U32 getHashCollisionCount() const
+	{
+		return U32(m_hashCollisions.getSize());
 	}
+
+private:
+	ResourceHashMap<CString, Type*, THasher> m_ptrs; ///< The key is the hash of the filename.
+	ResourceList<Type*> m_hashCollisions; ///< Resources whose filename hash is already in m_ptrs. Rare.
 };
 
 /// Resource manager. It holds a few global variables
@@ -109,6 +175,12 @@ public:
 	template<typename T>
 	Error loadResource(const CString& filename, ResourcePtr<T>& out, Bool async = true);
 
+	/// Load an image that the ResourceStreamer can stream. Only the small mipmaps are loaded and the rest come when
+	/// someone calls ImageResource::requestResolution(). The texture and the texture view of the image will change so
+	/// only consumers that request a resolution every frame and handle the changes should use it (eg materials).
+	/// loadResource() never returns such images.
+	Error loadStreamableImage(const CString& filename, ImageResourcePtr& out, Bool async = true);
+
 	// Internals:
 
 	ANKI_INTERNAL TransferGpuAllocator& getTransferGpuAllocator()
@@ -134,11 +206,23 @@ public:
 		TypeResourceManager<T>::unregisterResource(ptr);
 	}
 
+	/// Get the number of resources of a certain type that are currently loaded.
+	template<typename T>
+	ANKI_INTERNAL U32 getLoadedResourceCount() const
+	{
+		return TypeResourceManager<T>::getLoadedResourceCount();
+	}
+
 	ANKI_INTERNAL AsyncLoader& getAsyncLoader()
 	{
 		return *m_asyncLoader;
 	}
 
+	ANKI_INTERNAL ResourceStreamer& getResourceStreamer()
+	{
+		return *m_streamer;
+	}
+
 	/// Get the number of times loadResource() was called.
 	ANKI_INTERNAL U64 getLoadingRequestCount() const
 	{
@@ -154,6 +238,11 @@ public:
 		return *m_shaderProgramSystem;
 	}
 
+	ANKI_INTERNAL ShaderProgramResourceSystem& getShaderProgramResourceSystem()
+	{
+		return *m_shaderProgramSystem;
+	}
+
 	ANKI_INTERNAL ResourceFilesystem& getFilesystem()
 	{
 		return *m_fs;
@@ -162,6 +251,7 @@ public:
 private:
 	ResourceFilesystem* m_fs = nullptr;
 	AsyncLoader* m_asyncLoader = nullptr; ///< Async loading thread
+	ResourceStreamer* m_streamer = nullptr;
 	ShaderProgramResourceSystem* m_shaderProgramSystem = nullptr;
 	TransferGpuAllocator* m_transferGpuAlloc = nullptr;
 
@@ -171,6 +261,9 @@ private:
 	ResourceManager();
 
 	~ResourceManager();
+
+	template<typename T, typename TFilter, typename TLoadFunc>
+	Error loadResourceInternal(const CString& filename, ResourcePtr<T>& out, TFilter filter, TLoadFunc loadFunc);
 };
 /// @}
 
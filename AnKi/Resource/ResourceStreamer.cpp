@@ -0,0 +1,356 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Resource/ResourceStreamer.h>
+#include <AnKi/Resource/ImageResource.h>
+#include <AnKi/Resource/MaterialResource.h>
+#include <AnKi/Resource/MeshResource.h>
+#include <AnKi/Core/ConfigSet.h>
+#include <AnKi/Util/Tracer.h>
+
+namespace anki {
+
+ResourceStreamer::~ResourceStreamer()
+{
+	ANKI_ASSERT(m_images.getSize() == 0 && m_materials.getSize() == 0 && m_meshes.getSize() == 0
+				&& "Forgot to unregister some resources");
+}
+
+void ResourceStreamer::registerImage(ImageResource* image)
+{
+	ANKI_ASSERT(image && image->m_streamerIndex == kMaxU32);
+	LockGuard<Mutex> lock(m_mtx);
+	image->m_streamerIndex = m_images.getSize();
+	m_images.emplaceBack(image);
+}
+
+void ResourceStreamer::unregisterImage(ImageResource* image)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	const U32 idx = image->m_streamerIndex;
+	ANKI_ASSERT(idx < m_images.getSize() && m_images[idx] == image);
+
+	// Swap with the last
+	m_images[idx] = m_images.getBack();
+	m_images[idx]->m_streamerIndex = idx;
+	m_images.popBack();
+	image->m_streamerIndex = kMaxU32;
+}
+
+void ResourceStreamer::registerMaterial(MaterialResource* mtl)
+{
+	ANKI_ASSERT(mtl && mtl->m_streamerIndex == kMaxU32);
+	LockGuard<Mutex> lock(m_mtx);
+	mtl->m_streamerIndex = m_materials.getSize();
+	m_materials.emplaceBack(mtl);
+}
+
+void ResourceStreamer::unregisterMaterial(MaterialResource* mtl)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	const U32 idx = mtl->m_streamerIndex;
+	ANKI_ASSERT(idx < m_materials.getSize() && m_materials[idx] == mtl);
+
+	m_materials[idx] = m_materials.getBack();
+	m_materials[idx]->m_streamerIndex = idx;
+	m_materials.popBack();
+	mtl->m_streamerIndex = kMaxU32;
+}
+
+void ResourceStreamer::registerMesh(MeshResource* mesh)
+{
+	ANKI_ASSERT(mesh && mesh->m_streamerIndex == kMaxU32);
+	LockGuard<Mutex> lock(m_mtx);
+	mesh->m_streamerIndex = m_meshes.getSize();
+	m_meshes.emplaceBack(mesh);
+}
+
+void ResourceStreamer::unregisterMesh(MeshResource* mesh)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	const U32 idx = mesh->m_streamerIndex;
+	ANKI_ASSERT(idx < m_meshes.getSize() && m_meshes[idx] == mesh);
+
+	m_meshes[idx] = m_meshes.getBack();
+	m_meshes[idx]->m_streamerIndex = idx;
+	m_meshes.popBack();
+	mesh->m_streamerIndex = kMaxU32;
+}
+
+void ResourceStreamer::update()
+{
+	ANKI_TRACE_SCOPED_EVENT(RsrcStreaming);
+
+	LockGuard<Mutex> lock(m_mtx);
+	++m_frame;
+
+	updateImages();
+	updateMeshes();
+}
+
+void ResourceStreamer::updateImages()
+{
+	if(m_images.getSize() == 0)
+	{
+		m_streamedImageMemory = 0;
+		return;
+	}
+
+	// Gather the finished tasks and the requests of the previous frame
+	ResourceDynamicArray<Bool> changedImages; // Indexed by ImageResource::m_streamerIndex
+	PtrSize memory = 0;
+	U32 tasksInFlight = 0;
+	for(ImageResource* image : m_images)
+	{
+		if(image->m_streamTaskId)
+		{
+			if(image->m_streamedTexReady.load() != ImageResource::kStreamPending)
+			{
+				if(image->finishStreaming())
+				{
+					if(changedImages.getSize() == 0)
+					{
+						changedImages.resize(m_images.getSize(), false);
+					}
+
+					changedImages[image->m_streamerIndex] = true;
+				}
+			}
+			else
+			{
+				++tasksInFlight;
+			}
+		}
+
+		const U32 pixels = image->m_requestedResolution.exchange(0);
+		if(pixels)
+		{
+			image->m_wantedMip = U8(image->computeMipForResolution(pixels));
+			image->m_lastRequestFrame = m_frame;
+		}
+
+		memory += image->estimateMemory(image->m_residentMip);
+	}
+
+	const PtrSize budget = ConfigSet::getSingleton().getRsrcTextureStreamingBudget();
+	ResourceDynamicArray<ImageResource*> candidates;
+
+	// Evict the least recently used if over budget
+	if(memory > budget)
+	{
+		for(ImageResource* image : m_images)
+		{
+			const Bool unused = image->m_lastRequestFrame + kEvictionFrameDelay < m_frame;
+			const U32 targetMip = (unused) ? image->m_initialMip : image->m_wantedMip;
+			if(image->m_streamTaskId == 0 && targetMip > image->m_residentMip)
+			{
+				candidates.emplaceBack(image);
+			}
+		}
+
+		std::sort(candidates.getBegin(), candidates.getEnd(), [](const ImageResource* a, const ImageResource* b) {
+			return a->m_lastRequestFrame < b->m_lastRequestFrame;
+		});
+
+		for(ImageResource* image : candidates)
+		{
+			if(memory <= budget)
+			{
+				break;
+			}
+
+			const Bool unused = image->m_lastRequestFrame + kEvictionFrameDelay < m_frame;
+			const U32 targetMip = (unused) ? image->m_initialMip : image->m_wantedMip;
+
+			memory -= image->estimateMemory(image->m_residentMip) - image->estimateMemory(targetMip);
+			image->submitStreamTask(targetMip);
+			++tasksInFlight;
+		}
+
+		candidates.destroy();
+	}
+
+	// Stream in the images that need more resolution. The ones that miss the most mipmaps go first
+	for(ImageResource* image : m_images)
+	{
+		if(image->m_streamTaskId == 0 && image->m_wantedMip < image->m_residentMip
+		   && image->m_residentMip > image->m_minStreamableMip)
+		{
+			candidates.emplaceBack(image);
+		}
+	}
+
+	std::sort(candidates.getBegin(), candidates.getEnd(), [](const ImageResource* a, const ImageResource* b) {
+		return a->m_residentMip - a->m_wantedMip > b->m_residentMip - b->m_wantedMip;
+	});
+
+	for(ImageResource* image : candidates)
+	{
+		if(tasksInFlight >= kMaxTasksInFlight)
+		{
+			break;
+		}
+
+		const U32 targetMip = max<U32>(image->m_wantedMip, image->m_minStreamableMip);
+		const PtrSize extraMemory = image->estimateMemory(targetMip) - image->estimateMemory(image->m_residentMip);
+		if(memory + extraMemory > budget)
+		{
+			continue;
+		}
+
+		memory += extraMemory;
+		image->submitStreamTask(targetMip);
+		++tasksInFlight;
+	}
+
+	// The bindless indices of the textures are baked in the materials, update the ones that use the changed images
+	if(changedImages.getSize())
+	{
+		for(MaterialResource* mtl : m_materials)
+		{
+			for(const ImageResource* image : mtl->m_streamedImages)
+			{
+				if(changedImages[image->m_streamerIndex])
+				{
+					mtl->refreshStreamedTextures();
+					++m_version;
+					break;
+				}
+			}
+		}
+	}
+
+	m_streamedImageMemory = memory;
+	ANKI_TRACE_INC_COUNTER(RsrcStreamedTextureMemory, memory);
+	ANKI_TRACE_INC_COUNTER(RsrcTextureStreamingTasksInFlight, tasksInFlight);
+}
+
+void ResourceStreamer::updateMeshes()
+{
+	if(m_meshes.getSize() == 0)
+	{
+		m_streamedMeshMemory = 0;
+		return;
+	}
+
+	// Gather the finished tasks and the requests of the previous frame
+	PtrSize memory = 0;
+	U32 tasksInFlight = 0;
+	for(MeshResource* mesh : m_meshes)
+	{
+		if(mesh->m_streamTaskId)
+		{
+			if(mesh->m_streamedLodsReady.load() != MeshResource::kStreamPending)
+			{
+				if(mesh->finishStreaming())
+				{
+					++m_version;
+				}
+			}
+			else
+			{
+				++tasksInFlight;
+			}
+		}
+
+		const U32 lod = mesh->m_requestedLod.exchange(kMaxU32);
+		if(lod != kMaxU32)
+		{
+			mesh->m_wantedLod = U8(min(lod, mesh->getLodCount() - 1));
+			mesh->m_lastRequestFrame = m_frame;
+		}
+
+		for(U32 l = mesh->m_firstResidentLod; l < mesh->getLodCount(); ++l)
+		{
+			memory += mesh->estimateLodMemory(l);
+		}
+	}
+
+	const PtrSize budget = ConfigSet::getSingleton().getRsrcMeshStreamingBudget();
+	ResourceDynamicArray<MeshResource*> candidates;
+
+	// Evict the least recently used if over budget. That's cheap, there is no loading involved
+	if(memory > budget)
+	{
+		for(MeshResource* mesh : m_meshes)
+		{
+			const Bool unused = mesh->m_lastRequestFrame + kEvictionFrameDelay < m_frame;
+			const U32 targetLod = (unused) ? mesh->getLodCount() - 1 : mesh->m_wantedLod;
+			if(mesh->m_streamTaskId == 0 && targetLod > mesh->m_firstResidentLod)
+			{
+				candidates.emplaceBack(mesh);
+			}
+		}
+
+		std::sort(candidates.getBegin(), candidates.getEnd(), [](const MeshResource* a, const MeshResource* b) {
+			return a->m_lastRequestFrame < b->m_lastRequestFrame;
+		});
+
+		for(MeshResource* mesh : candidates)
+		{
+			if(memory <= budget)
+			{
+				break;
+			}
+
+			const Bool unused = mesh->m_lastRequestFrame + kEvictionFrameDelay < m_frame;
+			const U32 targetLod = (unused) ? mesh->getLodCount() - 1 : mesh->m_wantedLod;
+
+			for(U32 l = mesh->m_firstResidentLod; l < targetLod; ++l)
+			{
+				memory -= mesh->estimateLodMemory(l);
+			}
+
+			mesh->evictLods(targetLod);
+			++m_version;
+		}
+
+		candidates.destroy();
+	}
+
+	// Stream in the meshes that need finer LODs. The ones that miss the most LODs go first
+	for(MeshResource* mesh : m_meshes)
+	{
+		if(mesh->m_streamTaskId == 0 && mesh->m_wantedLod < mesh->m_firstResidentLod
+		   && mesh->m_firstResidentLod > mesh->m_minStreamableLod)
+		{
+			candidates.emplaceBack(mesh);
+		}
+	}
+
+	std::sort(candidates.getBegin(), candidates.getEnd(), [](const MeshResource* a, const MeshResource* b) {
+		return a->m_firstResidentLod - a->m_wantedLod > b->m_firstResidentLod - b->m_wantedLod;
+	});
+
+	for(MeshResource* mesh : candidates)
+	{
+		if(tasksInFlight >= kMaxTasksInFlight)
+		{
+			break;
+		}
+
+		const U32 targetLod = max<U32>(mesh->m_wantedLod, mesh->m_minStreamableLod);
+		PtrSize extraMemory = 0;
+		for(U32 l = targetLod; l < mesh->m_firstResidentLod; ++l)
+		{
+			extraMemory += mesh->estimateLodMemory(l);
+		}
+
+		if(memory + extraMemory > budget)
+		{
+			continue;
+		}
+
+		memory += extraMemory;
+		mesh->submitStreamTask(targetLod);
+		++tasksInFlight;
+	}
+
+	m_streamedMeshMemory = memory;
+	ANKI_TRACE_INC_COUNTER(RsrcStreamedMeshMemory, memory);
+	ANKI_TRACE_INC_COUNTER(RsrcMeshStreamingTasksInFlight, tasksInFlight);
+}
+
+} // end namespace anki
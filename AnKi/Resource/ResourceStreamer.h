@@ -0,0 +1,92 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Resource/Common.h>
+#include <AnKi/Util/Thread.h>
+
+namespace anki {
+
+// Forward
+class ImageResource;
+class MaterialResource;
+class MeshResource;
+
+/// @addtogroup resource
+/// @{
+
+/// Loads and unloads parts of resources depending on what is visible. Streamable images (see
+/// ResourceManager::loadStreamableImage) load only their small mipmaps and the streamer loads the big ones when
+/// something asks for them (see ImageResource::requestResolution). Meshes load only
+/// their coarsest LOD and the rest follow the same path (see MeshResource::requestLod). If the streamed memory goes
+/// over budget the parts of the resources that haven't been asked for a while are evicted.
+class ResourceStreamer
+{
+public:
+	ResourceStreamer() = default;
+
+	~ResourceStreamer();
+
+	/// Process the requests of the previous frame, kick off the loading and the evictions and switch to the streamed
+	/// textures that are ready. Call it once per frame before the scene update.
+	void update();
+
+	/// Get the estimated GPU memory of all streamed images.
+	PtrSize getStreamedImageMemory() const
+	{
+		return m_streamedImageMemory;
+	}
+
+	/// Get the estimated GPU memory of all streamed meshes.
+	PtrSize getStreamedMeshMemory() const
+	{
+		return m_streamedMeshMemory;
+	}
+
+	/// It changes every time the streamer changes a resource in a way that the users need to know (eg the textures of a
+	/// material or the LODs of a mesh). The users that stop checking their resources every frame can use it to know
+	/// when to check again.
+	U32 getVersion() const
+	{
+		return m_version;
+	}
+
+	ANKI_INTERNAL void registerImage(ImageResource* image);
+
+	ANKI_INTERNAL void unregisterImage(ImageResource* image);
+
+	ANKI_INTERNAL void registerMaterial(MaterialResource* mtl);
+
+	ANKI_INTERNAL void unregisterMaterial(MaterialResource* mtl);
+
+	ANKI_INTERNAL void registerMesh(MeshResource* mesh);
+
+	ANKI_INTERNAL void unregisterMesh(MeshResource* mesh);
+
+private:
+	/// Don't evict resources that were asked for in the last few frames.
+	static constexpr U64 kEvictionFrameDelay = 60;
+
+	/// Limit the number of resources that are loaded at the same time. Streaming is low priority work.
+	static constexpr U32 kMaxTasksInFlight = 8;
+
+	Mutex m_mtx;
+	ResourceDynamicArray<ImageResource*> m_images;
+	ResourceDynamicArray<MaterialResource*> m_materials;
+	ResourceDynamicArray<MeshResource*> m_meshes;
+
+	U64 m_frame = 0;
+	U32 m_version = 0;
+	PtrSize m_streamedImageMemory = 0;
+	PtrSize m_streamedMeshMemory = 0;
+
+	void updateImages();
+
+	void updateMeshes();
+};
+/// @}
+
+} // end namespace anki
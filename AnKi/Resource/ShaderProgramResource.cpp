@@ -6,6 +6,7 @@
 #include <AnKi/Resource/ShaderProgramResource.h>
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/ShaderProgramResourceSystem.h>
+#include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/Gr/ShaderProgram.h>
 #include <AnKi/Gr/GrManager.h>
 #include <AnKi/Util/Filesystem.h>
@@ -32,6 +33,14 @@ ShaderProgramResource::~ShaderProgramResource()
 	for(auto it : m_variants)
 	{
 		ShaderProgramResourceVariant* variant = &(*it);
+
+		const AsyncLoaderTaskId taskId = variant->m_createTaskId.load();
+		if(taskId)
+		{
+			// The task uses the program so remove it or wait for it
+			ResourceManager::getSingleton().getAsyncLoader().cancelTask(taskId);
+		}
+
 		deleteInstance(ResourceMemoryPool::getSingleton(), variant);
 	}
 }
@@ -193,26 +202,69 @@ Error ShaderProgramResource::parseConst(CString constName, U32& componentIdx, U3
 	return Error::kNone;
 }
 
-void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
-											   const ShaderProgramResourceVariant*& variant) const
+U64 ShaderProgramResource::computeVariantHash(const ShaderProgramResourceVariantInitInfo& info, U32 mutatorCount,
+											 U32 constCount)
 {
-	// Sanity checks
-	ANKI_ASSERT(info.m_setMutators.getEnabledBitCount() == m_mutators.getSize());
-	ANKI_ASSERT(info.m_setConstants.getEnabledBitCount() == m_consts.getSize());
-
-	// Compute variant hash
 	U64 hash = 0;
-	if(m_mutators.getSize())
+	if(mutatorCount)
+	{
+		hash = computeHash(info.m_mutation.getBegin(), mutatorCount * sizeof(info.m_mutation[0]));
+	}
+
+	if(constCount)
+	{
+		hash = appendHash(info.m_constantValues.getBegin(), constCount * sizeof(info.m_constantValues[0]), hash);
+	}
+
+	return hash;
+}
+
+const ShaderProgramBinaryVariant* ShaderProgramResource::findBinaryVariant(U64 mutationHash) const
+{
+	const ShaderProgramBinary& binary = m_binary.getBinary();
+
+	if(m_mutators.getSize() == 0)
 	{
-		hash = computeHash(info.m_mutation.getBegin(), m_mutators.getSize() * sizeof(info.m_mutation[0]));
+		ANKI_ASSERT(binary.m_variants.getSize() == 1);
+		return &binary.m_variants[0];
 	}
 
-	if(m_consts.getSize())
+	// The compiler sorts the mutations by hash
+	class Comp
+	{
+	public:
+		Bool operator()(const ShaderProgramBinaryMutation& a, U64 hash) const
+		{
+			return a.m_hash < hash;
+		}
+
+		Bool operator()(U64 hash, const ShaderProgramBinaryMutation& a) const
+		{
+			return hash < a.m_hash;
+		}
+	};
+
+	auto it = binarySearch(binary.m_mutations.getBegin(), binary.m_mutations.getEnd(), mutationHash, Comp());
+	if(it == binary.m_mutations.getEnd()) [[unlikely]]
 	{
-		hash =
-			appendHash(info.m_constantValues.getBegin(), m_consts.getSize() * sizeof(info.m_constantValues[0]), hash);
+		ANKI_ASSERT(!"Mutation not found");
+		return nullptr;
 	}
 
+	// If the variant index is kMaxU32 the mutation is skipped
+	return (it->m_variantIndex != kMaxU32) ? &binary.m_variants[it->m_variantIndex] : nullptr;
+}
+
+ShaderProgramResourceVariant*
+ShaderProgramResource::findOrAddVariant(const ShaderProgramResourceVariantInitInfo& info, Bool& newVariant) const
+{
+	// Sanity checks
+	ANKI_ASSERT(info.m_setMutators.getEnabledBitCount() == m_mutators.getSize());
+	ANKI_ASSERT(info.m_setConstants.getEnabledBitCount() == m_consts.getSize());
+
+	newVariant = false;
+	const U64 hash = computeVariantHash(info, m_mutators.getSize(), m_consts.getSize());
+
 	// Check if the variant is in the cache
 	{
 		RLockGuard<RWMutex> lock(m_mtx);
@@ -220,72 +272,143 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 		auto it = m_variants.find(hash);
 		if(it != m_variants.getEnd())
 		{
-			// Done
-			variant = *it;
-			return;
+			return *it;
 		}
 	}
 
-	// Create the variant
+	// Skipped mutations are not cached. Find them before taking the write lock
+	const U64 mutationHash = computeVariantHash(info, m_mutators.getSize(), 0);
+	const ShaderProgramBinaryVariant* binaryVariant = findBinaryVariant(mutationHash);
+	if(!binaryVariant)
+	{
+		return nullptr;
+	}
+
 	WLockGuard<RWMutex> lock(m_mtx);
 
 	// Check again
 	auto it = m_variants.find(hash);
 	if(it != m_variants.getEnd())
 	{
-		// Done
-		variant = *it;
-		return;
+		return *it;
+	}
+
+	// Add it to the cache but don't create the GPU objects while holding the lock
+	ShaderProgramResourceVariant* variant =
+		newInstance<ShaderProgramResourceVariant>(ResourceMemoryPool::getSingleton());
+	variant->m_binaryVariant = binaryVariant;
+	m_variants.emplace(hash, variant);
+	newVariant = true;
+
+	return variant;
+}
+
+Bool ShaderProgramResource::tryCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
+											 ShaderProgramResourceVariant& variant) const
+{
+	U32 expected = ShaderProgramResourceVariant::kStatePending;
+	if(!variant.m_state.compareExchange(expected, ShaderProgramResourceVariant::kStateCreating))
+	{
+		// Some other thread is creating it or it's already created
+		return false;
 	}
 
-	// Create
-	ShaderProgramResourceVariant* v = createNewVariant(info);
-	if(v)
+	createVariantGpuObjects(info, variant);
+
 	{
-		m_variants.emplace(hash, v);
+		LockGuard<Mutex> lock(m_variantReadyMtx);
+		variant.m_state.store(ShaderProgramResourceVariant::kStateReady);
 	}
+
+	m_variantReadyCondVar.notifyAll();
+
+	ResourceManager::getSingleton().getShaderProgramResourceSystem().recordVariant(*this, info);
+	return true;
+}
+
+void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
+											   const ShaderProgramResourceVariant*& variant) const
+{
+	Bool newVariant;
+	ShaderProgramResourceVariant* v = findOrAddVariant(info, newVariant);
 	variant = v;
+	if(!v || v->m_state.load() == ShaderProgramResourceVariant::kStateReady) [[likely]]
+	{
+		return;
+	}
+
+	// Create it. If it's in a queue of the AsyncLoader this thread will create it first
+	if(!tryCreateVariant(info, *v))
+	{
+		// Another thread is creating it, wait
+		LockGuard<Mutex> lock(m_variantReadyMtx);
+		while(v->m_state.load() != ShaderProgramResourceVariant::kStateReady)
+		{
+			m_variantReadyCondVar.wait(m_variantReadyMtx);
+		}
+	}
 }
 
-ShaderProgramResourceVariant*
-ShaderProgramResource::createNewVariant(const ShaderProgramResourceVariantInitInfo& info) const
+/// Creates a variant in the AsyncLoader.
+class ShaderProgramResource::CreateVariantTask : public AsyncLoaderTask
 {
-	const ShaderProgramBinary& binary = m_binary.getBinary();
+public:
+	/// Non-owning. The program cancels the task or waits for it before it's deleted.
+	const ShaderProgramResource* m_prog = nullptr;
+	ShaderProgramResourceVariantInitInfo m_info;
+	ShaderProgramResourceVariant* m_variant = nullptr;
 
-	// Get the binary program variant
-	const ShaderProgramBinaryVariant* binaryVariant = nullptr;
-	U64 mutationHash = 0;
-	if(m_mutators.getSize())
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
 	{
-		// Create the mutation hash
-		mutationHash = computeHash(info.m_mutation.getBegin(), m_mutators.getSize() * sizeof(info.m_mutation[0]));
+		m_prog->tryCreateVariant(m_info, *m_variant);
 
-		// Search for the mutation in the binary
-		// TODO optimize the search
-		for(const ShaderProgramBinaryMutation& mutation : binary.m_mutations)
-		{
-			if(mutation.m_hash == mutationHash)
-			{
-				if(mutation.m_variantIndex == kMaxU32)
-				{
-					// Skipped mutation, nothing to create
-					return nullptr;
-				}
+		// Last access of the program. After that the program's destructor doesn't have to wait for the task
+		m_variant->m_createTaskId.store(0);
+		return Error::kNone;
+	}
+};
 
-				binaryVariant = &binary.m_variants[mutation.m_variantIndex];
-				break;
-			}
-		}
+Bool ShaderProgramResource::tryGetOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
+												  const ShaderProgramResourceVariant*& variant) const
+{
+	Bool newVariant;
+	ShaderProgramResourceVariant* v = findOrAddVariant(info, newVariant);
+	if(!v || v->m_state.load() == ShaderProgramResourceVariant::kStateReady) [[likely]]
+	{
+		variant = v;
+		return true;
 	}
-	else
+
+	variant = nullptr;
+
+	if(newVariant)
 	{
-		ANKI_ASSERT(binary.m_variants.getSize() == 1);
-		binaryVariant = &binary.m_variants[0];
+		// This thread added it to the cache so it's responsible for creating it
+		CreateVariantTask* task = ResourceManager::getSingleton().getAsyncLoader().newTask<CreateVariantTask>();
+		task->m_prog = this;
+		memcpy(&task->m_info.m_constantValues, &info.m_constantValues, sizeof(info.m_constantValues));
+		task->m_info.m_setConstants = info.m_setConstants;
+		task->m_info.m_mutation = info.m_mutation;
+		task->m_info.m_setMutators = info.m_setMutators;
+		task->m_variant = v;
+
+		// Set the ID before submitting because the task might finish (and reset it) before submitTask returns
+		v->m_createTaskId.store(kMaxU64);
+		const AsyncLoaderTaskId taskId = ResourceManager::getSingleton().getAsyncLoader().submitTask(
+			task, AsyncLoaderTaskPriority::kHigh, AsyncLoaderTaskType::kCpu);
+		AsyncLoaderTaskId expected = kMaxU64;
+		v->m_createTaskId.compareExchange(expected, taskId);
 	}
+
+	return false;
+}
+
+void ShaderProgramResource::createVariantGpuObjects(const ShaderProgramResourceVariantInitInfo& info,
+												   ShaderProgramResourceVariant& variant) const
+{
+	const ShaderProgramBinary& binary = m_binary.getBinary();
+	const ShaderProgramBinaryVariant* binaryVariant = variant.m_binaryVariant;
 	ANKI_ASSERT(binaryVariant);
-	ShaderProgramResourceVariant* variant =
-		newInstance<ShaderProgramResourceVariant>(ResourceMemoryPool::getSingleton());
-	variant->m_binaryVariant = binaryVariant;
 
 	// Set the constant values
 	Array<ShaderSpecializationConstValue, 64> constValues;
@@ -322,7 +445,7 @@ ShaderProgramResource::createNewVariant(const ShaderProgramResourceVariantInitIn
 			if(binaryVariant->m_workgroupSizes[i] != kMaxU32)
 			{
 				// Size didn't come from specialization const
-				variant->m_workgroupSizes[i] = binaryVariant->m_workgroupSizes[i];
+				variant.m_workgroupSizes[i] = binaryVariant->m_workgroupSizes[i];
 			}
 			else
 			{
@@ -347,13 +470,13 @@ ShaderProgramResource::createNewVariant(const ShaderProgramResourceVariantInitIn
 						const I32 value = info.m_constantValues[i].m_ivec4[component];
 						ANKI_ASSERT(value > 0);
 
-						variant->m_workgroupSizes[i] = U32(value);
+						variant.m_workgroupSizes[i] = U32(value);
 						break;
 					}
 				}
 			}
 
-			ANKI_ASSERT(variant->m_workgroupSizes[i] != kMaxU32);
+			ANKI_ASSERT(variant.m_workgroupSizes[i] != kMaxU32);
 		}
 	}
 
@@ -399,7 +522,7 @@ ShaderProgramResource::createNewVariant(const ShaderProgramResourceVariantInitIn
 		}
 
 		// Create the program
-		variant->m_prog = GrManager::getSingleton().newShaderProgram(progInf);
+		variant.m_prog = GrManager::getSingleton().newShaderProgram(progInf);
 	}
 	else
 	{
@@ -422,13 +545,12 @@ ShaderProgramResource::createNewVariant(const ShaderProgramResourceVariantInitIn
 		}
 		ANKI_ASSERT(foundLib);
 
-		variant->m_prog = foundLib->getShaderProgram();
+		variant.m_prog = foundLib->getShaderProgram();
 
 		// Set the group handle index
-		variant->m_shaderGroupHandleIndex = foundLib->getShaderGroupHandleIndex(getFilename(), mutationHash);
+		const U64 mutationHash = computeVariantHash(info, m_mutators.getSize(), 0);
+		variant.m_shaderGroupHandleIndex = foundLib->getShaderGroupHandleIndex(getFilename(), mutationHash);
 	}
-
-	return variant;
 }
 
 } // end namespace anki
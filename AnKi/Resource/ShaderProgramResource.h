@@ -6,6 +6,7 @@
 #pragma once
 
 #include <AnKi/Resource/ResourceObject.h>
+#include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/ShaderCompiler/ShaderProgramCompiler.h>
 #include <AnKi/Gr/Utils/Functions.h>
 #include <AnKi/Gr/ShaderProgram.h>
@@ -13,6 +14,7 @@
 #include <AnKi/Util/String.h>
 #include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/WeakArray.h>
+#include <AnKi/Util/Atomic.h>
 #include <AnKi/Math.h>
 
 namespace anki {
@@ -103,11 +105,20 @@ public:
 	}
 
 private:
+	/// The variant is in the cache but nobody started creating it.
+	static constexpr U32 kStatePending = 0;
+	/// Some thread is creating the GPU objects.
+	static constexpr U32 kStateCreating = 1;
+	/// Ready to be used.
+	static constexpr U32 kStateReady = 2;
+
 	ShaderProgramPtr m_prog;
 	const ShaderProgramBinaryVariant* m_binaryVariant = nullptr;
 	BitSet<128, U64> m_activeConsts = {false};
 	Array<U32, 3> m_workgroupSizes;
 	U32 m_shaderGroupHandleIndex = kMaxU32; ///< Cache the index of the handle here.
+	Atomic<U32> m_state = {kStatePending};
+	Atomic<AsyncLoaderTaskId> m_createTaskId = {0}; ///< Reset by the task that creates it when it's done.
 };
 
 /// The value of a constant.
@@ -146,6 +157,7 @@ static_assert(sizeof(ShaderProgramResourceConstantValue) == sizeof(Vec4) * 2, "N
 class ShaderProgramResourceVariantInitInfo
 {
 	friend class ShaderProgramResource;
+	friend class ShaderProgramResourceSystem;
 
 public:
 	ShaderProgramResourceVariantInitInfo()
@@ -182,6 +194,8 @@ private:
 /// Shader program resource. It loads special AnKi programs.
 class ShaderProgramResource : public ResourceObject
 {
+	friend class ShaderProgramResourceSystem;
+
 public:
 	ShaderProgramResource();
 
@@ -240,7 +254,7 @@ public:
 
 	/// Get or create a graphics shader program variant. If returned variant is nullptr then it means that the mutation
 	/// is skipped and thus incorrect.
-	/// @note It's thread-safe.
+	/// @note It's thread-safe. The creation of one variant doesn't block the threads that ask for other variants.
 	void getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
 							const ShaderProgramResourceVariant*& variant) const;
 
@@ -250,6 +264,13 @@ public:
 		getOrCreateVariant(ShaderProgramResourceVariantInitInfo(), variant);
 	}
 
+	/// Same as getOrCreateVariant() but it never blocks. If the variant is not ready it starts creating it in the
+	/// AsyncLoader and returns false. The caller should skip the drawcall or use a fallback.
+	/// @note It's thread-safe.
+	/// @return True if the variant is ready. The variant can still be nullptr if the mutation is skipped.
+	Bool tryGetOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
+							   const ShaderProgramResourceVariant*& variant) const;
+
 private:
 	using Mutator = ShaderProgramResourceMutator;
 	using Const = ShaderProgramResourceConstant;
@@ -271,9 +292,32 @@ private:
 	mutable ResourceHashMap<U64, ShaderProgramResourceVariant*> m_variants;
 	mutable RWMutex m_mtx;
 
+	/// Used to wait for variants that other threads create.
+	mutable Mutex m_variantReadyMtx;
+	mutable ConditionVariable m_variantReadyCondVar;
+
 	ShaderTypeBit m_shaderStages = ShaderTypeBit::kNone;
 
-	ShaderProgramResourceVariant* createNewVariant(const ShaderProgramResourceVariantInitInfo& info) const;
+	class CreateVariantTask;
+
+	static U64 computeVariantHash(const ShaderProgramResourceVariantInitInfo& info, U32 mutatorCount,
+								  U32 constCount);
+
+	/// Find the variant in the cache or add a new one that is not created yet.
+	/// @return Null if the mutation is skipped.
+	ShaderProgramResourceVariant* findOrAddVariant(const ShaderProgramResourceVariantInitInfo& info,
+												   Bool& newVariant) const;
+
+	/// Binary search the mutation.
+	const ShaderProgramBinaryVariant* findBinaryVariant(U64 mutationHash) const;
+
+	/// Create the GPU objects of the variant if no other thread is doing that.
+	/// @return True if this thread created the variant.
+	Bool tryCreateVariant(const ShaderProgramResourceVariantInitInfo& info,
+						  ShaderProgramResourceVariant& variant) const;
+
+	void createVariantGpuObjects(const ShaderProgramResourceVariantInitInfo& info,
+								 ShaderProgramResourceVariant& variant) const;
 
 	static Error parseConst(CString constName, U32& componentIdx, U32& componentCount, CString& name);
 };
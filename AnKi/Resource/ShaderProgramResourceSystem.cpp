@@ -6,6 +6,7 @@
 #include <AnKi/Resource/ShaderProgramResourceSystem.h>
 #include <AnKi/Resource/ResourceFilesystem.h>
 #include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Resource/ShaderProgramResource.h>
 #include <AnKi/Util/Tracer.h>
 #include <AnKi/Gr/GrManager.h>
 #include <AnKi/ShaderCompiler/ShaderProgramCompiler.h>
@@ -26,6 +27,13 @@ U64 ShaderProgramRaytracingLibrary::generateShaderGroupGroupHash(CString resourc
 	return hash;
 }
 
+ShaderProgramResourceSystem::~ShaderProgramResourceSystem()
+{
+	m_prewarmedPrograms.destroy();
+	m_recordedVariants.destroy();
+	m_variantList.destroy();
+}
+
 Error ShaderProgramResourceSystem::init()
 {
 	if(!GrManager::getSingleton().getDeviceCapabilities().m_rayTracingEnabled)
@@ -455,4 +463,163 @@ Error ShaderProgramResourceSystem::createRayTracingPrograms(
 	return Error::kNone;
 }
 
+void ShaderProgramResourceSystem::recordVariant(const ShaderProgramResource& prog,
+												const ShaderProgramResourceVariantInitInfo& info)
+{
+	CString filename = prog.getFilename();
+	if(filename.isEmpty())
+	{
+		// The variant was created during the program's load(), there is no name to record
+		return;
+	}
+
+	const U32 mutatorCount = prog.getMutators().getSize();
+	const U32 constCount = prog.getConstants().getSize();
+	const U64 hash = appendHash(filename.cstr(), filename.getLength(),
+								ShaderProgramResource::computeVariantHash(info, mutatorCount, constCount));
+
+	LockGuard<Mutex> lock(m_variantListMtx);
+
+	if(m_recordedVariants.find(hash) != m_recordedVariants.getEnd())
+	{
+		return;
+	}
+	m_recordedVariants.emplace(hash, m_variantRecordCount++);
+
+	// Serialize the record
+	auto append = [this](const void* data, U32 size) {
+		const U32 offset = m_variantList.getSize();
+		m_variantList.resize(offset + size);
+		memcpy(&m_variantList[offset], data, size);
+	};
+
+	const U32 nameLength = filename.getLength();
+	append(&nameLength, sizeof(nameLength));
+	append(filename.cstr(), nameLength);
+	append(&mutatorCount, sizeof(mutatorCount));
+	append(info.m_mutation.getBegin(), U32(sizeof(info.m_mutation[0])) * mutatorCount);
+	append(&constCount, sizeof(constCount));
+	append(info.m_constantValues.getBegin(), U32(sizeof(info.m_constantValues[0])) * constCount);
+}
+
+Error ShaderProgramResourceSystem::saveVariantList(CString filename) const
+{
+	ANKI_RESOURCE_LOGI("Saving %u shader variants to: %s", m_variantRecordCount, filename.cstr());
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+
+	ANKI_CHECK(file.write(&kVariantListMagic[0], sizeof(kVariantListMagic)));
+	ANKI_CHECK(file.write(&m_variantRecordCount, sizeof(m_variantRecordCount)));
+	if(m_variantList.getSize())
+	{
+		ANKI_CHECK(file.write(&m_variantList[0], m_variantList.getSizeInBytes()));
+	}
+
+	return Error::kNone;
+}
+
+Error ShaderProgramResourceSystem::prewarm(CString filename)
+{
+	ANKI_TRACE_SCOPED_EVENT(RsrcShaderVariantPrewarm);
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::kRead | FileOpenFlag::kBinary));
+
+	Array<Char, sizeof(kVariantListMagic)> magic;
+	U32 recordCount;
+	ANKI_CHECK(file.read(&magic[0], sizeof(magic)));
+	ANKI_CHECK(file.readU32(recordCount));
+	if(memcmp(&magic[0], &kVariantListMagic[0], sizeof(magic)) != 0)
+	{
+		ANKI_RESOURCE_LOGE("Wrong magic in the shader variant list: %s", filename.cstr());
+		return Error::kUserData;
+	}
+
+	ResourceString progFilename;
+	ShaderProgramResourcePtr prog;
+	U32 variantCount = 0;
+	for(U32 i = 0; i < recordCount; ++i)
+	{
+		// Read the record
+		U32 nameLength;
+		ANKI_CHECK(file.readU32(nameLength));
+		if(nameLength == 0 || nameLength > kMaxVariantListNameLength)
+		{
+			ANKI_RESOURCE_LOGE("Corrupted shader variant list: %s", filename.cstr());
+			return Error::kUserData;
+		}
+		ResourceString name(' ', nameLength);
+		ANKI_CHECK(file.read(&name[0], nameLength));
+
+		ShaderProgramResourceVariantInitInfo info;
+
+		U32 mutatorCount;
+		ANKI_CHECK(file.readU32(mutatorCount));
+		if(mutatorCount > info.m_mutation.getSize())
+		{
+			ANKI_RESOURCE_LOGE("Corrupted shader variant list: %s", filename.cstr());
+			return Error::kUserData;
+		}
+		ANKI_CHECK(file.read(info.m_mutation.getBegin(), sizeof(info.m_mutation[0]) * mutatorCount));
+
+		U32 constCount;
+		ANKI_CHECK(file.readU32(constCount));
+		if(constCount > info.m_constantValues.getSize())
+		{
+			ANKI_RESOURCE_LOGE("Corrupted shader variant list: %s", filename.cstr());
+			return Error::kUserData;
+		}
+		ANKI_CHECK(file.read(info.m_constantValues.getBegin(), sizeof(info.m_constantValues[0]) * constCount));
+
+		// Records of the same program are usually next to each other
+		if(name != progFilename.toCString())
+		{
+			progFilename = name;
+			prog.reset(nullptr);
+			if(ResourceManager::getSingleton().loadResource(name, prog))
+			{
+				ANKI_RESOURCE_LOGW("Skipping the variants of a program that failed to load: %s", name.cstr());
+				continue;
+			}
+
+			m_prewarmedPrograms.emplaceBack(prog);
+		}
+
+		if(!prog)
+		{
+			continue;
+		}
+
+		// The program might have changed since the list was written, validate the record
+		Bool valid = mutatorCount == prog->getMutators().getSize() && constCount == prog->getConstants().getSize();
+		for(U32 m = 0; m < mutatorCount && valid; ++m)
+		{
+			valid = prog->getMutators()[m].valueExists(info.m_mutation[m]);
+			info.m_setMutators.set(m);
+		}
+
+		for(U32 c = 0; c < constCount && valid; ++c)
+		{
+			valid = info.m_constantValues[c].m_constantIndex == c;
+			info.m_setConstants.set(c);
+		}
+
+		if(!valid)
+		{
+			ANKI_RESOURCE_LOGW("Skipping stale shader variant of: %s", name.cstr());
+			continue;
+		}
+
+		// Kick off the creation
+		info.m_ptr = prog;
+		const ShaderProgramResourceVariant* variant;
+		prog->tryGetOrCreateVariant(info, variant);
+		++variantCount;
+	}
+
+	ANKI_RESOURCE_LOGI("Pre-warming %u shader variants of %u programs", variantCount, m_prewarmedPrograms.getSize());
+	return Error::kNone;
+}
+
 } // end namespace anki
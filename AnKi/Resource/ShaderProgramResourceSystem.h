@@ -9,10 +9,14 @@
 #include <AnKi/Gr/ShaderProgram.h>
 #include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/StringList.h>
+#include <AnKi/Util/Thread.h>
 #include <AnKi/ShaderCompiler/ShaderProgramBinary.h>
 
 namespace anki {
 
+// Forward
+class ShaderProgramResourceVariantInitInfo;
+
 /// @addtogroup resource
 /// @{
 
@@ -72,7 +76,7 @@ public:
 	{
 	}
 
-	~ShaderProgramResourceSystem() = default;
+	~ShaderProgramResourceSystem();
 
 	Error init();
 
@@ -81,9 +85,30 @@ public:
 		return m_rtLibraries;
 	}
 
+	/// Write all the variants that were created so far to a file. Feed it to prewarm() on the next run.
+	Error saveVariantList(CString filename) const;
+
+	/// Read a file written by saveVariantList() and start creating the variants it contains in the AsyncLoader's CPU
+	/// threads. The programs stay loaded for the lifetime of the system.
+	Error prewarm(CString filename);
+
+	/// Remember a variant so it can be pre-warmed later. Called when a variant is created.
+	ANKI_INTERNAL void recordVariant(const ShaderProgramResource& prog, const ShaderProgramResourceVariantInitInfo& info);
+
 private:
+	static constexpr Array<Char, 8> kVariantListMagic = {'A', 'N', 'K', 'I', 'V', 'A', 'R', '1'};
+	static constexpr U32 kMaxVariantListNameLength = 1024;
+
 	ResourceDynamicArray<ShaderProgramRaytracingLibrary> m_rtLibraries;
 
+	// Variant recording
+	Mutex m_variantListMtx;
+	ResourceDynamicArray<U8> m_variantList; ///< The records, serialized the way they are stored in the file.
+	U32 m_variantRecordCount = 0;
+	ResourceHashMap<U64, U32> m_recordedVariants; ///< The hashes of the recorded variants to avoid duplicates.
+
+	ResourceDynamicArray<ShaderProgramResourcePtr> m_prewarmedPrograms;
+
 	static Error createRayTracingPrograms(ResourceDynamicArray<ShaderProgramRaytracingLibrary>& outLibs);
 };
 /// @}
@@ -61,30 +61,20 @@ Error TransferGpuAllocator::allocate(PtrSize size, TransferGpuAllocatorHandle& h
 
 	LockGuard<Mutex> lock(m_mtx);
 
-	Pool* pool;
-	if(m_crntPoolAllocatedSize + size <= poolSize)
+	// If there is not enough space switch to the pool used in the past but only if all its handles are released. Never
+	// wait for handles, their owners might be waiting for this very allocation (async loader threads hold many handles
+	// and release them only after they flush). If the switch can't happen the current pool grows over the budget
+	Pool* pool = &m_pools[m_crntPool];
+	const U8 nextPoolIdx = U8((m_crntPool + 1) % kPoolCount);
+	if(m_crntPoolAllocatedSize + size > poolSize && m_pools[nextPoolIdx].m_pendingReleases == 0)
 	{
-		// Have enough space in the pool
-
-		pool = &m_pools[m_crntPool];
-	}
-	else
-	{
-		// Don't have enough space. Wait for one pool used in the past
-
-		m_crntPool = U8((m_crntPool + 1) % kPoolCount);
+		m_crntPool = nextPoolIdx;
 		pool = &m_pools[m_crntPool];
 
 		{
 			ANKI_TRACE_SCOPED_EVENT(RsrcWaitTransfer);
 
-			// Wait for all memory to be released
-			while(pool->m_pendingReleases != 0)
-			{
-				m_condVar.wait(m_mtx);
-			}
-
-			// All memory is released, loop until all fences are triggered
+			// Loop until all fences are triggered
 			while(!pool->m_fences.isEmpty())
 			{
 				FencePtr fence = pool->m_fences.getFront();
@@ -100,7 +90,6 @@ Error TransferGpuAllocator::allocate(PtrSize size, TransferGpuAllocatorHandle& h
 		pool->m_stackAlloc.reset();
 		m_crntPoolAllocatedSize = 0;
 	}
-
 	Chunk* chunk;
 	PtrSize offset;
 	[[maybe_unused]] const Error err = pool->m_stackAlloc.allocate(size, kGpuBufferAlignment, chunk, offset);
@@ -153,8 +142,6 @@ void TransferGpuAllocator::release(TransferGpuAllocatorHandle& handle, FencePtr
 
 		ANKI_ASSERT(pool.m_pendingReleases > 0);
 		--pool.m_pendingReleases;
-
-		m_condVar.notifyOne();
 	}
 
 	handle.invalidate();
@@ -113,8 +113,8 @@ public:
 
 	Error init(PtrSize maxSize);
 
-	/// Allocate some transfer memory. If there is not enough memory it will block until some is releaced. It's
-	/// threadsafe.
+	/// Allocate some transfer memory. It never waits for other handles to be released because the callers hold many of
+	/// them at the same time. If there is not enough memory it will go over the budget. It's threadsafe.
 	Error allocate(PtrSize size, TransferGpuAllocatorHandle& handle);
 
 	/// Release the memory. It will not be recycled before the fence is signaled. It's threadsafe.
@@ -200,7 +200,6 @@ private:
 	PtrSize m_maxAllocSize = 0;
 
 	Mutex m_mtx; ///< Protect all members bellow.
-	ConditionVariable m_condVar;
 	Array<Pool, kPoolCount> m_pools;
 	U8 m_crntPool = 0;
 	PtrSize m_crntPoolAllocatedSize = 0;
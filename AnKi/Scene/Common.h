@@ -39,7 +39,7 @@ class SceneMemoryPool : public HeapMemoryPool, public MakeSingleton<SceneMemoryP
 
 private:
 	SceneMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData)
-		: HeapMemoryPool(allocCb, allocCbUserData, "SceneMemPool")
+		: HeapMemoryPool(allocCb, allocCbUserData, "SceneMemPool", true)
 	{
 	}
 
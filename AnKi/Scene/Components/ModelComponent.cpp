@@ -8,6 +8,7 @@
 #include <AnKi/Scene/SceneGraph.h>
 #include <AnKi/Scene/Components/MoveComponent.h>
 #include <AnKi/Scene/Components/SkinComponent.h>
+#include <AnKi/Scene/SoftwareRasterizer.h>
 #include <AnKi/Resource/ModelResource.h>
 #include <AnKi/Resource/ResourceManager.h>
 
@@ -113,8 +114,24 @@ Error ModelComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		return Error::kNone;
 	}
 
-	const Bool resourceUpdated = m_dirty;
+	Bool resourceUpdated = m_dirty;
 	m_dirty = false;
+
+	// The streamed textures of the materials or the streamed LODs of the meshes might have changed
+	for(U32 i = 0; i < m_patchInfos.getSize(); ++i)
+	{
+		const ModelPatch& patch = m_model->getModelPatches()[i];
+		const U32 uniformsVersion = patch.getMaterial()->getPrefilledLocalUniformsVersion();
+		const U32 lodsVersion = patch.getMesh()->getLodsVersion();
+		if(m_patchInfos[i].m_prefilledLocalUniformsVersion != uniformsVersion
+		   || m_patchInfos[i].m_meshLodsVersion != lodsVersion) [[unlikely]]
+		{
+			m_patchInfos[i].m_prefilledLocalUniformsVersion = uniformsVersion;
+			m_patchInfos[i].m_meshLodsVersion = lodsVersion;
+			resourceUpdated = true;
+		}
+	}
+
 	const Bool moved = info.m_node->movedThisFrame() || m_firstTimeUpdate;
 	const Bool movedLastFrame = m_movedLastFrame || m_firstTimeUpdate;
 	m_firstTimeUpdate = false;
@@ -178,8 +195,7 @@ Error ModelComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 			const PtrSize offset = m_patchInfos[i].m_gpuSceneMeshLodsIndex * sizeof(meshLods)
 								   + SceneGraph::getSingleton().getAllGpuSceneContiguousArrays().getArrayBase(
 									   GpuSceneContiguousArrayType::kMeshLods);
-			GpuSceneMicroPatcher::getSingleton().newCopy(*info.m_framePool, offset, meshLods.getSizeInBytes(),
-														 &meshLods[0]);
+			GpuSceneMicroPatcher::getSingleton().newCopy(offset, meshLods.getSizeInBytes(), &meshLods[0]);
 		}
 
 		// Upload the uniforms
@@ -197,8 +213,8 @@ Error ModelComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		}
 
 		ANKI_ASSERT(count * 4 == m_gpuSceneUniforms.m_size);
-		GpuSceneMicroPatcher::getSingleton().newCopy(*info.m_framePool, m_gpuSceneUniforms.m_offset,
-													 m_gpuSceneUniforms.m_size, &allUniforms[0]);
+		GpuSceneMicroPatcher::getSingleton().newCopy(m_gpuSceneUniforms.m_offset, m_gpuSceneUniforms.m_size,
+													 &allUniforms[0]);
 	}
 
 	// Upload transforms
@@ -211,7 +227,7 @@ Error ModelComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		const PtrSize offset = m_gpuSceneTransformsIndex * sizeof(trfs)
 							   + SceneGraph::getSingleton().getAllGpuSceneContiguousArrays().getArrayBase(
 								   GpuSceneContiguousArrayType::kTransformPairs);
-		GpuSceneMicroPatcher::getSingleton().newCopy(*info.m_framePool, offset, sizeof(trfs), &trfs[0]);
+		GpuSceneMicroPatcher::getSingleton().newCopy(offset, sizeof(trfs), &trfs[0]);
 	}
 
 	// Spatial update
@@ -239,7 +255,57 @@ Error ModelComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	return Error::kNone;
 }
 
-void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique technique,
+Bool ModelComponent::hasOccluders() const
+{
+	if(!isEnabled() || m_skinComponent)
+	{
+		return false;
+	}
+
+	for(const ModelPatch& patch : m_model->getModelPatches())
+	{
+		if(patch.isOccluder())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ModelComponent::drawOccluders(SoftwareRasterizer& r) const
+{
+	ANKI_ASSERT(hasOccluders());
+
+	const Transform& trf = m_node->getWorldTransform();
+	DynamicArray<Vec3, MemoryPoolPtrWrapper<StackMemoryPool>> worldVerts(
+		&SceneGraph::getSingleton().getFrameMemoryPool());
+
+	const MeshResource* prevMesh = nullptr;
+	for(const ModelPatch& patch : m_model->getModelPatches())
+	{
+		// Patches usually share the mesh, don't draw it twice
+		const MeshResource* mesh = patch.getMesh().get();
+		if(mesh == prevMesh || !patch.isOccluder())
+		{
+			continue;
+		}
+		prevMesh = mesh;
+
+		const ConstWeakArray<Vec3> localVerts = mesh->getOccluderTriangles();
+
+		worldVerts.resize(localVerts.getSize());
+		for(U32 i = 0; i < localVerts.getSize(); ++i)
+		{
+			worldVerts[i] = trf.transform(localVerts[i]);
+		}
+
+		// Occluders are not necessarily closed so no backface culling
+		r.draw(&worldVerts[0][0], worldVerts.getSize(), sizeof(Vec3), false);
+	}
+}
+
+Bool ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique technique,
 												  WeakArray<RenderableQueueElement>& outRenderables) const
 {
 	ANKI_ASSERT(isEnabled());
@@ -249,7 +315,7 @@ void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique te
 	const RenderingTechniqueBit requestedRenderingTechniqueMask = RenderingTechniqueBit(1 << technique);
 	if(!(m_presentRenderingTechniques & requestedRenderingTechniqueMask))
 	{
-		return;
+		return true;
 	}
 
 	// Allocate renderables
@@ -261,15 +327,13 @@ void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique te
 
 	if(renderableCount == 0)
 	{
-		return;
+		return true;
 	}
 
 	RenderableQueueElement* renderables =
 		static_cast<RenderableQueueElement*>(SceneGraph::getSingleton().getFrameMemoryPool().allocate(
 			sizeof(RenderableQueueElement) * renderableCount, alignof(RenderableQueueElement)));
 
-	outRenderables.setArray(renderables, renderableCount);
-
 	// Fill renderables
 	const Bool moved = m_node->movedThisFrame() && technique == RenderingTechnique::kGBuffer;
 	const Bool hasSkin = m_skinComponent != nullptr && m_skinComponent->isEnabled();
@@ -281,6 +345,7 @@ void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique te
 	key.setSkinned(hasSkin);
 
 	renderableCount = 0;
+	Bool allReady = true;
 	for(U32 i = 0; i < m_patchInfos.getSize(); ++i)
 	{
 		if(!(m_patchInfos[i].m_techniques & requestedRenderingTechniqueMask))
@@ -288,12 +353,17 @@ void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique te
 			continue;
 		}
 
-		RenderableQueueElement& queueElem = renderables[renderableCount];
-
 		const ModelPatch& patch = m_model->getModelPatches()[i];
 
 		ModelRenderingInfo modelInf;
-		patch.getRenderingInfo(key, modelInf);
+		if(!patch.getRenderingInfo(key, modelInf))
+		{
+			// The program is not ready yet, skip it for this frame
+			allReady = false;
+			continue;
+		}
+
+		RenderableQueueElement& queueElem = renderables[renderableCount];
 
 		AllGpuSceneContiguousArrays& gpuArrays = SceneGraph::getSingleton().getAllGpuSceneContiguousArrays();
 
@@ -318,6 +388,9 @@ void ModelComponent::setupRenderableQueueElements(U32 lod, RenderingTechnique te
 
 		++renderableCount;
 	}
+
+	outRenderables.setArray((renderableCount) ? renderables : nullptr, renderableCount);
+	return allReady;
 }
 
 void ModelComponent::setupRayTracingInstanceQueueElements(U32 lod, RenderingTechnique technique,
@@ -349,8 +422,6 @@ void ModelComponent::setupRayTracingInstanceQueueElements(U32 lod, RenderingTech
 		static_cast<RayTracingInstanceQueueElement*>(SceneGraph::getSingleton().getFrameMemoryPool().allocate(
 			sizeof(RayTracingInstanceQueueElement) * instanceCount, alignof(RayTracingInstanceQueueElement)));
 
-	outInstances.setArray(instances, instanceCount);
-
 	RenderingKey key;
 	key.setLod(lod);
 	key.setRenderingTechnique(technique);
@@ -363,14 +434,18 @@ void ModelComponent::setupRayTracingInstanceQueueElements(U32 lod, RenderingTech
 			continue;
 		}
 
-		RayTracingInstanceQueueElement& queueElem = instances[instanceCount];
-
 		const ModelPatch& patch = m_model->getModelPatches()[i];
 
-		AllGpuSceneContiguousArrays& gpuArrays = SceneGraph::getSingleton().getAllGpuSceneContiguousArrays();
-
 		ModelRayTracingInfo modelInf;
-		patch.getRayTracingInfo(key, modelInf);
+		if(!patch.getRayTracingInfo(key, modelInf))
+		{
+			// The program is not ready yet, skip it for this frame
+			continue;
+		}
+
+		RayTracingInstanceQueueElement& queueElem = instances[instanceCount];
+
+		AllGpuSceneContiguousArrays& gpuArrays = SceneGraph::getSingleton().getAllGpuSceneContiguousArrays();
 
 		queueElem.m_bottomLevelAccelerationStructure = modelInf.m_bottomLevelAccelerationStructure.get();
 		queueElem.m_shaderGroupHandleIndex = modelInf.m_shaderGroupHandleIndex;
@@ -389,6 +464,48 @@ void ModelComponent::setupRayTracingInstanceQueueElements(U32 lod, RenderingTech
 
 		++instanceCount;
 	}
+
+	outInstances.setArray((instanceCount) ? instances : nullptr, instanceCount);
+}
+
+void ModelComponent::requestTextureResolution(U32 pixels) const
+{
+	ANKI_ASSERT(isEnabled());
+
+	for(const ModelPatch& patch : m_model->getModelPatches())
+	{
+		patch.getMaterial()->requestTextureResolution(pixels);
+	}
+}
+
+Bool ModelComponent::streamedResourcesChanged() const
+{
+	if(!isEnabled())
+	{
+		return false;
+	}
+
+	for(U32 i = 0; i < m_patchInfos.getSize(); ++i)
+	{
+		const ModelPatch& patch = m_model->getModelPatches()[i];
+		if(m_patchInfos[i].m_prefilledLocalUniformsVersion != patch.getMaterial()->getPrefilledLocalUniformsVersion()
+		   || m_patchInfos[i].m_meshLodsVersion != patch.getMesh()->getLodsVersion())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ModelComponent::requestMeshLod(U32 lod) const
+{
+	ANKI_ASSERT(isEnabled());
+
+	for(const ModelPatch& patch : m_model->getModelPatches())
+	{
+		patch.getMesh()->requestLod(lod);
+	}
 }
 
 void ModelComponent::onOtherComponentRemovedOrAdded(SceneComponent* other, Bool added)
@@ -13,6 +13,9 @@
 
 namespace anki {
 
+// Forward
+class SoftwareRasterizer;
+
 /// @addtogroup scene
 /// @{
 
@@ -43,12 +46,31 @@ public:
 		return m_castsShadow;
 	}
 
-	void setupRenderableQueueElements(U32 lod, RenderingTechnique technique,
+	/// Check if any of the meshes of the model has an occluder. Skinned models are never occluders.
+	Bool hasOccluders() const;
+
+	/// Feed the occluders of the model's meshes to a software rasterizer. They are in world space.
+	void drawOccluders(SoftwareRasterizer& r) const;
+
+	/// @return False if some renderables were skipped because their shader programs are not ready yet.
+	Bool setupRenderableQueueElements(U32 lod, RenderingTechnique technique,
 									  WeakArray<RenderableQueueElement>& outRenderables) const;
 
 	void setupRayTracingInstanceQueueElements(U32 lod, RenderingTechnique technique,
 											  WeakArray<RayTracingInstanceQueueElement>& outRenderables) const;
 
+	/// Ask for the streamed textures of the model to have at least that resolution.
+	/// @note It's thread-safe.
+	void requestTextureResolution(U32 pixels) const;
+
+	/// Check if the streamer changed the resources of the model since the last update. Parked nodes are not updated so
+	/// they need to be woken up to upload the new data to the GPU scene.
+	Bool streamedResourcesChanged() const;
+
+	/// Ask for the streamed meshes of the model to have that LOD resident.
+	/// @note It's thread-safe.
+	void requestMeshLod(U32 lod) const;
+
 private:
 	class PatchInfo
 	{
@@ -56,6 +78,8 @@ private:
 		U32 m_gpuSceneUniformsOffset = kMaxU32;
 		U32 m_gpuSceneMeshLodsIndex = kMaxU32;
 		RenderingTechniqueBit m_techniques;
+		U32 m_prefilledLocalUniformsVersion = 0; ///< Re-upload the uniforms if the material's version changes.
+		U32 m_meshLodsVersion = 0; ///< Re-upload the mesh LODs if the mesh's version changes.
 	};
 
 	SceneNode* m_node = nullptr;
@@ -314,10 +314,17 @@ Error ParticleEmitterComponent::update(SceneComponentUpdateInfo& info, Bool& upd
 	GpuSceneMicroPatcher& patcher = GpuSceneMicroPatcher::getSingleton();
 	if(m_aliveParticleCount > 0)
 	{
-		patcher.newCopy(*info.m_framePool, m_gpuScenePositions.m_offset, sizeof(Vec3) * m_aliveParticleCount,
-						positions);
-		patcher.newCopy(*info.m_framePool, m_gpuSceneScales.m_offset, sizeof(F32) * m_aliveParticleCount, scales);
-		patcher.newCopy(*info.m_framePool, m_gpuSceneAlphas.m_offset, sizeof(F32) * m_aliveParticleCount, alphas);
+		patcher.newCopy(m_gpuScenePositions.m_offset, sizeof(Vec3) * m_aliveParticleCount, positions);
+		patcher.newCopy(m_gpuSceneScales.m_offset, sizeof(F32) * m_aliveParticleCount, scales);
+		patcher.newCopy(m_gpuSceneAlphas.m_offset, sizeof(F32) * m_aliveParticleCount, alphas);
+	}
+
+	// The streamed textures of the material might have changed
+	const U32 uniformsVersion = m_particleEmitterResource->getMaterial()->getPrefilledLocalUniformsVersion();
+	if(m_prefilledLocalUniformsVersion != uniformsVersion) [[unlikely]]
+	{
+		m_prefilledLocalUniformsVersion = uniformsVersion;
+		m_resourceUpdated = true;
 	}
 
 	if(m_resourceUpdated)
@@ -330,9 +337,9 @@ Error ParticleEmitterComponent::update(SceneComponentUpdateInfo& info, Bool& upd
 		const PtrSize offset = m_gpuSceneIndex * sizeof(GpuSceneParticleEmitter)
 							   + SceneGraph::getSingleton().getAllGpuSceneContiguousArrays().getArrayBase(
 								   GpuSceneContiguousArrayType::kParticleEmitters);
-		patcher.newCopy(*info.m_framePool, offset, sizeof(GpuSceneParticleEmitter), &particles);
+		patcher.newCopy(offset, sizeof(GpuSceneParticleEmitter), &particles);
 
-		patcher.newCopy(*info.m_framePool, m_gpuSceneUniforms.m_offset,
+		patcher.newCopy(m_gpuSceneUniforms.m_offset,
 						m_particleEmitterResource->getMaterial()->getPrefilledLocalUniforms().getSizeInBytes(),
 						m_particleEmitterResource->getMaterial()->getPrefilledLocalUniforms().getBegin());
 	}
@@ -458,7 +465,12 @@ void ParticleEmitterComponent::setupRenderableQueueElements(RenderingTechnique t
 	RenderingKey key;
 	key.setRenderingTechnique(technique);
 	ShaderProgramPtr prog;
-	m_particleEmitterResource->getRenderingInfo(key, prog);
+	if(!m_particleEmitterResource->getRenderingInfo(key, prog))
+	{
+		// The program is not ready yet, skip it for this frame
+		outRenderables.setArray(nullptr, 0);
+		return;
+	}
 
 	RenderableQueueElement* el =
 		static_cast<RenderableQueueElement*>(SceneGraph::getSingleton().getFrameMemoryPool().allocate(
@@ -482,4 +494,10 @@ void ParticleEmitterComponent::setupRenderableQueueElements(RenderingTechnique t
 	outRenderables.setArray(el, 1);
 }
 
+void ParticleEmitterComponent::requestTextureResolution(U32 pixels) const
+{
+	ANKI_ASSERT(isEnabled());
+	m_particleEmitterResource->getMaterial()->requestTextureResolution(pixels);
+}
+
 } // end namespace anki
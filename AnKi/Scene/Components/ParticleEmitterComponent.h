@@ -39,6 +39,10 @@ public:
 	void setupRenderableQueueElements(RenderingTechnique technique,
 									  WeakArray<RenderableQueueElement>& outRenderables) const;
 
+	/// Ask for the streamed textures of the material to have at least that resolution.
+	/// @note It's thread-safe.
+	void requestTextureResolution(U32 pixels) const;
+
 private:
 	class ParticleBase;
 	class SimpleParticle;
@@ -70,6 +74,7 @@ private:
 	U32 m_gpuSceneIndex = kMaxU32;
 
 	Bool m_resourceUpdated = true;
+	U32 m_prefilledLocalUniformsVersion = 0; ///< Re-upload the uniforms if the material's version changes.
 	SimulationType m_simulationType = SimulationType::kUndefined;
 
 	Error update(SceneComponentUpdateInfo& info, Bool& updated);
@@ -108,7 +108,7 @@ Error ReflectionProbeComponent::update(SceneComponentUpdateInfo& info, Bool& upd
 		const PtrSize offset = m_gpuSceneIndex * sizeof(GpuSceneReflectionProbe)
 							   + SceneGraph::getSingleton().getAllGpuSceneContiguousArrays().getArrayBase(
 								   GpuSceneContiguousArrayType::kReflectionProbes);
-		GpuSceneMicroPatcher::getSingleton().newCopy(*info.m_framePool, offset, sizeof(gpuProbe), &gpuProbe);
+		GpuSceneMicroPatcher::getSingleton().newCopy(offset, sizeof(gpuProbe), &gpuProbe);
 	}
 
 	// Update spatial and frustums
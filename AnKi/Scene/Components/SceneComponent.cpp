@@ -12,7 +12,7 @@ static SceneComponentRtti* g_rttis[kMaxSceneComponentClasses] = {};
 SceneComponentCallbacks g_sceneComponentCallbacks;
 static U32 g_sceneComponentClassCount = 0;
 
-SceneComponentRtti::SceneComponentRtti(const char* name, F32 updateWeight, U32 size, U32 alignment,
+SceneComponentRtti::SceneComponentRtti(const char* name, F32 updateWeight, Bool alwaysUpdate, U32 size, U32 alignment,
 									   SceneComponentVtable vtable)
 {
 	if(g_sceneComponentClassCount >= kMaxSceneComponentClasses)
@@ -23,6 +23,7 @@ SceneComponentRtti::SceneComponentRtti(const char* name, F32 updateWeight, U32 s
 	}
 
 	m_updateWeight = updateWeight;
+	m_alwaysUpdate = alwaysUpdate;
 
 	m_className = name;
 	ANKI_ASSERT(size < getMaxNumericLimit<decltype(m_classSize)>());
@@ -49,8 +49,10 @@ public:
 	U16 m_classSize;
 	U8 m_classAlignment;
 	U8 m_classId;
+	Bool m_alwaysUpdate; ///< It needs an update every frame even if nothing touched it (eg scripts, physics).
 
-	SceneComponentRtti(const char* name, F32 updateWeight, U32 size, U32 alignment, SceneComponentVtable vtable);
+	SceneComponentRtti(const char* name, F32 updateWeight, Bool alwaysUpdate, U32 size, U32 alignment,
+					   SceneComponentVtable vtable);
 };
 
 /// Define a scene component.
@@ -86,8 +88,8 @@ public: \
 private:
 
 /// Define the statics of a scene component.
-#define ANKI_SCENE_COMPONENT_STATICS(className, updateWeight) \
-	SceneComponentRtti className::_m_rtti(ANKI_STRINGIZE(className), updateWeight, sizeof(className), \
+#define ANKI_SCENE_COMPONENT_STATICS(className, updateWeight, alwaysUpdate) \
+	SceneComponentRtti className::_m_rtti(ANKI_STRINGIZE(className), updateWeight, alwaysUpdate, sizeof(className), \
 										  alignof(className), \
 										  {className::_construct, className::_destruct, className::_onDestroy, \
 										   className::_update, className::_onOtherComponentRemovedOrAdded});
@@ -7,46 +7,46 @@
 #	define ANKI_SCENE_COMPONENT_SEPERATOR
 #endif
 
-ANKI_DEFINE_SCENE_COMPONENT(Script, 0.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Script, 0.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
 
-ANKI_DEFINE_SCENE_COMPONENT(Body, 10.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Body, 10.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(PlayerController, 10.0f)
+ANKI_DEFINE_SCENE_COMPONENT(PlayerController, 10.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
 
-ANKI_DEFINE_SCENE_COMPONENT(Joint, 10.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Joint, 10.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
 
-ANKI_DEFINE_SCENE_COMPONENT(Move, 30.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Move, 30.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Skin, 30.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Skin, 30.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
 
-ANKI_DEFINE_SCENE_COMPONENT(Trigger, 40.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Trigger, 40.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
 
-ANKI_DEFINE_SCENE_COMPONENT(Model, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Model, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(ParticleEmitter, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(ParticleEmitter, 100.0f, true)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Decal, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Decal, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Camera, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Camera, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(FogDensity, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(FogDensity, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(GlobalIlluminationProbe, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(GlobalIlluminationProbe, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(ReflectionProbe, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(ReflectionProbe, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Skybox, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Skybox, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Ui, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Ui, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(LensFlare, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(LensFlare, 100.0f, false)
 ANKI_SCENE_COMPONENT_SEPERATOR
-ANKI_DEFINE_SCENE_COMPONENT(Light, 100.0f)
+ANKI_DEFINE_SCENE_COMPONENT(Light, 100.0f, false)
 
 #undef ANKI_DEFINE_SCENE_COMPONENT
 #undef ANKI_SCENE_COMPONENT_SEPERATOR
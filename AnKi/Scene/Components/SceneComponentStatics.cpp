@@ -24,8 +24,8 @@
 
 namespace anki {
 
-#define ANKI_DEFINE_SCENE_COMPONENT(className, updateOrder) \
-	ANKI_SCENE_COMPONENT_STATICS(className##Component, updateOrder)
+#define ANKI_DEFINE_SCENE_COMPONENT(className, updateOrder, alwaysUpdate) \
+	ANKI_SCENE_COMPONENT_STATICS(className##Component, updateOrder, alwaysUpdate)
 #include <AnKi/Scene/Components/SceneComponentClasses.defs.h>
 
 } // end namespace anki
@@ -15,7 +15,18 @@ ANKI_CONFIG_VAR_F32(SceneShadowCascade1Distance, 40.0, 1.0, kMaxF32, "The distan
 ANKI_CONFIG_VAR_F32(SceneShadowCascade2Distance, 80.0, 1.0, kMaxF32, "The distance of the 3rd cascade")
 ANKI_CONFIG_VAR_F32(SceneShadowCascade3Distance, 200.0, 1.0, kMaxF32, "The distance of the 4th cascade")
 
+ANKI_CONFIG_VAR_BOOL(SceneDirtyTracking, false,
+					 "Update only the scene nodes that changed. Nodes that stay unchanged are parked until touched")
+
 ANKI_CONFIG_VAR_U32(SceneOctreeMaxDepth, 5, 2, 10, "The max depth of the octree")
+ANKI_CONFIG_VAR_BOOL(SceneLinearOctree, false,
+					 "Walk a flat copy of the octree that tests all the children of a leaf with SIMD")
+ANKI_CONFIG_VAR_U32(SceneOccluderCount, 16, 0, 256,
+					"The number of the nearest occluders to rasterize when the coverage buffer can't be used. 0 disables it")
+ANKI_CONFIG_VAR_F32(SceneCoverageBufferMaxCameraMove, 2.0f, 0.0f, kMaxF32,
+					"If the camera moved more than that the coverage buffer is not reprojected")
+ANKI_CONFIG_VAR_F32(SceneCoverageBufferMaxCameraRotation, 30.0f, 0.0f, 180.0f,
+					"If the camera rotated more than that (in degrees) the coverage buffer is not reprojected")
 ANKI_CONFIG_VAR_F32(SceneEarlyZDistance, (ANKI_PLATFORM_MOBILE) ? 0.0f : 10.0f, 0.0f, kMaxF32,
 					"Objects with distance lower than that will be used in early Z")
 
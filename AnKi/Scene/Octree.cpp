@@ -41,12 +41,13 @@ Octree::~Octree()
 	ANKI_ASSERT(m_rootLeaf == nullptr);
 }
 
-void Octree::init(const Vec3& sceneAabbMin, const Vec3& sceneAabbMax, U32 maxDepth)
+void Octree::init(const Vec3& sceneAabbMin, const Vec3& sceneAabbMax, U32 maxDepth, Bool linearTree)
 {
 	ANKI_ASSERT(sceneAabbMin < sceneAabbMax);
 	ANKI_ASSERT(maxDepth > 0);
 
 	m_maxDepth = maxDepth;
+	m_linearTreeEnabled = linearTree;
 	m_sceneAabbMin = sceneAabbMin;
 	m_sceneAabbMax = sceneAabbMax;
 }
@@ -56,8 +57,82 @@ void Octree::place(const Aabb& volume, OctreePlaceable* placeable, Bool updateAc
 	ANKI_ASSERT(placeable);
 	ANKI_ASSERT(testCollision(volume, Aabb(m_sceneAabbMin, m_sceneAabbMax)) && "volume is outside the scene");
 
+	if(updateActualSceneBounds)
+	{
+		this->updateActualSceneBounds(volume);
+	}
+
+	Array<I16, 6> keys;
+	if(placeable->m_deferredPlacementIdx == kMaxU32 && placementUnchanged(volume, *placeable, keys))
+	{
+		// Fast path, it will end up in the same leafs
+		return;
+	}
+
+	LockGuard<Mutex> lock(m_globalMtx);
+	cancelDeferredPlacement(*placeable);
+	placeInternal(volume, placeable);
+}
+
+void Octree::placeDeferred(const Aabb& volume, OctreePlaceable* placeable, Bool updateActualSceneBounds)
+{
+	ANKI_ASSERT(placeable);
+	ANKI_ASSERT(testCollision(volume, Aabb(m_sceneAabbMin, m_sceneAabbMax)) && "volume is outside the scene");
+
+	if(updateActualSceneBounds)
+	{
+		this->updateActualSceneBounds(volume);
+	}
+
+	Array<I16, 6> keys;
+	if(placeable->m_deferredPlacementIdx == kMaxU32 && placementUnchanged(volume, *placeable, keys))
+	{
+		// Fast path, it will end up in the same leafs
+		return;
+	}
+
+	LockGuard<SpinLock> lock(m_deferredPlacementsMtx);
+
+	if(placeable->m_deferredPlacementIdx == kMaxU32)
+	{
+		placeable->m_deferredPlacementIdx = m_deferredPlacementCount++;
+		if(placeable->m_deferredPlacementIdx == m_deferredPlacements.getSize())
+		{
+			m_deferredPlacements.emplaceBack();
+		}
+	}
+
+	DeferredPlacement& placement = m_deferredPlacements[placeable->m_deferredPlacementIdx];
+	placement.m_volume = volume;
+	placement.m_placeable = placeable;
+}
+
+void Octree::applyDeferredUpdates()
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneOctreeDeferredUpdates);
 	LockGuard<Mutex> lock(m_globalMtx);
 
+	for(U32 i = 0; i < m_deferredPlacementCount; ++i)
+	{
+		DeferredPlacement& placement = m_deferredPlacements[i];
+		if(placement.m_placeable)
+		{
+			ANKI_ASSERT(placement.m_placeable->m_deferredPlacementIdx == i);
+			placement.m_placeable->m_deferredPlacementIdx = kMaxU32;
+			placeInternal(placement.m_volume, placement.m_placeable);
+		}
+	}
+
+	m_deferredPlacementCount = 0;
+
+	if(m_linearTreeEnabled && m_linearTreeDirty)
+	{
+		rebuildLinearTree();
+	}
+}
+
+void Octree::placeInternal(const Aabb& volume, OctreePlaceable* placeable)
+{
 	// Remove the placeable from the Octree
 	removeInternal(*placeable);
 
@@ -72,12 +147,69 @@ void Octree::place(const Aabb& volume, OctreePlaceable* placeable, Bool updateAc
 	// And re-place it
 	placeRecursive(volume, placeable, m_rootLeaf, 0);
 	++m_placeableCount;
+	m_linearTreeDirty = true;
 
-	// Update the actual scene bounds
-	if(updateActualSceneBounds)
+	placeable->m_cellKeysValid = computeCellKeys(volume, placeable->m_cellKeys);
+}
+
+Bool Octree::computeCellKeys(const Aabb& volume, Array<I16, 6>& keys) const
+{
+	// Values that are closer than that to the border of a cell might be binned differently by placeRecursive because
+	// of floating point errors
+	constexpr F32 kEpsilon = 0.001f;
+
+	const F32 cellCount = F32(1u << m_maxDepth);
+	const Vec3 scale = Vec3(cellCount) / (m_sceneAabbMax - m_sceneAabbMin);
+	const Vec3 tMin = (volume.getMin().xyz() - m_sceneAabbMin) * scale;
+	const Vec3 tMax = (volume.getMax().xyz() - m_sceneAabbMin) * scale;
+
+	for(U32 i = 0; i < 6; ++i)
+	{
+		const F32 t = (i < 3) ? tMin[i] : tMax[i - 3];
+		const F32 cell = std::floor(t);
+		if(t - cell < kEpsilon || cell + 1.0f - t < kEpsilon)
+		{
+			return false;
+		}
+
+		keys[i] = I16(clamp(cell, -1.0f, cellCount));
+	}
+
+	return true;
+}
+
+Bool Octree::placementUnchanged(const Aabb& volume, const OctreePlaceable& placeable, Array<I16, 6>& keys) const
+{
+	if(!placeable.m_cellKeysValid || !computeCellKeys(volume, keys))
+	{
+		return false;
+	}
+
+	for(U32 i = 0; i < 6; ++i)
 	{
-		m_actualSceneAabbMin = m_actualSceneAabbMin.min(volume.getMin().xyz());
-		m_actualSceneAabbMax = m_actualSceneAabbMax.max(volume.getMax().xyz());
+		if(keys[i] != placeable.m_cellKeys[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Octree::updateActualSceneBounds(const Aabb& volume)
+{
+	LockGuard<SpinLock> lock(m_actualSceneAabbMtx);
+	m_actualSceneAabbMin = m_actualSceneAabbMin.min(volume.getMin().xyz());
+	m_actualSceneAabbMax = m_actualSceneAabbMax.max(volume.getMax().xyz());
+}
+
+void Octree::cancelDeferredPlacement(OctreePlaceable& placeable)
+{
+	if(placeable.m_deferredPlacementIdx != kMaxU32)
+	{
+		LockGuard<SpinLock> lock(m_deferredPlacementsMtx);
+		m_deferredPlacements[placeable.m_deferredPlacementIdx].m_placeable = nullptr;
+		placeable.m_deferredPlacementIdx = kMaxU32;
 	}
 }
 
@@ -86,6 +218,7 @@ void Octree::placeAlwaysVisible(OctreePlaceable* placeable)
 	ANKI_ASSERT(placeable);
 
 	LockGuard<Mutex> lock(m_globalMtx);
+	cancelDeferredPlacement(*placeable);
 
 	// Remove the placeable from the Octree
 	removeInternal(*placeable);
@@ -103,11 +236,13 @@ void Octree::placeAlwaysVisible(OctreePlaceable* placeable)
 	m_rootLeaf->m_placeables.pushBack(newPlaceableNode(placeable));
 
 	++m_placeableCount;
+	m_linearTreeDirty = true;
 }
 
 void Octree::remove(OctreePlaceable& placeable)
 {
 	LockGuard<Mutex> lock(m_globalMtx);
+	cancelDeferredPlacement(placeable);
 	removeInternal(placeable);
 }
 
@@ -292,9 +427,13 @@ void Octree::computeChildAabb(LeafMask child, const Vec3& parentAabbMin, const V
 
 void Octree::removeInternal(OctreePlaceable& placeable)
 {
+	placeable.m_cellKeysValid = false;
+
 	const Bool isPlaced = !placeable.m_leafs.isEmpty();
 	if(isPlaced)
 	{
+		m_linearTreeDirty = true;
+
 		while(!placeable.m_leafs.isEmpty())
 		{
 			// Pop a leaf node
@@ -371,6 +510,74 @@ void Octree::cleanupInternal()
 	}
 }
 
+void Octree::rebuildLinearTree()
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneOctreeLinearize);
+
+	// Keep the storage between rebuilds, the size of the tree doesn't change much from frame to frame
+	m_linearLeafs.resize(m_leafCount);
+	m_linearPlaceables.resize(m_placeableNodeCount);
+	m_linearTreeDirty = false;
+
+	U32 leafCount = 0;
+	U32 placeableCount = 0;
+	if(m_rootLeaf)
+	{
+		linearizeRecursive(*m_rootLeaf, leafCount, placeableCount);
+	}
+
+	ANKI_ASSERT(leafCount == m_linearLeafs.getSize());
+	ANKI_ASSERT(placeableCount == m_linearPlaceables.getSize());
+}
+
+U32 Octree::linearizeRecursive(const Leaf& leaf, U32& leafCount, U32& placeableCount)
+{
+	const U32 leafIdx = leafCount++;
+	LinearLeaf& linearLeaf = m_linearLeafs[leafIdx];
+	linearLeaf.m_childMask = 0;
+
+	linearLeaf.m_firstPlaceable = placeableCount;
+	for(const PlaceableNode& placeableNode : leaf.m_placeables)
+	{
+		m_linearPlaceables[placeableCount++] = placeableNode.m_placeable;
+	}
+	linearLeaf.m_placeableCount = placeableCount - linearLeaf.m_firstPlaceable;
+
+	for(U32 i = 0; i < 8; ++i)
+	{
+		const Leaf* child = leaf.m_children[i];
+		if(!child)
+		{
+			// Give it an empty box to keep the SIMD tests happy
+			linearLeaf.m_childAabbMinX[i] = linearLeaf.m_childAabbMinY[i] = linearLeaf.m_childAabbMinZ[i] = 0.0f;
+			linearLeaf.m_childAabbMaxX[i] = linearLeaf.m_childAabbMaxY[i] = linearLeaf.m_childAabbMaxZ[i] = 0.0f;
+			linearLeaf.m_children[i] = kMaxU32;
+			continue;
+		}
+
+		linearLeaf.m_childAabbMinX[i] = child->m_aabbMin.x();
+		linearLeaf.m_childAabbMinY[i] = child->m_aabbMin.y();
+		linearLeaf.m_childAabbMinZ[i] = child->m_aabbMin.z();
+		linearLeaf.m_childAabbMaxX[i] = child->m_aabbMax.x();
+		linearLeaf.m_childAabbMaxY[i] = child->m_aabbMax.y();
+		linearLeaf.m_childAabbMaxZ[i] = child->m_aabbMax.z();
+		linearLeaf.m_childMask |= U8(1u << i);
+
+		// The array doesn't grow so the linearLeaf reference stays valid
+		linearLeaf.m_children[i] = linearizeRecursive(*child, leafCount, placeableCount);
+	}
+
+	return leafIdx;
+}
+
+U32 Octree::testLinearLeafChildren(const LinearLeaf& leaf, ConstWeakArray<Plane> planes)
+{
+	U64 mask;
+	testPlanes(planes, {&leaf.m_childAabbMinX[0], &leaf.m_childAabbMinY[0], &leaf.m_childAabbMinZ[0]},
+			   {&leaf.m_childAabbMaxX[0], &leaf.m_childAabbMaxY[0], &leaf.m_childAabbMaxZ[0]}, 8, WeakArray<U64>(&mask, 1));
+	return U32(mask) & leaf.m_childMask;
+}
+
 void Octree::debugDrawRecursive(const Leaf& leaf, OctreeDebugDrawer& drawer) const
 {
 	const U32 placeableCount = U32(leaf.m_placeables.getSize());
@@ -8,6 +8,7 @@
 #include <AnKi/Scene/Common.h>
 #include <AnKi/Math.h>
 #include <AnKi/Collision/Aabb.h>
+#include <AnKi/Collision/Plane.h>
 #include <AnKi/Util/WeakArray.h>
 #include <AnKi/Util/Enum.h>
 #include <AnKi/Util/ObjectAllocator.h>
@@ -48,12 +49,22 @@ public:
 
 	Octree& operator=(const Octree&) = delete; // Non-copyable
 
-	void init(const Vec3& sceneAabbMin, const Vec3& sceneAabbMax, U32 maxDepth);
+	/// @param linearTree Maintain a linear version of the tree as well. See walkLinearTree.
+	void init(const Vec3& sceneAabbMin, const Vec3& sceneAabbMax, U32 maxDepth, Bool linearTree = false);
 
 	/// Place or re-place an element in the tree.
 	/// @note It's thread-safe against place and remove methods.
 	void place(const Aabb& volume, OctreePlaceable* placeable, Bool updateActualSceneBounds);
 
+	/// Same as place() but the tree will be updated in applyDeferredUpdates(). The actual scene bounds are updated
+	/// immediately. Use it when many placeables move from many threads.
+	/// @note It's thread-safe against placeDeferred, place and remove methods.
+	void placeDeferred(const Aabb& volume, OctreePlaceable* placeable, Bool updateActualSceneBounds);
+
+	/// Apply the updates of placeDeferred(). It also rebuilds the linear tree if needed.
+	/// @note It's thread-safe against place and remove methods but not against placeDeferred.
+	void applyDeferredUpdates();
+
 	/// Place the placeable somewhere where it's always visible.
 	/// @note It's thread-safe against place and remove methods.
 	void placeAlwaysVisible(OctreePlaceable* placeable);
@@ -78,6 +89,23 @@ public:
 		}
 	}
 
+	/// Check if walkLinearTree can be used. The linear tree is out of date if anything was placed after the last
+	/// applyDeferredUpdates().
+	Bool hasLinearTree() const
+	{
+		return m_linearTreeEnabled && !m_linearTreeDirty;
+	}
+
+	/// Same as walkTree but it walks a flat depth-first copy of the tree where the bounds of the 8 children of a leaf
+	/// are stored in SoA form and they are tested against the planes at once. The linear tree is built by
+	/// applyDeferredUpdates().
+	/// @param planes A leaf is visible if it's in front or it intersects all the planes.
+	/// @param testFunc An additional test for the leafs that passed the planes. Signature: Bool(*)(const Aabb& leafBox)
+	/// @param newPlaceableFunc See walkTree.
+	template<typename TTestAabbFunc, typename TNewPlaceableFunc>
+	void walkLinearTree(U32 testId, ConstWeakArray<Plane> planes, TTestAabbFunc testFunc,
+						TNewPlaceableFunc newPlaceableFunc);
+
 	/// Debug draw.
 	void debugDraw(OctreeDebugDrawer& drawer) const
 	{
@@ -88,7 +116,7 @@ public:
 	/// Get the bounds of the scene as calculated by the objects that were placed inside the Octree.
 	void getActualSceneBounds(Vec3& min, Vec3& max) const
 	{
-		LockGuard<Mutex> lock(m_globalMtx);
+		LockGuard<SpinLock> lock(m_actualSceneAabbMtx);
 		ANKI_ASSERT(m_actualSceneAabbMin.x() < kMaxF32);
 		ANKI_ASSERT(m_actualSceneAabbMax.x() > kMinF32);
 		min = m_actualSceneAabbMin;
@@ -175,6 +203,29 @@ private:
 	};
 	ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS_FRIEND(LeafMask)
 
+	/// A leaf of the linear tree.
+	class alignas(16) LinearLeaf
+	{
+	public:
+		Array<F32, 8> m_childAabbMinX;
+		Array<F32, 8> m_childAabbMinY;
+		Array<F32, 8> m_childAabbMinZ;
+		Array<F32, 8> m_childAabbMaxX;
+		Array<F32, 8> m_childAabbMaxY;
+		Array<F32, 8> m_childAabbMaxZ;
+		Array<U32, 8> m_children; ///< Indices to m_linearLeafs.
+		U32 m_firstPlaceable; ///< Index to m_linearPlaceables.
+		U32 m_placeableCount;
+		U8 m_childMask; ///< The children that exist.
+	};
+
+	class DeferredPlacement
+	{
+	public:
+		Aabb m_volume;
+		OctreePlaceable* m_placeable; ///< If nullptr the placement got cancelled.
+	};
+
 	U32 m_maxDepth = 0;
 	Vec3 m_sceneAabbMin = Vec3(0.0f);
 	Vec3 m_sceneAabbMax = Vec3(0.0f);
@@ -186,18 +237,37 @@ private:
 
 	Leaf* m_rootLeaf = nullptr;
 	U32 m_placeableCount = 0;
+	U32 m_leafCount = 0;
+	U32 m_placeableNodeCount = 0;
 
 	/// Compute the min of the scene bounds based on what is placed inside the octree.
 	Vec3 m_actualSceneAabbMin = Vec3(kMaxF32);
 	Vec3 m_actualSceneAabbMax = Vec3(kMinF32);
+	mutable SpinLock m_actualSceneAabbMtx;
+
+	/// @name The linear tree
+	/// @{
+	SceneDynamicArray<LinearLeaf> m_linearLeafs;
+	SceneDynamicArray<OctreePlaceable*> m_linearPlaceables;
+	Bool m_linearTreeEnabled = false;
+	Bool m_linearTreeDirty = true;
+	/// @}
+
+	/// The storage of placeDeferred(). Only the first m_deferredPlacementCount elements are valid.
+	SceneDynamicArray<DeferredPlacement> m_deferredPlacements;
+	U32 m_deferredPlacementCount = 0;
+	SpinLock m_deferredPlacementsMtx;
 
 	Leaf* newLeaf()
 	{
+		++m_leafCount;
 		return m_leafAlloc.newInstance();
 	}
 
 	void releaseLeaf(Leaf* leaf)
 	{
+		ANKI_ASSERT(m_leafCount > 0);
+		--m_leafCount;
 		m_leafAlloc.deleteInstance(leaf);
 	}
 
@@ -206,11 +276,14 @@ private:
 		ANKI_ASSERT(placeable);
 		PlaceableNode* out = m_placeableNodeAlloc.newInstance();
 		out->m_placeable = placeable;
+		++m_placeableNodeCount;
 		return out;
 	}
 
 	void releasePlaceableNode(PlaceableNode* placeable)
 	{
+		ANKI_ASSERT(m_placeableNodeCount > 0);
+		--m_placeableNodeCount;
 		m_placeableNodeAlloc.deleteInstance(placeable);
 	}
 
@@ -227,8 +300,32 @@ private:
 		m_leafNodeAlloc.deleteInstance(node);
 	}
 
+	void placeInternal(const Aabb& volume, OctreePlaceable* placeable);
+
 	void placeRecursive(const Aabb& volume, OctreePlaceable* placeable, Leaf* parent, U32 depth);
 
+	/// Quantize the volume to the cells of the deepest level. Two volumes with the same keys end up in the same leafs.
+	/// @return False if the volume is too close to the borders of the cells to be sure.
+	Bool computeCellKeys(const Aabb& volume, Array<I16, 6>& keys) const;
+
+	/// Check if the placeable would end up in the same leafs. It's lock-free.
+	Bool placementUnchanged(const Aabb& volume, const OctreePlaceable& placeable, Array<I16, 6>& keys) const;
+
+	void updateActualSceneBounds(const Aabb& volume);
+
+	/// Cancel a pending placeDeferred().
+	void cancelDeferredPlacement(OctreePlaceable& placeable);
+
+	void rebuildLinearTree();
+
+	/// Append the leaf and its children in depth-first pre-order.
+	/// @return The index of the leaf in m_linearLeafs.
+	U32 linearizeRecursive(const Leaf& leaf, U32& leafCount, U32& placeableCount);
+
+	/// Test the children of a linear leaf against some planes.
+	/// @return A mask with the visible children.
+	static U32 testLinearLeafChildren(const LinearLeaf& leaf, ConstWeakArray<Plane> planes);
+
 	static Bool volumeTotallyInsideLeaf(const Aabb& volume, const Leaf& leaf);
 
 	static void computeChildAabb(LeafMask child, const Vec3& parentAabbMin, const Vec3& parentAabbMax,
@@ -277,6 +374,10 @@ private:
 	Array<Atomic<U64>, kMaxTests / 64> m_visitedMasks = {0u, 0u};
 	IntrusiveList<Octree::LeafNode> m_leafs; ///< A list of leafs this placeable belongs.
 
+	Array<I16, 6> m_cellKeys = {}; ///< The quantized volume of the last placement. See Octree::computeCellKeys.
+	Bool m_cellKeysValid = false;
+	U32 m_deferredPlacementIdx = kMaxU32; ///< Index in Octree::m_deferredPlacements.
+
 	/// Check if already visited.
 	/// @note It's thread-safe.
 	Bool alreadyVisited(U32 testId)
@@ -320,6 +421,62 @@ inline void Octree::walkTreeInternal(Leaf& leaf, U32 testId, TTestAabbFunc testF
 
 	ANKI_TRACE_INC_COUNTER(SceneOctreeVisibleLeafs, visibleLeafs);
 }
+
+template<typename TTestAabbFunc, typename TNewPlaceableFunc>
+inline void Octree::walkLinearTree(U32 testId, ConstWeakArray<Plane> planes, TTestAabbFunc testFunc,
+								   TNewPlaceableFunc newPlaceableFunc)
+{
+	ANKI_ASSERT(m_linearTreeEnabled && !m_linearTreeDirty && "Forgot to call applyDeferredUpdates");
+	if(m_linearLeafs.getSize() == 0) [[unlikely]]
+	{
+		return;
+	}
+
+	// Depth first traversal. At most 7 siblings per level wait in the stack
+	Array<U32, 8 * 16> stack;
+	ANKI_ASSERT(m_maxDepth < 16);
+	U32 stackSize = 0;
+	stack[stackSize++] = 0;
+
+	[[maybe_unused]] U32 visibleLeafs = 0;
+	while(stackSize)
+	{
+		const LinearLeaf& leaf = m_linearLeafs[stack[--stackSize]];
+
+		// Visit the placeables that belong to that leaf
+		for(U32 i = leaf.m_firstPlaceable; i < leaf.m_firstPlaceable + leaf.m_placeableCount; ++i)
+		{
+			OctreePlaceable& placeable = *m_linearPlaceables[i];
+			if(!placeable.alreadyVisited(testId))
+			{
+				ANKI_ASSERT(placeable.m_userData);
+				newPlaceableFunc(placeable.m_userData);
+			}
+		}
+
+		if(!leaf.m_childMask)
+		{
+			continue;
+		}
+
+		U32 mask = testLinearLeafChildren(leaf, planes);
+		while(mask)
+		{
+			const U32 i = U32(__builtin_ctzll(mask));
+			mask &= mask - 1;
+
+			const Aabb aabb(Vec3(leaf.m_childAabbMinX[i], leaf.m_childAabbMinY[i], leaf.m_childAabbMinZ[i]),
+							Vec3(leaf.m_childAabbMaxX[i], leaf.m_childAabbMaxY[i], leaf.m_childAabbMaxZ[i]));
+			if(testFunc(aabb))
+			{
+				++visibleLeafs;
+				stack[stackSize++] = leaf.m_children[i];
+			}
+		}
+	}
+
+	ANKI_TRACE_INC_COUNTER(SceneOctreeVisibleLeafs, visibleLeafs);
+}
 /// @}
 
 } // end namespace anki
@@ -6,29 +6,37 @@
 #include <AnKi/Scene/SceneGraph.h>
 #include <AnKi/Scene/Octree.h>
 #include <AnKi/Scene/Components/CameraComponent.h>
+#include <AnKi/Scene/Components/ModelComponent.h>
 #include <AnKi/Physics/PhysicsWorld.h>
 #include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Resource/ResourceStreamer.h>
 #include <AnKi/Renderer/MainRenderer.h>
 #include <AnKi/Core/ConfigSet.h>
 #include <AnKi/Util/ThreadHive.h>
+#include <AnKi/Util/ParallelFor.h>
 #include <AnKi/Util/Tracer.h>
 #include <AnKi/Util/HighRezTimer.h>
 
 namespace anki {
 
-constexpr U32 kUpdateNodeBatchSize = 10;
+/// Nodes of the same hierarchy level that a thread will process at once.
+constexpr U32 kUpdateNodeGrainSize = 16;
 
-class SceneGraph::UpdateSceneNodesCtx
-{
-public:
-	SceneGraph* m_scene = nullptr;
+/// Every thread allocates from its own part of the frame pool to avoid contention.
+constexpr PtrSize kFramePoolThreadArenaSize = 64_KB;
 
-	IntrusiveList<SceneNode>::Iterator m_crntNode;
-	SpinLock m_crntNodeLock;
+/// Park a node after that many updates where nothing changed.
+constexpr U8 kIdleUpdatesBeforeParking = 2;
 
-	Second m_prevUpdateTime;
-	Second m_crntTime;
-};
+static U32 computeHierarchyDepth(const SceneNode& node)
+{
+	U32 depth = 0;
+	for(const SceneNode* parent = node.getParent(); parent; parent = parent->getParent())
+	{
+		++depth;
+	}
+	return depth;
+}
 
 SceneGraph::SceneGraph()
 {
@@ -55,10 +63,14 @@ Error SceneGraph::init(AllocAlignedCallback allocCallback, void* allocCallbackDa
 {
 	SceneMemoryPool::allocateSingleton(allocCallback, allocCallbackData);
 
-	m_framePool.init(allocCallback, allocCallbackData, 1 * 1024 * 1024);
+	m_framePool.init(allocCallback, allocCallbackData, 1_MB, 2.0, 0, true, ANKI_SAFE_ALIGNMENT, "SceneFrame",
+					 kFramePoolThreadArenaSize);
+
+	m_dirtyTracking = ConfigSet::getSingleton().getSceneDirtyTracking();
 
 	m_octree = newInstance<Octree>(SceneMemoryPool::getSingleton());
-	m_octree->init(m_sceneMin, m_sceneMax, ConfigSet::getSingleton().getSceneOctreeMaxDepth());
+	m_octree->init(m_sceneMin, m_sceneMax, ConfigSet::getSingleton().getSceneOctreeMaxDepth(),
+				   ConfigSet::getSingleton().getSceneLinearOctree());
 
 	// Init the default main camera
 	ANKI_CHECK(newSceneNode<SceneNode>("mainCamera", m_defaultMainCam));
@@ -91,6 +103,13 @@ Error SceneGraph::registerNode(SceneNode* node)
 	m_nodes.pushBack(node);
 	++m_nodesCount;
 
+	// New nodes start awake
+	if(m_dirtyTracking)
+	{
+		ANKI_ASSERT(!node->isParked());
+		m_activeNodes.emplaceBack(node);
+	}
+
 	return Error::kNone;
 }
 
@@ -131,6 +150,24 @@ void SceneGraph::deleteNodesMarkedForDeletion()
 {
 	/// Delete all nodes pending deletion. At this point all scene threads
 	/// should have finished their tasks
+	if(m_dirtyTracking && m_objectsMarkedForDeletionCount.load() > 0)
+	{
+		gatherWokenUpNodes();
+
+		for(U32 i = 0; i < m_activeNodes.getSize();)
+		{
+			if(m_activeNodes[i]->getMarkedForDeletion())
+			{
+				m_activeNodes[i] = m_activeNodes.getBack();
+				m_activeNodes.popBack();
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
 	while(m_objectsMarkedForDeletionCount.load() > 0)
 	{
 		[[maybe_unused]] Bool found = false;
@@ -188,27 +225,20 @@ Error SceneGraph::update(Second prevUpdateTime, Second crntTime)
 		ANKI_CHECK(m_events.updateAllEvents(prevUpdateTime, crntTime));
 
 		// Then the rest
-		Array<ThreadHiveTask, ThreadHive::kMaxThreads> tasks;
-		UpdateSceneNodesCtx updateCtx;
-		updateCtx.m_scene = this;
-		updateCtx.m_crntNode = m_nodes.getBegin();
-		updateCtx.m_prevUpdateTime = prevUpdateTime;
-		updateCtx.m_crntTime = crntTime;
-
-		for(U i = 0; i < CoreThreadHive::getSingleton().getThreadCount(); i++)
+		if(m_dirtyTracking)
 		{
-			tasks[i] = ANKI_THREAD_HIVE_TASK(
-				{
-					if(self->m_scene->updateNodes(*self))
-					{
-						ANKI_SCENE_LOGF("Will not recover");
-					}
-				},
-				&updateCtx, nullptr, nullptr);
+			wakeUpNodesWithStreamedChanges();
+		}
+
+		const Error err =
+			(m_dirtyTracking) ? updateActiveNodes(prevUpdateTime, crntTime) : updateAllNodes(prevUpdateTime, crntTime);
+		if(err)
+		{
+			ANKI_SCENE_LOGF("Will not recover");
 		}
 
-		CoreThreadHive::getSingleton().submitTasks(&tasks[0], CoreThreadHive::getSingleton().getThreadCount());
-		CoreThreadHive::getSingleton().waitAllTasks();
+		// The spatials that moved are re-placed in one go
+		m_octree->applyDeferredUpdates();
 	}
 
 	m_stats.m_updateTime = HighRezTimer::getCurrentTime() - m_stats.m_updateTime;
@@ -222,13 +252,12 @@ void SceneGraph::doVisibilityTests(RenderQueue& rqueue)
 	m_stats.m_visibilityTestsTime = HighRezTimer::getCurrentTime() - m_stats.m_visibilityTestsTime;
 }
 
-Error SceneGraph::updateNode(Second prevTime, Second crntTime, SceneNode& node)
+Error SceneGraph::updateNodeComponents(Second prevTime, Second crntTime, SceneNode& node)
 {
 	ANKI_TRACE_INC_COUNTER(SceneNodeUpdated, 1);
 
 	Error err = Error::kNone;
 
-	// Components update
 	SceneComponentUpdateInfo componentUpdateInfo(prevTime, crntTime);
 	componentUpdateInfo.m_framePool = &m_framePool;
 
@@ -251,80 +280,207 @@ Error SceneGraph::updateNode(Second prevTime, Second crntTime, SceneNode& node)
 		}
 	});
 
-	// Update children
-	if(!err)
+	if(!err && atLeastOneComponentUpdated)
 	{
-		err = node.visitChildrenMaxDepth(0, [&](SceneNode& child) -> Error {
-			return updateNode(prevTime, crntTime, child);
-		});
+		node.setComponentMaxTimestamp(GlobalFrameIndex::getSingleton().m_value);
 	}
+	else
+	{
+		// No components or nothing updated, don't change the timestamp
+	}
+
+	const U8 idleUpdateCount = node.m_idleUpdateCount.load();
+	if(atLeastOneComponentUpdated || node.m_hasAlwaysUpdateComponents)
+	{
+		node.m_idleUpdateCount.store(0);
+	}
+	else if(idleUpdateCount < kMaxU8)
+	{
+		node.m_idleUpdateCount.store(U8(idleUpdateCount + 1));
+	}
+
+	return err;
+}
+
+Error SceneGraph::updateAllNodes(Second prevUpdateTime, Second crntTime)
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneNodeUpdate);
 
-	// Frame update
-	if(!err)
+	// Gather the roots of the hierarchies and update them one level at a time. That way deep or wide hierarchies
+	// don't end up in a single thread
+	SceneNode** roots = newArray<SceneNode*>(m_framePool, m_nodesCount);
+	U32 rootCount = 0;
+	for(SceneNode& node : m_nodes)
 	{
-		if(atLeastOneComponentUpdated)
+		if(node.getParent() == nullptr)
 		{
-			node.setComponentMaxTimestamp(GlobalFrameIndex::getSingleton().m_value);
+			roots[rootCount++] = &node;
 		}
-		else
+	}
+
+	m_stats.m_updatedNodeCount = m_nodesCount;
+
+	return parallelForHierarchy(
+		CoreThreadHive::getSingleton(), ConstWeakArray<SceneNode*>(roots, rootCount), m_nodesCount,
+		kUpdateNodeGrainSize, m_framePool,
+		[&](SceneNode& node) {
+			return updateNodeComponents(prevUpdateTime, crntTime, node);
+		},
+		[&](SceneNode& node) {
+			return node.frameUpdate(prevUpdateTime, crntTime);
+		});
+}
+
+void SceneGraph::gatherWokenUpNodes()
+{
+	LockGuard<SpinLock> lock(m_wokenUpNodesMtx);
+	for(SceneNode* node : m_wokenUpNodes)
+	{
+		m_activeNodes.emplaceBack(node);
+	}
+	m_wokenUpNodes.destroy();
+}
+
+void SceneGraph::wakeUpNodesWithStreamedChanges()
+{
+	const U32 version = ResourceManager::getSingleton().getResourceStreamer().getVersion();
+	if(version == m_resourceStreamerVersion)
+	{
+		return;
+	}
+
+	m_resourceStreamerVersion = version;
+
+	// Streaming changes come in bursts so a walk of the nodes is fine. The active nodes will see the changes anyway
+	for(SceneNode& node : m_nodes)
+	{
+		if(!node.isParked())
 		{
-			// No components or nothing updated, don't change the timestamp
+			continue;
 		}
 
-		err = node.frameUpdate(prevTime, crntTime);
-	}
+		Bool changed = false;
+		static_cast<const SceneNode&>(node).iterateComponentsOfType<ModelComponent>([&](const ModelComponent& comp) {
+			changed = changed || comp.streamedResourcesChanged();
+		});
 
-	return err;
+		if(changed)
+		{
+			node.wakeUp();
+		}
+	}
 }
 
-Error SceneGraph::updateNodes(UpdateSceneNodesCtx& ctx)
+Error SceneGraph::updateActiveNodes(Second prevUpdateTime, Second crntTime)
 {
 	ANKI_TRACE_SCOPED_EVENT(SceneNodeUpdate);
 
-	IntrusiveList<SceneNode>::ConstIterator end = m_nodes.getEnd();
+	class WorkItem
+	{
+	public:
+		SceneNode* m_node;
+		U32 m_depth;
+	};
 
-	Bool quit = false;
-	Error err = Error::kNone;
-	while(!quit && !err)
+	auto depthLess = [](const WorkItem& a, const WorkItem& b) {
+		return a.m_depth < b.m_depth;
+	};
+
+	// Sort the active nodes per hierarchy depth. Parents need to be updated before their children
+	gatherWokenUpNodes();
+
+	DynamicArray<WorkItem, MemoryPoolPtrWrapper<StackMemoryPool>> work(&m_framePool);
+	work.resize(m_activeNodes.getSize());
+	for(U32 i = 0; i < m_activeNodes.getSize(); ++i)
 	{
-		// Fetch a batch of scene nodes that don't have parent
-		Array<SceneNode*, kUpdateNodeBatchSize> batch;
-		U batchSize = 0;
+		work[i] = {m_activeNodes[i], computeHierarchyDepth(*m_activeNodes[i])};
+	}
+	std::sort(work.getBegin(), work.getEnd(), depthLess);
+
+	Atomic<U32> errorCount = {0};
+	DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>> levelStarts(&m_framePool);
 
+	// Update the components one level at a time
+	U32 levelBegin = 0;
+	while(levelBegin < work.getSize())
+	{
+		const U32 depth = work[levelBegin].m_depth;
+		U32 levelEnd = levelBegin + 1;
+		while(levelEnd < work.getSize() && work[levelEnd].m_depth == depth)
 		{
-			LockGuard<SpinLock> lock(ctx.m_crntNodeLock);
+			++levelEnd;
+		}
 
-			while(1)
+		levelStarts.emplaceBack(levelBegin);
+
+		parallelFor(CoreThreadHive::getSingleton(), levelBegin, levelEnd, kUpdateNodeGrainSize,
+					[&](U32 begin, U32 end) {
+						for(U32 i = begin; i < end; ++i)
+						{
+							if(updateNodeComponents(prevUpdateTime, crntTime, *work[i].m_node))
+							{
+								errorCount.fetchAdd(1);
+							}
+						}
+					});
+
+		// Nodes might have woken up while updating this level (eg the children of a node that moved). Update the
+		// deeper ones in this frame. The rest will be updated in the next
+		const U32 firstWokenUp = m_activeNodes.getSize();
+		gatherWokenUpNodes();
+		if(firstWokenUp < m_activeNodes.getSize())
+		{
+			for(U32 i = firstWokenUp; i < m_activeNodes.getSize(); ++i)
 			{
-				if(batchSize == batch.getSize())
+				const U32 newDepth = computeHierarchyDepth(*m_activeNodes[i]);
+				if(newDepth > depth)
 				{
-					break;
+					work.emplaceBack(WorkItem{m_activeNodes[i], newDepth});
 				}
+			}
 
-				if(ctx.m_crntNode == end)
-				{
-					quit = true;
-					break;
-				}
+			std::sort(work.getBegin() + levelEnd, work.getEnd(), depthLess);
+		}
 
-				SceneNode& node = *ctx.m_crntNode;
-				if(node.getParent() == nullptr)
-				{
-					batch[batchSize++] = &node;
-				}
+		levelBegin = levelEnd;
+	}
+	levelStarts.emplaceBack(work.getSize());
 
-				++ctx.m_crntNode;
-			}
-		}
+	// Frame update from the leafs to the roots
+	for(U32 level = levelStarts.getSize() - 1; level-- > 0;)
+	{
+		parallelFor(CoreThreadHive::getSingleton(), levelStarts[level], levelStarts[level + 1], kUpdateNodeGrainSize,
+					[&](U32 begin, U32 end) {
+						for(U32 i = begin; i < end; ++i)
+						{
+							if(work[i].m_node->frameUpdate(prevUpdateTime, crntTime))
+							{
+								errorCount.fetchAdd(1);
+							}
+						}
+					});
+	}
+
+	m_stats.m_updatedNodeCount = work.getSize();
 
-		// Process nodes
-		for(U i = 0; i < batchSize && !err; ++i)
+	// Park the nodes that didn't change for a while
+	gatherWokenUpNodes();
+	for(U32 i = 0; i < m_activeNodes.getSize();)
+	{
+		SceneNode& node = *m_activeNodes[i];
+		if(node.m_idleUpdateCount.load() >= kIdleUpdatesBeforeParking && !node.getMarkedForDeletion())
 		{
-			err = updateNode(ctx.m_prevUpdateTime, ctx.m_crntTime, *batch[i]);
+			node.m_parked.store(true);
+			m_activeNodes[i] = m_activeNodes.getBack();
+			m_activeNodes.popBack();
+		}
+		else
+		{
+			++i;
 		}
 	}
 
-	return err;
+	return (errorCount.load()) ? Error::kFunctionFailed : Error::kNone;
 }
 
 } // end namespace anki
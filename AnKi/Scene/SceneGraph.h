@@ -29,6 +29,7 @@ public:
 	Second m_updateTime ANKI_DEBUG_CODE(= 0.0);
 	Second m_visibilityTestsTime ANKI_DEBUG_CODE(= 0.0);
 	Second m_physicsUpdate ANKI_DEBUG_CODE(= 0.0);
+	U32 m_updatedNodeCount ANKI_DEBUG_CODE(= 0); ///< Nodes visited by the last update.
 };
 
 /// The scene graph that  all the scene entities
@@ -159,8 +160,6 @@ public:
 	}
 
 private:
-	class UpdateSceneNodesCtx;
-
 	class InitMemPoolDummy
 	{
 	public:
@@ -195,6 +194,15 @@ private:
 
 	AllGpuSceneContiguousArrays m_gpuSceneAllocators;
 
+	/// @name Dirty tracking
+	/// @{
+	Bool m_dirtyTracking = false;
+	SceneDynamicArray<SceneNode*> m_activeNodes; ///< The nodes that are not parked.
+	SceneDynamicArray<SceneNode*> m_wokenUpNodes; ///< Nodes that woke up and are not in m_activeNodes yet.
+	SpinLock m_wokenUpNodesMtx;
+	U32 m_resourceStreamerVersion = 0;
+	/// @}
+
 	SceneGraph();
 
 	~SceneGraph();
@@ -206,8 +214,27 @@ private:
 	/// Delete the nodes that are marked for deletion
 	void deleteNodesMarkedForDeletion();
 
-	Error updateNodes(UpdateSceneNodesCtx& ctx);
-	Error updateNode(Second prevTime, Second crntTime, SceneNode& node);
+	/// Update the components of a node. The parent's components are already updated.
+	Error updateNodeComponents(Second prevTime, Second crntTime, SceneNode& node);
+
+	/// Update all nodes.
+	Error updateAllNodes(Second prevUpdateTime, Second crntTime);
+
+	/// Update only the nodes that are not parked and park those that stayed unchanged.
+	Error updateActiveNodes(Second prevUpdateTime, Second crntTime);
+
+	/// Called by SceneNode::wakeUp. It's thread-safe.
+	void addWokenUpNode(SceneNode& node)
+	{
+		LockGuard<SpinLock> lock(m_wokenUpNodesMtx);
+		m_wokenUpNodes.emplaceBack(&node);
+	}
+
+	/// Move the woken up nodes to the active nodes.
+	void gatherWokenUpNodes();
+
+	/// Wake up the parked nodes whose resources were changed by the ResourceStreamer.
+	void wakeUpNodesWithStreamedChanges();
 
 	/// Do visibility tests.
 	static void doVisibilityTests(SceneNode& frustumable, SceneGraph& scene, RenderQueue& rqueue);
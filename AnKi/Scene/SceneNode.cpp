@@ -51,6 +51,8 @@ void SceneNode::setMarkedForDeletion()
 void SceneNode::newComponentInternal(SceneComponent* newc)
 {
 	m_componentTypeMask |= 1 << newc->getClassId();
+	m_hasAlwaysUpdateComponents = m_hasAlwaysUpdateComponents || newc->getClassRtti().m_alwaysUpdate;
+	wakeUp();
 
 	// Inform all other components that some component was added
 	for(SceneComponent* other : m_components)
@@ -81,6 +83,15 @@ void SceneNode::newComponentInternal(SceneComponent* newc)
 	});
 }
 
+void SceneNode::wakeUpInternal()
+{
+	// Only one thread will succeed
+	if(m_parked.exchange(false))
+	{
+		SceneGraph::getSingleton().addWokenUpNode(*this);
+	}
+}
+
 Bool SceneNode::updateTransform()
 {
 	const Bool needsUpdate = m_localTransformDirty;
@@ -109,7 +120,7 @@ Bool SceneNode::updateTransform()
 
 		// Make children dirty as well. Don't walk the whole tree because you will re-walk it later
 		[[maybe_unused]] const Error err = visitChildrenMaxDepth(1, [](SceneNode& childNode) -> Error {
-			childNode.m_localTransformDirty = true;
+			childNode.markLocalTransformDirty();
 			return Error::kNone;
 		});
 	}
@@ -24,6 +24,7 @@ class SceneGraphExternalSubsystems;
 class SceneNode : public SceneHierarchy<SceneNode>, public IntrusiveListEnabled<SceneNode>
 {
 	friend class SceneComponent;
+	friend class SceneGraph;
 
 public:
 	using Base = SceneHierarchy<SceneNode>;
@@ -120,10 +121,11 @@ public:
 		}
 	}
 
-	/// Iterate all components of a specific type
+	/// Iterate all components of a specific type. It wakes up the node.
 	template<typename TComponent, typename TFunct>
 	void iterateComponentsOfType(TFunct func)
 	{
+		wakeUp();
 		if(m_componentTypeMask & (1 << TComponent::getStaticClassId()))
 		{
 			for(U32 i = 0; i < m_components.getSize(); ++i)
@@ -153,10 +155,11 @@ public:
 		return nullptr;
 	}
 
-	/// Try geting a pointer to the first component of the requested type
+	/// Try geting a pointer to the first component of the requested type. It wakes up the node.
 	template<typename TComponent>
 	TComponent* tryGetFirstComponentOfType()
 	{
+		wakeUp();
 		const TComponent* c = static_cast<const SceneNode*>(this)->tryGetFirstComponentOfType<TComponent>();
 		return const_cast<TComponent*>(c);
 	}
@@ -170,10 +173,11 @@ public:
 		return *out;
 	}
 
-	/// Get a pointer to the first component of the requested type
+	/// Get a pointer to the first component of the requested type. It wakes up the node.
 	template<typename TComponent>
 	TComponent& getFirstComponentOfType()
 	{
+		wakeUp();
 		const TComponent& c = static_cast<const SceneNode*>(this)->getFirstComponentOfType<TComponent>();
 		return const_cast<TComponent&>(c);
 	}
@@ -196,10 +200,11 @@ public:
 		return nullptr;
 	}
 
-	/// Try geting a pointer to the nth component of the requested type.
+	/// Try geting a pointer to the nth component of the requested type. It wakes up the node.
 	template<typename TComponent>
 	TComponent* tryGetNthComponentOfType(U32 nth)
 	{
+		wakeUp();
 		const TComponent* c = static_cast<const SceneNode*>(this)->tryGetNthComponentOfType<TComponent>(nth);
 		return const_cast<TComponent*>(c);
 	}
@@ -220,10 +225,11 @@ public:
 		return *out;
 	}
 
-	/// Get the nth component.
+	/// Get the nth component. It wakes up the node.
 	template<typename TComponent>
 	TComponent& getComponentAt(U32 idx)
 	{
+		wakeUp();
 		ANKI_ASSERT(m_components[idx]->getClassId() == TComponent::getStaticClassId());
 		SceneComponent* c = m_components[idx];
 		return *static_cast<TComponent*>(c);
@@ -267,13 +273,13 @@ public:
 	void setLocalTransform(const Transform& x)
 	{
 		m_ltrf = x;
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 
 	void setLocalOrigin(const Vec4& x)
 	{
 		m_ltrf.setOrigin(x);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 
 	const Vec4& getLocalOrigin() const
@@ -284,7 +290,7 @@ public:
 	void setLocalRotation(const Mat3x4& x)
 	{
 		m_ltrf.setRotation(x);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 
 	const Mat3x4& getLocalRotation() const
@@ -295,7 +301,7 @@ public:
 	void setLocalScale(F32 x)
 	{
 		m_ltrf.setScale(x);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 
 	F32 getLocalScale() const
@@ -318,46 +324,46 @@ public:
 	void rotateLocalX(F32 angleRad)
 	{
 		m_ltrf.getRotation().rotateXAxis(angleRad);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void rotateLocalY(F32 angleRad)
 	{
 		m_ltrf.getRotation().rotateYAxis(angleRad);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void rotateLocalZ(F32 angleRad)
 	{
 		m_ltrf.getRotation().rotateZAxis(angleRad);
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void moveLocalX(F32 distance)
 	{
 		Vec3 x_axis = m_ltrf.getRotation().getColumn(0);
 		m_ltrf.getOrigin() += Vec4(x_axis, 0.0) * distance;
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void moveLocalY(F32 distance)
 	{
 		Vec3 y_axis = m_ltrf.getRotation().getColumn(1);
 		m_ltrf.getOrigin() += Vec4(y_axis, 0.0) * distance;
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void moveLocalZ(F32 distance)
 	{
 		Vec3 z_axis = m_ltrf.getRotation().getColumn(2);
 		m_ltrf.getOrigin() += Vec4(z_axis, 0.0) * distance;
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	void scale(F32 s)
 	{
 		m_ltrf.getScale() *= s;
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 
 	void lookAtPoint(const Vec4& point)
 	{
 		m_ltrf.lookAt(point, Vec4(0.0f, 1.0f, 0.0f, 0.0f));
-		m_localTransformDirty = true;
+		markLocalTransformDirty();
 	}
 	/// @}
 
@@ -368,6 +374,23 @@ public:
 
 	ANKI_INTERNAL Bool updateTransform();
 
+	/// Put the node back to the nodes that get updated every frame. Only meaningful when SceneDirtyTracking is on. The
+	/// non-const component getters and the transform setters call it.
+	/// @note It's thread-safe.
+	void wakeUp()
+	{
+		m_idleUpdateCount.store(0);
+		if(m_parked.load()) [[unlikely]]
+		{
+			wakeUpInternal();
+		}
+	}
+
+	Bool isParked() const
+	{
+		return m_parked.load();
+	}
+
 	/// Create and append a component to the components container. The SceneNode has the ownership.
 	template<typename TComponent>
 	TComponent* newComponent()
@@ -387,6 +410,12 @@ private:
 
 	Timestamp m_maxComponentTimestamp = 0;
 
+	/// If true the node is not updated by the SceneGraph until someone wakes it up.
+	Atomic<Bool> m_parked = {false};
+
+	/// Number of consecutive updates where nothing changed.
+	Atomic<U8> m_idleUpdateCount = {0};
+
 	/// The transformation in local space.
 	Transform m_ltrf = Transform::getIdentity();
 
@@ -401,8 +430,17 @@ private:
 	Bool m_localTransformDirty : 1 = true;
 	Bool m_ignoreParentNodeTransform : 1 = false;
 	Bool m_transformUpdatedThisFrame : 1 = true;
+	Bool m_hasAlwaysUpdateComponents : 1 = false;
 
 	void newComponentInternal(SceneComponent* newc);
+
+	void markLocalTransformDirty()
+	{
+		m_localTransformDirty = true;
+		wakeUp();
+	}
+
+	void wakeUpInternal();
 };
 /// @}
 
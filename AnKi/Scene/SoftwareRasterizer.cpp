@@ -6,10 +6,213 @@
 #include <AnKi/Scene/SoftwareRasterizer.h>
 #include <AnKi/Collision/Aabb.h>
 #include <AnKi/Collision/Functions.h>
+#include <AnKi/Util/ParallelFor.h>
 #include <AnKi/Util/Tracer.h>
 
 namespace anki {
 
+namespace {
+
+/// A tiny wrapper on top of 4 floats to keep the rasterizer readable.
+class F32x4
+{
+public:
+	MathSimd<F32, 4>::Type m_simd;
+
+	F32x4() = default;
+
+	explicit F32x4(F32 f)
+	{
+#if ANKI_SIMD_SSE
+		m_simd = _mm_set1_ps(f);
+#elif ANKI_SIMD_NEON
+		m_simd = vdupq_n_f32(f);
+#else
+		m_simd[0] = m_simd[1] = m_simd[2] = m_simd[3] = f;
+#endif
+	}
+
+	F32x4(F32 a, F32 b, F32 c, F32 d)
+	{
+#if ANKI_SIMD_SSE
+		m_simd = _mm_set_ps(d, c, b, a);
+#elif ANKI_SIMD_NEON
+		m_simd = float32x4_t{a, b, c, d};
+#else
+		m_simd[0] = a;
+		m_simd[1] = b;
+		m_simd[2] = c;
+		m_simd[3] = d;
+#endif
+	}
+
+	static F32x4 load(const F32* ptr)
+	{
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_loadu_ps(ptr);
+#elif ANKI_SIMD_NEON
+		out.m_simd = vld1q_f32(ptr);
+#else
+		memcpy(&out.m_simd[0], ptr, sizeof(out.m_simd));
+#endif
+		return out;
+	}
+
+	void store(F32* ptr) const
+	{
+#if ANKI_SIMD_SSE
+		_mm_storeu_ps(ptr, m_simd);
+#elif ANKI_SIMD_NEON
+		vst1q_f32(ptr, m_simd);
+#else
+		memcpy(ptr, &m_simd[0], sizeof(m_simd));
+#endif
+	}
+
+	F32x4 operator+(const F32x4& b) const
+	{
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_add_ps(m_simd, b.m_simd);
+#elif ANKI_SIMD_NEON
+		out.m_simd = vaddq_f32(m_simd, b.m_simd);
+#else
+		for(U32 i = 0; i < 4; ++i)
+		{
+			out.m_simd[i] = m_simd[i] + b.m_simd[i];
+		}
+#endif
+		return out;
+	}
+
+	F32x4 operator*(const F32x4& b) const
+	{
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_mul_ps(m_simd, b.m_simd);
+#elif ANKI_SIMD_NEON
+		out.m_simd = vmulq_f32(m_simd, b.m_simd);
+#else
+		for(U32 i = 0; i < 4; ++i)
+		{
+			out.m_simd[i] = m_simd[i] * b.m_simd[i];
+		}
+#endif
+		return out;
+	}
+
+	F32x4 min(const F32x4& b) const
+	{
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_min_ps(m_simd, b.m_simd);
+#elif ANKI_SIMD_NEON
+		out.m_simd = vminq_f32(m_simd, b.m_simd);
+#else
+		for(U32 i = 0; i < 4; ++i)
+		{
+			out.m_simd[i] = anki::min(m_simd[i], b.m_simd[i]);
+		}
+#endif
+		return out;
+	}
+
+	F32x4 max(const F32x4& b) const
+	{
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_max_ps(m_simd, b.m_simd);
+#elif ANKI_SIMD_NEON
+		out.m_simd = vmaxq_f32(m_simd, b.m_simd);
+#else
+		for(U32 i = 0; i < 4; ++i)
+		{
+			out.m_simd[i] = anki::max(m_simd[i], b.m_simd[i]);
+		}
+#endif
+		return out;
+	}
+
+	/// @return A 4 bit mask with the lanes where this >= b.
+	U32 greaterEqualMask(const F32x4& b) const
+	{
+#if ANKI_SIMD_SSE
+		return U32(_mm_movemask_ps(_mm_cmpge_ps(m_simd, b.m_simd)));
+#elif ANKI_SIMD_NEON
+		return vaddvq_u32(vandq_u32(vcgeq_f32(m_simd, b.m_simd), uint32x4_t{1, 2, 4, 8}));
+#else
+		U32 mask = 0;
+		for(U32 i = 0; i < 4; ++i)
+		{
+			mask |= (m_simd[i] >= b.m_simd[i]) ? (1u << i) : 0u;
+		}
+		return mask;
+#endif
+	}
+
+	/// @return A 4 bit mask with the lanes where this < b.
+	U32 lessMask(const F32x4& b) const
+	{
+		return ~greaterEqualMask(b) & 0xFu;
+	}
+
+	/// Pick the lanes of a where the bit of the mask is set and the rest from b.
+	static F32x4 select(U32 mask, const F32x4& a, const F32x4& b)
+	{
+		ANKI_ASSERT(mask <= 0xF);
+		alignas(16) static constexpr Array<Array<U32, 4>, 16> kMasks = {
+			{{0, 0, 0, 0},
+			 {kMaxU32, 0, 0, 0},
+			 {0, kMaxU32, 0, 0},
+			 {kMaxU32, kMaxU32, 0, 0},
+			 {0, 0, kMaxU32, 0},
+			 {kMaxU32, 0, kMaxU32, 0},
+			 {0, kMaxU32, kMaxU32, 0},
+			 {kMaxU32, kMaxU32, kMaxU32, 0},
+			 {0, 0, 0, kMaxU32},
+			 {kMaxU32, 0, 0, kMaxU32},
+			 {0, kMaxU32, 0, kMaxU32},
+			 {kMaxU32, kMaxU32, 0, kMaxU32},
+			 {0, 0, kMaxU32, kMaxU32},
+			 {kMaxU32, 0, kMaxU32, kMaxU32},
+			 {0, kMaxU32, kMaxU32, kMaxU32},
+			 {kMaxU32, kMaxU32, kMaxU32, kMaxU32}}};
+
+		F32x4 out;
+#if ANKI_SIMD_SSE
+		out.m_simd = _mm_blendv_ps(b.m_simd, a.m_simd, _mm_load_ps(reinterpret_cast<const F32*>(&kMasks[mask][0])));
+#elif ANKI_SIMD_NEON
+		out.m_simd = vbslq_f32(vld1q_u32(&kMasks[mask][0]), a.m_simd, b.m_simd);
+#else
+		for(U32 i = 0; i < 4; ++i)
+		{
+			out.m_simd[i] = (kMasks[mask][i]) ? a.m_simd[i] : b.m_simd[i];
+		}
+#endif
+		return out;
+	}
+
+	F32 getMin() const
+	{
+		alignas(16) Array<F32, 4> arr;
+		store(&arr[0]);
+		return anki::min(anki::min(arr[0], arr[1]), anki::min(arr[2], arr[3]));
+	}
+
+	F32 getMax() const
+	{
+		alignas(16) Array<F32, 4> arr;
+		store(&arr[0]);
+		return anki::max(anki::max(arr[0], arr[1]), anki::max(arr[2], arr[3]));
+	}
+};
+
+} // end anonymous namespace
+
+/// The depth of the far plane. Everything is visible if the depth buffer is cleared to that.
+constexpr F32 kFarDepth = 1.0f;
+
 void SoftwareRasterizer::prepare(const Mat4& mv, const Mat4& p, U32 width, U32 height)
 {
 	m_mv = mv;
@@ -19,16 +222,35 @@ void SoftwareRasterizer::prepare(const Mat4& mv, const Mat4& p, U32 width, U32 h
 	extractClipPlanes(p, m_planesL);
 	extractClipPlanes(m_mvp, m_planesW);
 
-	// Reset z buffer
+	// Reset the buffers. They are padded so the rasterization doesn't have to care about the borders
 	ANKI_ASSERT(width > 0 && height > 0);
 	m_width = width;
 	m_height = height;
-	U32 size = width * height;
-	if(m_zbuffer.getSize() < size)
+	m_bufferWidth = getAlignedRoundUp(kBinSize, width);
+	m_bufferHeight = getAlignedRoundUp(kBinSize, height);
+	m_binCountX = m_bufferWidth / kBinSize;
+	m_binCountY = m_bufferHeight / kBinSize;
+
+	const U32 size = m_bufferWidth * m_bufferHeight;
+	m_zbuffer.resize(size);
+	m_tileMinDepth.resize(size / (kTileSize * kTileSize));
+	m_tileMaxDepth.resize(size / (kTileSize * kTileSize));
+	for(F32& z : m_zbuffer)
 	{
-		m_zbuffer.resize(size);
+		z = kFarDepth;
+	}
+	for(U32 i = 0; i < m_tileMinDepth.getSize(); ++i)
+	{
+		m_tileMinDepth[i] = kFarDepth;
+		m_tileMaxDepth[i] = kFarDepth;
+	}
+
+	m_triangles.resize(0);
+	m_bins.resize(m_binCountX * m_binCountY);
+	for(SceneDynamicArray<U32>& bin : m_bins)
+	{
+		bin.resize(0);
 	}
-	memset(&m_zbuffer[0], 0xFF, sizeof(m_zbuffer[0]) * size);
 }
 
 void SoftwareRasterizer::clipTriangle(const Vec4* inVerts, Vec4* outVerts, U& outVertCount) const
@@ -163,6 +385,36 @@ void SoftwareRasterizer::draw(const F32* verts, U vertCount, U stride, Bool back
 	ANKI_ASSERT(verts && vertCount > 0 && (vertCount % 3) == 0);
 	ANKI_ASSERT(stride >= sizeof(F32) * 3 && (stride % sizeof(F32)) == 0);
 
+	// Setup the triangles locally and bin them in batches to avoid locking too often
+	constexpr U32 kBatchSize = 64;
+	Array<BinnedTriangle, kBatchSize> batch;
+	U32 batchCount = 0;
+
+	auto binBatch = [&]() {
+		LockGuard<SpinLock> lock(m_binningMtx);
+
+		for(U32 i = 0; i < batchCount; ++i)
+		{
+			const BinnedTriangle& tri = batch[i];
+			const U32 triIdx = m_triangles.getSize();
+			m_triangles.emplaceBack(tri);
+
+			const U32 binBeginX = tri.m_bbox[0] / kBinSize;
+			const U32 binBeginY = tri.m_bbox[1] / kBinSize;
+			const U32 binEndX = (tri.m_bbox[2] + kBinSize - 1) / kBinSize;
+			const U32 binEndY = (tri.m_bbox[3] + kBinSize - 1) / kBinSize;
+			for(U32 y = binBeginY; y < binEndY; ++y)
+			{
+				for(U32 x = binBeginX; x < binEndX; ++x)
+				{
+					m_bins[y * m_binCountX + x].emplaceBack(triIdx);
+				}
+			}
+		}
+
+		batchCount = 0;
+	};
+
 	U floatStride = stride / sizeof(F32);
 	const F32* vertsEnd = verts + vertCount * floatStride;
 	while(verts != vertsEnd)
@@ -198,7 +450,7 @@ void SoftwareRasterizer::draw(const F32* verts, U vertCount, U stride, Bool back
 			continue;
 		}
 
-		// Rasterize
+		// Setup
 		Array<Vec4, 3> clip;
 		for(U j = 0; j < clippedCount; j += 3)
 		{
@@ -208,85 +460,203 @@ void SoftwareRasterizer::draw(const F32* verts, U vertCount, U stride, Bool back
 				ANKI_ASSERT(clip[k].w() > 0.0f);
 			}
 
-			rasterizeTriangle(&clip[0]);
+			if(setupTriangle(&clip[0], batch[batchCount]))
+			{
+				++batchCount;
+				if(batchCount == kBatchSize)
+				{
+					binBatch();
+				}
+			}
 		}
 	}
+
+	if(batchCount)
+	{
+		binBatch();
+	}
 }
 
-Bool SoftwareRasterizer::computeBarycetrinc(const Vec2& a, const Vec2& b, const Vec2& c, const Vec2& p, Vec3& uvw) const
+Bool SoftwareRasterizer::setupTriangle(const Vec4* tri, BinnedTriangle& out) const
 {
-	Vec2 dca = c - a;
-	Vec2 dba = b - a;
-	Vec2 dap = a - p;
+	ANKI_ASSERT(tri);
+
+	const Vec2 windowSize{F32(m_width), F32(m_height)};
+	Array<Vec2, 3> window;
+	Array<F32, 3> depth;
+	Vec2 bboxMin(kMaxF32), bboxMax(kMinF32);
+	for(U32 i = 0; i < 3; i++)
+	{
+		const Vec3 ndc = tri[i].xyz() / tri[i].w();
+		window[i] = (ndc.xy() / 2.0f + 0.5f) * windowSize;
+		depth[i] = ndc.z();
+		ANKI_ASSERT(depth[i] >= -kEpsilonf && depth[i] <= 1.0f + kEpsilonf);
+
+		bboxMin = bboxMin.min(window[i]);
+		bboxMax = bboxMax.max(window[i]);
+	}
 
-	Vec3 n(dca.x(), dba.x(), dap.x());
-	Vec3 m(dca.y(), dba.y(), dap.y());
+	// Bounding box in pixels. A pixel is covered if its center is inside the triangle
+	for(U32 j = 0; j < 2; j++)
+	{
+		bboxMin[j] = clamp(std::floor(bboxMin[j]), 0.0f, windowSize[j]);
+		bboxMax[j] = clamp(std::ceil(bboxMax[j]), 0.0f, windowSize[j]);
+	}
 
-	Vec3 k = n.cross(m);
+	if(bboxMin.x() >= bboxMax.x() || bboxMin.y() >= bboxMax.y())
+	{
+		return false;
+	}
 
-	Bool skip = false;
-	if(!isZero(k.z()))
+	out.m_bbox = {U32(bboxMin.x()), U32(bboxMin.y()), U32(bboxMax.x()), U32(bboxMax.y())};
+
+	// Edge functions. Edge i is the one opposite to vertex i. Flip them so the inside is positive no matter the winding
+	F32 doubleArea = 0.0f;
+	for(U32 i = 0; i < 3; ++i)
 	{
-		uvw = Vec3(1.0f - (k.x() + k.y()) / k.z(), k.y() / k.z(), k.x() / k.z());
+		const Vec2& a = window[(i + 1) % 3];
+		const Vec2& b = window[(i + 2) % 3];
+		Vec3 edge(a.y() - b.y(), b.x() - a.x(), a.x() * b.y() - a.y() * b.x());
 
-		if(uvw.x() < 0.0f || uvw.y() < 0.0f || uvw.z() < 0.0f)
+		const F32 opposite = edge.x() * window[i].x() + edge.y() * window[i].y() + edge.z();
+		if(opposite < 0.0f)
 		{
-			skip = true;
+			edge = -edge;
 		}
+
+		out.m_edges[i] = edge;
+		doubleArea = absolute(opposite);
 	}
-	else
+
+	if(doubleArea < kEpsilonf)
 	{
-		skip = true;
+		return false;
 	}
 
-	return skip;
+	// The NDC depth is linear in screen space. Interpolate it with the normalized edge functions (the barycentrics)
+	out.m_depthPlane = Vec3(0.0f);
+	for(U32 i = 0; i < 3; ++i)
+	{
+		out.m_depthPlane += out.m_edges[i] * (clamp(depth[i], 0.0f, 1.0f) / doubleArea);
+	}
+
+	return true;
 }
 
-void SoftwareRasterizer::rasterizeTriangle(const Vec4* tri)
+void SoftwareRasterizer::flush(ThreadHive* hive)
 {
-	ANKI_ASSERT(tri);
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerFlush);
 
-	const Vec2 windowSize{F32(m_width), F32(m_height)};
-	Array<Vec3, 3> ndc;
-	Array<Vec2, 3> window;
-	Vec2 bboxMin(kMaxF32), bboxMax(kMinF32);
-	for(U i = 0; i < 3; i++)
+	const U32 binCount = m_bins.getSize();
+	if(hive)
 	{
-		ndc[i] = tri[i].xyz() / tri[i].w();
-		window[i] = (ndc[i].xy() / 2.0f + 0.5f) * windowSize;
-
-		for(U j = 0; j < 2; j++)
+		parallelFor(*hive, 0, binCount, 1, [this](U32 begin, U32 end) {
+			for(U32 bin = begin; bin < end; ++bin)
+			{
+				rasterizeBin(bin);
+			}
+		});
+	}
+	else
+	{
+		for(U32 bin = 0; bin < binCount; ++bin)
 		{
-			bboxMin[j] = std::floor(min(bboxMin[j], window[i][j]));
-			bboxMin[j] = clamp(bboxMin[j], 0.0f, windowSize[j]);
-
-			bboxMax[j] = std::ceil(max(bboxMax[j], window[i][j]));
-			bboxMax[j] = clamp(bboxMax[j], 0.0f, windowSize[j]);
+			rasterizeBin(bin);
 		}
 	}
 
-	for(F32 y = bboxMin.y() + 0.5f; y < bboxMax.y() + 0.5f; y += 1.0f)
+	m_triangles.resize(0);
+}
+
+void SoftwareRasterizer::rasterizeBin(U32 bin)
+{
+	SceneDynamicArray<U32>& triIndices = m_bins[bin];
+	if(triIndices.getSize() == 0)
+	{
+		return;
+	}
+
+	const U32 binBeginX = (bin % m_binCountX) * kBinSize;
+	const U32 binBeginY = (bin / m_binCountX) * kBinSize;
+	const U32 binEndX = binBeginX + kBinSize;
+	const U32 binEndY = binBeginY + kBinSize;
+	const F32x4 pixelOffsets(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for(U32 triIdx : triIndices)
 	{
-		for(F32 x = bboxMin.x() + 0.5f; x < bboxMax.x() + 0.5f; x += 1.0f)
+		const BinnedTriangle& tri = m_triangles[triIdx];
+
+		// The part of the triangle that is inside the bin. X is aligned to 4 because the pixels are processed in quads
+		const U32 beginX = max(binBeginX, tri.m_bbox[0]) & ~3u;
+		const U32 beginY = max(binBeginY, tri.m_bbox[1]);
+		const U32 endX = min(binEndX, tri.m_bbox[2]);
+		const U32 endY = min(binEndY, tri.m_bbox[3]);
+
+		const F32x4 edgeA[3] = {F32x4(tri.m_edges[0].x()), F32x4(tri.m_edges[1].x()), F32x4(tri.m_edges[2].x())};
+		const F32x4 zero(0.0f);
+
+		for(U32 y = beginY; y < endY; ++y)
 		{
-			Vec2 p(x, y);
-			Vec3 bc;
-			if(!computeBarycetrinc(window[0], window[1], window[2], p, bc))
+			const F32 py = F32(y) + 0.5f;
+
+			// The edge functions and the depth without the X part
+			Array<F32x4, 3> edgeRow;
+			for(U32 i = 0; i < 3; ++i)
+			{
+				edgeRow[i] = F32x4(tri.m_edges[i].y() * py + tri.m_edges[i].z());
+			}
+			const F32x4 depthRow(tri.m_depthPlane.y() * py + tri.m_depthPlane.z());
+			const F32x4 depthA(tri.m_depthPlane.x());
+
+			F32* zbuffer = &m_zbuffer[y * m_bufferWidth];
+			for(U32 x = beginX; x < endX; x += 4)
 			{
-				const F32 z0 = ndc[0].z();
-				const F32 z1 = ndc[1].z();
-				const F32 z2 = ndc[2].z();
+				const F32x4 px = F32x4(F32(x)) + pixelOffsets;
+
+				U32 mask = (edgeA[0] * px + edgeRow[0]).greaterEqualMask(zero);
+				mask &= (edgeA[1] * px + edgeRow[1]).greaterEqualMask(zero);
+				mask &= (edgeA[2] * px + edgeRow[2]).greaterEqualMask(zero);
+				if(mask == 0)
+				{
+					continue;
+				}
+
+				const F32x4 oldDepth = F32x4::load(zbuffer + x);
+				const F32x4 newDepth = (depthA * px + depthRow).min(oldDepth);
+				F32x4::select(mask, newDepth, oldDepth).store(zbuffer + x);
+			}
+		}
+	}
 
-				F32 depth = z0 * bc[0] + z1 * bc[1] + z2 * bc[2];
-				ANKI_ASSERT(depth >= 0.0 && depth <= 1.0);
+	triIndices.resize(0);
 
-				// Clamp it to a bit less that 1.0f because 1.0f will produce a 0 depthi
-				depth = min(depth, 1.0f - kEpsilonf);
+	const U32 tilesPerBin = kBinSize / kTileSize;
+	updateTiles(binBeginX / kTileSize, binBeginY / kTileSize, binBeginX / kTileSize + tilesPerBin,
+				binBeginY / kTileSize + tilesPerBin);
+}
 
-				// Store the min of the current value and new one
-				const U32 depthi = U32(depth * F32(kMaxU32));
-				m_zbuffer[U32(y) * m_width + U32(x)].min(depthi);
+void SoftwareRasterizer::updateTiles(U32 tileBeginX, U32 tileBeginY, U32 tileEndX, U32 tileEndY)
+{
+	const U32 tileCountX = m_bufferWidth / kTileSize;
+	for(U32 tileY = tileBeginY; tileY < tileEndY; ++tileY)
+	{
+		for(U32 tileX = tileBeginX; tileX < tileEndX; ++tileX)
+		{
+			F32x4 minDepth(kMaxF32);
+			F32x4 maxDepth(kMinF32);
+			for(U32 y = tileY * kTileSize; y < (tileY + 1) * kTileSize; ++y)
+			{
+				const F32* row = &m_zbuffer[y * m_bufferWidth + tileX * kTileSize];
+				for(U32 x = 0; x < kTileSize; x += 4)
+				{
+					const F32x4 depth = F32x4::load(row + x);
+					minDepth = minDepth.min(depth);
+					maxDepth = maxDepth.max(depth);
+				}
 			}
+
+			m_tileMinDepth[tileY * tileCountX + tileX] = minDepth.getMin();
+			m_tileMaxDepth[tileY * tileCountX + tileX] = maxDepth.getMax();
 		}
 	}
 }
@@ -353,31 +723,60 @@ Bool SoftwareRasterizer::visibilityTestInternal(const Aabb& aabb) const
 	}
 
 	// Fix the bounds
-	bboxMin.x() = floorf(bboxMin.x());
-	bboxMin.x() = clamp(bboxMin.x(), 0.0f, F32(m_width));
-
-	bboxMax.x() = ceilf(bboxMax.x());
-	bboxMax.x() = clamp(bboxMax.x(), 0.0f, F32(m_width));
-
-	bboxMin.y() = floorf(bboxMin.y());
-	bboxMin.y() = clamp(bboxMin.y(), 0.0f, F32(m_height));
-
-	bboxMax.y() = ceilf(bboxMax.y());
-	bboxMax.y() = clamp(bboxMax.y(), 0.0f, F32(m_height));
+	const U32 beginX = U32(clamp(floorf(bboxMin.x()), 0.0f, F32(m_width)));
+	const U32 endX = U32(clamp(ceilf(bboxMax.x()), 0.0f, F32(m_width)));
+	const U32 beginY = U32(clamp(floorf(bboxMin.y()), 0.0f, F32(m_height)));
+	const U32 endY = U32(clamp(ceilf(bboxMax.y()), 0.0f, F32(m_height)));
+	if(beginX >= endX || beginY >= endY)
+	{
+		return false;
+	}
 
-	// Loop the tiles
-	F32 minZ = bboxMin.z();
-	for(F32 y = bboxMin.y(); y < bboxMax.y(); y += 1.0f)
+	// Loop the tiles and go to the pixels only if the tile can't decide
+	const F32 minZ = bboxMin.z();
+	const U32 tileCountX = m_bufferWidth / kTileSize;
+	const F32x4 minZ4(minZ);
+	for(U32 tileY = beginY / kTileSize; tileY <= (endY - 1) / kTileSize; ++tileY)
 	{
-		for(F32 x = bboxMin.x(); x < bboxMax.x(); x += 1.0f)
+		for(U32 tileX = beginX / kTileSize; tileX <= (endX - 1) / kTileSize; ++tileX)
 		{
-			const U32 idx = U32(y) * m_width + U32(x);
-			const U32 depthi = m_zbuffer[idx].getNonAtomically();
-			const F32 depthf = F32(depthi) / F32(kMaxU32);
-			if(minZ < depthf)
+			const U32 tileIdx = tileY * tileCountX + tileX;
+			if(minZ < m_tileMinDepth[tileIdx])
 			{
+				// In front of everything in the tile
 				return true;
 			}
+
+			if(minZ >= m_tileMaxDepth[tileIdx])
+			{
+				// Behind everything in the tile
+				continue;
+			}
+
+			const U32 tileBeginX = max(beginX, tileX * kTileSize);
+			const U32 tileEndX = min(endX, (tileX + 1) * kTileSize);
+			const U32 tileBeginY = max(beginY, tileY * kTileSize);
+			const U32 tileEndY = min(endY, (tileY + 1) * kTileSize);
+			for(U32 y = tileBeginY; y < tileEndY; ++y)
+			{
+				const F32* row = &m_zbuffer[y * m_bufferWidth];
+				U32 x = tileBeginX;
+				for(; x + 4 <= tileEndX; x += 4)
+				{
+					if(minZ4.lessMask(F32x4::load(row + x)))
+					{
+						return true;
+					}
+				}
+
+				for(; x < tileEndX; ++x)
+				{
+					if(minZ < row[x])
+					{
+						return true;
+					}
+				}
+			}
 		}
 	}
 
@@ -386,19 +785,19 @@ Bool SoftwareRasterizer::visibilityTestInternal(const Aabb& aabb) const
 
 void SoftwareRasterizer::fillDepthBuffer(ConstWeakArray<F32> depthValues)
 {
-	ANKI_ASSERT(m_zbuffer.getSize() == depthValues.getSize());
+	ANKI_ASSERT(m_width * m_height == depthValues.getSize());
 
-	U32 count = depthValues.getSize();
-	while(count--)
+	for(U32 y = 0; y < m_height; ++y)
 	{
-		F32 depth = depthValues[count];
-		ANKI_ASSERT(depth >= 0.0f && depth <= 1.0f);
-
-		depth = min(depth, 1.0f - kEpsilonf); // See a few lines above why is that
-
-		const U32 depthi = U32(depth * F32(kMaxU32));
-		m_zbuffer[count].setNonAtomically(depthi);
+		for(U32 x = 0; x < m_width; ++x)
+		{
+			const F32 depth = depthValues[y * m_width + x];
+			ANKI_ASSERT(depth >= 0.0f && depth <= 1.0f);
+			m_zbuffer[y * m_bufferWidth + x] = depth;
+		}
 	}
+
+	updateTiles(0, 0, m_bufferWidth / kTileSize, m_bufferHeight / kTileSize);
 }
 
 } // end namespace anki
@@ -9,20 +9,29 @@
 #include <AnKi/Math.h>
 #include <AnKi/Collision/Plane.h>
 #include <AnKi/Util/WeakArray.h>
+#include <AnKi/Util/Thread.h>
 
 namespace anki {
 
+// Forward
+class ThreadHive;
+
 /// @addtogroup scene
 /// @{
 
-/// Software rasterizer for visibility tests.
+/// Software rasterizer for visibility tests. The triangles are binned into screen space bins and every bin is
+/// rasterized 4 pixels at a time using edge functions. The min and max depth of every tile of the depth buffer is kept
+/// so most of the visibility tests don't have to touch the pixels.
 class SoftwareRasterizer
 {
 public:
+	static constexpr U32 kTileSize = 8; ///< The size of the tiles of the hierarchical depth in pixels.
+	static constexpr U32 kBinSize = 32; ///< The size of the bins in pixels. Should be a multiple of kTileSize.
+
 	/// Prepare for rendering. Call it before every draw.
 	void prepare(const Mat4& mv, const Mat4& p, U32 width, U32 height);
 
-	/// Render some verts.
+	/// Bin some verts. Call flush() to rasterize them.
 	/// @param[in] verts Pointer to the first vertex to draw.
 	/// @param vertCount The number of verts to draw.
 	/// @param stride The stride (in bytes) of the next vertex.
@@ -30,15 +39,29 @@ public:
 	/// @note It's thread-safe against other draw() invocations only.
 	void draw(const F32* verts, U vertCount, U stride, Bool backfaceCulling);
 
+	/// Rasterize the triangles of the previous draw() calls.
+	/// @param hive If not nullptr the bins will be rasterized in parallel.
+	void flush(ThreadHive* hive = nullptr);
+
 	/// Fill the depth buffer with some values.
 	void fillDepthBuffer(ConstWeakArray<F32> depthValues);
 
 	/// Perform visibility tests.
 	/// @param aabb The Aabb in of the cs in world space.
 	/// @return Return true if it's visible and false otherwise.
+	/// @note It's thread-safe against other visibilityTest() invocations. Call flush() before that.
 	Bool visibilityTest(const Aabb& aabb) const;
 
 private:
+	/// A triangle ready to be rasterized.
+	class BinnedTriangle
+	{
+	public:
+		Array<Vec3, 3> m_edges; ///< The A, B and C of the edge functions. A pixel is inside if all are positive.
+		Vec3 m_depthPlane; ///< Depth is m_depthPlane.x() * x + m_depthPlane.y() * y + m_depthPlane.z().
+		Array<U32, 4> m_bbox; ///< Min X, min Y, max X and max Y (exclusive) in pixels.
+	};
+
 	Mat4 m_mv; ///< ModelView.
 	Mat4 m_p; ///< Projection.
 	Mat4 m_mvp;
@@ -46,12 +69,27 @@ private:
 	Array<Plane, 6> m_planesW; ///< In world space.
 	U32 m_width;
 	U32 m_height;
-	SceneDynamicArray<Atomic<U32>> m_zbuffer;
+	U32 m_bufferWidth; ///< The width of the buffers aligned to kBinSize.
+	U32 m_bufferHeight; ///< The height of the buffers aligned to kBinSize.
+	U32 m_binCountX;
+	U32 m_binCountY;
+
+	SceneDynamicArray<F32> m_zbuffer; ///< Row major. Its size is m_bufferWidth * m_bufferHeight.
+	SceneDynamicArray<F32> m_tileMinDepth;
+	SceneDynamicArray<F32> m_tileMaxDepth;
+
+	SceneDynamicArray<BinnedTriangle> m_triangles;
+	SceneDynamicArray<SceneDynamicArray<U32>> m_bins; ///< The indices of the triangles that touch each bin.
+	SpinLock m_binningMtx;
 
 	/// @param tri In clip space.
-	void rasterizeTriangle(const Vec4* tri);
+	/// @return False if the triangle is degenerate or outside the screen.
+	Bool setupTriangle(const Vec4* tri, BinnedTriangle& out) const;
+
+	void rasterizeBin(U32 bin);
 
-	Bool computeBarycetrinc(const Vec2& a, const Vec2& b, const Vec2& c, const Vec2& p, Vec3& uvw) const;
+	/// Compute the min and max depth of the tiles of a rectangle.
+	void updateTiles(U32 tileBeginX, U32 tileBeginY, U32 tileEndX, U32 tileEndY);
 
 	/// Clip triangle in the near plane.
 	/// @note Triangles in view space.
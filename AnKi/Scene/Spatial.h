@@ -89,7 +89,7 @@ public:
 		m_dirty = true;
 	}
 
-	/// Should be called each frame.
+	/// Should be called each frame. The octree will see the new placement after Octree::applyDeferredUpdates.
 	/// @return True if updated.
 	Bool update(Octree& octree)
 	{
@@ -99,7 +99,7 @@ public:
 		{
 			if(!m_alwaysVisible) [[likely]]
 			{
-				octree.place(m_aabb, &m_octreeInfo, m_updatesOctreeBounds);
+				octree.placeDeferred(m_aabb, &m_octreeInfo, m_updatesOctreeBounds);
 			}
 			else
 			{
@@ -49,6 +49,21 @@ static U8 computeLod(const Frustum& frustum, F32 distanceFromTheNearPlane)
 	return lod;
 }
 
+/// Estimate the size in pixels of an object on the screen. The streamed textures need at least that resolution.
+static U32 computeScreenSize(const Frustum& frustum, const Aabb& aabb, F32 distanceFromTheNearPlane)
+{
+	const U32 screenHeight = ConfigSet::getSingleton().getHeight();
+	if(frustum.getFrustumType() != FrustumType::kPerspective)
+	{
+		return screenHeight;
+	}
+
+	const F32 radius = (aabb.getMax() - aabb.getMin()).xyz().getLength() / 2.0f;
+	const F32 distance = max(distanceFromTheNearPlane, kEpsilonf);
+	const F32 size = radius / (distance * tan(frustum.getFovY() / 2.0f)) * F32(screenHeight);
+	return max(1u, U32(min(size, F32(screenHeight))));
+}
+
 static FrustumFlags getLightFrustumFlags()
 {
 	FrustumFlags flags;
@@ -148,11 +163,12 @@ void VisibilityContext::submitNewWork(const VisibilityFrustum& frustum, const Vi
 
 	// Software rasterizer task
 	ThreadHiveSemaphore* prepareRasterizerSem = nullptr;
-	if(frustum.m_coverageBuffer && frustum.m_frustum->hasCoverageBuffer())
+	if(frustum.m_coverageBuffer
+	   && (frustum.m_frustum->hasCoverageBuffer() || ConfigSet::getSingleton().getSceneOccluderCount() > 0))
 	{
 		// Gather triangles task
 		ThreadHiveTask fillDepthTask = ANKI_THREAD_HIVE_TASK(
-			{ self->fill(); },
+			{ self->fill(hive); },
 			newInstance<FillRasterizerWithCoverageTask>(SceneGraph::getSingleton().getFrameMemoryPool(), frcCtx),
 			nullptr, hive.newSemaphore(1));
 
@@ -179,25 +195,25 @@ void VisibilityContext::submitNewWork(const VisibilityFrustum& frustum, const Vi
 	// Combind results task
 	ANKI_ASSERT(frcCtx->m_visTestsSignalSem);
 	ThreadHiveTask combineTask = ANKI_THREAD_HIVE_TASK(
-		{ self->combine(); }, newInstance<CombineResultsTask>(SceneGraph::getSingleton().getFrameMemoryPool(), frcCtx),
+		{ self->combine(hive); }, newInstance<CombineResultsTask>(SceneGraph::getSingleton().getFrameMemoryPool(), frcCtx),
 		frcCtx->m_visTestsSignalSem, nullptr);
 	hive.submitTasks(&combineTask, 1);
 }
 
-void FillRasterizerWithCoverageTask::fill()
+void FillRasterizerWithCoverageTask::fill(ThreadHive& hive)
 {
 	ANKI_TRACE_SCOPED_EVENT(SceneVisFillDepth);
 
-	// Get the C-Buffer
-	ConstWeakArray<F32> depthBuff;
-	U32 width;
-	U32 height;
-	m_frcCtx->m_frustum.m_frustum->getCoverageBufferInfo(depthBuff, width, height);
-	ANKI_ASSERT(width > 0 && height > 0 && depthBuff.getSize() > 0);
-
-	// Init the rasterizer
-	if(true)
+	if(m_frcCtx->m_frustum.m_frustum->hasCoverageBuffer() && !isCameraCut())
 	{
+		// Get the C-Buffer
+		ConstWeakArray<F32> depthBuff;
+		U32 width;
+		U32 height;
+		m_frcCtx->m_frustum.m_frustum->getCoverageBufferInfo(depthBuff, width, height);
+		ANKI_ASSERT(width > 0 && height > 0 && depthBuff.getSize() > 0);
+
+		// Init the rasterizer
 		m_frcCtx->m_r = newInstance<SoftwareRasterizer>(SceneGraph::getSingleton().getFrameMemoryPool());
 		m_frcCtx->m_r->prepare(
 			Mat4(m_frcCtx->m_frustum.m_frustum->getPreviousViewMatrix(1), Vec4(0.0f, 0.0f, 0.0f, 1.0f)),
@@ -206,40 +222,154 @@ void FillRasterizerWithCoverageTask::fill()
 		// Do the work
 		m_frcCtx->m_r->fillDepthBuffer(depthBuff);
 	}
+	else if(ConfigSet::getSingleton().getSceneOccluderCount() > 0)
+	{
+		// The coverage buffer is missing or useless, rasterize some occluders instead
+		drawNearestOccluders(hive);
+	}
 }
 
-void GatherVisiblesFromOctreeTask::gather(ThreadHive& hive)
+Bool FillRasterizerWithCoverageTask::isCameraCut() const
 {
-	ANKI_TRACE_SCOPED_EVENT(SceneVisOctreeGather);
+	const Frustum& frustum = *m_frcCtx->m_frustum.m_frustum;
+	const Mat3x4& crntView = frustum.getViewMatrix();
+	const Mat3x4& prevView = frustum.getPreviousViewMatrix(1);
+
+	// The rows of the rotation of the view matrix are the axes of the camera in world space
+	const Mat3 crntRot = crntView.getRotationPart();
+	const Mat3 prevRot = prevView.getRotationPart();
+	const Vec3 crntEye = -(crntRot.getTransposed() * crntView.getTranslationPart());
+	const Vec3 prevEye = -(prevRot.getTransposed() * prevView.getTranslationPart());
+
+	const F32 maxMove = ConfigSet::getSingleton().getSceneCoverageBufferMaxCameraMove();
+	if((crntEye - prevEye).getLengthSquared() > maxMove * maxMove)
+	{
+		return true;
+	}
 
-	U32 testIdx = m_frcCtx->m_visCtx->m_testsCount.fetchAdd(1);
+	const F32 maxRotation = toRad(ConfigSet::getSingleton().getSceneCoverageBufferMaxCameraRotation());
+	return crntRot.getRow(2).dot(prevRot.getRow(2)) < cos(maxRotation);
+}
 
-	// Walk the tree
+void FillRasterizerWithCoverageTask::drawNearestOccluders(ThreadHive& hive)
+{
+	constexpr U32 kWidth = 256;
+	constexpr U32 kHeight = 128;
+
+	class Candidate
+	{
+	public:
+		const ModelComponent* m_comp;
+		F32 m_distanceSquared;
+	};
+
+	const Frustum& frustum = *m_frcCtx->m_frustum.m_frustum;
+	const Vec4 eye = frustum.getWorldTransform().getOrigin();
+
+	// Gather the models with occluders that are inside the frustum
+	DynamicArray<Candidate, MemoryPoolPtrWrapper<StackMemoryPool>> candidates(
+		&SceneGraph::getSingleton().getFrameMemoryPool());
+
+	const U32 testIdx = m_frcCtx->m_visCtx->m_testsCount.fetchAdd(1);
 	SceneGraph::getSingleton().getOctree().walkTree(
 		testIdx,
 		[&](const Aabb& box) {
-			Bool visible = m_frcCtx->m_frustum.m_frustum->insideFrustum(box);
-			if(visible && m_frcCtx->m_r)
-			{
-				visible = m_frcCtx->m_r->visibilityTest(box);
-			}
-
-			return visible;
+			return frustum.insideFrustum(box);
 		},
 		[&](void* placeableUserData) {
-			ANKI_ASSERT(placeableUserData);
-			Spatial* spatial = static_cast<Spatial*>(placeableUserData);
-
-			ANKI_ASSERT(m_spatialCount < m_spatials.getSize());
-
-			m_spatials[m_spatialCount++] = spatial;
+			const Spatial* spatial = static_cast<const Spatial*>(placeableUserData);
+			const SceneComponent& comp = spatial->getSceneComponent();
+			if(comp.getClassId() != ModelComponent::getStaticClassId()
+			   || !static_cast<const ModelComponent&>(comp).hasOccluders())
+			{
+				return;
+			}
 
-			if(m_spatialCount == m_spatials.getSize())
+			const Aabb& box = spatial->getAabbWorldSpace();
+			if(!frustum.insideFrustum(box))
 			{
-				flush(hive);
+				return;
 			}
+
+			const Vec4 closestPoint = eye.max(box.getMin()).min(box.getMax());
+			candidates.emplaceBack(Candidate{static_cast<const ModelComponent*>(&comp),
+											 (closestPoint - eye).getLengthSquared()});
 		});
 
+	if(candidates.getSize() == 0)
+	{
+		return;
+	}
+
+	// Keep the nearest
+	const U32 count = min(candidates.getSize(), ConfigSet::getSingleton().getSceneOccluderCount());
+	std::partial_sort(candidates.getBegin(), candidates.getBegin() + count, candidates.getEnd(),
+					  [](const Candidate& a, const Candidate& b) {
+						  return a.m_distanceSquared < b.m_distanceSquared;
+					  });
+
+	// Rasterize
+	m_frcCtx->m_r = newInstance<SoftwareRasterizer>(SceneGraph::getSingleton().getFrameMemoryPool());
+	m_frcCtx->m_r->prepare(Mat4(frustum.getViewMatrix(), Vec4(0.0f, 0.0f, 0.0f, 1.0f)), frustum.getProjectionMatrix(),
+						   kWidth, kHeight);
+
+	for(U32 i = 0; i < count; ++i)
+	{
+		candidates[i].m_comp->drawOccluders(*m_frcCtx->m_r);
+	}
+
+	m_frcCtx->m_r->flush(&hive);
+}
+
+void GatherVisiblesFromOctreeTask::gather(ThreadHive& hive)
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneVisOctreeGather);
+
+	U32 testIdx = m_frcCtx->m_visCtx->m_testsCount.fetchAdd(1);
+
+	auto newPlaceableFunc = [&](void* placeableUserData) {
+		ANKI_ASSERT(placeableUserData);
+		Spatial* spatial = static_cast<Spatial*>(placeableUserData);
+
+		ANKI_ASSERT(m_spatialCount < m_spatials.getSize());
+
+		m_spatials[m_spatialCount++] = spatial;
+
+		if(m_spatialCount == m_spatials.getSize())
+		{
+			flush(hive);
+		}
+	};
+
+	// Walk the tree
+	Octree& octree = SceneGraph::getSingleton().getOctree();
+	if(octree.hasLinearTree())
+	{
+		// The frustum planes are tested by the octree
+		const auto& planes = m_frcCtx->m_frustum.m_frustum->getViewPlanes();
+		octree.walkLinearTree(
+			testIdx, ConstWeakArray<Plane>(planes),
+			[&](const Aabb& box) {
+				return (m_frcCtx->m_r) ? m_frcCtx->m_r->visibilityTest(box) : true;
+			},
+			newPlaceableFunc);
+	}
+	else
+	{
+		octree.walkTree(
+			testIdx,
+			[&](const Aabb& box) {
+				Bool visible = m_frcCtx->m_frustum.m_frustum->insideFrustum(box);
+				if(visible && m_frcCtx->m_r)
+				{
+					visible = m_frcCtx->m_r->visibilityTest(box);
+				}
+
+				return visible;
+			},
+			newPlaceableFunc);
+	}
+
 	// Flush the remaining
 	flush(hive);
 
@@ -288,6 +418,25 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 	WeakArray<RenderQueue> nextQueues;
 	WeakArray<VisibilityFrustum> nextFrustums;
 
+	// Test all the boxes against the frustum at once. The padding copies the last box
+	ANKI_ASSERT(m_spatialToTestCount > 0);
+	alignas(16) Array<Array<F32, kMaxSpatialsPerVisTest>, 6> aabbMinMax;
+	for(U32 i = 0; i < getAlignedRoundUp(4u, m_spatialToTestCount); ++i)
+	{
+		const Aabb& aabb = m_spatialsToTest[min(i, m_spatialToTestCount - 1)]->getAabbWorldSpace();
+		for(U32 c = 0; c < 3; ++c)
+		{
+			aabbMinMax[c][i] = aabb.getMin()[c];
+			aabbMinMax[c + 3][i] = aabb.getMax()[c];
+		}
+	}
+
+	U64 insideFrustumMask = 0;
+	testPlanes(ConstWeakArray<Plane>(testedFrustum.getViewPlanes()),
+			   {&aabbMinMax[0][0], &aabbMinMax[1][0], &aabbMinMax[2][0]},
+			   {&aabbMinMax[3][0], &aabbMinMax[4][0], &aabbMinMax[5][0]}, m_spatialToTestCount,
+			   WeakArray<U64>(&insideFrustumMask, 1));
+
 	// Iterate
 	RenderQueueView& result = m_frcCtx->m_queueViews[taskId];
 	for(U i = 0; i < m_spatialToTestCount; ++i)
@@ -298,7 +447,8 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 		const Aabb& aabb = spatial->getAabbWorldSpace();
 
 		auto isInside = [&] {
-			return spatial->getAlwaysVisible() || (testedFrustum.insideFrustum(aabb) && testAgainstRasterizer(aabb));
+			return spatial->getAlwaysVisible()
+				   || ((insideFrustumMask & (U64(1) << U64(i))) && testAgainstRasterizer(aabb));
 		};
 
 		if(comp.getClassId() == ModelComponent::getStaticClassId())
@@ -314,9 +464,19 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 			const F32 distanceFromCamera = max(0.0f, testPlane(nearPlane, aabb));
 			const U8 lod = computeLod(primaryFrustum, distanceFromCamera);
 
+			// Only what the camera sees drives the streaming. The other frustums use whatever is resident
+			if(&testedFrustum == &primaryFrustum)
+			{
+				modelc.requestMeshLod(lod);
+				modelc.requestTextureResolution(computeScreenSize(primaryFrustum, aabb, distanceFromCamera));
+			}
+
 			WeakArray<RenderableQueueElement> elements;
-			modelc.setupRenderableQueueElements(
-				lod, (isShadowFrustum) ? RenderingTechnique::kShadow : RenderingTechnique::kGBuffer, elements);
+			if(!modelc.setupRenderableQueueElements(
+				   lod, (isShadowFrustum) ? RenderingTechnique::kShadow : RenderingTechnique::kGBuffer, elements))
+			{
+				result.m_renderablesSkipped = true;
+			}
 			for(RenderableQueueElement& el : elements)
 			{
 				el.m_distanceFromCamera = distanceFromCamera;
@@ -367,6 +527,11 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 			const Plane& nearPlane = primaryFrustum.getViewPlanes()[FrustumPlaneType::kNear];
 			const F32 distanceFromCamera = max(0.0f, testPlane(nearPlane, aabb));
 
+			if(&testedFrustum == &primaryFrustum)
+			{
+				partemitc.requestTextureResolution(computeScreenSize(primaryFrustum, aabb, distanceFromCamera));
+			}
+
 			WeakArray<RenderableQueueElement> elements;
 			partemitc.setupRenderableQueueElements(RenderingTechnique::kGBuffer, elements);
 			for(RenderableQueueElement& el : elements)
@@ -647,7 +812,7 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 	} // end for
 }
 
-void CombineResultsTask::combine()
+void CombineResultsTask::combine(ThreadHive& hive)
 {
 	ANKI_TRACE_SCOPED_EVENT(SceneVisCombine);
 
@@ -657,12 +822,14 @@ void CombineResultsTask::combine()
 	const U32 threadCount = m_frcCtx->m_queueViews.getSize();
 	results.m_shadowRenderablesLastUpdateTimestamp = 0;
 	U32 renderableCount = 0;
+	Bool renderablesSkipped = false;
 	for(U32 i = 0; i < threadCount; ++i)
 	{
 		results.m_shadowRenderablesLastUpdateTimestamp =
 			max(results.m_shadowRenderablesLastUpdateTimestamp, m_frcCtx->m_queueViews[i].m_timestamp);
 
 		renderableCount += m_frcCtx->m_queueViews[i].m_renderables.m_elementCount;
+		renderablesSkipped = renderablesSkipped || m_frcCtx->m_queueViews[i].m_renderablesSkipped;
 	}
 
 	if(renderableCount)
@@ -674,11 +841,15 @@ void CombineResultsTask::combine()
 		ANKI_ASSERT(results.m_shadowRenderablesLastUpdateTimestamp == 0);
 	}
 
-	if(m_frcCtx->m_frustum.m_frustum->getUpdatedThisFrame())
+	// If some renderables were skipped the next frames will be different even if nothing moves so don't cache
+	if(m_frcCtx->m_frustum.m_frustum->getUpdatedThisFrame() || renderablesSkipped)
 	{
 		results.m_shadowRenderablesLastUpdateTimestamp = GlobalFrameIndex::getSingleton().m_value;
 	}
 
+	const Bool isShadowFrustum = m_frcCtx->m_frustum.m_gatherShadowCasterModelComponents;
+	StackMemoryPool& framePool = SceneGraph::getSingleton().getFrameMemoryPool();
+
 #define ANKI_VIS_COMBINE(t_, member_) \
 	{ \
 		Array<TRenderQueueElementStorage<t_>, 64> subStorages; \
@@ -687,12 +858,32 @@ void CombineResultsTask::combine()
 			subStorages[i] = m_frcCtx->m_queueViews[i].member_; \
 		} \
 		combineQueueElements<t_>(WeakArray<TRenderQueueElementStorage<t_>>(&subStorages[0], threadCount), nullptr, \
-								 results.member_, nullptr); \
+								 results.member_, nullptr, framePool); \
 	}
 
-	ANKI_VIS_COMBINE(RenderableQueueElement, m_renderables);
-	ANKI_VIS_COMBINE(RenderableQueueElement, m_earlyZRenderables);
-	ANKI_VIS_COMBINE(RenderableQueueElement, m_forwardShadingRenderables);
+#define ANKI_VIS_COMBINE_RENDERABLES(member_, getKey_) \
+	{ \
+		Array<TRenderQueueElementStorage<RenderableQueueElement>, 64> subStorages; \
+		for(U32 i = 0; i < threadCount; ++i) \
+		{ \
+			subStorages[i] = m_frcCtx->m_queueViews[i].member_; \
+		} \
+		const WeakArray<TRenderQueueElementStorage<RenderableQueueElement>> weak(&subStorages[0], threadCount); \
+		if(isShadowFrustum) \
+		{ \
+			combineRenderables(weak, results.member_, framePool); \
+		} \
+		else \
+		{ \
+			combineAndSortRenderables(weak, results.member_, framePool, hive, getKey_); \
+		} \
+	}
+
+	// The renderables of shadow frustums are not sorted
+	ANKI_VIS_COMBINE_RENDERABLES(m_renderables, computeMergeSortKey);
+	ANKI_VIS_COMBINE_RENDERABLES(m_earlyZRenderables, computeMergeSortKey);
+	ANKI_VIS_COMBINE_RENDERABLES(m_forwardShadingRenderables, computeBackToFrontSortKey);
+
 	ANKI_VIS_COMBINE(PointLightQueueElement, m_pointLights);
 	ANKI_VIS_COMBINE(SpotLightQueueElement, m_spotLights);
 	ANKI_VIS_COMBINE(ReflectionProbeQueueElement, m_reflectionProbes);
@@ -705,6 +896,7 @@ void CombineResultsTask::combine()
 	ANKI_VIS_COMBINE(UiQueueElement, m_uis);
 
 #undef ANKI_VIS_COMBINE
+#undef ANKI_VIS_COMBINE_RENDERABLES
 
 	results.m_reflectionProbeForRefresh = m_frcCtx->m_reflectionProbeForRefresh;
 	results.m_giProbeForRefresh = m_frcCtx->m_giProbeForRefresh;
@@ -722,20 +914,7 @@ void CombineResultsTask::combine()
 		}
 	}
 
-	const Bool isShadowFrustum = m_frcCtx->m_frustum.m_gatherShadowCasterModelComponents;
-
 	// Sort some of the arrays
-	if(!isShadowFrustum)
-	{
-		std::sort(results.m_renderables.getBegin(), results.m_renderables.getEnd(), MaterialDistanceSortFunctor());
-
-		std::sort(results.m_earlyZRenderables.getBegin(), results.m_earlyZRenderables.getEnd(),
-				  MaterialDistanceSortFunctor());
-
-		std::sort(results.m_forwardShadingRenderables.getBegin(), results.m_forwardShadingRenderables.getEnd(),
-				  RevDistanceSortFunctor<RenderableQueueElement>());
-	}
-
 	std::sort(results.m_giProbes.getBegin(), results.m_giProbes.getEnd());
 
 	// Sort the ligths as well because some rendering effects expect the same order from frame to frame
@@ -784,102 +963,6 @@ void CombineResultsTask::combine()
 	}
 }
 
-template<typename T>
-void CombineResultsTask::combineQueueElements(WeakArray<TRenderQueueElementStorage<T>> subStorages,
-											  WeakArray<TRenderQueueElementStorage<U32>>* ptrSubStorages,
-											  WeakArray<T>& combined, WeakArray<T*>* ptrCombined)
-{
-	StackMemoryPool& framePool = SceneGraph::getSingleton().getFrameMemoryPool();
-
-	U32 totalElCount = subStorages[0].m_elementCount;
-	U32 biggestSubStorageIdx = 0;
-	for(U32 i = 1; i < subStorages.getSize(); ++i)
-	{
-		totalElCount += subStorages[i].m_elementCount;
-
-		if(subStorages[i].m_elementStorage > subStorages[biggestSubStorageIdx].m_elementStorage)
-		{
-			biggestSubStorageIdx = i;
-		}
-	}
-
-	if(totalElCount == 0)
-	{
-		return;
-	}
-
-	// Count ptrSubStorage elements
-	T** ptrIt = nullptr;
-	if(ptrSubStorages != nullptr)
-	{
-		ANKI_ASSERT(ptrCombined);
-		U32 ptrTotalElCount = (*ptrSubStorages)[0].m_elementCount;
-
-		for(U32 i = 1; i < ptrSubStorages->getSize(); ++i)
-		{
-			ptrTotalElCount += (*ptrSubStorages)[i].m_elementCount;
-		}
-
-		// Create the new storage
-		if(ptrTotalElCount > 0)
-		{
-			ptrIt = newArray<T*>(framePool, ptrTotalElCount);
-			*ptrCombined = WeakArray<T*>(ptrIt, ptrTotalElCount);
-		}
-	}
-
-	T* it;
-	if(totalElCount > subStorages[biggestSubStorageIdx].m_elementStorage)
-	{
-		// Can't reuse any of the existing storage, will allocate a brand new one
-
-		it = newArray<T>(framePool, totalElCount);
-		biggestSubStorageIdx = kMaxU32;
-
-		combined = WeakArray<T>(it, totalElCount);
-	}
-	else
-	{
-		// Will reuse existing storage
-
-		it = subStorages[biggestSubStorageIdx].m_elements + subStorages[biggestSubStorageIdx].m_elementCount;
-
-		combined = WeakArray<T>(subStorages[biggestSubStorageIdx].m_elements, totalElCount);
-	}
-
-	for(U32 i = 0; i < subStorages.getSize(); ++i)
-	{
-		if(subStorages[i].m_elementCount == 0)
-		{
-			continue;
-		}
-
-		// Copy the pointers
-		if(ptrIt)
-		{
-			T* base = (i != biggestSubStorageIdx) ? it : subStorages[biggestSubStorageIdx].m_elements;
-
-			for(U32 x = 0; x < (*ptrSubStorages)[i].m_elementCount; ++x)
-			{
-				ANKI_ASSERT((*ptrSubStorages)[i].m_elements[x] < subStorages[i].m_elementCount);
-
-				*ptrIt = base + (*ptrSubStorages)[i].m_elements[x];
-
-				++ptrIt;
-			}
-
-			ANKI_ASSERT(ptrIt <= ptrCombined->getEnd());
-		}
-
-		// Copy the elements
-		if(i != biggestSubStorageIdx)
-		{
-			memcpy(it, subStorages[i].m_elements, sizeof(T) * subStorages[i].m_elementCount);
-			it += subStorages[i].m_elementCount;
-		}
-	}
-}
-
 void SceneGraph::doVisibilityTests(SceneNode& camera, SceneGraph& scene, RenderQueue& rqueue)
 {
 	ANKI_TRACE_SCOPED_EVENT(SceneVisTests);
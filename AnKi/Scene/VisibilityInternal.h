@@ -12,6 +12,7 @@
 #include <AnKi/Scene/Spatial.h>
 #include <AnKi/Util/Thread.h>
 #include <AnKi/Util/Tracer.h>
+#include <AnKi/Util/RadixSort.h>
 #include <AnKi/Renderer/RenderQueue.h>
 
 namespace anki {
@@ -19,7 +20,8 @@ namespace anki {
 /// @addtogroup scene
 /// @{
 
-constexpr U32 kMaxSpatialsPerVisTest = 48; ///< Num of spatials to test in a single ThreadHive task.
+/// Num of spatials to test in a single ThreadHive task. It's the size of the visibility mask of testPlanes().
+constexpr U32 kMaxSpatialsPerVisTest = 64;
 
 class FrameMemoryPoolWrapper
 {
@@ -56,26 +58,6 @@ public:
 	}
 };
 
-template<typename T>
-class RevDistanceSortFunctor
-{
-public:
-	Bool operator()(const T& a, const T& b)
-	{
-		return a.m_distanceFromCamera > b.m_distanceFromCamera;
-	}
-};
-
-/// Sorts first by LOD and then by material (merge key).
-class MaterialDistanceSortFunctor
-{
-public:
-	Bool operator()(const RenderableQueueElement& a, const RenderableQueueElement& b)
-	{
-		return a.m_mergeKey < b.m_mergeKey;
-	}
-};
-
 /// Storage for a single element type.
 template<typename T, U32 kInitialStorage = 32, U32 kStorageGrowRate = 4>
 class TRenderQueueElementStorage
@@ -126,6 +108,7 @@ public:
 	Bool m_skyboxSet = false;
 
 	Timestamp m_timestamp = 0;
+	Bool m_renderablesSkipped = false; ///< Some renderables were skipped because their programs are not ready.
 
 	RenderQueueView()
 	{
@@ -217,7 +200,14 @@ public:
 		ANKI_ASSERT(m_frcCtx);
 	}
 
-	void fill();
+	void fill(ThreadHive& hive);
+
+private:
+	/// Check if the camera moved too much since the coverage buffer was rendered.
+	Bool isCameraCut() const;
+
+	/// Rasterize the occluders of the nearest models.
+	void drawNearestOccluders(ThreadHive& hive);
 };
 static_assert(std::is_trivially_destructible<FillRasterizerWithCoverageTask>::value == true,
 			  "Should be trivially destructible");
@@ -283,15 +273,215 @@ public:
 		ANKI_ASSERT(m_frcCtx);
 	}
 
-	void combine();
+	void combine(ThreadHive& hive);
 
-private:
+	/// Sort key that puts the renderables that can be merged next to each other. The merge key is a hash so all that
+	/// matters is to have equal keys next to each other. Use only the upper half of it to halve the radix passes. A
+	/// rare collision will only break a merge.
+	static U32 computeMergeSortKey(const RenderableQueueElement& el)
+	{
+		return U32(el.m_mergeKey >> 32u);
+	}
+
+	/// Sort key for back to front order.
+	static U32 computeBackToFrontSortKey(const RenderableQueueElement& el)
+	{
+		return ~floatToRadixKey(el.m_distanceFromCamera);
+	}
+
+	/// Concatenate the per-thread storages. The biggest storage is reused if it has enough space.
 	template<typename T>
 	static void combineQueueElements(WeakArray<TRenderQueueElementStorage<T>> subStorages,
 									 WeakArray<TRenderQueueElementStorage<U32>>* ptrSubStorage, WeakArray<T>& combined,
-									 WeakArray<T*>* ptrCombined);
+									 WeakArray<T*>* ptrCombined, StackMemoryPool& framePool);
+
+	/// Gather the per-thread renderables without copying them. The runs point to the per-thread storages and the
+	/// renderables are in the order of the threads.
+	static void combineRenderables(WeakArray<TRenderQueueElementStorage<RenderableQueueElement>> subStorages,
+								   RenderableQueueElementArray& combined, StackMemoryPool& framePool);
+
+	/// Same as combineRenderables but it also sorts the renderables. Only the order changes, the renderables stay in
+	/// the per-thread storages.
+	/// @param getKey A functor with signature TKey(const RenderableQueueElement&). TKey is an unsigned integer.
+	template<typename TGetKeyFunc>
+	static void combineAndSortRenderables(WeakArray<TRenderQueueElementStorage<RenderableQueueElement>> subStorages,
+										  RenderableQueueElementArray& combined, StackMemoryPool& framePool,
+										  ThreadHive& hive, TGetKeyFunc getKey);
 };
 static_assert(std::is_trivially_destructible<CombineResultsTask>::value == true, "Should be trivially destructible");
+
+inline void
+CombineResultsTask::combineRenderables(WeakArray<TRenderQueueElementStorage<RenderableQueueElement>> subStorages,
+									   RenderableQueueElementArray& combined, StackMemoryPool& framePool)
+{
+	ANKI_ASSERT(subStorages.getSize() <= RenderableQueueElementArray::kMaxRunCount);
+
+	U32 totalElCount = 0;
+	U32 runCount = 0;
+	for(const TRenderQueueElementStorage<RenderableQueueElement>& subStorage : subStorages)
+	{
+		totalElCount += subStorage.m_elementCount;
+		runCount += (subStorage.m_elementCount > 0);
+	}
+
+	if(totalElCount == 0)
+	{
+		return;
+	}
+
+	combined.m_runs =
+		WeakArray<const RenderableQueueElement*>(newArray<const RenderableQueueElement*>(framePool, runCount), runCount);
+	combined.m_order = WeakArray<U32>(newArray<U32>(framePool, totalElCount), totalElCount);
+
+	U32 run = 0;
+	U32* order = combined.m_order.getBegin();
+	for(const TRenderQueueElementStorage<RenderableQueueElement>& subStorage : subStorages)
+	{
+		if(subStorage.m_elementCount == 0)
+		{
+			continue;
+		}
+
+		combined.m_runs[run] = subStorage.m_elements;
+		for(U32 i = 0; i < subStorage.m_elementCount; ++i)
+		{
+			*order++ = RenderableQueueElementArray::packIndex(run, i);
+		}
+
+		++run;
+	}
+	ANKI_ASSERT(order == combined.m_order.getEnd());
+}
+
+template<typename TGetKeyFunc>
+inline void
+CombineResultsTask::combineAndSortRenderables(WeakArray<TRenderQueueElementStorage<RenderableQueueElement>> subStorages,
+											  RenderableQueueElementArray& combined, StackMemoryPool& framePool,
+											  ThreadHive& hive, TGetKeyFunc getKey)
+{
+	combineRenderables(subStorages, combined, framePool);
+
+	const U32 count = combined.getSize();
+	if(count == 0)
+	{
+		return;
+	}
+
+	// Sort small (key, index) pairs instead of the renderables
+	using Key = decltype(getKey(combined[0]));
+	using Pair = RadixSortPair<Key>;
+
+	Pair* pairs = newArray<Pair>(framePool, count * 2);
+	for(U32 i = 0; i < count; ++i)
+	{
+		pairs[i].m_key = getKey(combined[i]);
+		pairs[i].m_index = combined.m_order[i];
+	}
+
+	radixSortKeys(WeakArray<Pair>(pairs, count), WeakArray<Pair>(pairs + count, count), &hive);
+
+	for(U32 i = 0; i < count; ++i)
+	{
+		combined.m_order[i] = pairs[i].m_index;
+	}
+
+	deleteArray(framePool, pairs, count * 2);
+}
+
+template<typename T>
+inline void CombineResultsTask::combineQueueElements(WeakArray<TRenderQueueElementStorage<T>> subStorages,
+													 WeakArray<TRenderQueueElementStorage<U32>>* ptrSubStorages,
+													 WeakArray<T>& combined, WeakArray<T*>* ptrCombined,
+													 StackMemoryPool& framePool)
+{
+	U32 totalElCount = subStorages[0].m_elementCount;
+	U32 biggestSubStorageIdx = 0;
+	for(U32 i = 1; i < subStorages.getSize(); ++i)
+	{
+		totalElCount += subStorages[i].m_elementCount;
+
+		if(subStorages[i].m_elementStorage > subStorages[biggestSubStorageIdx].m_elementStorage)
+		{
+			biggestSubStorageIdx = i;
+		}
+	}
+
+	if(totalElCount == 0)
+	{
+		return;
+	}
+
+	// Count ptrSubStorage elements
+	T** ptrIt = nullptr;
+	if(ptrSubStorages != nullptr)
+	{
+		ANKI_ASSERT(ptrCombined);
+		U32 ptrTotalElCount = (*ptrSubStorages)[0].m_elementCount;
+
+		for(U32 i = 1; i < ptrSubStorages->getSize(); ++i)
+		{
+			ptrTotalElCount += (*ptrSubStorages)[i].m_elementCount;
+		}
+
+		// Create the new storage
+		if(ptrTotalElCount > 0)
+		{
+			ptrIt = newArray<T*>(framePool, ptrTotalElCount);
+			*ptrCombined = WeakArray<T*>(ptrIt, ptrTotalElCount);
+		}
+	}
+
+	T* it;
+	if(totalElCount > subStorages[biggestSubStorageIdx].m_elementStorage)
+	{
+		// Can't reuse any of the existing storage, will allocate a brand new one
+
+		it = newArray<T>(framePool, totalElCount);
+		biggestSubStorageIdx = kMaxU32;
+
+		combined = WeakArray<T>(it, totalElCount);
+	}
+	else
+	{
+		// Will reuse existing storage
+
+		it = subStorages[biggestSubStorageIdx].m_elements + subStorages[biggestSubStorageIdx].m_elementCount;
+
+		combined = WeakArray<T>(subStorages[biggestSubStorageIdx].m_elements, totalElCount);
+	}
+
+	for(U32 i = 0; i < subStorages.getSize(); ++i)
+	{
+		if(subStorages[i].m_elementCount == 0)
+		{
+			continue;
+		}
+
+		// Copy the pointers
+		if(ptrIt)
+		{
+			T* base = (i != biggestSubStorageIdx) ? it : subStorages[biggestSubStorageIdx].m_elements;
+
+			for(U32 x = 0; x < (*ptrSubStorages)[i].m_elementCount; ++x)
+			{
+				ANKI_ASSERT((*ptrSubStorages)[i].m_elements[x] < subStorages[i].m_elementCount);
+
+				*ptrIt = base + (*ptrSubStorages)[i].m_elements[x];
+
+				++ptrIt;
+			}
+
+			ANKI_ASSERT(ptrIt <= ptrCombined->getEnd());
+		}
+
+		// Copy the elements
+		if(i != biggestSubStorageIdx)
+		{
+			memcpy(it, subStorages[i].m_elements, sizeof(T) * subStorages[i].m_elementCount);
+			it += subStorages[i].m_elementCount;
+		}
+	}
+}
 /// @}
 
 } // end namespace anki
@@ -15,6 +15,8 @@
 #endif
 #if ANKI_POSIX
 #	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
 #endif
 
 namespace anki {
@@ -34,6 +36,7 @@ File& File::operator=(File&& b)
 		m_file = b.m_file;
 		m_flags = b.m_flags;
 		m_size = b.m_size;
+		m_mappedMemory = b.m_mappedMemory;
 	}
 
 	b.zero();
@@ -195,6 +198,13 @@ Error File::openAndroidFile(const CString& filename, FileOpenFlag flags)
 
 void File::close()
 {
+#if ANKI_POSIX
+	if(m_mappedMemory)
+	{
+		munmap(m_mappedMemory, m_size);
+	}
+#endif
+
 	if(m_file)
 	{
 #if ANKI_OS_ANDROID
@@ -269,6 +279,85 @@ Error File::read(void* buff, PtrSize size)
 	return err;
 }
 
+Error File::readAt(PtrSize offset, void* buff, PtrSize size)
+{
+	ANKI_ASSERT(buff);
+	ANKI_ASSERT(size > 0);
+	ANKI_ASSERT(m_file);
+	ANKI_ASSERT((m_flags & FileOpenFlag::kRead) != FileOpenFlag::kNone);
+
+#if ANKI_POSIX
+#	if ANKI_OS_ANDROID
+	if(!!(m_flags & FileOpenFlag::kSpecial))
+	{
+		ANKI_CHECK(seek(offset, FileSeekOrigin::kBeginning));
+		return read(buff, size);
+	}
+#	endif
+
+	const int fd = fileno(ANKI_CFILE);
+	U8* out = static_cast<U8*>(buff);
+	while(size > 0)
+	{
+		const ssize_t readSize = pread(fd, out, size, off_t(offset));
+		if(readSize <= 0)
+		{
+			ANKI_UTIL_LOGE("pread() failed");
+			return Error::kFileAccess;
+		}
+
+		out += readSize;
+		offset += PtrSize(readSize);
+		size -= PtrSize(readSize);
+	}
+
+	return Error::kNone;
+#else
+	ANKI_CHECK(seek(offset, FileSeekOrigin::kBeginning));
+	return read(buff, size);
+#endif
+}
+
+Error File::map(const void*& ptr)
+{
+	ANKI_ASSERT(m_file);
+	ANKI_ASSERT((m_flags & FileOpenFlag::kRead) != FileOpenFlag::kNone);
+	ptr = nullptr;
+
+	if(m_mappedMemory)
+	{
+		ptr = m_mappedMemory;
+		return Error::kNone;
+	}
+
+#if ANKI_POSIX
+#	if ANKI_OS_ANDROID
+	if(!!(m_flags & FileOpenFlag::kSpecial))
+	{
+		return Error::kFunctionFailed;
+	}
+#	endif
+
+	if(m_size == 0)
+	{
+		return Error::kFunctionFailed;
+	}
+
+	void* mem = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileno(ANKI_CFILE), 0);
+	if(mem == MAP_FAILED)
+	{
+		ANKI_UTIL_LOGE("mmap() failed");
+		return Error::kFunctionFailed;
+	}
+
+	m_mappedMemory = mem;
+	ptr = mem;
+	return Error::kNone;
+#else
+	return Error::kFunctionFailed;
+#endif
+}
+
 Error File::readU32(U32& out)
 {
 	ANKI_ASSERT(m_file);
@@ -85,6 +85,10 @@ public:
 	/// Read data from the file
 	Error read(void* buff, PtrSize size);
 
+	/// Read data from a specific offset of the file. On POSIX it doesn't touch the position indicator and it's
+	/// thread-safe. On other platforms it moves the position indicator so the caller should synchronize.
+	Error readAt(PtrSize offset, void* buff, PtrSize size);
+
 	/// Read all the contents of a text file. If the file is not rewined it will probably fail.
 	template<typename TMemPool>
 	Error readAllText(BaseString<TMemPool>& out)
@@ -136,10 +140,15 @@ public:
 		return m_size;
 	}
 
+	/// Map the whole file to memory. The memory is read-only and it's valid until the file is closed. Calling it again
+	/// returns the same memory. It's only supported for regular files opened for reading on POSIX platforms.
+	Error map(const void*& ptr);
+
 private:
 	void* m_file = nullptr; ///< A native file type
 	FileOpenFlag m_flags = FileOpenFlag::kNone; ///< All the flags. Set on open
 	PtrSize m_size = 0;
+	void* m_mappedMemory = nullptr;
 
 	/// Get the current machine's endianness
 	static FileOpenFlag getMachineEndianness();
@@ -157,6 +166,7 @@ private:
 		m_file = nullptr;
 		m_flags = FileOpenFlag::kNone;
 		m_size = 0;
+		m_mappedMemory = nullptr;
 	}
 };
 /// @}
@@ -49,6 +49,12 @@ public:
 		return m_parent;
 	}
 
+	/// Get the number of direct children. It walks the list of children.
+	U32 getChildrenCount() const
+	{
+		return U32(m_children.getSize());
+	}
+
 	Value& getChild(PtrSize i)
 	{
 		return *(*(m_children.getBegin() + i));
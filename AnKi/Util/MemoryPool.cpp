@@ -9,6 +9,8 @@
 #include <AnKi/Util/Thread.h>
 #include <AnKi/Util/Atomic.h>
 #include <AnKi/Util/Logger.h>
+#include <AnKi/Util/ClassAllocatorBuilder.h>
+#include <AnKi/Util/BitSet.h>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -162,12 +164,419 @@ void BaseMemoryPool::destroy()
 	m_allocationCount.setNonAtomically(0);
 }
 
-void HeapMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name)
+/// Serves the small allocations of a HeapMemoryPool. The size classes are built with ClassAllocatorBuilder and every
+/// thread keeps linked lists of free blocks per class. The lists are refilled and drained in batches.
+class HeapMemoryPool::ThreadCachingAllocator
+{
+public:
+	ThreadCachingAllocator(HeapMemoryPool& parent)
+		: m_parent(parent)
+		, m_internalPool(parent.m_allocCb, parent.m_allocCbUserData)
+		, m_central(MemoryPoolPtrWrapper<HeapMemoryPool>(&m_internalPool))
+		, m_caches(MemoryPoolPtrWrapper<HeapMemoryPool>(&m_internalPool))
+	{
+		m_central.getInterface().m_parent = this;
+		m_central.init();
+
+		for(U32 i = 0; i < m_sizeToClass.getSize(); ++i)
+		{
+			U32 classIdx = 0;
+			while(kClassBlockSizes[classIdx] < i * kAlignment)
+			{
+				++classIdx;
+			}
+			m_sizeToClass[i] = U8(classIdx);
+		}
+
+		// Find a free slot in the thread local arrays. If there is none the pool will work without thread caches
+		U32 usedSlots = m_usedSlots.load();
+		while(usedSlots != kMaxU32)
+		{
+			const U32 slot = U32(__builtin_ctzll(~usedSlots));
+			if(m_usedSlots.compareExchange(usedSlots, usedSlots | (1u << slot)))
+			{
+				m_slot = slot;
+				break;
+			}
+		}
+
+		if(m_slot == kMaxU32)
+		{
+			ANKI_UTIL_LOGW("Too many thread caching memory pools. Will not use thread caches: %s", parent.getName());
+		}
+		else
+		{
+			LockGuard<Mutex> lock(m_liveAllocatorsMtx);
+			m_liveAllocators[m_slot] = this;
+		}
+	}
+
+	~ThreadCachingAllocator()
+	{
+		// Exiting threads can't find this allocator any more. They'll leave their caches to the loop below
+		if(m_slot != kMaxU32)
+		{
+			LockGuard<Mutex> lock(m_liveAllocatorsMtx);
+			m_liveAllocators[m_slot] = nullptr;
+		}
+
+		for(ThreadCache* cache : m_caches)
+		{
+			for(U32 classIdx = 0; classIdx < kClassCount; ++classIdx)
+			{
+				flush(*cache, classIdx, cache->m_freeCounts[classIdx]);
+			}
+
+			deleteInstance(m_internalPool, cache);
+		}
+		m_caches.destroy();
+
+		if(m_slot != kMaxU32)
+		{
+			m_usedSlots.fetchAnd(~(1u << m_slot));
+		}
+	}
+
+	void* allocate(PtrSize size, PtrSize alignment)
+	{
+		if(size <= kMaxBlockSize - kPrefixSize && alignment <= kAlignment) [[likely]]
+		{
+			const U32 classIdx = m_sizeToClass[(size + kPrefixSize + kAlignment - 1) / kAlignment];
+			ThreadCache* cache = getThreadCache();
+			if(cache == nullptr) [[unlikely]]
+			{
+				return allocateFromCentral(classIdx);
+			}
+
+			if(cache->m_freeCounts[classIdx] == 0 && !refill(*cache, classIdx)) [[unlikely]]
+			{
+				return nullptr;
+			}
+
+			void* mem = cache->m_freeLists[classIdx];
+			cache->m_freeLists[classIdx] = *static_cast<void**>(mem);
+			--cache->m_freeCounts[classIdx];
+			cache->m_cachedSize.store(cache->m_cachedSize.load() - kClassBlockSizes[classIdx]);
+			return mem;
+		}
+
+		// Big allocation, go to the callback
+		const PtrSize prefixSize = max<PtrSize>(alignment, kPrefixSize);
+		const PtrSize memAlignment = max<PtrSize>(alignment, kAlignment);
+		U8* mem =
+			static_cast<U8*>(m_parent.m_allocCb(m_parent.m_allocCbUserData, nullptr, size + prefixSize, memAlignment));
+		if(mem == nullptr) [[unlikely]]
+		{
+			return nullptr;
+		}
+
+		Prefix& prefix = getPrefix(mem + prefixSize);
+		prefix.m_chunkOrMemory = mem;
+		prefix.m_classIdx = kMaxPtrSize;
+		return mem + prefixSize;
+	}
+
+	void free(void* ptr)
+	{
+		const Prefix& prefix = getPrefix(ptr);
+		if(prefix.m_classIdx == kMaxPtrSize)
+		{
+			m_parent.m_allocCb(m_parent.m_allocCbUserData, prefix.m_chunkOrMemory, 0, 0);
+			return;
+		}
+
+		const U32 classIdx = U32(prefix.m_classIdx);
+		ThreadCache* cache = getThreadCache();
+		if(cache == nullptr) [[unlikely]]
+		{
+			freeToCentral(ptr);
+			return;
+		}
+
+		*static_cast<void**>(ptr) = cache->m_freeLists[classIdx];
+		cache->m_freeLists[classIdx] = ptr;
+		++cache->m_freeCounts[classIdx];
+		cache->m_cachedSize.store(cache->m_cachedSize.load() + kClassBlockSizes[classIdx]);
+
+		// Don't let a thread that only frees hoard memory
+		if(cache->m_freeCounts[classIdx] > getBatchSize(classIdx) * 2)
+		{
+			flush(*cache, classIdx, getBatchSize(classIdx));
+		}
+	}
+
+	void getStats(HeapMemoryPoolStats& stats)
+	{
+		ClassAllocatorBuilderStats centralStats;
+		m_central.getStats(centralStats);
+		stats.m_classAllocatedSize = centralStats.m_allocatedSize;
+		stats.m_classInUseSize = centralStats.m_inUseSize;
+
+		LockGuard<Mutex> lock(m_cachesMtx);
+		for(const ThreadCache* cache : m_caches)
+		{
+			stats.m_threadCachedSize += cache->m_cachedSize.load();
+		}
+		stats.m_threadCacheCount = m_caches.getSize();
+	}
+
+private:
+	/// Block sizes, including the prefix.
+	static constexpr Array<U16, 23> kClassBlockSizes = {
+		32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792,
+		2048};
+	static constexpr U32 kClassCount = kClassBlockSizes.getSize();
+	static constexpr PtrSize kMaxBlockSize = kClassBlockSizes[kClassCount - 1];
+	static constexpr PtrSize kAlignment = 16; ///< The size classes can't serve bigger alignments.
+	static constexpr U32 kMaxSuballocationsPerChunk = 128;
+	static constexpr PtrSize kTargetChunkSize = 32_KB; ///< Don't make the chunks of the big classes too big.
+	static constexpr U32 kMaxPoolCount = 32; ///< Max number of thread caching pools that can be alive.
+
+	/// Every allocation is preceded by that. It's how free() knows where the memory came from.
+	class Prefix
+	{
+	public:
+		void* m_chunkOrMemory;
+		PtrSize m_classIdx; ///< kMaxPtrSize if it's not a small allocation.
+	};
+
+	static constexpr PtrSize kPrefixSize = sizeof(Prefix);
+	static_assert(kPrefixSize == kAlignment);
+
+	class Chunk : public IntrusiveListEnabled<Chunk>
+	{
+	public:
+		BitSet<kMaxSuballocationsPerChunk, U64> m_inUseSuballocations = {false};
+		U32 m_suballocationCount = 0;
+		void* m_class = nullptr;
+		U8* m_memory = nullptr;
+	};
+
+	class Interface
+	{
+	public:
+		ThreadCachingAllocator* m_parent = nullptr;
+
+		U32 getClassCount() const
+		{
+			return kClassCount;
+		}
+
+		void getClassInfo(U32 classIdx, PtrSize& chunkSize, PtrSize& suballocationSize) const
+		{
+			suballocationSize = kClassBlockSizes[classIdx];
+			chunkSize = getChunkSize(classIdx);
+		}
+
+		Error allocateChunk(U32 classIdx, Chunk*& chunk)
+		{
+			const PtrSize memorySize = getChunkSize(classIdx);
+			constexpr PtrSize kChunkHeaderSize = getAlignedRoundUp(kAlignment, sizeof(Chunk));
+			void* mem = m_parent->m_parent.m_allocCb(m_parent->m_parent.m_allocCbUserData, nullptr,
+													  kChunkHeaderSize + memorySize, kAlignment);
+			if(mem == nullptr) [[unlikely]]
+			{
+				return Error::kOutOfMemory;
+			}
+
+			chunk = ::new(mem) Chunk();
+			chunk->m_memory = static_cast<U8*>(mem) + kChunkHeaderSize;
+			return Error::kNone;
+		}
+
+		void freeChunk(Chunk* chunk)
+		{
+			chunk->~Chunk();
+			m_parent->m_parent.m_allocCb(m_parent->m_parent.m_allocCbUserData, chunk, 0, 0);
+		}
+	};
+
+	/// The free blocks of a single thread. The link of the lists is stored in the blocks themselves.
+	class alignas(ANKI_CACHE_LINE_SIZE) ThreadCache
+	{
+	public:
+		Array<void*, kClassCount> m_freeLists = {};
+		Array<U32, kClassCount> m_freeCounts = {};
+		Atomic<PtrSize> m_cachedSize = {0}; ///< Only for stats.
+	};
+
+	/// Points to the ThreadCache of a thread. The UUID guards against a pool that was destroyed.
+	class ThreadCacheRef
+	{
+	public:
+		U64 m_allocatorUuid = 0;
+		ThreadCache* m_cache = nullptr;
+	};
+
+	/// The caches of a thread. When the thread exits it gives its caches back to the allocators that are still alive.
+	class ThreadCacheRefs
+	{
+	public:
+		Array<ThreadCacheRef, kMaxPoolCount> m_refs = {};
+
+		~ThreadCacheRefs()
+		{
+			LockGuard<Mutex> lock(m_liveAllocatorsMtx);
+			for(U32 slot = 0; slot < kMaxPoolCount; ++slot)
+			{
+				ThreadCachingAllocator* allocator = m_liveAllocators[slot];
+				if(allocator && allocator->m_uuid == m_refs[slot].m_allocatorUuid)
+				{
+					allocator->releaseThreadCache(m_refs[slot].m_cache);
+				}
+			}
+		}
+	};
+
+	static thread_local ThreadCacheRefs m_threadCaches;
+	static inline Array<ThreadCachingAllocator*, kMaxPoolCount> m_liveAllocators = {};
+	static inline Mutex m_liveAllocatorsMtx; ///< Protects m_liveAllocators.
+	static inline Atomic<U32> m_usedSlots = {0};
+	static inline Atomic<U64> m_nextUuid = {1};
+
+	HeapMemoryPool& m_parent;
+	HeapMemoryPool m_internalPool; ///< For the bookkeeping.
+	ClassAllocatorBuilder<Chunk, Interface, Mutex, MemoryPoolPtrWrapper<HeapMemoryPool>> m_central;
+	Array<U8, kMaxBlockSize / kAlignment + 1> m_sizeToClass;
+
+	U64 m_uuid = m_nextUuid.fetchAdd(1);
+	U32 m_slot = kMaxU32;
+	DynamicArray<ThreadCache*, MemoryPoolPtrWrapper<HeapMemoryPool>> m_caches;
+	Mutex m_cachesMtx;
+
+	static Prefix& getPrefix(void* ptr)
+	{
+		return *reinterpret_cast<Prefix*>(static_cast<U8*>(ptr) - kPrefixSize);
+	}
+
+	static PtrSize getChunkSize(U32 classIdx)
+	{
+		const PtrSize blockSize = kClassBlockSizes[classIdx];
+		return min<PtrSize>(kTargetChunkSize / blockSize, kMaxSuballocationsPerChunk) * blockSize;
+	}
+
+	static U32 getBatchSize(U32 classIdx)
+	{
+		return min<U32>(max<U32>(U32(8_KB / kClassBlockSizes[classIdx]), 4), 32);
+	}
+
+	ThreadCache* getThreadCache()
+	{
+		if(m_slot == kMaxU32) [[unlikely]]
+		{
+			return nullptr;
+		}
+
+		ThreadCacheRef& ref = m_threadCaches.m_refs[m_slot];
+		if(ref.m_allocatorUuid != m_uuid) [[unlikely]]
+		{
+			ref.m_cache = newInstance<ThreadCache>(m_internalPool);
+			ref.m_allocatorUuid = m_uuid;
+
+			LockGuard<Mutex> lock(m_cachesMtx);
+			m_caches.emplaceBack(ref.m_cache);
+		}
+
+		return ref.m_cache;
+	}
+
+	/// Flush the cache of an exiting thread and delete it.
+	void releaseThreadCache(ThreadCache* cache)
+	{
+		for(U32 classIdx = 0; classIdx < kClassCount; ++classIdx)
+		{
+			flush(*cache, classIdx, cache->m_freeCounts[classIdx]);
+		}
+
+		{
+			LockGuard<Mutex> lock(m_cachesMtx);
+			for(U32 i = 0; i < m_caches.getSize(); ++i)
+			{
+				if(m_caches[i] == cache)
+				{
+					m_caches[i] = m_caches.getBack();
+					m_caches.popBack();
+					break;
+				}
+			}
+		}
+
+		deleteInstance(m_internalPool, cache);
+	}
+
+	void* allocateFromCentral(U32 classIdx)
+	{
+		Chunk* chunk;
+		PtrSize offset;
+		if(m_central.allocate(kClassBlockSizes[classIdx], kAlignment, chunk, offset)) [[unlikely]]
+		{
+			return nullptr;
+		}
+
+		U8* mem = chunk->m_memory + offset + kPrefixSize;
+		Prefix& prefix = getPrefix(mem);
+		prefix.m_chunkOrMemory = chunk;
+		prefix.m_classIdx = classIdx;
+		return mem;
+	}
+
+	void freeToCentral(void* ptr)
+	{
+		Chunk* chunk = static_cast<Chunk*>(getPrefix(ptr).m_chunkOrMemory);
+		m_central.free(chunk, static_cast<U8*>(ptr) - kPrefixSize - chunk->m_memory);
+	}
+
+	Bool refill(ThreadCache& cache, U32 classIdx)
+	{
+		const U32 batchSize = getBatchSize(classIdx);
+		for(U32 i = 0; i < batchSize; ++i)
+		{
+			void* mem = allocateFromCentral(classIdx);
+			if(mem == nullptr) [[unlikely]]
+			{
+				break;
+			}
+
+			*static_cast<void**>(mem) = cache.m_freeLists[classIdx];
+			cache.m_freeLists[classIdx] = mem;
+			++cache.m_freeCounts[classIdx];
+		}
+
+		cache.m_cachedSize.store(cache.m_cachedSize.load() + cache.m_freeCounts[classIdx] * kClassBlockSizes[classIdx]);
+		return cache.m_freeCounts[classIdx] > 0;
+	}
+
+	void flush(ThreadCache& cache, U32 classIdx, U32 count)
+	{
+		ANKI_ASSERT(count <= cache.m_freeCounts[classIdx]);
+		for(U32 i = 0; i < count; ++i)
+		{
+			void* mem = cache.m_freeLists[classIdx];
+			cache.m_freeLists[classIdx] = *static_cast<void**>(mem);
+			freeToCentral(mem);
+		}
+
+		cache.m_freeCounts[classIdx] -= count;
+		cache.m_cachedSize.store(cache.m_cachedSize.load() - count * kClassBlockSizes[classIdx]);
+	}
+};
+
+thread_local HeapMemoryPool::ThreadCachingAllocator::ThreadCacheRefs
+	HeapMemoryPool::ThreadCachingAllocator::m_threadCaches;
+
+void HeapMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name, Bool threadCaching)
 {
 	BaseMemoryPool::init(allocCb, allocCbUserData, name);
 #if ANKI_MEM_EXTRA_CHECKS
 	m_signature = computePoolSignature(this);
 #endif
+
+	if(threadCaching)
+	{
+		m_threadCachingAllocator = static_cast<ThreadCachingAllocator*>(
+			m_allocCb(m_allocCbUserData, nullptr, sizeof(ThreadCachingAllocator), alignof(ThreadCachingAllocator)));
+		::new(m_threadCachingAllocator) ThreadCachingAllocator(*this);
+	}
 }
 
 void HeapMemoryPool::destroy()
@@ -178,6 +587,22 @@ void HeapMemoryPool::destroy()
 		ANKI_UTIL_LOGE("Memory pool destroyed before all memory being released (%u deallocations missed): %s", count,
 					   getName());
 	}
+
+	if(m_threadCachingAllocator)
+	{
+		if(count == 0)
+		{
+			m_threadCachingAllocator->~ThreadCachingAllocator();
+			m_allocCb(m_allocCbUserData, m_threadCachingAllocator, 0, 0);
+		}
+		else
+		{
+			// The size classes still have memory in use. Leak them along with the user's memory
+		}
+
+		m_threadCachingAllocator = nullptr;
+	}
+
 	BaseMemoryPool::destroy();
 }
 
@@ -189,7 +614,8 @@ void* HeapMemoryPool::allocate(PtrSize size, PtrSize alignment)
 	size += kAllocationHeaderSize;
 #endif
 
-	void* mem = m_allocCb(m_allocCbUserData, nullptr, size, alignment);
+	void* mem = (m_threadCachingAllocator) ? m_threadCachingAllocator->allocate(size, alignment)
+										   : m_allocCb(m_allocCbUserData, nullptr, size, alignment);
 
 	if(mem != nullptr)
 	{
@@ -231,7 +657,25 @@ void HeapMemoryPool::free(void* ptr)
 	invalidateMemory(ptr, header.m_allocationSize);
 #endif
 	m_allocationCount.fetchSub(1);
-	m_allocCb(m_allocCbUserData, ptr, 0, 0);
+
+	if(m_threadCachingAllocator)
+	{
+		m_threadCachingAllocator->free(ptr);
+	}
+	else
+	{
+		m_allocCb(m_allocCbUserData, ptr, 0, 0);
+	}
+}
+
+void HeapMemoryPool::getStats(HeapMemoryPoolStats& stats) const
+{
+	stats = {};
+	stats.m_allocationCount = m_allocationCount.load();
+	if(m_threadCachingAllocator)
+	{
+		m_threadCachingAllocator->getStats(stats);
+	}
 }
 
 Error StackMemoryPool::StackAllocatorBuilderInterface::allocateChunk(PtrSize size, Chunk*& out)
@@ -274,9 +718,12 @@ void StackMemoryPool::StackAllocatorBuilderInterface::recycleChunk([[maybe_unuse
 #endif
 }
 
+thread_local Array<StackMemoryPool::ThreadArena, StackMemoryPool::kMaxThreadArenaPools>
+	StackMemoryPool::m_threadArenas = {};
+
 void StackMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData, PtrSize initialChunkSize,
 						   F64 nextChunkScale, PtrSize nextChunkBias, Bool ignoreDeallocationErrors, U32 alignmentBytes,
-						   const Char* name)
+						   const Char* name, PtrSize threadArenaSize)
 {
 	ANKI_ASSERT(initialChunkSize > 0);
 	ANKI_ASSERT(nextChunkScale >= 1.0);
@@ -289,19 +736,100 @@ void StackMemoryPool::init(AllocAlignedCallback allocCb, void* allocCbUserData,
 	m_builder.getInterface().m_initialChunkSize = initialChunkSize;
 	m_builder.getInterface().m_nextChunkScale = nextChunkScale;
 	m_builder.getInterface().m_nextChunkBias = nextChunkBias;
+
+	if(threadArenaSize)
+	{
+		m_threadArenaSize = getAlignedRoundUp(alignmentBytes, threadArenaSize);
+		m_threadArenaGeneration = m_nextThreadArenaGeneration.fetchAdd(1);
+
+		// Find a free slot in the thread local arrays. If there is none fallback to the shared chunks
+		U32 usedSlots = m_usedThreadArenaSlots.load();
+		while(usedSlots != kMaxU32 >> (32 - kMaxThreadArenaPools))
+		{
+			const U32 slot = U32(__builtin_ctzll(~usedSlots));
+			if(m_usedThreadArenaSlots.compareExchange(usedSlots, usedSlots | (1u << slot)))
+			{
+				m_threadArenaSlot = slot;
+				break;
+			}
+		}
+
+		if(m_threadArenaSlot == kMaxU32)
+		{
+			ANKI_UTIL_LOGW("Too many pools with thread arenas. Will not use thread arenas for %s", getName());
+			m_threadArenaSize = 0;
+		}
+	}
 }
 
 void StackMemoryPool::destroy()
 {
+	if(m_threadArenaSlot != kMaxU32)
+	{
+		m_usedThreadArenaSlots.fetchAnd(~(1u << m_threadArenaSlot));
+	}
+
+	m_threadArenaSize = 0;
+	m_threadArenaSlot = kMaxU32;
+	m_threadArenaGeneration = 0;
+
 	m_builder.destroy();
 	m_builder.getInterface() = {};
 	BaseMemoryPool::destroy();
 }
 
+void* StackMemoryPool::allocateFromThreadArena(PtrSize size, PtrSize alignment)
+{
+	ANKI_ASSERT(alignment <= m_builder.getInterface().getMaxAlignment());
+	ThreadArena& arena = m_threadArenas[m_threadArenaSlot];
+
+	if(arena.m_generation == m_threadArenaGeneration) [[likely]]
+	{
+		U8* out = numberToPtr<U8*>(getAlignedRoundUp(alignment, ptrToNumber(arena.m_crnt)));
+		if(out + size <= arena.m_end) [[likely]]
+		{
+			arena.m_crnt = out + size;
+			return out;
+		}
+	}
+
+	// Big allocations go to the shared chunks, they would waste too much of the arena
+	if(size > m_threadArenaSize / 4)
+	{
+		Chunk* chunk;
+		PtrSize offset;
+		if(m_builder.allocate(size, alignment, chunk, offset)) [[unlikely]]
+		{
+			return nullptr;
+		}
+
+		return &chunk->m_memoryStart[0] + offset;
+	}
+
+	// Get a new arena. What's left in the old one is wasted
+	Chunk* chunk;
+	PtrSize offset;
+	if(m_builder.allocate(m_threadArenaSize, m_builder.getInterface().getMaxAlignment(), chunk, offset)) [[unlikely]]
+	{
+		return nullptr;
+	}
+
+	U8* out = &chunk->m_memoryStart[0] + offset;
+	arena.m_generation = m_threadArenaGeneration;
+	arena.m_crnt = out + size;
+	arena.m_end = out + m_threadArenaSize;
+	return out;
+}
+
 void* StackMemoryPool::allocate(PtrSize size, PtrSize alignment)
 {
 	ANKI_ASSERT(size > 0);
 
+	if(m_threadArenaSlot != kMaxU32)
+	{
+		return allocateFromThreadArena(size, alignment);
+	}
+
 	Chunk* chunk;
 	PtrSize offset;
 	if(m_builder.allocate(size, alignment, chunk, offset))
@@ -321,6 +849,12 @@ void StackMemoryPool::free(void* ptr)
 		return;
 	}
 
+	if(m_threadArenaSize)
+	{
+		// Nothing to do, the allocations are not tracked
+		return;
+	}
+
 	[[maybe_unused]] const U32 count = m_allocationCount.fetchSub(1);
 	ANKI_ASSERT(count > 0);
 	m_builder.free();
@@ -330,6 +864,12 @@ void StackMemoryPool::reset()
 {
 	m_builder.reset();
 	m_allocationCount.store(0);
+
+	if(m_threadArenaSize)
+	{
+		// A new generation makes all the thread arenas empty
+		m_threadArenaGeneration = m_nextThreadArenaGeneration.fetchAdd(1);
+	}
 }
 
 } // end namespace anki
@@ -125,7 +125,27 @@ private:
 	Type m_type = Type::kNone;
 };
 
-/// A dummy interface to match the StackMemoryPool interfaces in order to be used by the same allocator template.
+/// @memberof HeapMemoryPool
+class HeapMemoryPoolStats
+{
+public:
+	U32 m_allocationCount = 0;
+
+	/// Memory of the size classes that was requested from the allocation callback.
+	PtrSize m_classAllocatedSize = 0;
+
+	/// The part of m_classAllocatedSize that is handed out or sits in the thread caches.
+	PtrSize m_classInUseSize = 0;
+
+	/// The part of m_classInUseSize that sits in the thread caches.
+	PtrSize m_threadCachedSize = 0;
+
+	U32 m_threadCacheCount = 0;
+};
+
+/// A memory pool that forwards the allocations to the allocation callback. Optionally small allocations are served by
+/// size classes and every thread keeps a cache of free blocks per class. That way most small allocations and frees
+/// don't lock and don't go through the allocation callback. Threads give their caches back when they exit.
 class HeapMemoryPool : public BaseMemoryPool
 {
 public:
@@ -136,10 +156,11 @@ public:
 	}
 
 	/// @see init
-	HeapMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name = nullptr)
+	HeapMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name = nullptr,
+				   Bool threadCaching = false)
 		: HeapMemoryPool()
 	{
-		init(allocCb, allocCbUserData, name);
+		init(allocCb, allocCbUserData, name, threadCaching);
 	}
 
 	/// Destroy
@@ -152,7 +173,9 @@ public:
 	/// @param allocCb The allocation function callback.
 	/// @param allocCbUserData The user data to pass to the allocation function.
 	/// @param name An optional name.
-	void init(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name = nullptr);
+	/// @param threadCaching Serve small allocations from size classes with per-thread caches.
+	void init(AllocAlignedCallback allocCb, void* allocCbUserData, const Char* name = nullptr,
+			  Bool threadCaching = false);
 
 	/// Manual destroy. The destructor calls that as well.
 	void destroy();
@@ -164,7 +187,15 @@ public:
 	/// @param[in, out] ptr Memory block to deallocate.
 	void free(void* ptr);
 
+	/// Get some statistics.
+	/// @note It's thread-safe. The numbers of the thread caches are approximate if other threads are allocating.
+	void getStats(HeapMemoryPoolStats& stats) const;
+
 private:
+	class ThreadCachingAllocator;
+
+	ThreadCachingAllocator* m_threadCachingAllocator = nullptr;
+
 #if ANKI_MEM_EXTRA_CHECKS
 	PoolSignature m_signature = 0;
 #endif
@@ -186,7 +217,10 @@ private:
 };
 
 /// Thread safe memory pool. It's a preallocated memory pool that is used for memory allocations on top of that
-/// preallocated memory. It is mainly used by fast stack allocators
+/// preallocated memory. It is mainly used by fast stack allocators.
+///
+/// Optionally each thread can allocate from a private arena. The arenas are big blocks that are allocated from the
+/// shared chunks so the threads don't fight over the same atomic all the time. The arenas are invalidated by reset().
 class StackMemoryPool : public BaseMemoryPool
 {
 public:
@@ -198,11 +232,11 @@ public:
 	/// @see init
 	StackMemoryPool(AllocAlignedCallback allocCb, void* allocCbUserData, PtrSize initialChunkSize,
 					F64 nextChunkScale = 2.0, PtrSize nextChunkBias = 0, Bool ignoreDeallocationErrors = true,
-					U32 alignmentBytes = ANKI_SAFE_ALIGNMENT, const Char* name = nullptr)
+					U32 alignmentBytes = ANKI_SAFE_ALIGNMENT, const Char* name = nullptr, PtrSize threadArenaSize = 0)
 		: StackMemoryPool()
 	{
 		init(allocCb, allocCbUserData, initialChunkSize, nextChunkScale, nextChunkBias, ignoreDeallocationErrors,
-			 alignmentBytes, name);
+			 alignmentBytes, name, threadArenaSize);
 	}
 
 	/// Destroy
@@ -221,9 +255,11 @@ public:
 	///        true to suppress such errors.
 	/// @param alignmentBytes The maximum supported alignment for returned memory.
 	/// @param name An optional name.
+	/// @param threadArenaSize If it's not zero every thread allocates from a private arena of that size. The allocation
+	///        count is not tracked in that case.
 	void init(AllocAlignedCallback allocCb, void* allocCbUserData, PtrSize initialChunkSize, F64 nextChunkScale = 2.0,
 			  PtrSize nextChunkBias = 0, Bool ignoreDeallocationErrors = true, U32 alignmentBytes = ANKI_SAFE_ALIGNMENT,
-			  const Char* name = nullptr);
+			  const Char* name = nullptr, PtrSize threadArenaSize = 0);
 
 	/// Manual destroy. The destructor calls that as well.
 	void destroy();
@@ -240,7 +276,8 @@ public:
 	/// @param[in, out] ptr Memory block to deallocate.
 	void free(void* ptr);
 
-	/// Reinit the pool. All existing allocated memory is effectively invalidated.
+	/// Reinit the pool. All existing allocated memory is effectively invalidated. The thread arenas are invalidated
+	/// without touching them.
 	/// @note It's not thread safe with other methods.
 	void reset();
 
@@ -255,6 +292,18 @@ private:
 	/// This is the absolute max alignment.
 	static constexpr U32 kMaxAlignment = ANKI_SAFE_ALIGNMENT;
 
+	/// Max number of pools with thread arenas that can be alive at the same time.
+	static constexpr U32 kMaxThreadArenaPools = 16;
+
+	/// The part of an arena that a thread hasn't used yet.
+	class ThreadArena
+	{
+	public:
+		U64 m_generation = 0; ///< If it's not the same as the pool's the arena is empty.
+		U8* m_crnt = nullptr;
+		U8* m_end = nullptr;
+	};
+
 	/// This is the chunk the StackAllocatorBuilder will be allocating.
 	class alignas(kMaxAlignment) Chunk
 	{
@@ -326,12 +375,22 @@ private:
 
 		Atomic<U32>* getAllocationCount()
 		{
-			return (m_parent) ? &m_parent->m_allocationCount : nullptr;
+			return (m_parent && m_parent->m_threadArenaSize == 0) ? &m_parent->m_allocationCount : nullptr;
 		}
 	};
 
+	static thread_local Array<ThreadArena, kMaxThreadArenaPools> m_threadArenas;
+	static inline Atomic<U32> m_usedThreadArenaSlots = {0};
+	static inline Atomic<U64> m_nextThreadArenaGeneration = {1};
+
 	/// The allocator helper.
 	StackAllocatorBuilder<Chunk, StackAllocatorBuilderInterface, Mutex> m_builder;
+
+	PtrSize m_threadArenaSize = 0;
+	U32 m_threadArenaSlot = kMaxU32;
+	U64 m_threadArenaGeneration = 0;
+
+	void* allocateFromThreadArena(PtrSize size, PtrSize alignment);
 };
 
 /// A wrapper class that makes a pointer to a memory pool act like a reference.
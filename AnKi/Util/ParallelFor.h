@@ -0,0 +1,346 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Util/ThreadHive.h>
+#include <AnKi/Util/Functions.h>
+#include <AnKi/Util/DynamicArray.h>
+
+namespace anki {
+
+/// @addtogroup util_thread
+/// @{
+
+namespace detail {
+
+/// The state of a parallelFor or parallelReduce call. It lives in the scratch memory of the hive because some helper
+/// tasks might run after the call has returned. Those tasks will not find any work and they will not touch the
+/// caller's data.
+template<typename TShared>
+class ParallelForContext
+{
+public:
+	TShared* m_shared; ///< It's on the caller's stack. Access it only after a successful claim().
+	U32 m_end;
+	U32 m_grainSize;
+	U32 m_participantCount;
+	Atomic<U32> m_next;
+	Atomic<U32> m_completedCount;
+
+	/// Get a chunk of the range. The chunks start big and get smaller as the range is consumed.
+	Bool claim(U32& chunkBegin, U32& chunkEnd)
+	{
+		U32 crnt = m_next.load();
+		U32 chunkSize;
+		do
+		{
+			if(crnt >= m_end)
+			{
+				return false;
+			}
+
+			const U32 remaining = m_end - crnt;
+			chunkSize = min(remaining, max(m_grainSize, remaining / (m_participantCount * 2u)));
+		} while(!m_next.compareExchange(crnt, crnt + chunkSize, AtomicMemoryOrder::kAcquire));
+
+		chunkBegin = crnt;
+		chunkEnd = crnt + chunkSize;
+		return true;
+	}
+
+	/// Process chunks until there is nothing left.
+	void participate()
+	{
+		U32 chunkBegin, chunkEnd;
+		if(!claim(chunkBegin, chunkEnd))
+		{
+			return;
+		}
+
+		typename TShared::Participant participant(*m_shared);
+		U32 processedCount = 0;
+		do
+		{
+			participant.run(chunkBegin, chunkEnd);
+			processedCount += chunkEnd - chunkBegin;
+		} while(claim(chunkBegin, chunkEnd));
+
+		participant.finalize();
+
+		// After that the caller might return so don't touch m_shared
+		m_completedCount.fetchAdd(processedCount, AtomicMemoryOrder::kRelease);
+	}
+
+	static void helperTaskCallback(void* userData, [[maybe_unused]] U32 threadId, [[maybe_unused]] ThreadHive& hive,
+								   [[maybe_unused]] ThreadHiveSemaphore* signalSemaphore)
+	{
+		static_cast<ParallelForContext*>(userData)->participate();
+	}
+};
+
+template<typename TShared>
+void runParallelFor(ThreadHive& hive, U32 begin, U32 end, U32 grainSize, TShared& shared)
+{
+	ANKI_ASSERT(begin <= end && grainSize > 0);
+	const U32 problemSize = end - begin;
+	const U32 maxChunkCount = (problemSize + grainSize - 1) / grainSize;
+	const U32 maxHelperCount = min(hive.getThreadCount(), ThreadHive::kMaxThreads);
+	const U32 helperCount = (maxChunkCount > 1) ? min(maxHelperCount, maxChunkCount - 1) : 0;
+
+	if(helperCount == 0)
+	{
+		// Not worth it, run it serially
+		if(problemSize)
+		{
+			typename TShared::Participant participant(shared);
+			participant.run(begin, end);
+			participant.finalize();
+		}
+		return;
+	}
+
+	using Ctx = ParallelForContext<TShared>;
+	Ctx& ctx = *::new(hive.allocateScratchMemory(sizeof(Ctx), alignof(Ctx))) Ctx();
+	ctx.m_shared = &shared;
+	ctx.m_end = end;
+	ctx.m_grainSize = grainSize;
+	ctx.m_participantCount = helperCount + 1;
+	ctx.m_next.setNonAtomically(begin);
+	ctx.m_completedCount.setNonAtomically(0);
+
+	Array<ThreadHiveTask, ThreadHive::kMaxThreads> tasks;
+	for(U32 i = 0; i < helperCount; ++i)
+	{
+		tasks[i].m_callback = Ctx::helperTaskCallback;
+		tasks[i].m_argument = &ctx;
+	}
+	hive.submitTasks(&tasks[0], helperCount);
+
+	// The caller does work as well
+	ctx.participate();
+
+	// Wait for the chunks that the helpers are still processing. Helpers that haven't started are not waited
+	for(U32 spinCount = 0; ctx.m_completedCount.load(AtomicMemoryOrder::kAcquire) < problemSize; ++spinCount)
+	{
+		if(spinCount < 16)
+		{
+#if ANKI_SIMD_SSE
+			_mm_pause();
+#endif
+		}
+		else
+		{
+			std::this_thread::yield();
+			spinCount = 0;
+		}
+	}
+}
+
+template<typename TFunc>
+class ParallelForShared
+{
+public:
+	TFunc* m_func;
+
+	class Participant
+	{
+	public:
+		ParallelForShared& m_shared;
+
+		Participant(ParallelForShared& shared)
+			: m_shared(shared)
+		{
+		}
+
+		void run(U32 chunkBegin, U32 chunkEnd)
+		{
+			(*m_shared.m_func)(chunkBegin, chunkEnd);
+		}
+
+		void finalize()
+		{
+		}
+	};
+};
+
+template<typename T, typename TMapFunc, typename TReduceFunc>
+class ParallelReduceShared
+{
+public:
+	TMapFunc* m_mapFunc;
+	TReduceFunc* m_reduceFunc;
+	const T* m_identity;
+	T* m_result;
+	SpinLock m_mtx;
+
+	class Participant
+	{
+	public:
+		ParallelReduceShared& m_shared;
+		T m_partial;
+
+		Participant(ParallelReduceShared& shared)
+			: m_shared(shared)
+			, m_partial(*shared.m_identity)
+		{
+		}
+
+		void run(U32 chunkBegin, U32 chunkEnd)
+		{
+			m_partial = (*m_shared.m_reduceFunc)(m_partial, (*m_shared.m_mapFunc)(chunkBegin, chunkEnd));
+		}
+
+		void finalize()
+		{
+			LockGuard<SpinLock> lock(m_shared.m_mtx);
+			*m_shared.m_result = (*m_shared.m_reduceFunc)(*m_shared.m_result, m_partial);
+		}
+	};
+};
+
+} // end namespace detail
+
+/// Process the range [begin, end) in parallel using the threads of a ThreadHive. The range is split into chunks that
+/// start big and get smaller (but not smaller than grainSize) as the range is consumed. The calling thread processes
+/// chunks as well and the function returns when the whole range is processed. It's safe to call it from inside a
+/// ThreadHive task.
+/// @code
+/// parallelFor(hive, 0, particleCount, 64, [&](U32 begin, U32 end) {
+/// 	for(U32 i = begin; i < end; ++i)
+/// 	{
+/// 		simulate(particles[i]);
+/// 	}
+/// });
+/// @endcode
+/// @param func A functor with signature void(U32 chunkBegin, U32 chunkEnd).
+template<typename TFunc>
+void parallelFor(ThreadHive& hive, U32 begin, U32 end, U32 grainSize, TFunc func)
+{
+	detail::ParallelForShared<TFunc> shared;
+	shared.m_func = &func;
+	detail::runParallelFor(hive, begin, end, grainSize, shared);
+}
+
+/// Same as parallelFor but it also combines the results of the chunks.
+/// @param identity The identity value of the reduction (eg 0 for a sum).
+/// @param mapFunc A functor with signature T(U32 chunkBegin, U32 chunkEnd) that computes the result of a chunk.
+/// @param reduceFunc A functor with signature T(const T&, const T&). It should be associative and commutative since
+///                   the chunks are combined in no particular order.
+template<typename T, typename TMapFunc, typename TReduceFunc>
+T parallelReduce(ThreadHive& hive, U32 begin, U32 end, U32 grainSize, const T& identity, TMapFunc mapFunc,
+				 TReduceFunc reduceFunc)
+{
+	T result = identity;
+	detail::ParallelReduceShared<T, TMapFunc, TReduceFunc> shared;
+	shared.m_mapFunc = &mapFunc;
+	shared.m_reduceFunc = &reduceFunc;
+	shared.m_identity = &identity;
+	shared.m_result = &result;
+	detail::runParallelFor(hive, begin, end, grainSize, shared);
+	return result;
+}
+
+/// Visit forests of Hierarchy objects in parallel, one depth level at a time. The preFunc of a node is called after
+/// the preFunc of its parent and the postFunc of a node after the postFunc of all of its children. Nodes of the same
+/// level are processed in parallel so a single huge hierarchy scales as well as many small ones.
+/// @param roots The nodes without a parent.
+/// @param nodeCount The total number of nodes in all hierarchies (or an upper bound).
+/// @param tmpPool A thread-safe pool to allocate some temporary memory.
+/// @param preFunc A functor with signature Error(TNode&).
+/// @param postFunc A functor with signature Error(TNode&).
+/// @return The first error of preFunc or postFunc. On error the rest of the nodes might not be visited.
+template<typename TNode, typename TMemPool, typename TPreFunc, typename TPostFunc>
+Error parallelForHierarchy(ThreadHive& hive, ConstWeakArray<TNode*> roots, U32 nodeCount, U32 grainSize,
+						   TMemPool& tmpPool, TPreFunc preFunc, TPostFunc postFunc)
+{
+	ANKI_ASSERT(roots.getSize() <= nodeCount);
+	if(roots.getSize() == 0)
+	{
+		return Error::kNone;
+	}
+
+	// All nodes are stored in one array level after level
+	TNode** nodes = newArray<TNode*>(tmpPool, nodeCount);
+	memcpy(nodes, roots.getBegin(), roots.getSizeInBytes());
+	Atomic<U32> nodesEnd = {roots.getSize()};
+
+	DynamicArray<U32, MemoryPoolPtrWrapper<TMemPool>> levelStarts(&tmpPool);
+
+	Atomic<Bool> failed = {false};
+	Error firstErr = Error::kNone;
+	SpinLock firstErrMtx;
+	auto setError = [&](Error err) {
+		LockGuard<SpinLock> lock(firstErrMtx);
+		if(!firstErr)
+		{
+			firstErr = err;
+		}
+		failed.store(true);
+	};
+
+	// Top to bottom
+	U32 levelBegin = 0;
+	U32 levelEnd = roots.getSize();
+	while(levelBegin < levelEnd && !failed.load())
+	{
+		levelStarts.emplaceBack(levelBegin);
+
+		parallelFor(hive, levelBegin, levelEnd, grainSize, [&](U32 chunkBegin, U32 chunkEnd) {
+			U32 childCount = 0;
+			for(U32 i = chunkBegin; i < chunkEnd && !failed.load(); ++i)
+			{
+				const Error err = preFunc(*nodes[i]);
+				if(err)
+				{
+					setError(err);
+				}
+
+				childCount += nodes[i]->getChildrenCount();
+			}
+
+			if(childCount == 0 || failed.load())
+			{
+				return;
+			}
+
+			// Append the children to the next level
+			U32 outIdx = nodesEnd.fetchAdd(childCount);
+			ANKI_ASSERT(outIdx + childCount <= nodeCount && "nodeCount is wrong");
+			for(U32 i = chunkBegin; i < chunkEnd; ++i)
+			{
+				[[maybe_unused]] const Error err = nodes[i]->visitChildrenMaxDepth(0, [&](TNode& child) {
+					nodes[outIdx++] = &child;
+					return Error::kNone;
+				});
+			}
+		});
+
+		levelBegin = levelEnd;
+		levelEnd = nodesEnd.load();
+	}
+	levelStarts.emplaceBack(levelEnd);
+
+	// Bottom to top
+	for(U32 level = levelStarts.getSize() - 1; level-- > 0 && !failed.load();)
+	{
+		parallelFor(hive, levelStarts[level], levelStarts[level + 1], grainSize, [&](U32 chunkBegin, U32 chunkEnd) {
+			for(U32 i = chunkBegin; i < chunkEnd && !failed.load(); ++i)
+			{
+				const Error err = postFunc(*nodes[i]);
+				if(err)
+				{
+					setError(err);
+				}
+			}
+		});
+	}
+
+	deleteArray(tmpPool, nodes, nodeCount);
+	return firstErr;
+}
+/// @}
+
+} // end namespace anki
@@ -0,0 +1,262 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Util/ParallelFor.h>
+#include <AnKi/Util/WeakArray.h>
+
+namespace anki {
+
+/// @addtogroup util_containers
+/// @{
+
+/// An element of the arrays radixSortKeys() sorts. The index is usually the position of the element the key was
+/// generated from.
+template<typename TKey>
+class RadixSortPair
+{
+public:
+	TKey m_key;
+	U32 m_index;
+};
+
+/// Convert a float to an unsigned integer that has the same order as the float. Useful to generate keys for radix sort.
+inline U32 floatToRadixKey(F32 f)
+{
+	U32 u;
+	memcpy(&u, &f, sizeof(u));
+	// Negative floats: flip all the bits. Positive: flip the sign
+	return u ^ ((u >> 31u) ? kMaxU32 : 0x80000000u);
+}
+
+namespace detail {
+
+constexpr U32 kRadixSortDigitBits = 8;
+constexpr U32 kRadixSortBucketCount = 1u << kRadixSortDigitBits;
+constexpr U32 kRadixSortMinElementCount = 64; ///< Below that use insertion sort.
+constexpr U32 kRadixSortMinParallelElementCount = 16 * 1024; ///< Below that don't bother with the hive.
+constexpr U32 kRadixSortMaxBlockCount = 16;
+
+template<typename TKey>
+void insertionSort(WeakArray<RadixSortPair<TKey>> pairs)
+{
+	for(U32 i = 1; i < pairs.getSize(); ++i)
+	{
+		const RadixSortPair<TKey> pair = pairs[i];
+		U32 j = i;
+		while(j > 0 && pairs[j - 1].m_key > pair.m_key)
+		{
+			pairs[j] = pairs[j - 1];
+			--j;
+		}
+		pairs[j] = pair;
+	}
+}
+
+} // end namespace detail
+
+/// Sort (key, index) pairs in ascending key order. It's a stable LSD radix sort that processes 8 bits per pass. Passes
+/// where all keys have the same digit are skipped so keys with few significant bits are cheap to sort.
+/// @param[in,out] pairs The pairs to sort.
+/// @param scratch Temporary storage with the same size as pairs.
+/// @param hive If not nullptr big arrays will be sorted in parallel. It's safe to call it from inside a ThreadHive task.
+template<typename TKey>
+void radixSortKeys(WeakArray<RadixSortPair<TKey>> pairs, WeakArray<RadixSortPair<TKey>> scratch,
+				   ThreadHive* hive = nullptr)
+{
+	static_assert(std::is_unsigned_v<TKey>, "Only unsigned keys are supported");
+	using namespace detail;
+	using Pair = RadixSortPair<TKey>;
+
+	const U32 count = pairs.getSize();
+	ANKI_ASSERT(scratch.getSize() >= count);
+
+	if(count < kRadixSortMinElementCount)
+	{
+		insertionSort(pairs);
+		return;
+	}
+
+	// Split the array into fixed blocks. Every block is processed by one thread and the blocks are scattered in order
+	// so the sort stays stable
+	const U32 blockCount = (hive && count >= kRadixSortMinParallelElementCount)
+							   ? min(kRadixSortMaxBlockCount, hive->getThreadCount() + 1)
+							   : 1;
+	const U32 blockSize = (count + blockCount - 1) / blockCount;
+
+	Array2d<U32, kRadixSortMaxBlockCount, kRadixSortBucketCount> offsets;
+
+	auto forEachBlock = [&](auto func) {
+		if(blockCount == 1)
+		{
+			func(0);
+		}
+		else
+		{
+			parallelFor(*hive, 0, blockCount, 1, [&](U32 begin, U32 end) {
+				for(U32 block = begin; block < end; ++block)
+				{
+					func(block);
+				}
+			});
+		}
+	};
+
+	// When there is a single block the histograms of all passes can be computed with a single read of the keys
+	constexpr U32 kPassCount = sizeof(TKey) * 8 / kRadixSortDigitBits;
+	Array2d<U32, kPassCount, kRadixSortBucketCount> serialHistograms;
+	if(blockCount == 1)
+	{
+		memset(&serialHistograms[0][0], 0, sizeof(serialHistograms));
+		for(U32 i = 0; i < count; ++i)
+		{
+			TKey key = pairs[i].m_key;
+			for(U32 pass = 0; pass < kPassCount; ++pass)
+			{
+				++serialHistograms[pass][key & (kRadixSortBucketCount - 1)];
+				key >>= kRadixSortDigitBits;
+			}
+		}
+	}
+
+	Pair* src = pairs.getBegin();
+	Pair* dst = scratch.getBegin();
+	for(U32 pass = 0; pass < kPassCount; ++pass)
+	{
+		const U32 shift = pass * kRadixSortDigitBits;
+
+		// Histogram of every block
+		if(blockCount == 1)
+		{
+			offsets[0] = serialHistograms[pass];
+		}
+		else
+		{
+			forEachBlock([&](U32 block) {
+				Array<U32, kRadixSortBucketCount>& hist = offsets[block];
+				memset(&hist[0], 0, sizeof(hist));
+
+				const U32 end = min(count, (block + 1) * blockSize);
+				for(U32 i = block * blockSize; i < end; ++i)
+				{
+					++hist[(src[i].m_key >> shift) & (kRadixSortBucketCount - 1)];
+				}
+			});
+		}
+
+		// Prefix sum. Buckets first and blocks second
+		U32 sum = 0;
+		Bool skipPass = false;
+		for(U32 bucket = 0; bucket < kRadixSortBucketCount; ++bucket)
+		{
+			U32 bucketCount = 0;
+			for(U32 block = 0; block < blockCount; ++block)
+			{
+				const U32 c = offsets[block][bucket];
+				offsets[block][bucket] = sum;
+				sum += c;
+				bucketCount += c;
+			}
+
+			if(bucketCount == count)
+			{
+				// All keys have the same digit, nothing to do
+				skipPass = true;
+				break;
+			}
+		}
+
+		if(skipPass)
+		{
+			continue;
+		}
+
+		// Scatter
+		forEachBlock([&](U32 block) {
+			Array<U32, kRadixSortBucketCount>& offs = offsets[block];
+
+			const U32 end = min(count, (block + 1) * blockSize);
+			for(U32 i = block * blockSize; i < end; ++i)
+			{
+				dst[offs[(src[i].m_key >> shift) & (kRadixSortBucketCount - 1)]++] = src[i];
+			}
+		});
+
+		std::swap(src, dst);
+	}
+
+	if(src != pairs.getBegin())
+	{
+		memcpy(pairs.getBegin(), src, pairs.getSizeInBytes());
+	}
+}
+
+/// Sort an array of elements in ascending order of an unsigned integer key. It's stable. The keys are sorted using
+/// radixSortKeys() and the elements are moved only once at the end so it's cheap for big elements as well.
+/// @param[in,out] elements The elements to sort. They should be trivially destructible.
+/// @param tmpPool A pool to allocate some temporary memory.
+/// @param hive If not nullptr big arrays will be sorted in parallel.
+/// @param getKey A functor with signature TKey(const T&). TKey is an unsigned integer.
+template<typename T, typename TMemPool, typename TGetKeyFunc>
+void radixSort(WeakArray<T> elements, TMemPool& tmpPool, ThreadHive* hive, TGetKeyFunc getKey)
+{
+	static_assert(std::is_trivially_destructible_v<T>, "The temporary copies of the elements are not destroyed");
+	using Key = decltype(getKey(elements[0]));
+	using Pair = RadixSortPair<Key>;
+
+	const U32 count = elements.getSize();
+	if(count <= 1)
+	{
+		return;
+	}
+
+	Pair* pairs = static_cast<Pair*>(tmpPool.allocate(sizeof(Pair) * count * 2, alignof(Pair)));
+	T* tmpElements = static_cast<T*>(tmpPool.allocate(sizeof(T) * count, alignof(T)));
+
+	// Generate the keys and copy the elements at the same time
+	auto generateKeys = [&](U32 begin, U32 end) {
+		for(U32 i = begin; i < end; ++i)
+		{
+			pairs[i].m_key = getKey(elements[i]);
+			pairs[i].m_index = i;
+			::new(&tmpElements[i]) T(elements[i]);
+		}
+	};
+
+	if(hive && count >= detail::kRadixSortMinParallelElementCount)
+	{
+		parallelFor(*hive, 0, count, 1024, generateKeys);
+	}
+	else
+	{
+		generateKeys(0, count);
+	}
+
+	radixSortKeys(WeakArray<Pair>(pairs, count), WeakArray<Pair>(pairs + count, count), hive);
+
+	// Move the elements to their final place
+	auto gather = [&](U32 begin, U32 end) {
+		for(U32 i = begin; i < end; ++i)
+		{
+			elements[i] = tmpElements[pairs[i].m_index];
+		}
+	};
+
+	if(hive && count >= detail::kRadixSortMinParallelElementCount)
+	{
+		parallelFor(*hive, 0, count, 1024, gather);
+	}
+	else
+	{
+		gather(0, count);
+	}
+
+	tmpPool.free(tmpElements);
+	tmpPool.free(pairs);
+}
+/// @}
+
+} // end namespace anki
@@ -11,6 +11,7 @@
 namespace anki {
 
 Atomic<U32> ThreadHive::m_uuid = {0};
+thread_local ThreadHive::Thread* ThreadHive::m_threadTls = nullptr;
 
 #define ANKI_ENABLE_HIVE_DEBUG_PRINT 0
 
@@ -27,13 +28,24 @@ public:
 	anki::Thread m_thread; ///< Runs the workingFunc
 	ThreadHive* m_hive;
 
+	/// @name Work-stealing deque. The owner pushes and pops at the tail, thieves steal from the head.
+	/// @{
+	Task* m_dequeHead = nullptr;
+	Task* m_dequeTail = nullptr;
+	SpinLock m_dequeMtx;
+	/// @}
+
 	/// Constructor
-	Thread(U32 id, ThreadHive* hive, Bool pinToCore, CString threadName)
+	Thread(U32 id, ThreadHive* hive, CString threadName)
 		: m_id(id)
 		, m_thread(threadName.cstr())
 		, m_hive(hive)
 	{
 		ANKI_ASSERT(hive);
+	}
+
+	void start(Bool pinToCore)
+	{
 		m_thread.start(this, threadCallback, ThreadCoreAffinityMask(false).set(m_id, pinToCore));
 	}
 
@@ -43,7 +55,17 @@ private:
 	{
 		Thread& self = *static_cast<Thread*>(info.m_userData);
 
-		self.m_hive->threadRun(self.m_id);
+		if(self.m_hive->m_mode == ThreadHiveMode::kWorkStealing)
+		{
+			m_threadTls = &self;
+			self.m_hive->threadRunWorkStealing(self);
+			m_threadTls = nullptr;
+		}
+		else
+		{
+			self.m_hive->threadRun(self.m_id);
+		}
+
 		return Error::kNone;
 	}
 };
@@ -52,6 +74,7 @@ class ThreadHive::Task
 {
 public:
 	Task* m_next; ///< Next in the list.
+	Task* m_prev; ///< Previous in the list. Only used by the work-stealing deques.
 
 	ThreadHiveTaskCallback m_cb; ///< Callback that defines the task.
 	void* m_arg; ///< Args for the callback.
@@ -60,9 +83,10 @@ public:
 	ThreadHiveSemaphore* m_signalSemaphore;
 };
 
-ThreadHive::ThreadHive(U32 threadCount, Bool pinToCores)
+ThreadHive::ThreadHive(U32 threadCount, Bool pinToCores, ThreadHiveMode mode)
 	: m_pool(stackPoolAllocate, nullptr, 4_KB)
 	, m_threadCount(threadCount)
+	, m_mode(mode)
 {
 	m_threads =
 		static_cast<Thread*>(DefaultMemoryPool::getSingleton().allocate(sizeof(Thread) * threadCount, alignof(Thread)));
@@ -73,7 +97,13 @@ ThreadHive::ThreadHive(U32 threadCount, Bool pinToCores)
 	{
 		Array<Char, 32> threadName;
 		snprintf(&threadName[0], threadName.getSize(), "Hive#%u/#%u", uuid, i);
-		::new(&m_threads[i]) Thread(i, this, pinToCores, &threadName[0]);
+		::new(&m_threads[i]) Thread(i, this, &threadName[0]);
+	}
+
+	// Start the threads after all of them are constructed since the work-stealing threads access each other
+	for(U32 i = 0; i < threadCount; ++i)
+	{
+		m_threads[i].start(pinToCores);
 	}
 }
 
@@ -109,44 +139,50 @@ void ThreadHive::submitTasks(ThreadHiveTask* tasks, const U32 taskCount)
 	Task* const htasks = newArray<Task>(m_pool, taskCount);
 
 	// Initialize tasks
-	Task* prevTask = nullptr;
 	for(U32 i = 0; i < taskCount; ++i)
 	{
 		const ThreadHiveTask& inTask = tasks[i];
 		Task& outTask = htasks[i];
 
 		outTask.m_next = nullptr;
+		outTask.m_prev = nullptr;
 		outTask.m_cb = inTask.m_callback;
 		outTask.m_arg = inTask.m_argument;
 		outTask.m_waitSemaphore = inTask.m_waitSemaphore;
 		outTask.m_signalSemaphore = inTask.m_signalSemaphore;
+	}
 
-		// Connect tasks
-		if(prevTask)
-		{
-			prevTask->m_next = &outTask;
-		}
-		prevTask = &outTask;
+	if(m_mode == ThreadHiveMode::kWorkStealing)
+	{
+		submitTasksWorkStealing(htasks, taskCount);
+		return;
 	}
 
 	// Push work
 	{
 		LockGuard<Mutex> lock(m_mtx);
 
-		if(m_head != nullptr)
-		{
-			ANKI_ASSERT(m_tail && m_head);
-			m_tail->m_next = &htasks[0];
-			m_tail = &htasks[taskCount - 1];
-		}
-		else
+		// Count all of them as pending before some get parked and potentially released by another thread
+		m_pendingTasks += taskCount;
+
+		for(U32 i = 0; i < taskCount; ++i)
 		{
-			ANKI_ASSERT(m_tail == nullptr);
-			m_head = &htasks[0];
-			m_tail = &htasks[taskCount - 1];
-		}
+			Task& task = htasks[i];
+			if(parkTask(task))
+			{
+				continue;
+			}
 
-		m_pendingTasks += taskCount;
+			if(m_tail)
+			{
+				m_tail->m_next = &task;
+			}
+			else
+			{
+				m_head = &task;
+			}
+			m_tail = &task;
+		}
 
 		ANKI_HIVE_DEBUG_PRINT("submit tasks\n");
 	}
@@ -158,8 +194,9 @@ void ThreadHive::submitTasks(ThreadHiveTask* tasks, const U32 taskCount)
 void ThreadHive::threadRun(U32 threadId)
 {
 	Task* task = nullptr;
+	Task* releasedTasks = nullptr;
 
-	while(!waitForWork(threadId, task))
+	while(!waitForWork(threadId, task, releasedTasks))
 	{
 		// Run the task
 		ANKI_ASSERT(task && task->m_cb);
@@ -172,18 +209,24 @@ void ThreadHive::threadRun(U32 threadId)
 #endif
 
 		// Signal the semaphore as early as possible
+		releasedTasks = nullptr;
 		if(task->m_signalSemaphore)
 		{
-			[[maybe_unused]] const U32 out = task->m_signalSemaphore->m_atomic.fetchSub(1);
+			const U32 out = task->m_signalSemaphore->m_atomic.fetchSub(1, AtomicMemoryOrder::kAcqRel);
 			ANKI_ASSERT(out > 0u);
 			ANKI_HIVE_DEBUG_PRINT("\tsem is %u\n", out - 1u);
+
+			if(out == 1)
+			{
+				releasedTasks = takeWaitingTasks(*task->m_signalSemaphore);
+			}
 		}
 	}
 
 	ANKI_HIVE_DEBUG_PRINT("tid: %lu thread quits!\n", threadId);
 }
 
-Bool ThreadHive::waitForWork([[maybe_unused]] U32 threadId, Task*& task)
+Bool ThreadHive::waitForWork([[maybe_unused]] U32 threadId, Task*& task, Task* releasedTasks)
 {
 	LockGuard<Mutex> lock(m_mtx);
 
@@ -194,9 +237,28 @@ Bool ThreadHive::waitForWork([[maybe_unused]] U32 threadId, Task*& task)
 	{
 		--m_pendingTasks;
 
-		if(task->m_signalSemaphore || m_pendingTasks == 0)
+		// Append the tasks that became ready
+		while(releasedTasks)
 		{
-			// A dependency maybe got resolved or we are out of tasks. Wake them all
+			Task* next = releasedTasks->m_next;
+			releasedTasks->m_next = nullptr;
+
+			if(m_tail)
+			{
+				m_tail->m_next = releasedTasks;
+			}
+			else
+			{
+				m_head = releasedTasks;
+			}
+			m_tail = releasedTasks;
+
+			releasedTasks = next;
+		}
+
+		if(m_head || m_pendingTasks == 0)
+		{
+			// Some dependencies got resolved or we are out of tasks. Wake them all
 			ANKI_HIVE_DEBUG_PRINT("tid: %lu wake all\n", threadId);
 			m_cvar.notifyAll();
 		}
@@ -215,56 +277,315 @@ Bool ThreadHive::waitForWork([[maybe_unused]] U32 threadId, Task*& task)
 
 ThreadHive::Task* ThreadHive::getNewTask()
 {
-	Task* prevTask = nullptr;
+	// All tasks in the list are ready, the ones with unresolved dependencies are parked in their semaphores
 	Task* task = m_head;
-	while(task)
+	if(task)
+	{
+		m_head = task->m_next;
+		if(m_head == nullptr)
+		{
+			m_tail = nullptr;
+		}
+
+#if ANKI_EXTRA_CHECKS
+		task->m_next = nullptr;
+#endif
+	}
+
+	return task;
+}
+
+Bool ThreadHive::parkTask(Task& task)
+{
+	ThreadHiveSemaphore* sem = task.m_waitSemaphore;
+	if(sem == nullptr || sem->m_atomic.load(AtomicMemoryOrder::kAcquire) == 0)
+	{
+		return false;
+	}
+
+	LockGuard<SpinLock> lock(sem->m_waitingTasksMtx);
+
+	// Check again while holding the lock. The thread that zeroes the semaphore will take the same lock after it
+	// decrements it
+	if(sem->m_atomic.load(AtomicMemoryOrder::kAcquire) == 0)
+	{
+		return false;
+	}
+
+	task.m_next = sem->m_waitingTasksHead;
+	sem->m_waitingTasksHead = &task;
+	return true;
+}
+
+ThreadHive::Task* ThreadHive::takeWaitingTasks(ThreadHiveSemaphore& sem)
+{
+	ANKI_ASSERT(sem.m_atomic.load() == 0);
+
+	LockGuard<SpinLock> lock(sem.m_waitingTasksMtx);
+	Task* head = sem.m_waitingTasksHead;
+	sem.m_waitingTasksHead = nullptr;
+	return head;
+}
+
+void ThreadHive::waitAllTasks()
+{
+	if(m_mode == ThreadHiveMode::kWorkStealing)
+	{
+		waitAllTasksWorkStealing();
+		return;
+	}
+
+	ANKI_HIVE_DEBUG_PRINT("mt: waiting all\n");
+
+	LockGuard<Mutex> lock(m_mtx);
+	while(m_pendingTasks > 0)
+	{
+		m_cvar.wait(m_mtx);
+	}
+
+	m_head = nullptr;
+	m_tail = nullptr;
+	m_pool.reset();
+
+	ANKI_HIVE_DEBUG_PRINT("mt: done waiting all\n");
+}
+
+void ThreadHive::submitTasksWorkStealing(Task* tasks, U32 taskCount)
+{
+	// Count them as pending before they become visible to the other threads
+	m_pendingTaskCount.fetchAdd(taskCount, AtomicMemoryOrder::kSeqCst);
+
+	// Park the tasks with unresolved dependencies and gather the rest
+	Task* readyHead = nullptr;
+	Task* readyTail = nullptr;
+	U32 readyCount = 0;
+	for(U32 i = 0; i < taskCount; ++i)
+	{
+		Task& task = tasks[i];
+		if(parkTask(task))
+		{
+			continue;
+		}
+
+		task.m_prev = readyTail;
+		if(readyTail)
+		{
+			readyTail->m_next = &task;
+		}
+		else
+		{
+			readyHead = &task;
+		}
+		readyTail = &task;
+		++readyCount;
+	}
+
+	if(readyCount)
+	{
+		// If the submission comes from one of the hive's threads push to its deque, else spread the work
+		Thread* thread = m_threadTls;
+		if(thread == nullptr || thread->m_hive != this)
+		{
+			thread = &m_threads[m_nextThreadToFeed.fetchAdd(1) % m_threadCount];
+		}
+
+		pushReadyTasks(*thread, readyHead, readyTail, readyCount);
+	}
+}
+
+void ThreadHive::pushReadyTasks(Thread& thread, Task* first, Task* last, U32 taskCount)
+{
+	ANKI_ASSERT(first && last && taskCount > 0);
+
 	{
-		// Check if there are dependencies
-		const Bool allDepsCompleted = task->m_waitSemaphore == nullptr || task->m_waitSemaphore->m_atomic.load() == 0;
+		LockGuard<SpinLock> lock(thread.m_dequeMtx);
 
-		if(allDepsCompleted)
+		first->m_prev = thread.m_dequeTail;
+		if(thread.m_dequeTail)
+		{
+			thread.m_dequeTail->m_next = first;
+		}
+		else
+		{
+			thread.m_dequeHead = first;
+		}
+		thread.m_dequeTail = last;
+	}
+
+	// Increment after pushing. The counter is only a hint for the sleeping threads so it's OK to go negative for a
+	// while if someone steals the tasks before the increment
+	m_readyTaskCount.fetchAdd(I32(taskCount), AtomicMemoryOrder::kSeqCst);
+
+	// Wake only as many threads as needed. The sleepers increment the counter before checking m_readyTaskCount so one
+	// of the two sides will always see the other
+	const U32 sleepingCount = m_sleepingThreadCount.load(AtomicMemoryOrder::kSeqCst);
+	if(sleepingCount > 0)
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		if(taskCount >= sleepingCount)
+		{
+			m_cvar.notifyAll();
+		}
+		else
 		{
-			// Found something, pop it
-			if(prevTask)
+			for(U32 i = 0; i < taskCount; ++i)
 			{
-				prevTask->m_next = task->m_next;
+				m_cvar.notifyOne();
 			}
+		}
+	}
+}
 
-			if(m_head == task)
+ThreadHive::Task* ThreadHive::popOrStealTask(Thread& thread)
+{
+	Task* task = nullptr;
+
+	// First try our own deque
+	{
+		LockGuard<SpinLock> lock(thread.m_dequeMtx);
+		task = thread.m_dequeTail;
+		if(task)
+		{
+			thread.m_dequeTail = task->m_prev;
+			if(thread.m_dequeTail)
 			{
-				m_head = task->m_next;
+				thread.m_dequeTail->m_next = nullptr;
 			}
+			else
+			{
+				thread.m_dequeHead = nullptr;
+			}
+		}
+	}
+
+	// Then steal the oldest task of some other thread
+	for(U32 i = 1; i < m_threadCount && task == nullptr; ++i)
+	{
+		Thread& victim = m_threads[(thread.m_id + i) % m_threadCount];
 
-			if(m_tail == task)
+		LockGuard<SpinLock> lock(victim.m_dequeMtx);
+		task = victim.m_dequeHead;
+		if(task)
+		{
+			victim.m_dequeHead = task->m_next;
+			if(victim.m_dequeHead)
+			{
+				victim.m_dequeHead->m_prev = nullptr;
+			}
+			else
 			{
-				m_tail = prevTask;
+				victim.m_dequeTail = nullptr;
 			}
 
+			ANKI_HIVE_DEBUG_PRINT("tid: %u stole from %u\n", thread.m_id, victim.m_id);
+		}
+	}
+
+	if(task)
+	{
+		m_readyTaskCount.fetchSub(1, AtomicMemoryOrder::kSeqCst);
+#if ANKI_EXTRA_CHECKS
+		task->m_next = nullptr;
+		task->m_prev = nullptr;
+#endif
+	}
+
+	return task;
+}
+
+ThreadHive::Task* ThreadHive::waitForWorkWorkStealing(Thread& thread)
+{
+	while(true)
+	{
+		Task* task = popOrStealTask(thread);
+		if(task)
+		{
+			return task;
+		}
+
+		LockGuard<Mutex> lock(m_mtx);
+
+		m_sleepingThreadCount.fetchAdd(1, AtomicMemoryOrder::kSeqCst);
+		while(!m_quit && m_readyTaskCount.load(AtomicMemoryOrder::kSeqCst) <= 0)
+		{
+			ANKI_HIVE_DEBUG_PRINT("tid: %u waiting\n", thread.m_id);
+			m_cvar.wait(m_mtx);
+		}
+		m_sleepingThreadCount.fetchSub(1, AtomicMemoryOrder::kSeqCst);
+
+		if(m_quit)
+		{
+			return nullptr;
+		}
+	}
+}
+
+void ThreadHive::threadRunWorkStealing(Thread& thread)
+{
+	Task* task;
+	while((task = waitForWorkWorkStealing(thread)) != nullptr)
+	{
+		ANKI_ASSERT(task->m_cb);
+		task->m_cb(task->m_arg, thread.m_id, *this, task->m_signalSemaphore);
+
 #if ANKI_EXTRA_CHECKS
-			task->m_next = nullptr;
+		task->m_cb = nullptr;
 #endif
-			break;
+
+		if(task->m_signalSemaphore)
+		{
+			const U32 out = task->m_signalSemaphore->m_atomic.fetchSub(1, AtomicMemoryOrder::kAcqRel);
+			ANKI_ASSERT(out > 0u);
+
+			if(out == 1)
+			{
+				releaseWaitingTasks(*task->m_signalSemaphore, thread);
+			}
 		}
 
-		prevTask = task;
-		task = task->m_next;
+		// The dependents (if any) are already in the deques and counted as pending so this can't reach zero early
+		if(m_pendingTaskCount.fetchSub(1, AtomicMemoryOrder::kSeqCst) == 1)
+		{
+			LockGuard<Mutex> lock(m_mtx);
+			m_waitAllCvar.notifyAll();
+		}
 	}
 
-	return task;
+	ANKI_HIVE_DEBUG_PRINT("tid: %u thread quits!\n", thread.m_id);
 }
 
-void ThreadHive::waitAllTasks()
+void ThreadHive::releaseWaitingTasks(ThreadHiveSemaphore& sem, Thread& thread)
+{
+	Task* readyHead = takeWaitingTasks(sem);
+	if(readyHead == nullptr)
+	{
+		return;
+	}
+
+	// Connect the previous pointers that the deques need
+	Task* readyTail = readyHead;
+	readyHead->m_prev = nullptr;
+	U32 readyCount = 1;
+	while(readyTail->m_next)
+	{
+		readyTail->m_next->m_prev = readyTail;
+		readyTail = readyTail->m_next;
+		++readyCount;
+	}
+
+	pushReadyTasks(thread, readyHead, readyTail, readyCount);
+}
+
+void ThreadHive::waitAllTasksWorkStealing()
 {
 	ANKI_HIVE_DEBUG_PRINT("mt: waiting all\n");
 
 	LockGuard<Mutex> lock(m_mtx);
-	while(m_pendingTasks > 0)
+	while(m_pendingTaskCount.load(AtomicMemoryOrder::kSeqCst) > 0)
 	{
-		m_cvar.wait(m_mtx);
+		m_waitAllCvar.wait(m_mtx);
 	}
 
-	m_head = nullptr;
-	m_tail = nullptr;
 	m_pool.reset();
 
 	ANKI_HIVE_DEBUG_PRINT("mt: done waiting all\n");
@@ -13,31 +13,11 @@ namespace anki {
 
 // Forward
 class ThreadHive;
+class ThreadHiveSemaphore;
 
 /// @addtogroup util_thread
 /// @{
 
-/// Opaque handle that defines a ThreadHive depedency. @memberof ThreadHive
-class ThreadHiveSemaphore
-{
-	friend class ThreadHive;
-
-public:
-	/// Increase the value of the semaphore. It's easy to brake things with that.
-	/// @note It's thread-safe.
-	void increaseSemaphore(U32 increase)
-	{
-		m_atomic.fetchAdd(increase);
-	}
-
-private:
-	Atomic<U32> m_atomic;
-
-	// No need to construct it or delete it
-	ThreadHiveSemaphore() = delete;
-	~ThreadHiveSemaphore() = delete;
-};
-
 /// The callback that defines a ThreadHibe task.
 /// @memberof ThreadHive
 using ThreadHiveTaskCallback = void (*)(void* userData, U32 threadId, ThreadHive& hive,
@@ -72,15 +52,28 @@ public:
 			argument_, waitSemaphore_, signalSemaphore_ \
 	}
 
+/// The scheduling policy of a ThreadHive. @memberof ThreadHive
+enum class ThreadHiveMode : U8
+{
+	/// All tasks live in a single list that is guarded by a mutex. Every submission wakes all threads.
+	kSharedQueue,
+
+	/// Every thread owns a deque of ready tasks. Threads pop from their own deque (LIFO) and steal from the deques of
+	/// others (FIFO) when they run out of work. Only the necessary number of sleeping threads are woken up.
+	kWorkStealing
+};
+
 /// A scheduler of small tasks. It takes a number of tasks and schedules them in one of the threads. The tasks can
 /// depend on previously submitted tasks or be completely independent.
 class ThreadHive
 {
+	friend class ThreadHiveSemaphore;
+
 public:
 	static constexpr U32 kMaxThreads = 32;
 
 	/// Create the hive.
-	ThreadHive(U32 threadCount, Bool pinToCores = false);
+	ThreadHive(U32 threadCount, Bool pinToCores = false, ThreadHiveMode mode = ThreadHiveMode::kSharedQueue);
 
 	ThreadHive(const ThreadHive&) = delete; // Non-copyable
 
@@ -93,17 +86,15 @@ public:
 		return m_threadCount;
 	}
 
-	/// Create a new semaphore with some initial value.
-	/// @param initialValue Can't be zero.
-	ThreadHiveSemaphore* newSemaphore(const U32 initialValue)
+	ThreadHiveMode getMode() const
 	{
-		ANKI_ASSERT(initialValue > 0);
-		ThreadHiveSemaphore* sem = static_cast<ThreadHiveSemaphore*>(
-			m_pool.allocate(sizeof(ThreadHiveSemaphore), alignof(ThreadHiveSemaphore)));
-		sem->m_atomic.setNonAtomically(initialValue);
-		return sem;
+		return m_mode;
 	}
 
+	/// Create a new semaphore with some initial value.
+	/// @param initialValue Can't be zero.
+	ThreadHiveSemaphore* newSemaphore(const U32 initialValue);
+
 	/// Allocate some scratch memory. The memory becomes invalid after waitAllTasks() is called.
 	void* allocateScratchMemory(PtrSize size, U32 alignment)
 	{
@@ -139,6 +130,7 @@ private:
 	StackMemoryPool m_pool;
 	Thread* m_threads = nullptr;
 	U32 m_threadCount = 0;
+	ThreadHiveMode m_mode = ThreadHiveMode::kSharedQueue;
 
 	Task* m_head = nullptr; ///< Head of the task list.
 	Task* m_tail = nullptr; ///< Tail of the task list.
@@ -148,16 +140,56 @@ private:
 	Mutex m_mtx;
 	ConditionVariable m_cvar;
 
+	/// @name Work-stealing members
+	/// @{
+	Atomic<U32> m_pendingTaskCount = {0}; ///< Submitted but not completed tasks.
+	Atomic<I32> m_readyTaskCount = {0}; ///< Approximate number of tasks sitting in the deques.
+	Atomic<U32> m_sleepingThreadCount = {0};
+	Atomic<U32> m_nextThreadToFeed = {0}; ///< Round-robin counter for tasks submitted from outside the hive.
+
+	ConditionVariable m_waitAllCvar; ///< Used by waitAllTasks() to wait for m_pendingTaskCount to reach zero.
+
+	static thread_local Thread* m_threadTls; ///< The hive thread that is running in this OS thread.
+	/// @}
+
 	static Atomic<U32> m_uuid;
 
 	void threadRun(U32 threadId);
 
 	/// Wait for more tasks.
-	Bool waitForWork(U32 threadId, Task*& task);
+	/// @param[in,out] task The task that was just completed. On return it's the new task.
+	/// @param releasedTasks Tasks whose dependencies got resolved by the completed task.
+	Bool waitForWork(U32 threadId, Task*& task, Task* releasedTasks);
 
 	/// Get new work from the queue.
 	Task* getNewTask();
 
+	/// Park the task in its wait semaphore if the semaphore is not zero.
+	/// @return True if the task got parked.
+	static Bool parkTask(Task& task);
+
+	/// Take all the tasks that wait on a semaphore that reached zero.
+	/// @return A list of tasks connected with Task::m_next.
+	static Task* takeWaitingTasks(ThreadHiveSemaphore& sem);
+
+	void submitTasksWorkStealing(Task* tasks, U32 taskCount);
+
+	void threadRunWorkStealing(Thread& thread);
+
+	/// Wait for a ready task. Returns nullptr when the hive is quitting.
+	Task* waitForWorkWorkStealing(Thread& thread);
+
+	/// Pop from the thread's deque or steal from another.
+	Task* popOrStealTask(Thread& thread);
+
+	/// Push a list of ready tasks to the deque of a thread and wake some sleeping threads.
+	void pushReadyTasks(Thread& thread, Task* first, Task* last, U32 taskCount);
+
+	/// Move the tasks that wait on a semaphore that reached zero to the deque of the thread.
+	void releaseWaitingTasks(ThreadHiveSemaphore& sem, Thread& thread);
+
+	void waitAllTasksWorkStealing();
+
 	static void* stackPoolAllocate([[maybe_unused]] void* userData, void* ptr, PtrSize size, PtrSize alignment)
 	{
 		if(ptr)
@@ -171,6 +203,42 @@ private:
 		}
 	}
 };
+
+/// Opaque handle that defines a ThreadHive depedency. The tasks that wait on the semaphore are parked in it and they are
+/// released by the task that brings the value to zero. @memberof ThreadHive
+class ThreadHiveSemaphore
+{
+	friend class ThreadHive;
+
+public:
+	/// Increase the value of the semaphore. It's easy to brake things with that.
+	/// @note It's thread-safe.
+	void increaseSemaphore(U32 increase)
+	{
+		m_atomic.fetchAdd(increase);
+	}
+
+private:
+	Atomic<U32> m_atomic;
+
+	ThreadHive::Task* m_waitingTasksHead = nullptr; ///< Tasks that wait for the semaphore to reach zero.
+	SpinLock m_waitingTasksMtx;
+
+	// No need to delete it
+	ThreadHiveSemaphore(U32 initialValue)
+		: m_atomic(initialValue)
+	{
+	}
+
+	~ThreadHiveSemaphore() = delete;
+};
+
+inline ThreadHiveSemaphore* ThreadHive::newSemaphore(const U32 initialValue)
+{
+	ANKI_ASSERT(initialValue > 0);
+	void* mem = m_pool.allocate(sizeof(ThreadHiveSemaphore), alignof(ThreadHiveSemaphore));
+	return ::new(mem) ThreadHiveSemaphore(initialValue);
+}
 /// @}
 
 } // end namespace anki
@@ -7,9 +7,83 @@
 #include <AnKi/Util/HighRezTimer.h>
 #include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/List.h>
+#include <AnKi/Util/File.h>
 
 namespace anki {
 
+/// The max size of an encoded record. 3 varints.
+constexpr U32 kMaxRecordSize = 3 * 10;
+
+static U8* writeVarint(U8* out, U64 value)
+{
+	while(value >= 0x80)
+	{
+		*out++ = U8(value | 0x80);
+		value >>= 7;
+	}
+
+	*out++ = U8(value);
+	return out;
+}
+
+static U64 zigzagEncode(I64 value)
+{
+	return (U64(value) << 1) ^ U64(value >> 63);
+}
+
+static I64 zigzagDecode(U64 value)
+{
+	return I64(value >> 1) ^ -I64(value & 1);
+}
+
+/// Helper to read a flight recorder dump.
+class TracerDumpReader
+{
+public:
+	const U8* m_ptr = nullptr;
+	const U8* m_end = nullptr;
+
+	template<typename T>
+	Bool read(T& out)
+	{
+		if(m_ptr + sizeof(T) > m_end)
+		{
+			return false;
+		}
+
+		memcpy(&out, m_ptr, sizeof(T));
+		m_ptr += sizeof(T);
+		return true;
+	}
+
+	Bool readVarint(U64& out)
+	{
+		out = 0;
+		for(U32 shift = 0; shift < 64 && m_ptr < m_end; shift += 7)
+		{
+			const U8 byte = *m_ptr++;
+			out |= U64(byte & 0x7F) << shift;
+			if((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+/// A block of the ring buffer of the flight recorder. The records are 3 varints: (nameId << 1 | isCounter), the
+/// zigzag encoded delta of the time from the previous record and the duration in ns or the counter value.
+class Tracer::RingBlock
+{
+public:
+	U64 m_baseTime; ///< The time of the 1st record in ns.
+	U64 m_prevTime; ///< The time of the last record in ns.
+	U32 m_size;
+	Array<U8, kRingBlockSize> m_data;
+};
+
 class Tracer::Chunk : public IntrusiveListEnabled<Chunk>
 {
 public:
@@ -28,6 +102,12 @@ public:
 	Chunk* m_currentChunk = nullptr;
 	IntrusiveList<Chunk> m_allChunks;
 	SpinLock m_currentChunkLock;
+
+	// Flight recorder. It's protected by m_currentChunkLock as well
+	RingBlock* m_ringBlocks = nullptr;
+	U32 m_crntRingBlock = 0;
+	Bool m_ringWrapped = false;
+	HashMap<const char*, U32> m_nameIds; ///< A cache of Tracer::m_nameIds. Only the thread touches it.
 };
 
 thread_local Tracer::ThreadLocal* Tracer::m_threadLocal = nullptr;
@@ -37,8 +117,22 @@ Tracer::~Tracer()
 	LockGuard<Mutex> lock(m_allThreadLocalMtx);
 	for(ThreadLocal* tlocal : m_allThreadLocal)
 	{
+		if(tlocal->m_ringBlocks)
+		{
+			deleteArray(DefaultMemoryPool::getSingleton(), tlocal->m_ringBlocks, m_ringBlockCount);
+		}
+
 		deleteInstance(DefaultMemoryPool::getSingleton(), tlocal);
 	}
+
+	// At least this thread can create a new Tracer
+	m_threadLocal = nullptr;
+}
+
+void Tracer::setFlightRecorder(PtrSize ringBufferSize)
+{
+	ANKI_ASSERT(m_allThreadLocal.getSize() == 0 && "Should be called before any tracing");
+	m_ringBlockCount = (ringBufferSize) ? max<U32>(2, U32(ringBufferSize / kRingBlockSize)) : 0;
 }
 
 Tracer::ThreadLocal& Tracer::getThreadLocal()
@@ -50,6 +144,15 @@ Tracer::ThreadLocal& Tracer::getThreadLocal()
 		out->m_tid = Thread::getCurrentThreadId();
 		m_threadLocal = out;
 
+		if(m_ringBlockCount)
+		{
+			out->m_ringBlocks = newArray<RingBlock>(DefaultMemoryPool::getSingleton(), m_ringBlockCount);
+			for(U32 i = 0; i < m_ringBlockCount; ++i)
+			{
+				out->m_ringBlocks[i].m_size = 0;
+			}
+		}
+
 		// Store it
 		LockGuard<Mutex> lock(m_allThreadLocalMtx);
 		m_allThreadLocal.emplaceBack(out);
@@ -79,6 +182,68 @@ Tracer::Chunk& Tracer::getOrCreateChunk(ThreadLocal& tlocal)
 	return *out;
 }
 
+U32 Tracer::getNameId(ThreadLocal& tlocal, const char* name)
+{
+	auto it = tlocal.m_nameIds.find(name);
+	if(it != tlocal.m_nameIds.getEnd()) [[likely]]
+	{
+		return *it;
+	}
+
+	U32 id;
+	{
+		LockGuard<Mutex> lock(m_namesMtx);
+		auto it2 = m_nameIds.find(name);
+		if(it2 != m_nameIds.getEnd())
+		{
+			id = *it2;
+		}
+		else
+		{
+			id = m_names.getSize();
+			m_names.emplaceBack(name);
+			m_nameIds.emplace(name, id);
+		}
+	}
+
+	tlocal.m_nameIds.emplace(name, id);
+	return id;
+}
+
+void Tracer::writeRecord(ThreadLocal& tlocal, const char* name, Bool isCounter, Second time, U64 durationOrValue)
+{
+	const U32 nameId = getNameId(tlocal, name);
+	const U64 timeNs = U64(time * 1000000000.0);
+
+	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
+
+	RingBlock* block = &tlocal.m_ringBlocks[tlocal.m_crntRingBlock];
+	if(block->m_size + kMaxRecordSize > kRingBlockSize)
+	{
+		// Move to the next block. It might be the oldest block so overwrite it
+		tlocal.m_crntRingBlock = (tlocal.m_crntRingBlock + 1) % m_ringBlockCount;
+		tlocal.m_ringWrapped = tlocal.m_ringWrapped || tlocal.m_crntRingBlock == 0;
+		block = &tlocal.m_ringBlocks[tlocal.m_crntRingBlock];
+		block->m_size = 0;
+	}
+
+	if(block->m_size == 0)
+	{
+		block->m_baseTime = timeNs;
+		block->m_prevTime = timeNs;
+	}
+
+	// The events are written when they end so their start times are not in order. That's why zigzag
+	const U64 delta = zigzagEncode(I64(timeNs - block->m_prevTime));
+	block->m_prevTime = timeNs;
+
+	U8* out = &block->m_data[block->m_size];
+	out = writeVarint(out, (U64(nameId) << 1) | U64(isCounter));
+	out = writeVarint(out, delta);
+	out = writeVarint(out, durationOrValue);
+	block->m_size = U32(out - &block->m_data[0]);
+}
+
 TracerEventHandle Tracer::beginEvent()
 {
 	TracerEventHandle out;
@@ -111,6 +276,12 @@ void Tracer::endEvent(const char* eventName, TracerEventHandle event)
 
 	ThreadLocal& tlocal = getThreadLocal();
 
+	if(m_ringBlockCount)
+	{
+		writeRecord(tlocal, eventName, false, event.m_start, U64(duration * 1000000000.0));
+		return;
+	}
+
 	// Write the event
 	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
 	Chunk& chunk = getOrCreateChunk(tlocal);
@@ -136,6 +307,12 @@ void Tracer::addCustomEvent(const char* eventName, Second start, Second duration
 
 	ThreadLocal& tlocal = getThreadLocal();
 
+	if(m_ringBlockCount)
+	{
+		writeRecord(tlocal, eventName, false, start, U64(duration * 1000000000.0));
+		return;
+	}
+
 	// Write the event
 	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
 	Chunk& chunk = getOrCreateChunk(tlocal);
@@ -160,6 +337,12 @@ void Tracer::incrementCounter(const char* counterName, U64 value)
 
 	ThreadLocal& tlocal = getThreadLocal();
 
+	if(m_ringBlockCount)
+	{
+		writeRecord(tlocal, counterName, true, HighRezTimer::getCurrentTime(), value);
+		return;
+	}
+
 	LockGuard<SpinLock> lock(tlocal.m_currentChunkLock);
 	Chunk& chunk = getOrCreateChunk(tlocal);
 
@@ -191,4 +374,175 @@ void Tracer::flush(TracerFlushCallback callback, void* callbackUserData)
 	}
 }
 
+Error Tracer::dumpFlightRecorder(CString filename)
+{
+	if(m_ringBlockCount == 0)
+	{
+		ANKI_UTIL_LOGE("The flight recorder is not enabled");
+		return Error::kFunctionFailed;
+	}
+
+	// Copy the ring buffers first to not hold the locks while writing the file
+	DynamicArray<U8, SingletonMemoryPoolWrapper<DefaultMemoryPool>> threadsData;
+	auto append = [&](const void* data, U32 size) {
+		const U32 offset = threadsData.getSize();
+		threadsData.resize(offset + size);
+		memcpy(&threadsData[offset], data, size);
+	};
+
+	U32 threadCount = 0;
+	{
+		LockGuard<Mutex> lock(m_allThreadLocalMtx);
+		for(ThreadLocal* tlocal : m_allThreadLocal)
+		{
+			LockGuard<SpinLock> lock2(tlocal->m_currentChunkLock);
+
+			// Oldest block first
+			const U32 firstBlock = (tlocal->m_ringWrapped) ? (tlocal->m_crntRingBlock + 1) % m_ringBlockCount : 0;
+			const U32 blockCount = (tlocal->m_ringWrapped) ? m_ringBlockCount : tlocal->m_crntRingBlock + 1;
+
+			append(&tlocal->m_tid, sizeof(tlocal->m_tid));
+			append(&blockCount, sizeof(blockCount));
+			for(U32 i = 0; i < blockCount; ++i)
+			{
+				const RingBlock& block = tlocal->m_ringBlocks[(firstBlock + i) % m_ringBlockCount];
+				append(&block.m_baseTime, sizeof(block.m_baseTime));
+				append(&block.m_size, sizeof(block.m_size));
+				append(&block.m_data[0], block.m_size);
+			}
+
+			++threadCount;
+		}
+	}
+
+	// Then the names. After the ring buffers because some thread might have added a new name in the meantime
+	DynamicArray<const char*, SingletonMemoryPoolWrapper<DefaultMemoryPool>> names;
+	{
+		LockGuard<Mutex> lock(m_namesMtx);
+		names.resize(m_names.getSize());
+		if(names.getSize())
+		{
+			memcpy(&names[0], &m_names[0], m_names.getSizeInBytes());
+		}
+	}
+
+	// Write the file
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+
+	ANKI_CHECK(file.write(&kFlightRecorderMagic[0], sizeof(kFlightRecorderMagic)));
+
+	const U32 nameCount = names.getSize();
+	ANKI_CHECK(file.write(&nameCount, sizeof(nameCount)));
+	for(const char* name : names)
+	{
+		const U32 nameLength = U32(strlen(name));
+		ANKI_CHECK(file.write(&nameLength, sizeof(nameLength)));
+		ANKI_CHECK(file.write(name, nameLength));
+	}
+
+	ANKI_CHECK(file.write(&threadCount, sizeof(threadCount)));
+	if(threadsData.getSize())
+	{
+		ANKI_CHECK(file.write(&threadsData[0], threadsData.getSizeInBytes()));
+	}
+
+	return Error::kNone;
+}
+
+Error Tracer::readFlightRecorderDump(CString filename, TracerDumpCallback callback, void* callbackUserData)
+{
+	ANKI_ASSERT(callback);
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::kRead | FileOpenFlag::kBinary));
+
+	DynamicArray<U8, SingletonMemoryPoolWrapper<DefaultMemoryPool>> data;
+	data.resize(U32(file.getSize()));
+	if(data.getSize())
+	{
+		ANKI_CHECK(file.read(&data[0], data.getSize()));
+	}
+
+	TracerDumpReader reader;
+	reader.m_ptr = data.getBegin();
+	reader.m_end = data.getEnd();
+
+#define ANKI_CHECK_DUMP(x) \
+	do \
+	{ \
+		if(!(x)) \
+		{ \
+			ANKI_UTIL_LOGE("Corrupted flight recorder dump: %s", filename.cstr()); \
+			return Error::kUserData; \
+		} \
+	} while(0)
+
+	Array<Char, sizeof(kFlightRecorderMagic)> magic;
+	ANKI_CHECK_DUMP(reader.read(magic));
+	ANKI_CHECK_DUMP(memcmp(&magic[0], &kFlightRecorderMagic[0], sizeof(magic)) == 0);
+
+	// Names
+	U32 nameCount;
+	ANKI_CHECK_DUMP(reader.read(nameCount));
+	DynamicArray<String> names;
+	names.resize(nameCount);
+	for(String& name : names)
+	{
+		U32 nameLength;
+		ANKI_CHECK_DUMP(reader.read(nameLength));
+		ANKI_CHECK_DUMP(nameLength > 0 && reader.m_ptr + nameLength <= reader.m_end);
+		const Char* nameBegin = reinterpret_cast<const Char*>(reader.m_ptr);
+		name = String(nameBegin, nameBegin + nameLength);
+		reader.m_ptr += nameLength;
+	}
+
+	// Threads
+	U32 threadCount;
+	ANKI_CHECK_DUMP(reader.read(threadCount));
+	for(U32 thread = 0; thread < threadCount; ++thread)
+	{
+		TracerDumpRecord record;
+		U32 blockCount;
+		ANKI_CHECK_DUMP(reader.read(record.m_tid));
+		ANKI_CHECK_DUMP(reader.read(blockCount));
+
+		for(U32 block = 0; block < blockCount; ++block)
+		{
+			U64 time;
+			U32 blockSize;
+			ANKI_CHECK_DUMP(reader.read(time));
+			ANKI_CHECK_DUMP(reader.read(blockSize));
+			ANKI_CHECK_DUMP(blockSize <= kRingBlockSize && reader.m_ptr + blockSize <= reader.m_end);
+
+			TracerDumpReader blockReader;
+			blockReader.m_ptr = reader.m_ptr;
+			blockReader.m_end = reader.m_ptr + blockSize;
+			reader.m_ptr += blockSize;
+
+			while(blockReader.m_ptr < blockReader.m_end)
+			{
+				U64 nameIdAndType, delta, durationOrValue;
+				ANKI_CHECK_DUMP(blockReader.readVarint(nameIdAndType));
+				ANKI_CHECK_DUMP(blockReader.readVarint(delta));
+				ANKI_CHECK_DUMP(blockReader.readVarint(durationOrValue));
+				ANKI_CHECK_DUMP((nameIdAndType >> 1) < nameCount);
+
+				time += U64(zigzagDecode(delta));
+
+				record.m_name = names[U32(nameIdAndType >> 1)];
+				record.m_isCounter = nameIdAndType & 1;
+				record.m_start = Second(time) / 1000000000.0;
+				record.m_duration = (record.m_isCounter) ? 0.0 : Second(durationOrValue) / 1000000000.0;
+				record.m_counterValue = (record.m_isCounter) ? durationOrValue : 0;
+				callback(callbackUserData, record);
+			}
+		}
+	}
+
+#undef ANKI_CHECK_DUMP
+
+	return Error::kNone;
+}
+
 } // end namespace anki
@@ -8,6 +8,7 @@
 #include <AnKi/Util/Thread.h>
 #include <AnKi/Util/WeakArray.h>
 #include <AnKi/Util/DynamicArray.h>
+#include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/Singleton.h>
 #include <AnKi/Util/String.h>
 
@@ -52,11 +53,28 @@ public:
 	}
 };
 
+/// A record of a flight recorder dump. See Tracer::readFlightRecorderDump.
+/// @memberof Tracer
+class TracerDumpRecord
+{
+public:
+	CString m_name;
+	ThreadId m_tid = 0;
+	Second m_start = 0.0; ///< For counters it's the time the counter got incremented.
+	Second m_duration = 0.0; ///< Zero for counters.
+	U64 m_counterValue = 0; ///< Zero for events.
+	Bool m_isCounter = false;
+};
+
 /// Tracer flush callback.
 /// @memberof Tracer
 using TracerFlushCallback = void (*)(void* userData, ThreadId tid, ConstWeakArray<TracerEvent> events,
 									 ConstWeakArray<TracerCounter> counters);
 
+/// Callback of Tracer::readFlightRecorderDump.
+/// @memberof Tracer
+using TracerDumpCallback = void (*)(void* userData, const TracerDumpRecord& record);
+
 /// Tracer.
 class Tracer : public MakeSingleton<Tracer>
 {
@@ -98,12 +116,36 @@ public:
 		m_enabled = enabled;
 	}
 
+	/// Instead of keeping all the events and counters until flush() keep only the latest ones of every thread in a
+	/// fixed-size ring buffer. The records are compact: interned names and delta-encoded timestamps. It's cheap enough
+	/// to stay on all the time and dump the ring buffers when something interesting happens. flush() gets nothing in
+	/// that mode.
+	/// @param ringBufferSize The size of the ring buffer of each thread. Zero disables the flight recorder.
+	/// @note It's not thread-safe. Call it before any tracing.
+	void setFlightRecorder(PtrSize ringBufferSize);
+
+	Bool getFlightRecorderEnabled() const
+	{
+		return m_ringBlockCount > 0;
+	}
+
+	/// Write the ring buffers of all threads to a binary file. Use readFlightRecorderDump() to read it back.
+	/// @note It's thread-safe.
+	Error dumpFlightRecorder(CString filename);
+
+	/// Read a file written by dumpFlightRecorder(). The callback is called once for every record. The names of the
+	/// records are valid only inside the callback.
+	static Error readFlightRecorderDump(CString filename, TracerDumpCallback callback, void* callbackUserData);
+
 private:
 	static constexpr U32 kEventsPerChunk = 256;
 	static constexpr U32 kCountersPerChunk = 512;
+	static constexpr U32 kRingBlockSize = 4_KB;
+	static constexpr Array<Char, 8> kFlightRecorderMagic = {'A', 'N', 'K', 'I', 'T', 'R', 'C', '1'};
 
 	class ThreadLocal;
 	class Chunk;
+	class RingBlock;
 
 	static thread_local ThreadLocal* m_threadLocal;
 
@@ -112,6 +154,13 @@ private:
 
 	Mutex m_allThreadLocalMtx;
 
+	/// The names of the flight recorder. The index in the array is the ID of the name.
+	DynamicArray<const char*, SingletonMemoryPoolWrapper<DefaultMemoryPool>> m_names;
+	HashMap<const char*, U32> m_nameIds;
+	Mutex m_namesMtx;
+
+	U32 m_ringBlockCount = 0;
+
 	Bool m_enabled = false;
 
 	Tracer() = default;
@@ -124,6 +173,12 @@ private:
 
 	/// Get or create a new chunk.
 	Chunk& getOrCreateChunk(ThreadLocal& tlocal);
+
+	/// Get the ID of an event or counter name.
+	U32 getNameId(ThreadLocal& tlocal, const char* name);
+
+	/// Write an event or a counter to the ring buffer.
+	void writeRecord(ThreadLocal& tlocal, const char* name, Bool isCounter, Second time, U64 durationOrValue);
 };
 
 /// Scoped tracer event.
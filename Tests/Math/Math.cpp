@@ -5,6 +5,8 @@
 
 #include <Tests/Framework/Framework.h>
 #include <AnKi/Math.h>
+#include <AnKi/Collision/Functions.h>
+#include <AnKi/Util/HighRezTimer.h>
 
 using namespace anki;
 
@@ -376,3 +378,87 @@ ANKI_TEST(Math, Mat3x4)
 		ANKI_TEST_EXPECT_EQ(m * v, Vec3(20, 44, 68));
 	}
 }
+
+ANKI_TEST(Math, AabbBatchVsPlanes)
+{
+	constexpr U32 kAabbCount = 64 * 1024 + 3;
+	constexpr U32 kPaddedAabbCount = getAlignedRoundUp(4u, kAabbCount);
+	constexpr U32 kIterationCount = 50;
+
+	// A frustum looking at the center of the boxes
+	const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(70.0f), toRad(50.0f), 0.1f, 200.0f);
+	const Mat4 view = Mat4::lookAt(Vec3(0.0f, 0.0f, 100.0f), Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f)).getInverse();
+	Array<Plane, 6> planes;
+	extractClipPlanes(proj * view, planes);
+
+	// Random boxes
+	alignas(16) static Array<Array<F32, kPaddedAabbCount>, 6> aabbMinMax;
+	static Array<Aabb, kAabbCount> aabbs;
+	for(U32 i = 0; i < kPaddedAabbCount; ++i)
+	{
+		const Vec3 min(getRandomRange(-150.0f, 150.0f), getRandomRange(-150.0f, 150.0f), getRandomRange(-150.0f, 150.0f));
+		const Vec3 max = min + Vec3(getRandomRange(0.1f, 5.0f));
+		if(i < kAabbCount)
+		{
+			aabbs[i] = Aabb(min, max);
+		}
+
+		for(U32 c = 0; c < 3; ++c)
+		{
+			aabbMinMax[c][i] = min[c];
+			aabbMinMax[c + 3][i] = max[c];
+		}
+	}
+
+	Array<U64, (kAabbCount + 63) / 64> mask;
+	auto batchTest = [&]() {
+		testPlanes(ConstWeakArray<Plane>(planes), {&aabbMinMax[0][0], &aabbMinMax[1][0], &aabbMinMax[2][0]},
+				   {&aabbMinMax[3][0], &aabbMinMax[4][0], &aabbMinMax[5][0]}, kAabbCount, WeakArray<U64>(mask));
+	};
+
+	auto isInside = [&](const Aabb& aabb) {
+		for(const Plane& plane : planes)
+		{
+			if(testPlane(plane, aabb) < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// Correctness
+	batchTest();
+	U32 insideCount = 0;
+	for(U32 i = 0; i < kAabbCount; ++i)
+	{
+		const Bool inside = isInside(aabbs[i]);
+		insideCount += inside;
+		ANKI_TEST_EXPECT_EQ(!!(mask[i / 64] & (U64(1) << U64(i % 64))), inside);
+	}
+	ANKI_TEST_EXPECT_EQ(mask.getBack() >> U64(kAabbCount % 64), 0);
+
+	// Benchmark
+	Second begin = HighRezTimer::getCurrentTime();
+	for(U32 it = 0; it < kIterationCount; ++it)
+	{
+		batchTest();
+	}
+	const Second batchTime = HighRezTimer::getCurrentTime() - begin;
+
+	U32 count = 0;
+	begin = HighRezTimer::getCurrentTime();
+	for(U32 it = 0; it < kIterationCount; ++it)
+	{
+		for(const Aabb& aabb : aabbs)
+		{
+			count += isInside(aabb);
+		}
+	}
+	const Second singleTime = HighRezTimer::getCurrentTime() - begin;
+	ANKI_TEST_EXPECT_EQ(count, insideCount * kIterationCount);
+
+	const F64 totalCount = F64(kAabbCount) * kIterationCount;
+	ANKI_TEST_LOGI("%u of %u AABBs inside. Per core: batched %f MAABBs/sec, one by one %f MAABBs/sec", insideCount,
+				   kAabbCount, totalCount / batchTime / 1000000.0, totalCount / singleTime / 1000000.0);
+}
@@ -102,6 +102,8 @@ public:
 
 ANKI_TEST(Resource, AsyncLoader)
 {
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
 	HeapMemoryPool pool(allocAligned, nullptr);
 
 	// Simple create destroy
@@ -262,4 +264,114 @@ ANKI_TEST(Resource, AsyncLoader)
 		barrier.wait();
 		ANKI_TEST_EXPECT_EQ(counter.load(), 10);
 	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+namespace {
+
+/// Records the order it got executed in.
+class OrderTask : public AsyncLoaderTask
+{
+public:
+	U32 m_id;
+	Array<U32, 64>* m_order;
+	Atomic<U32>* m_orderCount;
+	F32 m_sleepTime;
+
+	OrderTask(U32 id, Array<U32, 64>* order, Atomic<U32>* orderCount, F32 sleepTime)
+		: m_id(id)
+		, m_order(order)
+		, m_orderCount(orderCount)
+		, m_sleepTime(sleepTime)
+	{
+	}
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx)
+	{
+		(*m_order)[m_orderCount->fetchAdd(1)] = m_id;
+		HighRezTimer::sleep(m_sleepTime);
+		return Error::kNone;
+	}
+};
+
+} // namespace
+
+ANKI_TEST(Resource, AsyncLoaderPriorities)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		AsyncLoader a(1, 1);
+
+		// Pause so all tasks are in the queues before the workers start picking them
+		a.pause();
+
+		Array<Array<U32, 64>, 2> orders;
+		Array<Atomic<U32>, 2> orderCounts = {0u, 0u};
+
+		// Mixed workloads. Long CPU tasks (think texture uploads) and short IO tasks (think meshes)
+		constexpr U32 kCpuTaskCount = 4;
+		for(U32 i = 0; i < kCpuTaskCount; ++i)
+		{
+			a.submitTask(a.newTask<OrderTask>(100 + i, &orders[1], &orderCounts[1], 0.05f), AsyncLoaderTaskPriority::kLow,
+						 AsyncLoaderTaskType::kCpu);
+		}
+
+		const AsyncLoaderTaskId low0 = a.submitTask(a.newTask<OrderTask>(0, &orders[0], &orderCounts[0], 0.001f),
+													AsyncLoaderTaskPriority::kLow, AsyncLoaderTaskType::kIo);
+		const AsyncLoaderTaskId low1 = a.submitTask(a.newTask<OrderTask>(1, &orders[0], &orderCounts[0], 0.001f),
+													AsyncLoaderTaskPriority::kLow, AsyncLoaderTaskType::kIo);
+		a.submitTask(a.newTask<OrderTask>(2, &orders[0], &orderCounts[0], 0.001f), AsyncLoaderTaskPriority::kMedium,
+					 AsyncLoaderTaskType::kIo);
+		a.submitTask(a.newTask<OrderTask>(3, &orders[0], &orderCounts[0], 0.001f), AsyncLoaderTaskPriority::kHigh,
+					 AsyncLoaderTaskType::kIo);
+		a.submitTask(a.newTask<OrderTask>(4, &orders[0], &orderCounts[0], 0.001f), AsyncLoaderTaskPriority::kMedium,
+					 AsyncLoaderTaskType::kIo);
+		const AsyncLoaderTaskId cancelled = a.submitTask(a.newTask<OrderTask>(5, &orders[0], &orderCounts[0], 0.001f),
+														 AsyncLoaderTaskPriority::kHigh, AsyncLoaderTaskType::kIo);
+		ANKI_TEST_EXPECT_EQ(a.getQueuedTaskCount(AsyncLoaderTaskType::kIo), 6);
+		ANKI_TEST_EXPECT_EQ(a.getQueuedTaskCount(AsyncLoaderTaskType::kCpu), kCpuTaskCount);
+
+		// Raise the priority of one and cancel another
+		a.setTaskPriority(low1, AsyncLoaderTaskPriority::kHigh);
+		ANKI_TEST_EXPECT_EQ(a.cancelTask(cancelled), true);
+		ANKI_TEST_EXPECT_EQ(a.getQueuedTaskCount(AsyncLoaderTaskType::kIo), 5);
+
+		a.resume();
+
+		// The IO tasks shouldn't wait for the long CPU tasks
+		while(orderCounts[0].load() < 5)
+		{
+			HighRezTimer::sleep(0.001);
+		}
+		ANKI_TEST_EXPECT_LT(orderCounts[1].load(), kCpuTaskCount);
+
+		// Wait for the rest
+		while(a.getCompletedTaskCount() < 5 + kCpuTaskCount)
+		{
+			HighRezTimer::sleep(0.001);
+		}
+
+		// High first, then medium and low last. FIFO for the same priority
+		const Array<U32, 5> expectedIoOrder = {3, 1, 2, 4, 0};
+		for(U32 i = 0; i < expectedIoOrder.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(orders[0][i], expectedIoOrder[i]);
+		}
+
+		for(U32 i = 0; i < kCpuTaskCount; ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(orders[1][i], 100 + i);
+		}
+
+		// Done tasks can't be cancelled
+		ANKI_TEST_EXPECT_EQ(a.cancelTask(low0), false);
+		ANKI_TEST_EXPECT_GT(a.getTotalTaskLatency(), 0.0);
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
 }
@@ -10,26 +10,124 @@ ANKI_TEST(Resource, ResourceFilesystem)
 {
 	printf("Test requires the Data dir\n");
 
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
 	ConfigSet::allocateSingleton(allocAligned, nullptr);
-
-	ResourceFilesystem fs;
-	ANKI_TEST_EXPECT_NO_ERR(fs.init());
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
 
 	{
-		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("Tests/Data/Dir/../Dir/", ResourceStringList()));
-		ResourceFilePtr file;
-		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir0/hello.txt", file));
-		ResourceString txt;
-		ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
-		ANKI_TEST_EXPECT_EQ(txt, "hello\n");
+		ResourceFilesystem fs;
+		ANKI_TEST_EXPECT_NO_ERR(fs.init());
+
+		{
+			ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("Tests/Data/Dir/../Dir/", ResourceStringList()));
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir0/hello.txt", file));
+			ResourceString txt;
+			ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
+			ANKI_TEST_EXPECT_EQ(txt, "hello\n");
+		}
+
+		{
+			ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./Tests/Data/Dir.ankizip", ResourceStringList()));
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir0/hello.txt", file));
+			ResourceString txt;
+			ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
+			ANKI_TEST_EXPECT_EQ(txt, "hell\n");
+		}
 	}
 
+	ResourceMemoryPool::freeSingleton();
+	ConfigSet::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, ResourceFilesystemArchive)
+{
+	printf("Test requires the Data dir\n");
+
+	ConfigSet::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ConfigSet::getSingleton().setRsrcDataPaths("Tests/Data/Dir.ankizip");
+
 	{
-		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./Tests/Data/Dir.AnKiZLibip", ResourceStringList()));
-		ResourceFilePtr file;
-		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir0/hello.txt", file));
-		ResourceString txt;
-		ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
-		ANKI_TEST_EXPECT_EQ(txt, "hell\n");
+		ResourceFilesystem fs;
+		ANKI_TEST_EXPECT_NO_ERR(fs.init());
+
+		// List the archive. Directories and empty files are skipped
+		U32 fileCount = 0;
+		ANKI_TEST_EXPECT_NO_ERR(fs.iterateAllFilenames([&](CString fname) {
+			ANKI_TEST_EXPECT_EQ((fname == "subdir0/hello.txt" || fname == "subdir1/deflated.txt"), true);
+			++fileCount;
+			return Error::kNone;
+		}));
+		ANKI_TEST_EXPECT_EQ(fileCount, 2);
+
+		// Stored file
+		{
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir0/hello.txt", file));
+			ANKI_TEST_EXPECT_EQ(file->getSize(), 5);
+
+			ResourceString txt;
+			ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
+			ANKI_TEST_EXPECT_EQ(txt, "hell\n");
+
+			// Seek and partial reads
+			Array<Char, 3> buff;
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(1, FileSeekOrigin::kBeginning));
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], 2));
+			ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], "el", 2), 0);
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], 2));
+			ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], "l\n", 2), 0);
+			ANKI_TEST_EXPECT_NEQ(file->read(&buff[0], 1), Error::kNone);
+
+			// Stored files can be mapped if the archive was mapped
+			const U8* mem = file->map();
+			if(mem)
+			{
+				ANKI_TEST_EXPECT_EQ(memcmp(mem, "hell\n", 5), 0);
+			}
+		}
+
+		// Deflated file. Its compressed data are bigger than the buffer that feeds zlib
+		{
+			ResourceString expected;
+			U32 x = 1;
+			for(U32 i = 0; i < 4000; ++i)
+			{
+				x = x * 1664525u + 1013904223u;
+				Array<Char, 32> line;
+				snprintf(&line[0], line.getSize(), "%u %08x\n", i, x);
+				expected += CString(&line[0]);
+			}
+
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("subdir1/deflated.txt", file));
+			ANKI_TEST_EXPECT_EQ(file->getSize(), expected.getLength());
+			ANKI_TEST_EXPECT_EQ(file->map(), static_cast<const U8*>(nullptr));
+
+			ResourceString txt;
+			ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
+			ANKI_TEST_EXPECT_EQ(txt, expected);
+
+			// Seek backwards, forwards and read parts
+			Array<Char, 64> buff;
+			const PtrSize offsets[] = {100, 40000, 10, 54000, 0};
+			for(PtrSize offset : offsets)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(offset, FileSeekOrigin::kBeginning));
+				ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], buff.getSize()));
+				ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], &expected[offset], buff.getSize()), 0);
+			}
+
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(expected.getLength() - 2, FileSeekOrigin::kBeginning));
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], 2));
+			ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], &expected[expected.getLength() - 2], 2), 0);
+			ANKI_TEST_EXPECT_NEQ(file->read(&buff[0], 1), Error::kNone);
+		}
 	}
+
+	ResourceMemoryPool::freeSingleton();
+	ConfigSet::freeSingleton();
 }
@@ -7,6 +7,7 @@
 #include <AnKi/Resource/DummyResource.h>
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Core/ConfigSet.h>
+#include <AnKi/Util/HighRezTimer.h>
 
 ANKI_TEST(Resource, ResourceManager)
 {
@@ -75,3 +76,193 @@ ANKI_TEST(Resource, ResourceManager)
 	// Delete
 	ResourceManager::freeSingleton();
 }
+
+namespace {
+
+/// Expose the internals of TypeResourceManager to test it without the rest of the ResourceManager.
+template<typename THasher = DefaultHasher<CString>>
+class DummyTypeResourceManager : public TypeResourceManager<DummyResource, THasher>
+{
+public:
+	using TypeResourceManager<DummyResource, THasher>::findLoadedResource;
+	using TypeResourceManager<DummyResource, THasher>::registerResource;
+	using TypeResourceManager<DummyResource, THasher>::unregisterResource;
+	using TypeResourceManager<DummyResource, THasher>::getLoadedResourceCount;
+	using TypeResourceManager<DummyResource, THasher>::getHashCollisionCount;
+};
+
+/// A bad hash function that puts many filenames in the same bucket.
+class CollidingHasher
+{
+public:
+	static constexpr U64 kBucketCount = 8;
+
+	U64 operator()(const CString& filename) const
+	{
+		return filename.computeHash() % kBucketCount;
+	}
+};
+
+} // end anonymous namespace
+
+ANKI_TEST(Resource, ResourceManagerLookup)
+{
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kResourceCount = 10000;
+		constexpr U32 kSmallResourceCount = 100;
+		constexpr U32 kLookupCount = 100000;
+
+		DummyTypeResourceManager<> manager;
+		ResourceDynamicArray<DummyResource*> resources;
+		resources.resize(kResourceCount);
+
+		// Returns the average time of a lookup
+		auto timeLookups = [&](U32 loadedCount) {
+			const Second begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kLookupCount; ++i)
+			{
+				const U32 idx = (i * 7919) % loadedCount;
+				DummyResource* found = manager.findLoadedResource(resources[idx]->getFilename());
+				ANKI_TEST_EXPECT_EQ(found, resources[idx]);
+			}
+
+			// A miss
+			ANKI_TEST_EXPECT_EQ(manager.findLoadedResource("not_loaded"), static_cast<DummyResource*>(nullptr));
+
+			return (HighRezTimer::getCurrentTime() - begin) / Second(kLookupCount);
+		};
+
+		Second smallLookupTime = 0.0;
+		for(U32 i = 0; i < kResourceCount; ++i)
+		{
+			ResourceString filename;
+			filename.sprintf("Dummy/Resource%u.ankidummy", i);
+			resources[i] = newInstance<DummyResource>(ResourceMemoryPool::getSingleton());
+			resources[i]->setFilename(filename);
+			manager.registerResource(resources[i]);
+
+			if(i + 1 == kSmallResourceCount)
+			{
+				smallLookupTime = timeLookups(kSmallResourceCount);
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(manager.getLoadedResourceCount(), kResourceCount);
+		ANKI_TEST_EXPECT_EQ(manager.getHashCollisionCount(), 0);
+		const Second bigLookupTime = timeLookups(kResourceCount);
+
+		// Only informative, the timings are too noisy to be tested
+		ANKI_TEST_LOGI("Lookup time with %u resources %fns, with %u resources %fns", kSmallResourceCount,
+					   smallLookupTime * 1000000000.0, kResourceCount, bigLookupTime * 1000000000.0);
+
+		// Unregister half and check the rest are still there
+		for(U32 i = 0; i < kResourceCount; i += 2)
+		{
+			manager.unregisterResource(resources[i]);
+		}
+
+		ANKI_TEST_EXPECT_EQ(manager.getLoadedResourceCount(), kResourceCount / 2);
+		for(U32 i = 0; i < kResourceCount; ++i)
+		{
+			DummyResource* found = manager.findLoadedResource(resources[i]->getFilename());
+			ANKI_TEST_EXPECT_EQ(found, (i & 1) ? resources[i] : nullptr);
+		}
+
+		for(U32 i = 1; i < kResourceCount; i += 2)
+		{
+			manager.unregisterResource(resources[i]);
+		}
+
+		ANKI_TEST_EXPECT_EQ(manager.getLoadedResourceCount(), 0);
+		ANKI_TEST_EXPECT_EQ(manager.findLoadedResource(resources[1]->getFilename()),
+							static_cast<DummyResource*>(nullptr));
+
+		for(DummyResource* rsrc : resources)
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), rsrc);
+		}
+	}
+
+	ResourceMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, ResourceManagerHashCollisions)
+{
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kResourceCount = 64;
+
+		DummyTypeResourceManager<CollidingHasher> manager;
+		ResourceDynamicArray<DummyResource*> resources;
+		resources.resize(kResourceCount);
+
+		for(U32 i = 0; i < kResourceCount; ++i)
+		{
+			ResourceString filename;
+			filename.sprintf("Dummy/Resource%u.ankidummy", i);
+			resources[i] = newInstance<DummyResource>(ResourceMemoryPool::getSingleton());
+			resources[i]->setFilename(filename);
+			manager.registerResource(resources[i]);
+		}
+
+		// One resource per hash is in the map, the rest are collisions
+		ANKI_TEST_EXPECT_EQ(manager.getLoadedResourceCount(), kResourceCount);
+		const U32 mapCount = kResourceCount - manager.getHashCollisionCount();
+		ANKI_TEST_EXPECT_GT(mapCount, 0);
+		ANKI_TEST_EXPECT_LEQ(mapCount, CollidingHasher::kBucketCount);
+
+		// Hits in the map and in the collisions
+		for(DummyResource* rsrc : resources)
+		{
+			ANKI_TEST_EXPECT_EQ(manager.findLoadedResource(rsrc->getFilename()), rsrc);
+		}
+
+		// Misses that share a hash with loaded resources
+		for(U32 i = 0; i < 16; ++i)
+		{
+			ResourceString filename;
+			filename.sprintf("Dummy/NotLoaded%u.ankidummy", i);
+			ANKI_TEST_EXPECT_EQ(manager.findLoadedResource(filename), static_cast<DummyResource*>(nullptr));
+		}
+
+		// Unregister them one by one. If a resource in the map goes away a colliding one should take its place
+		Array<U32, CollidingHasher::kBucketCount> bucketSizes = {};
+		for(DummyResource* rsrc : resources)
+		{
+			++bucketSizes[CollidingHasher()(rsrc->getFilename())];
+		}
+
+		for(U32 i = 0; i < kResourceCount; ++i)
+		{
+			const U32 collisionCount = manager.getHashCollisionCount();
+			manager.unregisterResource(resources[i]);
+
+			// Only the last resource of a hash is not a collision
+			U32& bucketSize = bucketSizes[CollidingHasher()(resources[i]->getFilename())];
+			const U32 expectedCollisionCount = (bucketSize > 1) ? collisionCount - 1 : collisionCount;
+			ANKI_TEST_EXPECT_EQ(manager.getHashCollisionCount(), expectedCollisionCount);
+			--bucketSize;
+
+			ANKI_TEST_EXPECT_EQ(manager.getLoadedResourceCount(), kResourceCount - i - 1);
+			ANKI_TEST_EXPECT_EQ(manager.findLoadedResource(resources[i]->getFilename()),
+								static_cast<DummyResource*>(nullptr));
+
+			for(U32 j = i + 1; j < kResourceCount; ++j)
+			{
+				ANKI_TEST_EXPECT_EQ(manager.findLoadedResource(resources[j]->getFilename()), resources[j]);
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(manager.getHashCollisionCount(), 0);
+
+		for(DummyResource* rsrc : resources)
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), rsrc);
+		}
+	}
+
+	ResourceMemoryPool::freeSingleton();
+}
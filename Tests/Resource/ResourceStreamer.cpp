@@ -0,0 +1,198 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Resource/ResourceStreamer.h>
+#include <AnKi/Resource/ImageResource.h>
+#include <AnKi/Core/ConfigSet.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+ANKI_TEST(Resource, ResourceStreamer)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ConfigSet& cfg = ConfigSet::allocateSingleton(allocAligned, nullptr);
+	initConfig(cfg);
+	cfg.setGrValidation(false);
+	cfg.setRsrcDataPaths("EngineAssets");
+	cfg.setRsrcTextureStreaming(true);
+	cfg.setRsrcTextureStreamingInitialSize(4);
+	cfg.setRsrcTextureStreamingBudget(256_MB);
+
+	NativeWindow* win = createWindow(cfg);
+	GrManager* gr = createGrManager(win);
+	createResourceManager(gr);
+
+	{
+		ResourceStreamer& streamer = ResourceManager::getSingleton().getResourceStreamer();
+
+		// The skybox is big enough to go over the smallest budget
+		const Array<CString, 6> filenames = {"DefaultSkybox.ankitex", "GreenDecal.ankitex", "LensDirt.ankitex",
+											 "LightBulb.ankitex",	  "Mirror.ankitex",		"SpotLight.ankitex"};
+
+		Array<ImageResourcePtr, 6> images;
+		Array<U32, 6> initialWidths;
+		for(U32 i = 0; i < images.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(ResourceManager::getSingleton().loadStreamableImage(filenames[i], images[i], true));
+			ANKI_TEST_EXPECT_EQ(images[i]->isStreamed(), true);
+			initialWidths[i] = images[i]->getWidth();
+		}
+
+		// The consumers that don't request a resolution get the whole image and a different resource
+		{
+			ImageResourcePtr image;
+			ANKI_TEST_EXPECT_NO_ERR(ResourceManager::getSingleton().loadResource(filenames[0], image, true));
+			ANKI_TEST_EXPECT_NEQ(image.get(), images[0].get());
+			ANKI_TEST_EXPECT_EQ(image->isStreamable(), false);
+			ANKI_TEST_EXPECT_EQ(image->isStreamed(), false);
+			ANKI_TEST_EXPECT_GT(image->getWidth(), initialWidths[0]);
+
+			ImageResourcePtr image2;
+			ANKI_TEST_EXPECT_NO_ERR(ResourceManager::getSingleton().loadStreamableImage(filenames[0], image2, true));
+			ANKI_TEST_EXPECT_EQ(image2.get(), images[0].get());
+		}
+
+		streamer.update();
+		const PtrSize initialMemory = streamer.getStreamedImageMemory();
+
+		// Run frames until a condition is met or until it times out
+		constexpr Second kMaxWaitTime = 30.0;
+		auto runFrames = [&](U32 minFrameCount, auto requestFunc, auto doneFunc) {
+			const Second begin = HighRezTimer::getCurrentTime();
+			for(U32 frame = 0; frame < minFrameCount || !doneFunc(); ++frame)
+			{
+				if(HighRezTimer::getCurrentTime() - begin > kMaxWaitTime)
+				{
+					return false;
+				}
+
+				requestFunc();
+				streamer.update();
+				HighRezTimer::sleep(1.0_ms);
+			}
+
+			return true;
+		};
+
+		// Ask for the full resolution and wait for all the mipmaps to be streamed in
+		auto requestAll = [&]() {
+			for(const ImageResourcePtr& image : images)
+			{
+				image->requestResolution(kMaxU16);
+			}
+		};
+
+		auto allStreamedIn = [&]() {
+			for(U32 i = 0; i < images.getSize(); ++i)
+			{
+				if(images[i]->getWidth() <= initialWidths[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		ANKI_TEST_EXPECT_EQ(runFrames(1, requestAll, allStreamedIn), true);
+		const PtrSize fullMemory = streamer.getStreamedImageMemory();
+		ANKI_TEST_EXPECT_GT(fullMemory, initialMemory);
+
+		// Go over budget. The images are still in use so nothing should be evicted
+		cfg.setRsrcTextureStreamingBudget(1_MB);
+		const Array<U32, 6> fullWidths = {images[0]->getWidth(), images[1]->getWidth(), images[2]->getWidth(),
+										  images[3]->getWidth(), images[4]->getWidth(), images[5]->getWidth()};
+
+		auto noCondition = []() {
+			return true;
+		};
+
+		ANKI_TEST_EXPECT_EQ(runFrames(10, requestAll, noCondition), true);
+		for(U32 i = 0; i < images.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(images[i]->getWidth(), fullWidths[i]);
+		}
+
+		// Stop asking for the images. After a while they become candidates for eviction and they drop to their
+		// initial resolution until the memory is within budget
+		auto requestNothing = []() {
+		};
+
+		auto evicted = [&]() {
+			if(streamer.getStreamedImageMemory() > cfg.getRsrcTextureStreamingBudget())
+			{
+				return false;
+			}
+
+			// The memory is updated when the evictions start, the textures change when they finish
+			for(U32 i = 0; i < images.getSize(); ++i)
+			{
+				if(images[i]->getWidth() < fullWidths[i])
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+		// The number of frames is bigger than the eviction delay of the streamer
+		ANKI_TEST_EXPECT_EQ(runFrames(100, requestNothing, evicted), true);
+
+		for(U32 i = 0; i < images.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_LEQ(images[i]->getWidth(), fullWidths[i]);
+			ANKI_TEST_EXPECT_GEQ(images[i]->getWidth(), initialWidths[i]);
+		}
+
+		// Drop half of the images while they stream in. They should unregister and cancel their tasks
+		cfg.setRsrcTextureStreamingBudget(256_MB);
+		for(U32 frame = 0; frame < 4; ++frame)
+		{
+			requestAll();
+			streamer.update();
+		}
+
+		for(U32 i = 0; i < images.getSize(); i += 2)
+		{
+			images[i].reset(nullptr);
+		}
+
+		auto remainingStreamedIn = [&]() {
+			for(U32 i = 1; i < images.getSize(); i += 2)
+			{
+				if(images[i]->getWidth() != fullWidths[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		auto requestRemaining = [&]() {
+			for(U32 i = 1; i < images.getSize(); i += 2)
+			{
+				images[i]->requestResolution(kMaxU16);
+			}
+		};
+
+		ANKI_TEST_EXPECT_EQ(runFrames(1, requestRemaining, remainingStreamedIn), true);
+
+		// Drop the rest. The streamer should have nothing left
+		for(ImageResourcePtr& image : images)
+		{
+			image.reset(nullptr);
+		}
+
+		streamer.update();
+		ANKI_TEST_EXPECT_EQ(streamer.getStreamedImageMemory(), 0);
+	}
+
+	// It asserts if some resources didn't unregister
+	ResourceManager::freeSingleton();
+	GrManager::freeSingleton();
+	NativeWindow::freeSingleton();
+	ConfigSet::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
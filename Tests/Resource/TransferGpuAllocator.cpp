@@ -0,0 +1,146 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Resource/MeshResource.h>
+#include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Core/ConfigSet.h>
+#include <AnKi/Core/GpuMemoryPools.h>
+#include <AnKi/Gr/CommandBuffer.h>
+#include <AnKi/Gr/Fence.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/ThreadHive.h>
+
+using namespace anki;
+
+static void initTransferGpuAllocatorTest(U32 ioThreadCount)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ConfigSet& cfg = ConfigSet::allocateSingleton(allocAligned, nullptr);
+	initConfig(cfg);
+	cfg.setGrValidation(false);
+	cfg.setRsrcDataPaths("Samples/SimpleScene/Assets");
+	cfg.setRsrcAsyncLoaderIoThreadCount(ioThreadCount);
+	cfg.setRsrcAsyncLoaderCpuThreadCount(2);
+	cfg.setRsrcTransferScratchMemorySize(1_MB); // Use the smallest budget to force the pools to rotate
+
+	NativeWindow* win = createWindow(cfg);
+	GrManager* gr = createGrManager(win);
+	UnifiedGeometryMemoryPool::allocateSingleton().init();
+	createResourceManager(gr);
+}
+
+static void destroyTransferGpuAllocatorTest()
+{
+	ResourceManager::freeSingleton();
+	UnifiedGeometryMemoryPool::freeSingleton();
+	GrManager::freeSingleton();
+	NativeWindow::freeSingleton();
+	ConfigSet::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, TransferGpuAllocatorManyConsumers)
+{
+	initTransferGpuAllocatorTest(1);
+
+	{
+		constexpr U32 kThreadCount = 4;
+		constexpr U32 kHandlesPerTask = 3;
+		constexpr U32 kIterationCount = 16;
+		constexpr PtrSize kAllocationSize = 16_MB;
+
+		// Every thread holds more than a pool at the same time and releases only after it flushes. That's what the
+		// async loader threads do
+		ThreadHive hive(kThreadCount);
+
+		Atomic<U32> allocationCount = {0};
+		auto taskCallback = [](void* userData, [[maybe_unused]] U32 threadId, [[maybe_unused]] ThreadHive& hive,
+							   [[maybe_unused]] ThreadHiveSemaphore* sem) {
+			TransferGpuAllocator& alloc = ResourceManager::getSingleton().getTransferGpuAllocator();
+
+			for(U32 it = 0; it < kIterationCount; ++it)
+			{
+				Array<TransferGpuAllocatorHandle, kHandlesPerTask> handles;
+				for(TransferGpuAllocatorHandle& handle : handles)
+				{
+					ANKI_TEST_EXPECT_NO_ERR(alloc.allocate(kAllocationSize, handle));
+					memset(handle.getMappedMemory(), 0xFF, 64);
+				}
+
+				CommandBufferInitInfo cmdbInit;
+				cmdbInit.m_flags = CommandBufferFlag::kSmallBatch | CommandBufferFlag::kGeneralWork;
+				CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(cmdbInit);
+				FencePtr fence;
+				cmdb->flush({}, &fence);
+
+				for(TransferGpuAllocatorHandle& handle : handles)
+				{
+					alloc.release(handle, fence);
+				}
+
+				static_cast<Atomic<U32>*>(userData)->fetchAdd(kHandlesPerTask);
+			}
+		};
+
+		for(U32 i = 0; i < kThreadCount; ++i)
+		{
+			hive.submitTask(taskCallback, &allocationCount);
+		}
+
+		hive.waitAllTasks();
+		ANKI_TEST_EXPECT_EQ(allocationCount.load(), kThreadCount * kHandlesPerTask * kIterationCount);
+	}
+
+	destroyTransferGpuAllocatorTest();
+}
+
+ANKI_TEST(Resource, MeshResourceConcurrentLoading)
+{
+	initTransferGpuAllocatorTest(4);
+
+	{
+		const Array<CString, 8> meshFilenames = {
+			"Mesh_0_d56f58fc33de003f.ankimesh", "Mesh_1_266a0dd9d2092f46.ankimesh", "Mesh_2_be53007bec464649.ankimesh",
+			"Mesh_3_c026fdb5b74773ed.ankimesh", "Mesh_4_4d4aae6c030c4fd5.ankimesh", "Mesh_5_629309b27fa549a7.ankimesh",
+			"Mesh_6_a078cf217893be6f.ankimesh", "Mesh_7_4b76b132380d8a62.ankimesh"};
+
+		constexpr U32 kRoundCount = 32;
+		constexpr Second kMaxWaitTime = 30.0;
+
+		for(U32 round = 0; round < kRoundCount; ++round)
+		{
+			const U64 completedBefore = ResourceManager::getSingleton().getAsyncTaskCompletedCount();
+
+			Array<MeshResourcePtr, 8> meshes;
+			for(U32 i = 0; i < meshFilenames.getSize(); ++i)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(
+					ResourceManager::getSingleton().loadResource(meshFilenames[i], meshes[i], true));
+			}
+
+			// In odd rounds drop the meshes while they are still loading. Their destructors have to cancel the tasks
+			// or wait for them
+			if(round & 1)
+			{
+				continue;
+			}
+
+			// Wait for all the uploads. If the loader threads deadlock this will time out
+			const Second begin = HighRezTimer::getCurrentTime();
+			while(ResourceManager::getSingleton().getAsyncTaskCompletedCount() < completedBefore + meshes.getSize()
+				  && HighRezTimer::getCurrentTime() - begin < kMaxWaitTime)
+			{
+				HighRezTimer::sleep(1.0_ms);
+			}
+
+			ANKI_TEST_EXPECT_GEQ(ResourceManager::getSingleton().getAsyncTaskCompletedCount(),
+								 completedBefore + meshes.getSize());
+		}
+	}
+
+	destroyTransferGpuAllocatorTest();
+}
@@ -0,0 +1,156 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SceneGraph.h>
+#include <AnKi/Scene/Components/MoveComponent.h>
+#include <AnKi/Scene/Components/TriggerComponent.h>
+#include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Physics/PhysicsWorld.h>
+#include <AnKi/Core/ConfigSet.h>
+#include <AnKi/Core/GpuMemoryPools.h>
+
+using namespace anki;
+
+/// Same as kIdleUpdatesBeforeParking in SceneGraph.cpp.
+constexpr U32 kIdleUpdatesBeforeParking = 2;
+
+static void initDirtyTrackingTest()
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ConfigSet& cfg = ConfigSet::allocateSingleton(allocAligned, nullptr);
+	initConfig(cfg);
+	cfg.setGrValidation(false);
+	cfg.setRsrcDataPaths("EngineAssets");
+	cfg.setSceneDirtyTracking(true);
+
+	GlobalFrameIndex::allocateSingleton();
+	CoreThreadHive::allocateSingleton(4);
+
+	NativeWindow* win = createWindow(cfg);
+	GrManager* gr = createGrManager(win);
+	UnifiedGeometryMemoryPool::allocateSingleton().init();
+	GpuSceneMemoryPool::allocateSingleton().init();
+	RebarStagingGpuMemoryPool::allocateSingleton().init();
+	ANKI_TEST_EXPECT_NO_ERR(PhysicsWorld::allocateSingleton().init(allocAligned, nullptr));
+	createResourceManager(gr);
+	ANKI_TEST_EXPECT_NO_ERR(SceneGraph::allocateSingleton().init(allocAligned, nullptr));
+}
+
+static void destroyDirtyTrackingTest()
+{
+	SceneGraph::freeSingleton();
+	ResourceManager::freeSingleton();
+	PhysicsWorld::freeSingleton();
+	RebarStagingGpuMemoryPool::freeSingleton();
+	GpuSceneMemoryPool::freeSingleton();
+	UnifiedGeometryMemoryPool::freeSingleton();
+	GrManager::freeSingleton();
+	NativeWindow::freeSingleton();
+	CoreThreadHive::freeSingleton();
+	GlobalFrameIndex::freeSingleton();
+	ConfigSet::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+static void updateScene(U32 updateCount = 1)
+{
+	for(U32 i = 0; i < updateCount; ++i)
+	{
+		const Second time = Second(GlobalFrameIndex::getSingleton().m_value) / 60.0;
+		ANKI_TEST_EXPECT_NO_ERR(SceneGraph::getSingleton().update(time - 1.0 / 60.0, time));
+		++GlobalFrameIndex::getSingleton().m_value;
+	}
+}
+
+ANKI_TEST(Scene, DirtyTracking)
+{
+	initDirtyTrackingTest();
+
+	{
+		SceneGraph& scene = SceneGraph::getSingleton();
+
+		// A node without components never updates anything
+		SceneNode* idleNode;
+		ANKI_TEST_EXPECT_NO_ERR(scene.newSceneNode("idle", idleNode));
+
+		// The MoveComponent updates only when the transform changes
+		SceneNode* parent;
+		ANKI_TEST_EXPECT_NO_ERR(scene.newSceneNode("parent", parent));
+		parent->newComponent<MoveComponent>();
+
+		SceneNode* child;
+		ANKI_TEST_EXPECT_NO_ERR(scene.newSceneNode("child", child));
+		child->newComponent<MoveComponent>();
+		parent->addChild(child);
+
+		// The TriggerComponent needs an update every frame even if nothing touched it
+		SceneNode* alwaysUpdateNode;
+		ANKI_TEST_EXPECT_NO_ERR(scene.newSceneNode("alwaysUpdate", alwaysUpdateNode));
+		alwaysUpdateNode->newComponent<TriggerComponent>();
+
+		// New nodes start awake
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(alwaysUpdateNode->isParked(), false);
+
+		// The idle node parks after the idle updates, not before
+		updateScene(kIdleUpdatesBeforeParking - 1);
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), false);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), true);
+
+		// The moving nodes updated their transforms in the 1st update so they park one update later
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), false);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), true);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), true);
+
+		// Nodes with always update components never park
+		updateScene(10);
+		ANKI_TEST_EXPECT_EQ(alwaysUpdateNode->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), true);
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), true);
+
+		// Moving the parent wakes it up right away and the child when the parent's transform is updated
+		parent->setLocalOrigin(Vec4(1.0f, 0.0f, 0.0f, 0.0f));
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), true);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(child->getWorldTransform().getOrigin(), Vec4(1.0f, 0.0f, 0.0f, 0.0f));
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), true);
+
+		updateScene(kIdleUpdatesBeforeParking);
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), true);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), true);
+
+		// Getting a component for writing wakes up the node even if nothing changes
+		[[maybe_unused]] MoveComponent& move = child->getFirstComponentOfType<MoveComponent>();
+		ANKI_TEST_EXPECT_EQ(child->isParked(), false);
+		ANKI_TEST_EXPECT_EQ(parent->isParked(), true);
+		updateScene(kIdleUpdatesBeforeParking - 1);
+		ANKI_TEST_EXPECT_EQ(child->isParked(), false);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(child->isParked(), true);
+
+		// Adding a component wakes up the node
+		idleNode->newComponent<MoveComponent>();
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), false);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(idleNode->isParked(), false);
+
+		// Parked nodes can be deleted
+		scene.deleteSceneNode(parent);
+		updateScene();
+		ANKI_TEST_EXPECT_EQ(scene.tryFindSceneNode("parent"), nullptr);
+		ANKI_TEST_EXPECT_EQ(scene.tryFindSceneNode("child"), nullptr);
+	}
+
+	destroyDirtyTrackingTest();
+}
@@ -5,11 +5,13 @@
 
 #include <Tests/Framework/Framework.h>
 #include <AnKi/Scene/Octree.h>
+#include <AnKi/Util/ParallelFor.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+#include <AnKi/Collision/Functions.h>
 
 ANKI_TEST(Scene, Octree)
 {
-	HeapAllocator<U8> alloc(allocAligned, nullptr);
-
 	// Fuzzy
 #if 0
 	{
@@ -82,3 +84,346 @@ ANKI_TEST(Scene, Octree)
 	}
 #endif
 }
+
+static Aabb randomVolume(F32 sceneSize, F32 maxVolumeSize)
+{
+	const Vec3 size(getRandomRange(0.1f, maxVolumeSize), getRandomRange(0.1f, maxVolumeSize),
+					getRandomRange(0.1f, maxVolumeSize));
+	const Vec3 min(getRandomRange(-sceneSize, sceneSize - size.x()), getRandomRange(-sceneSize, sceneSize - size.y()),
+				   getRandomRange(-sceneSize, sceneSize - size.z()));
+	return Aabb(min, min + size);
+}
+
+static Aabb moveVolume(const Aabb& volume, F32 sceneSize, F32 distance)
+{
+	const Vec3 size = volume.getMax().xyz() - volume.getMin().xyz();
+	Vec3 min = volume.getMin().xyz()
+			   + Vec3(getRandomRange(-distance, distance), getRandomRange(-distance, distance),
+					  getRandomRange(-distance, distance));
+	min = min.max(Vec3(-sceneSize)).min(Vec3(sceneSize) - size);
+	return Aabb(min, min + size);
+}
+
+ANKI_TEST(Scene, OctreeDeferredPlacement)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr F32 kSceneSize = 100.0f;
+		constexpr U32 kPlaceableCount = 2000;
+		constexpr U32 kFrameCount = 20;
+
+		Octree octree;
+		octree.init(Vec3(-kSceneSize), Vec3(kSceneSize), 5);
+
+		ThreadHive hive(8);
+
+		DynamicArray<OctreePlaceable> placeables;
+		placeables.resize(kPlaceableCount);
+		DynamicArray<Aabb> volumes;
+		volumes.resize(kPlaceableCount);
+		for(U32 i = 0; i < kPlaceableCount; ++i)
+		{
+			volumes[i] = randomVolume(kSceneSize, 10.0f);
+			placeables[i].m_userData = &placeables[i];
+			octree.place(volumes[i], &placeables[i], true);
+		}
+
+		DynamicArray<Aabb> firstMoves;
+		firstMoves.resize(kPlaceableCount);
+
+		for(U32 frame = 0; frame < kFrameCount; ++frame)
+		{
+			// Compute the moves here because the random generator is not thread-safe. Some move a lot and some a little
+			for(U32 i = 0; i < kPlaceableCount; ++i)
+			{
+				const F32 distance = (i % 4 == 0) ? 20.0f : 0.01f;
+				firstMoves[i] = moveVolume(volumes[i], kSceneSize, distance);
+
+				// Move again to test that the last placement wins
+				volumes[i] = (i % 7 == 0) ? moveVolume(firstMoves[i], kSceneSize, distance) : firstMoves[i];
+			}
+
+			// Move from many threads
+			parallelFor(hive, 0, kPlaceableCount, 64, [&](U32 begin, U32 end) {
+				for(U32 i = begin; i < end; ++i)
+				{
+					octree.placeDeferred(firstMoves[i], &placeables[i], true);
+					if(i % 7 == 0)
+					{
+						octree.placeDeferred(volumes[i], &placeables[i], true);
+					}
+				}
+			});
+
+			// Remove and re-place some before the deferred placements are applied
+			for(U32 i = frame; i < kPlaceableCount; i += 97)
+			{
+				octree.remove(placeables[i]);
+			}
+
+			octree.applyDeferredUpdates();
+
+			for(U32 i = frame; i < kPlaceableCount; i += 97)
+			{
+				octree.place(volumes[i], &placeables[i], true);
+			}
+
+			// Query a box and check that nothing is missing
+			const Aabb queryBox = randomVolume(kSceneSize, 50.0f);
+			for(OctreePlaceable& placeable : placeables)
+			{
+				placeable.reset();
+			}
+
+			DynamicArray<U8> visible;
+			visible.resize(kPlaceableCount, U8(0));
+			octree.walkTree(
+				0,
+				[&](const Aabb& leafBox) {
+					return testCollision(leafBox, queryBox);
+				},
+				[&](void* userData) {
+					++visible[U32(static_cast<OctreePlaceable*>(userData) - &placeables[0])];
+				});
+
+			for(U32 i = 0; i < kPlaceableCount; ++i)
+			{
+				ANKI_TEST_EXPECT_LEQ(visible[i], 1);
+				if(testCollision(volumes[i], queryBox))
+				{
+					ANKI_TEST_EXPECT_EQ(visible[i], 1);
+				}
+			}
+		}
+
+		for(OctreePlaceable& placeable : placeables)
+		{
+			octree.remove(placeable);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, OctreeMoveBench)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr F32 kSceneSize = 1000.0f;
+		constexpr U32 kPlaceableCount = 20000;
+		constexpr U32 kFrameCount = 10;
+
+		Octree octree;
+		octree.init(Vec3(-kSceneSize), Vec3(kSceneSize), 5);
+
+		DynamicArray<OctreePlaceable> placeables;
+		placeables.resize(kPlaceableCount);
+		DynamicArray<Aabb> volumes;
+		volumes.resize(kPlaceableCount);
+		for(U32 i = 0; i < kPlaceableCount; ++i)
+		{
+			volumes[i] = randomVolume(kSceneSize, 5.0f);
+			placeables[i].m_userData = &placeables[i];
+			octree.place(volumes[i], &placeables[i], true);
+		}
+
+		// Pre-compute the moves. Most of the objects move a little
+		DynamicArray<Aabb> moves;
+		moves.resize(kPlaceableCount * kFrameCount);
+		for(U32 frame = 0; frame < kFrameCount; ++frame)
+		{
+			for(U32 i = 0; i < kPlaceableCount; ++i)
+			{
+				const Aabb& prev = (frame == 0) ? volumes[i] : moves[(frame - 1) * kPlaceableCount + i];
+				moves[frame * kPlaceableCount + i] = moveVolume(prev, kSceneSize, (i % 10 == 0) ? 50.0f : 0.5f);
+			}
+		}
+
+		for(U32 threadCount = 1; threadCount <= getCpuCoresCount() * 2; threadCount *= 2)
+		{
+			ThreadHive hive(threadCount);
+
+			for(Bool deferred : {false, true})
+			{
+				// Reset
+				for(U32 i = 0; i < kPlaceableCount; ++i)
+				{
+					octree.place(volumes[i], &placeables[i], true);
+				}
+
+				const Second begin = HighRezTimer::getCurrentTime();
+				for(U32 frame = 0; frame < kFrameCount; ++frame)
+				{
+					parallelFor(hive, 0, kPlaceableCount, 256, [&](U32 chunkBegin, U32 chunkEnd) {
+						for(U32 i = chunkBegin; i < chunkEnd; ++i)
+						{
+							const Aabb& volume = moves[frame * kPlaceableCount + i];
+							if(deferred)
+							{
+								octree.placeDeferred(volume, &placeables[i], true);
+							}
+							else
+							{
+								octree.place(volume, &placeables[i], true);
+							}
+						}
+					});
+
+					if(deferred)
+					{
+						octree.applyDeferredUpdates();
+					}
+				}
+				const Second elapsed = HighRezTimer::getCurrentTime() - begin;
+
+				ANKI_TEST_LOGI("%u threads, %s: %f moves/sec", threadCount, (deferred) ? "deferred" : "immediate",
+							   F64(kPlaceableCount * kFrameCount) / elapsed);
+			}
+		}
+
+		for(OctreePlaceable& placeable : placeables)
+		{
+			octree.remove(placeable);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, OctreeLinearWalk)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr F32 kSceneSize = 1000.0f;
+		constexpr U32 kPlaceableCount = 50000;
+		constexpr U32 kViewCount = 32;
+		constexpr U32 kIterationCount = 4;
+
+		Octree octree;
+		octree.init(Vec3(-kSceneSize), Vec3(kSceneSize), 6, true);
+
+		DynamicArray<OctreePlaceable> placeables;
+		placeables.resize(kPlaceableCount);
+		for(U32 i = 0; i < kPlaceableCount; ++i)
+		{
+			placeables[i].m_userData = &placeables[i];
+			octree.place(randomVolume(kSceneSize, (i % 100 == 0) ? 100.0f : 5.0f), &placeables[i], true);
+		}
+
+		ANKI_TEST_EXPECT_EQ(octree.hasLinearTree(), false);
+		Second rebuildTime = HighRezTimer::getCurrentTime();
+		octree.applyDeferredUpdates();
+		rebuildTime = HighRezTimer::getCurrentTime() - rebuildTime;
+		ANKI_TEST_EXPECT_EQ(octree.hasLinearTree(), true);
+
+		// Some cameras looking around the scene
+		const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(70.0f), toRad(50.0f), 0.1f, 500.0f);
+		DynamicArray<Array<Plane, 6>> views;
+		views.resize(kViewCount);
+		for(Array<Plane, 6>& planes : views)
+		{
+			const Vec3 eye = randomVolume(kSceneSize * 0.8f, 1.0f).getMin().xyz();
+			const Vec3 target = randomVolume(kSceneSize * 0.8f, 1.0f).getMin().xyz();
+			const Mat4 view = Mat4::lookAt(eye, target, Vec3(0.0f, 1.0f, 0.0f)).getInverse();
+			extractClipPlanes(proj * view, planes);
+		}
+
+		DynamicArray<U8> visibleA;
+		visibleA.resize(kPlaceableCount, U8(0));
+		DynamicArray<U8> visibleB;
+		visibleB.resize(kPlaceableCount, U8(0));
+		U32 visibleCount = 0;
+
+		Second walkTime = 0.0;
+		Second linearWalkTime = 0.0;
+		for(U32 it = 0; it < kIterationCount; ++it)
+		{
+			for(const Array<Plane, 6>& planes : views)
+			{
+				const Bool check = it == 0;
+				if(check)
+				{
+					memset(visibleA.getBegin(), 0, visibleA.getSizeInBytes());
+					memset(visibleB.getBegin(), 0, visibleB.getSizeInBytes());
+				}
+
+				// The test IDs are limited so start over
+				for(OctreePlaceable& placeable : placeables)
+				{
+					placeable.reset();
+				}
+				U32 testId = 0;
+
+				Second begin = HighRezTimer::getCurrentTime();
+				octree.walkTree(
+					testId++,
+					[&](const Aabb& box) {
+						for(const Plane& plane : planes)
+						{
+							if(testPlane(plane, box) < 0.0f)
+							{
+								return false;
+							}
+						}
+						return true;
+					},
+					[&](void* userData) {
+						if(check)
+						{
+							visibleA[U32(static_cast<OctreePlaceable*>(userData) - placeables.getBegin())] = 1;
+						}
+					});
+				walkTime += HighRezTimer::getCurrentTime() - begin;
+
+				begin = HighRezTimer::getCurrentTime();
+				octree.walkLinearTree(
+					testId++, ConstWeakArray<Plane>(planes),
+					[]([[maybe_unused]] const Aabb& box) {
+						return true;
+					},
+					[&](void* userData) {
+						if(check)
+						{
+							visibleB[U32(static_cast<OctreePlaceable*>(userData) - placeables.getBegin())] = 1;
+						}
+					});
+				linearWalkTime += HighRezTimer::getCurrentTime() - begin;
+
+				if(check)
+				{
+					for(U32 i = 0; i < kPlaceableCount; ++i)
+					{
+						ANKI_TEST_EXPECT_EQ(visibleA[i], visibleB[i]);
+						visibleCount += visibleA[i];
+					}
+				}
+			}
+		}
+
+		ANKI_TEST_LOGI("%u placeables, %u visible per view. Walk %fms, linear walk %fms (rebuild %fms)",
+					   kPlaceableCount, visibleCount / kViewCount, walkTime * 1000.0 / (kViewCount * kIterationCount),
+					   linearWalkTime * 1000.0 / (kViewCount * kIterationCount), rebuildTime * 1000.0);
+
+		// Changing the tree invalidates the linear tree
+		octree.place(randomVolume(kSceneSize, 5.0f), &placeables[0], true);
+		ANKI_TEST_EXPECT_EQ(octree.hasLinearTree(), false);
+		octree.applyDeferredUpdates();
+		ANKI_TEST_EXPECT_EQ(octree.hasLinearTree(), true);
+
+		for(OctreePlaceable& placeable : placeables)
+		{
+			octree.remove(placeable);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+}
@@ -0,0 +1,346 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/VisibilityInternal.h>
+#include <AnKi/Renderer/Drawer.h>
+#include <AnKi/Collision/Functions.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+#include <algorithm>
+
+using namespace anki;
+
+namespace {
+
+constexpr U32 kThreadCount = 8;
+
+using Storage = TRenderQueueElementStorage<RenderableQueueElement>;
+
+/// Renderables that share a few programs and meshes.
+void initRenderable(U32 i, RenderableQueueElement& el)
+{
+	memset(&el, 0, sizeof(el));
+	el.m_program = numberToPtr<ShaderProgram*>(PtrSize(getRandom() % 16 + 1) * 256);
+	el.m_indexed = true;
+	el.m_indexCount = U32(getRandom() % 8 + 1) * 300;
+	el.m_firstIndex = U32(getRandom() % 4) * 1000;
+	el.m_primitiveTopology = PrimitiveTopology::kTriangles;
+	el.m_worldTransformsOffset = i;
+	el.m_uniformsOffset = i * 2;
+	el.m_geometryOffset = i * 3;
+	el.m_distanceFromCamera = getRandomRange(0.0f, 1000.0f);
+	el.computeMergeKey();
+}
+
+/// Spread some renderables to per-thread storages like the VisibilityTestTask does. Some threads might get nothing.
+void fillStorages(U32 renderableCount, StackMemoryPool& pool, Array<Storage, kThreadCount>& storages)
+{
+	Array<U32, kThreadCount> counts = {};
+	for(U32 i = 0; i < renderableCount; ++i)
+	{
+		++counts[getRandom() % (kThreadCount - 1)];
+	}
+
+	U32 idx = 0;
+	for(U32 t = 0; t < kThreadCount; ++t)
+	{
+		Storage& storage = storages[t];
+		storage.m_elementCount = counts[t];
+		storage.m_elementStorage = counts[t];
+		storage.m_elements = (counts[t]) ? newArray<RenderableQueueElement>(pool, counts[t]) : nullptr;
+
+		for(U32 i = 0; i < counts[t]; ++i)
+		{
+			initRenderable(idx++, storage.m_elements[i]);
+		}
+	}
+}
+
+/// Point to some renderables as they are.
+RenderableQueueElementArray wrapRenderables(WeakArray<RenderableQueueElement> renderables, StackMemoryPool& pool)
+{
+	Storage storage;
+	storage.m_elements = renderables.getBegin();
+	storage.m_elementCount = renderables.getSize();
+	storage.m_elementStorage = renderables.getSize();
+
+	RenderableQueueElementArray out;
+	CombineResultsTask::combineRenderables(WeakArray<Storage>(&storage, 1), out, pool);
+	return out;
+}
+
+/// Count the drawcalls the drawer would emit.
+U32 countDrawcalls(const RenderableQueueElementArray& renderables)
+{
+	if(renderables.getSize() == 0)
+	{
+		return 0;
+	}
+
+	U32 drawcallCount = 0;
+	const RenderableQueueElement* prev = nullptr;
+	RenderableDrawer::iterateRange(renderables, 0, renderables.getSize(), [&](const RenderableQueueElement& el) {
+		if(!prev || !prev->canMergeWith(el))
+		{
+			++drawcallCount;
+		}
+		prev = &el;
+	});
+
+	return drawcallCount;
+}
+
+/// Check that the renderables point to every element of the storages once and without copying them.
+void checkNoCopy(const RenderableQueueElementArray& renderables, const Array<Storage, kThreadCount>& storages)
+{
+	U32 totalCount = 0;
+	for(const Storage& storage : storages)
+	{
+		totalCount += storage.m_elementCount;
+	}
+	ANKI_TEST_EXPECT_EQ(renderables.getSize(), totalCount);
+
+	DynamicArray<Bool> seen;
+	seen.resize(totalCount, false);
+	for(U32 i = 0; i < renderables.getSize(); ++i)
+	{
+		const RenderableQueueElement& el = renderables[i];
+
+		Bool inStorage = false;
+		for(const Storage& storage : storages)
+		{
+			inStorage = inStorage || (&el >= storage.m_elements && &el < storage.m_elements + storage.m_elementCount);
+		}
+		ANKI_TEST_EXPECT_EQ(inStorage, true);
+
+		ANKI_TEST_EXPECT_EQ(seen[el.m_worldTransformsOffset], false);
+		seen[el.m_worldTransformsOffset] = true;
+	}
+}
+
+} // end anonymous namespace
+
+ANKI_TEST(Scene, RenderableSort)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(getCpuCoresCount());
+		StackMemoryPool framePool(allocAligned, nullptr, 16_MB);
+
+		// A big array to use the parallel sort, a small one and an empty one
+		for(U32 renderableCount : {30000u, 100u, 0u})
+		{
+			framePool.reset();
+
+			Array<Storage, kThreadCount> storages;
+			fillStorages(renderableCount, framePool, storages);
+
+			// Sort by merge key like the deferred renderables
+			RenderableQueueElementArray combined;
+			CombineResultsTask::combineAndSortRenderables(WeakArray<Storage>(storages), combined, framePool, hive,
+														  CombineResultsTask::computeMergeSortKey);
+
+			ANKI_TEST_EXPECT_EQ(combined.getSize(), renderableCount);
+			if(renderableCount == 0)
+			{
+				continue;
+			}
+
+			// The renderables stay in the per-thread storages and they are visited once
+			checkNoCopy(combined, storages);
+
+			// The keys are ascending and equal keys stay in the order of the threads
+			const RenderableQueueElement* prev = nullptr;
+			RenderableDrawer::iterateRange(combined, 0, renderableCount, [&](const RenderableQueueElement& el) {
+				if(prev)
+				{
+					const U32 prevKey = CombineResultsTask::computeMergeSortKey(*prev);
+					const U32 key = CombineResultsTask::computeMergeSortKey(el);
+					ANKI_TEST_EXPECT_LEQ(prevKey, key);
+					if(prevKey == key)
+					{
+						ANKI_TEST_EXPECT_LT(prev->m_worldTransformsOffset, el.m_worldTransformsOffset);
+					}
+				}
+				prev = &el;
+			});
+
+			// Same drawcalls as sorting the elements themselves
+			DynamicArray<RenderableQueueElement> sortedElements;
+			for(const Storage& storage : storages)
+			{
+				for(U32 i = 0; i < storage.m_elementCount; ++i)
+				{
+					sortedElements.emplaceBack(storage.m_elements[i]);
+				}
+			}
+			std::stable_sort(sortedElements.getBegin(), sortedElements.getEnd(),
+							 [](const RenderableQueueElement& a, const RenderableQueueElement& b) {
+								 return CombineResultsTask::computeMergeSortKey(a)
+										< CombineResultsTask::computeMergeSortKey(b);
+							 });
+
+			RenderableQueueElementArray unsorted;
+			CombineResultsTask::combineRenderables(WeakArray<Storage>(storages), unsorted, framePool);
+
+			const U32 drawcallCount = countDrawcalls(combined);
+			ANKI_TEST_EXPECT_EQ(drawcallCount,
+								countDrawcalls(wrapRenderables(WeakArray<RenderableQueueElement>(sortedElements),
+															   framePool)));
+			ANKI_TEST_EXPECT_LT(drawcallCount, countDrawcalls(unsorted));
+
+			// A sub-range visits the same elements as the full range
+			const U32 begin = renderableCount / 3;
+			const U32 end = renderableCount - renderableCount / 4;
+			U32 i = begin;
+			RenderableDrawer::iterateRange(combined, begin, end, [&](const RenderableQueueElement& el) {
+				ANKI_TEST_EXPECT_EQ(&el, &combined[i]);
+				++i;
+			});
+			ANKI_TEST_EXPECT_EQ(i, end);
+
+			// Back to front like the forward renderables
+			CombineResultsTask::combineAndSortRenderables(WeakArray<Storage>(storages), combined, framePool, hive,
+														  CombineResultsTask::computeBackToFrontSortKey);
+			checkNoCopy(combined, storages);
+			prev = nullptr;
+			RenderableDrawer::iterateRange(combined, 0, renderableCount, [&](const RenderableQueueElement& el) {
+				if(prev)
+				{
+					ANKI_TEST_EXPECT_GEQ(prev->m_distanceFromCamera, el.m_distanceFromCamera);
+				}
+				prev = &el;
+			});
+		}
+
+		// Shadows don't sort. The renderables are visited in the order of the threads
+		{
+			framePool.reset();
+
+			constexpr U32 kRenderableCount = 1000;
+			Array<Storage, kThreadCount> storages;
+			fillStorages(kRenderableCount, framePool, storages);
+
+			RenderableQueueElementArray combined;
+			CombineResultsTask::combineRenderables(WeakArray<Storage>(storages), combined, framePool);
+			checkNoCopy(combined, storages);
+
+			U32 i = 0;
+			RenderableDrawer::iterateRange(combined, 0, kRenderableCount, [&](const RenderableQueueElement& el) {
+				ANKI_TEST_EXPECT_EQ(el.m_worldTransformsOffset, i);
+				++i;
+			});
+			ANKI_TEST_EXPECT_EQ(i, kRenderableCount);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, RenderableSortBench)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kRenderableCount = 100000;
+
+		ThreadHive hive(getCpuCoresCount());
+		StackMemoryPool framePool(allocAligned, nullptr, 64_MB);
+
+		// A scene of renderables spread around the camera
+		DynamicArray<RenderableQueueElement> sceneRenderables;
+		sceneRenderables.resize(kRenderableCount);
+		Array<DynamicArray<F32>, 3> aabbMins;
+		Array<DynamicArray<F32>, 3> aabbMaxs;
+		for(U32 d = 0; d < 3; ++d)
+		{
+			aabbMins[d].resize(kRenderableCount);
+			aabbMaxs[d].resize(kRenderableCount);
+		}
+
+		for(U32 i = 0; i < kRenderableCount; ++i)
+		{
+			initRenderable(i, sceneRenderables[i]);
+
+			const Vec3 center(getRandomRange(-500.0f, 500.0f), getRandomRange(-50.0f, 50.0f),
+							  getRandomRange(-500.0f, 500.0f));
+			for(U32 d = 0; d < 3; ++d)
+			{
+				aabbMins[d][i] = center[d] - 1.0f;
+				aabbMaxs[d][i] = center[d] + 1.0f;
+			}
+		}
+
+		// A camera that sees a part of the scene
+		const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(90.0f), toRad(90.0f), 0.1f, 1000.0f);
+		Array<Plane, 6> planes;
+		extractClipPlanes(proj, planes);
+
+		for(U32 iteration = 0; iteration < 2; ++iteration)
+		{
+			framePool.reset();
+
+			// Visibility: Test the boxes and append the visible in per-thread storage like the VisibilityTestTask
+			Second begin = HighRezTimer::getCurrentTime();
+
+			constexpr U32 kBatchSize = 64;
+			Array<Storage, kThreadCount> storages;
+			for(Storage& storage : storages)
+			{
+				storage.m_elementStorage = kRenderableCount / kThreadCount + kBatchSize;
+				storage.m_elements = newArray<RenderableQueueElement>(framePool, storage.m_elementStorage);
+			}
+
+			U64 visibleMask;
+			for(U32 first = 0; first < kRenderableCount; first += kBatchSize)
+			{
+				const U32 count = min(kBatchSize, kRenderableCount - first);
+				testPlanes(ConstWeakArray<Plane>(planes),
+						   {&aabbMins[0][first], &aabbMins[1][first], &aabbMins[2][first]},
+						   {&aabbMaxs[0][first], &aabbMaxs[1][first], &aabbMaxs[2][first]}, count,
+						   WeakArray<U64>(&visibleMask, 1));
+
+				Storage& storage = storages[(first / kBatchSize) % kThreadCount];
+				for(U32 bit = 0; bit < count; ++bit)
+				{
+					if(!(visibleMask & (1_U64 << bit)))
+					{
+						continue;
+					}
+
+					const U32 idx = first + bit;
+					RenderableQueueElement& el = storage.m_elements[storage.m_elementCount++];
+					el = sceneRenderables[idx];
+					const Vec3 pos(aabbMins[0][idx], aabbMins[1][idx], aabbMins[2][idx]);
+					el.m_distanceFromCamera = pos.getLength();
+				}
+			}
+
+			const Second visibilityTime = HighRezTimer::getCurrentTime() - begin;
+
+			// Combine and sort like the CombineResultsTask
+			begin = HighRezTimer::getCurrentTime();
+			RenderableQueueElementArray combined;
+			CombineResultsTask::combineAndSortRenderables(WeakArray<Storage>(storages), combined, framePool, hive,
+														  CombineResultsTask::computeMergeSortKey);
+			const Second sortTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			const U32 drawcallCount = countDrawcalls(combined);
+			const Second drawListTime = HighRezTimer::getCurrentTime() - begin;
+
+			if(iteration == 1)
+			{
+				ANKI_TEST_LOGI("%u visible out of %u renderables, %u drawcalls. Visibility %fms", combined.getSize(),
+							   kRenderableCount, drawcallCount, visibilityTime * 1000.0);
+				ANKI_TEST_LOGI("Combine and sort %fms, draw list %fms", sortTime * 1000.0, drawListTime * 1000.0);
+			}
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
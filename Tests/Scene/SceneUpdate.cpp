@@ -0,0 +1,272 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Util/ParallelFor.h>
+#include <AnKi/Util/Hierarchy.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+#include <AnKi/Math.h>
+
+using namespace anki;
+
+namespace {
+
+/// Something that looks like a SceneNode. The world transform depends on the parent's world transform.
+class BenchNode : public Hierarchy<BenchNode, SingletonMemoryPoolWrapper<DefaultMemoryPool>>
+{
+public:
+	Transform m_localTrf = Transform::getIdentity();
+	Transform m_worldTrf = Transform::getIdentity();
+	U32 m_depth = 0;
+	U32 m_preOrder = kMaxU32;
+	U32 m_postOrder = kMaxU32;
+	U32 m_maxChildPostOrder = 0;
+
+	void update()
+	{
+		// Some busy work to make it look like component updates
+		Transform trf = m_localTrf;
+		for(U32 i = 0; i < 16; ++i)
+		{
+			trf = trf.combineTransformations(m_localTrf);
+		}
+		m_localTrf.setOrigin(m_localTrf.getOrigin() + trf.getOrigin() * 0.0f);
+
+		m_worldTrf = (getParent()) ? getParent()->m_worldTrf.combineTransformations(m_localTrf) : m_localTrf;
+	}
+};
+
+class BenchScene
+{
+public:
+	DynamicArray<BenchNode*> m_nodes;
+	DynamicArray<BenchNode*> m_roots;
+	StackMemoryPool m_tmpPool;
+
+	BenchScene()
+	{
+		m_tmpPool.init(allocAligned, nullptr, 1024 * 1024);
+	}
+
+	~BenchScene()
+	{
+		for(BenchNode* node : m_nodes)
+		{
+			deleteInstance(DefaultMemoryPool::getSingleton(), node);
+		}
+	}
+
+	BenchNode* newNode(BenchNode* parent)
+	{
+		BenchNode* node = newInstance<BenchNode>(DefaultMemoryPool::getSingleton());
+		node->m_localTrf.setOrigin(Vec4(1.0f, 0.0f, 0.0f, 0.0f));
+		if(parent)
+		{
+			parent->addChild(node);
+			node->m_depth = parent->m_depth + 1;
+		}
+		else
+		{
+			m_roots.emplaceBack(node);
+		}
+
+		m_nodes.emplaceBack(node);
+		return node;
+	}
+
+	/// One root with all the nodes as children.
+	void buildWide(U32 nodeCount)
+	{
+		BenchNode* root = newNode(nullptr);
+		for(U32 i = 1; i < nodeCount; ++i)
+		{
+			newNode(root);
+		}
+	}
+
+	/// A few long chains.
+	void buildDeep(U32 nodeCount, U32 chainCount)
+	{
+		for(U32 c = 0; c < chainCount; ++c)
+		{
+			BenchNode* parent = nullptr;
+			for(U32 i = 0; i < nodeCount / chainCount; ++i)
+			{
+				parent = newNode(parent);
+			}
+		}
+	}
+
+	/// One root with a few levels of children, like a city block.
+	void buildBushy(U32 nodeCount, U32 branching)
+	{
+		newNode(nullptr);
+		for(U32 i = 0; m_nodes.getSize() < nodeCount; ++i)
+		{
+			newNode(m_nodes[i / branching]);
+		}
+	}
+
+	/// The old way. Every root is a work item and the children are updated recursively in the same thread.
+	void updateRecursive(ThreadHive& hive)
+	{
+		parallelFor(hive, 0, m_roots.getSize(), 1, [&](U32 begin, U32 end) {
+			for(U32 i = begin; i < end; ++i)
+			{
+				[[maybe_unused]] const Error err = m_roots[i]->visitThisAndChildren([](BenchNode& node) {
+					node.update();
+					return Error::kNone;
+				});
+			}
+		});
+	}
+
+	void updatePerLevel(ThreadHive& hive)
+	{
+		m_tmpPool.reset();
+		[[maybe_unused]] const Error err = parallelForHierarchy(
+			hive, ConstWeakArray<BenchNode*>(&m_roots[0], m_roots.getSize()), m_nodes.getSize(), 16, m_tmpPool,
+			[](BenchNode& node) {
+				node.update();
+				return Error::kNone;
+			},
+			[]([[maybe_unused]] BenchNode& node) {
+				return Error::kNone;
+			});
+	}
+};
+
+} // end anonymous namespace
+
+ANKI_TEST(Scene, HierarchyUpdate)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	for(ThreadHiveMode mode : {ThreadHiveMode::kSharedQueue, ThreadHiveMode::kWorkStealing})
+	{
+		ThreadHive hive(8, false, mode);
+
+		BenchScene scene;
+		scene.buildBushy(5000, 4);
+		scene.buildDeep(1000, 10);
+		scene.buildWide(500);
+
+		Atomic<U32> preCounter = {0};
+		Atomic<U32> postCounter = {0};
+		const Error err = parallelForHierarchy(
+			hive, ConstWeakArray<BenchNode*>(&scene.m_roots[0], scene.m_roots.getSize()), scene.m_nodes.getSize(), 4,
+			scene.m_tmpPool,
+			[&](BenchNode& node) {
+				node.m_preOrder = preCounter.fetchAdd(1);
+				node.update();
+				return Error::kNone;
+			},
+			[&](BenchNode& node) {
+				node.m_postOrder = postCounter.fetchAdd(1);
+				[[maybe_unused]] const Error err = node.visitChildrenMaxDepth(0, [&](BenchNode& child) {
+					node.m_maxChildPostOrder = max(node.m_maxChildPostOrder, child.m_postOrder);
+					return Error::kNone;
+				});
+				return Error::kNone;
+			});
+		ANKI_TEST_EXPECT_EQ(!!err, false);
+		ANKI_TEST_EXPECT_EQ(preCounter.getNonAtomically(), scene.m_nodes.getSize());
+		ANKI_TEST_EXPECT_EQ(postCounter.getNonAtomically(), scene.m_nodes.getSize());
+
+		for(BenchNode* node : scene.m_nodes)
+		{
+			// Parents before children on the way down, children before parents on the way up
+			if(node->getParent())
+			{
+				ANKI_TEST_EXPECT_LT(node->getParent()->m_preOrder, node->m_preOrder);
+			}
+
+			if(node->getChildrenCount())
+			{
+				ANKI_TEST_EXPECT_LT(node->m_maxChildPostOrder, node->m_postOrder);
+			}
+
+			// The world transform was computed from the final world transform of the parent
+			ANKI_TEST_EXPECT_NEAR(node->m_worldTrf.getOrigin().x(), F32(node->m_depth + 1), 0.0001f);
+		}
+
+		// Errors are propagated
+		scene.m_tmpPool.reset();
+		const Error err2 = parallelForHierarchy(
+			hive, ConstWeakArray<BenchNode*>(&scene.m_roots[0], scene.m_roots.getSize()), scene.m_nodes.getSize(), 4,
+			scene.m_tmpPool,
+			[&](BenchNode& node) {
+				return (node.m_depth == 3) ? Error::kUserData : Error::kNone;
+			},
+			[&]([[maybe_unused]] BenchNode& node) {
+				return Error::kNone;
+			});
+		ANKI_TEST_EXPECT_EQ(err2 == Error::kUserData, true);
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, HierarchyUpdateBench)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(getCpuCoresCount(), true, ThreadHiveMode::kWorkStealing);
+		constexpr U32 kNodeCount = 100000;
+		constexpr U32 kIterationCount = 20;
+
+		auto bench = [&](CString name, BenchScene& scene) {
+			// Warm up
+			scene.updateRecursive(hive);
+			scene.updatePerLevel(hive);
+
+			const Second timeA = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterationCount; ++i)
+			{
+				scene.updateRecursive(hive);
+			}
+			const Second timeB = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterationCount; ++i)
+			{
+				scene.updatePerLevel(hive);
+			}
+			const Second timeC = HighRezTimer::getCurrentTime();
+
+			ANKI_TEST_LOGI("%s (%u roots): Recursive per root %fms, per level %fms", name.cstr(),
+						   scene.m_roots.getSize(), (timeB - timeA) * 1000.0 / kIterationCount,
+						   (timeC - timeB) * 1000.0 / kIterationCount);
+		};
+
+		{
+			BenchScene scene;
+			scene.buildWide(kNodeCount);
+			bench("Wide", scene);
+		}
+
+		{
+			BenchScene scene;
+			scene.buildBushy(kNodeCount, 8);
+			bench("Bushy", scene);
+		}
+
+		{
+			BenchScene scene;
+			scene.buildDeep(kNodeCount, 16);
+			bench("Deep", scene);
+		}
+
+		{
+			BenchScene scene;
+			scene.buildDeep(kNodeCount, kNodeCount / 4);
+			bench("Many small", scene);
+		}
+
+		hive.waitAllTasks();
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
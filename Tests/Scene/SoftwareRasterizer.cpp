@@ -0,0 +1,175 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SoftwareRasterizer.h>
+#include <AnKi/Collision/Aabb.h>
+#include <AnKi/Util/ThreadHive.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+
+using namespace anki;
+
+namespace {
+
+/// A camera at the origin looking at -Z.
+class RasterizerCamera
+{
+public:
+	Mat4 m_view = Mat4::getIdentity();
+	Mat4 m_proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(90.0f), toRad(90.0f), 0.1f, 1000.0f);
+};
+
+/// A quad facing the camera as 2 triangles.
+static Array<Vec3, 6> quad(F32 minX, F32 minY, F32 maxX, F32 maxY, F32 z)
+{
+	return {Vec3(minX, minY, z), Vec3(maxX, minY, z), Vec3(maxX, maxY, z),
+			Vec3(maxX, maxY, z), Vec3(minX, maxY, z), Vec3(minX, minY, z)};
+}
+
+static Aabb box(const Vec3& center, F32 halfSize)
+{
+	return Aabb(center - Vec3(halfSize), center + Vec3(halfSize));
+}
+
+} // end anonymous namespace
+
+ANKI_TEST(Scene, SoftwareRasterizer)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(4);
+		RasterizerCamera cam;
+		SoftwareRasterizer r;
+
+		// Odd sizes to test the padding
+		for(Bool parallel : {false, true})
+		{
+			r.prepare(cam.m_view, cam.m_proj, 253, 131);
+
+			// Nothing drawn, everything in the frustum is visible
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(0.0f, 0.0f, -50.0f), 1.0f)), true);
+
+			// A big occluder in the middle of the screen. Draw it with both windings
+			Array<Vec3, 6> occluder = quad(-10.0f, -10.0f, 10.0f, 10.0f, -20.0f);
+			r.draw(&occluder[0][0], 6, sizeof(Vec3), false);
+			std::swap(occluder[0], occluder[1]);
+			std::swap(occluder[3], occluder[4]);
+			r.draw(&occluder[0][0], 6, sizeof(Vec3), false);
+			r.flush((parallel) ? &hive : nullptr);
+
+			// Behind the occluder
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(0.0f, 0.0f, -50.0f), 1.0f)), false);
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(5.0f, -5.0f, -40.0f), 2.0f)), false);
+
+			// In front of the occluder
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(0.0f, 0.0f, -10.0f), 1.0f)), true);
+
+			// Crosses the occluder
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(0.0f, 0.0f, -20.0f), 1.0f)), true);
+
+			// Behind but it peeks from the side
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(18.0f, 0.0f, -40.0f), 2.0f)), true);
+
+			// Crosses the near plane
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(0.0f, 0.0f, 0.0f), 1.0f)), true);
+		}
+
+		// Depth buffer from somewhere else: Left half near and right half far
+		{
+			constexpr U32 kWidth = 64;
+			constexpr U32 kHeight = 32;
+			Array<F32, kWidth * kHeight> depths;
+			for(U32 y = 0; y < kHeight; ++y)
+			{
+				for(U32 x = 0; x < kWidth; ++x)
+				{
+					depths[y * kWidth + x] = (x < kWidth / 2) ? 0.5f : 1.0f;
+				}
+			}
+
+			r.prepare(cam.m_view, cam.m_proj, kWidth, kHeight);
+			r.fillDepthBuffer(ConstWeakArray<F32>(depths));
+
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(-50.0f, 0.0f, -100.0f), 1.0f)), false);
+			ANKI_TEST_EXPECT_EQ(r.visibilityTest(box(Vec3(50.0f, 0.0f, -100.0f), 1.0f)), true);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, SoftwareRasterizerBench)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kWidth = 256;
+		constexpr U32 kHeight = 128;
+		constexpr U32 kTriangleCount = 20000;
+		constexpr U32 kTestCount = 100000;
+
+		ThreadHive hive(getCpuCoresCount());
+		RasterizerCamera cam;
+		SoftwareRasterizer r;
+
+		// Random triangles of random sizes in front of the camera
+		DynamicArray<Vec3> verts;
+		verts.resize(kTriangleCount * 3);
+		for(U32 i = 0; i < kTriangleCount; ++i)
+		{
+			const Vec3 center(getRandomRange(-100.0f, 100.0f), getRandomRange(-50.0f, 50.0f),
+							  getRandomRange(-150.0f, -20.0f));
+			const F32 size = (i % 16 == 0) ? 20.0f : 2.0f;
+			for(U32 v = 0; v < 3; ++v)
+			{
+				verts[i * 3 + v] = center
+								   + Vec3(getRandomRange(-size, size), getRandomRange(-size, size),
+										  getRandomRange(-size, size));
+			}
+		}
+
+		DynamicArray<Aabb> boxes;
+		boxes.resize(kTestCount);
+		for(Aabb& b : boxes)
+		{
+			b = box(Vec3(getRandomRange(-150.0f, 150.0f), getRandomRange(-75.0f, 75.0f),
+						 getRandomRange(-200.0f, -10.0f)),
+					getRandomRange(0.5f, 3.0f));
+		}
+
+		for(Bool parallel : {false, true})
+		{
+			r.prepare(cam.m_view, cam.m_proj, kWidth, kHeight);
+
+			Second begin = HighRezTimer::getCurrentTime();
+			r.draw(&verts[0][0], verts.getSize(), sizeof(Vec3), false);
+			const Second binTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			r.flush((parallel) ? &hive : nullptr);
+			const Second rasterTime = HighRezTimer::getCurrentTime() - begin;
+
+			U32 visibleCount = 0;
+			begin = HighRezTimer::getCurrentTime();
+			for(const Aabb& b : boxes)
+			{
+				visibleCount += r.visibilityTest(b);
+			}
+			const Second testTime = HighRezTimer::getCurrentTime() - begin;
+
+			ANKI_TEST_LOGI("%s: Binning %fms, rasterization %fms, %u tests %fms (%u visible)",
+						   (parallel) ? "Parallel" : "Serial", binTime * 1000.0, rasterTime * 1000.0, kTestCount,
+						   testTime * 1000.0, visibleCount);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+}
@@ -7,6 +7,8 @@
 #include <Tests/Util/Foo.h>
 #include <AnKi/Util/MemoryPool.h>
 #include <AnKi/Util/ThreadPool.h>
+#include <AnKi/Util/ThreadHive.h>
+#include <AnKi/Util/HighRezTimer.h>
 #include <type_traits>
 #include <cstring>
 
@@ -33,6 +35,154 @@ ANKI_TEST(Util, HeapMemoryPool)
 	}
 }
 
+ANKI_TEST(Util, ThreadCachingHeapMemoryPool)
+{
+	// Small and big allocations
+	{
+		HeapMemoryPool pool(allocAligned, nullptr, "Test", true);
+
+		Array<std::pair<PtrSize, PtrSize>, 7> sizesAndAlignments = {
+			{{1, 1}, {16, 16}, {100, 8}, {2000, 16}, {2048, 16}, {64, 64}, {100_KB, 32}}};
+
+		Array<void*, sizesAndAlignments.getSize()> ptrs;
+		for(U32 i = 0; i < sizesAndAlignments.getSize(); ++i)
+		{
+			const auto [size, alignment] = sizesAndAlignments[i];
+			ptrs[i] = pool.allocate(size, alignment);
+			ANKI_TEST_EXPECT_NEQ(ptrs[i], nullptr);
+			ANKI_TEST_EXPECT_EQ(isAligned(alignment, ptrs[i]), true);
+			memset(ptrs[i], I32(i), size);
+		}
+
+		HeapMemoryPoolStats stats;
+		pool.getStats(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, sizesAndAlignments.getSize());
+		ANKI_TEST_EXPECT_EQ(stats.m_threadCacheCount, 1);
+		ANKI_TEST_EXPECT_GT(stats.m_classInUseSize, 0);
+
+		for(U32 i = 0; i < sizesAndAlignments.getSize(); ++i)
+		{
+			const U8* ptr = static_cast<const U8*>(ptrs[i]);
+			for(PtrSize j = 0; j < sizesAndAlignments[i].first; ++j)
+			{
+				ANKI_TEST_EXPECT_EQ(ptr[j], U8(i));
+			}
+
+			pool.free(ptrs[i]);
+		}
+
+		pool.getStats(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_classInUseSize, stats.m_threadCachedSize);
+	}
+
+	// Threads that exit give their caches back
+	{
+		HeapMemoryPool pool(allocAligned, nullptr, "Test", true);
+
+		Thread thread("CacheTest");
+		thread.start(&pool, [](ThreadCallbackInfo& info) -> Error {
+			HeapMemoryPool& pool = *static_cast<HeapMemoryPool*>(info.m_userData);
+			Array<void*, 64> ptrs;
+			for(void*& ptr : ptrs)
+			{
+				ptr = pool.allocate(100, 8);
+			}
+
+			for(void* ptr : ptrs)
+			{
+				pool.free(ptr);
+			}
+			return Error::kNone;
+		});
+		ANKI_TEST_EXPECT_NO_ERR(thread.join());
+
+		HeapMemoryPoolStats stats;
+		pool.getStats(stats);
+		ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_threadCacheCount, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_threadCachedSize, 0);
+		ANKI_TEST_EXPECT_EQ(stats.m_classInUseSize, 0);
+	}
+
+	// Allocate in some threads and free in others. Then benchmark against a pool without thread caching
+	{
+		constexpr U32 kThreadCount = 8;
+		constexpr U32 kIterationCount = 200000;
+		constexpr U32 kLiveAllocationCount = 256;
+		ThreadPool threadPool(kThreadCount);
+
+		class ChurnTask : public ThreadPoolTask
+		{
+		public:
+			HeapMemoryPool* m_pool = nullptr;
+			Array<void*, kLiveAllocationCount>* m_allocations = nullptr;
+			Bool m_failed = false;
+
+			Error operator()(U32 taskId, [[maybe_unused]] PtrSize threadsCount)
+			{
+				Array<void*, kLiveAllocationCount>& allocations = *m_allocations;
+				U32 seed = taskId + 1;
+				for(U32 i = 0; i < kIterationCount; ++i)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					const U32 idx = (seed >> 8) % kLiveAllocationCount;
+					const PtrSize size = 8 + (seed >> 20) % 512;
+
+					if(allocations[idx])
+					{
+						m_failed = m_failed || *static_cast<U32*>(allocations[idx]) != idx;
+						m_pool->free(allocations[idx]);
+					}
+
+					allocations[idx] = m_pool->allocate(size, 8);
+					*static_cast<U32*>(allocations[idx]) = idx;
+				}
+
+				return Error::kNone;
+			}
+		};
+
+		auto churn = [&](Bool threadCaching) {
+			HeapMemoryPool pool(allocAligned, nullptr, "Churn", threadCaching);
+			Array<Array<void*, kLiveAllocationCount>, kThreadCount> allocations = {};
+			Array<ChurnTask, kThreadCount> tasks;
+
+			const Second begin = HighRezTimer::getCurrentTime();
+			for(U32 pass = 0; pass < 2; ++pass)
+			{
+				for(U32 i = 0; i < kThreadCount; ++i)
+				{
+					// On the 2nd pass the threads free what the others allocated
+					tasks[i].m_pool = &pool;
+					tasks[i].m_allocations = &allocations[(i + pass) % kThreadCount];
+					threadPool.assignNewTask(i, &tasks[i]);
+				}
+
+				ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+			}
+			const Second time = HighRezTimer::getCurrentTime() - begin;
+
+			for(U32 i = 0; i < kThreadCount; ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(tasks[i].m_failed, false);
+				for(void* ptr : allocations[i])
+				{
+					pool.free(ptr);
+				}
+			}
+
+			ANKI_TEST_EXPECT_EQ(pool.getAllocationCount(), 0);
+			return time;
+		};
+
+		const Second systemTime = churn(false);
+		const Second cachingTime = churn(true);
+		ANKI_TEST_LOGI("Multi-threaded churn: system allocator %fms, thread caching %fms", systemTime * 1000.0,
+					   cachingTime * 1000.0);
+	}
+}
+
 ANKI_TEST(Util, StackMemoryPool)
 {
 	// Create/destroy test
@@ -157,3 +307,83 @@ ANKI_TEST(Util, StackMemoryPool)
 		}
 	}
 }
+
+ANKI_TEST(Util, StackMemoryPoolThreadArenas)
+{
+	constexpr U32 kThreadCount = 8;
+	constexpr U32 kTaskCount = 64;
+	constexpr U32 kAllocationsPerTask = 20000;
+
+	class Task
+	{
+	public:
+		StackMemoryPool* m_pool = nullptr;
+		U32 m_idx = 0;
+		Bool m_failed = false;
+
+		static void callback(void* ud, [[maybe_unused]] U32 threadId, [[maybe_unused]] ThreadHive& hive,
+							 [[maybe_unused]] ThreadHiveSemaphore* sem)
+		{
+			Task& self = *static_cast<Task*>(ud);
+			U32* prev = nullptr;
+			for(U32 i = 0; i < kAllocationsPerTask; ++i)
+			{
+				const PtrSize alignment = (i & 1) ? 16 : 4;
+				U32* ptr = static_cast<U32*>(self.m_pool->allocate(4 + (i % 7) * 12, alignment));
+				self.m_failed = self.m_failed || !isAligned(alignment, ptrToNumber(ptr));
+				*ptr = self.m_idx;
+
+				// The previous allocation shouldn't have been overwritten by another thread
+				self.m_failed = self.m_failed || (prev && *prev != self.m_idx);
+				prev = ptr;
+			}
+		}
+	};
+
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(kThreadCount);
+
+		auto run = [&](PtrSize threadArenaSize) {
+			StackMemoryPool pool(allocAligned, nullptr, 1_MB, 2.0, 0, true, ANKI_SAFE_ALIGNMENT, "Frame",
+								 threadArenaSize);
+			Array<Task, kTaskCount> tasks;
+
+			Second time = 0.0;
+			for(U32 frame = 0; frame < 4; ++frame)
+			{
+				pool.reset();
+
+				const Second begin = HighRezTimer::getCurrentTime();
+				for(U32 i = 0; i < kTaskCount; ++i)
+				{
+					tasks[i].m_pool = &pool;
+					tasks[i].m_idx = i;
+					hive.submitTask(Task::callback, &tasks[i]);
+				}
+				hive.waitAllTasks();
+				time += HighRezTimer::getCurrentTime() - begin;
+
+				for(const Task& task : tasks)
+				{
+					ANKI_TEST_EXPECT_EQ(task.m_failed, false);
+				}
+			}
+
+			// Big allocations bypass the arenas
+			void* big = pool.allocate(2_MB, 16);
+			ANKI_TEST_EXPECT_NEQ(big, nullptr);
+			memset(big, 0, 2_MB);
+
+			return time;
+		};
+
+		const Second sharedTime = run(0);
+		const Second arenasTime = run(64_KB);
+		ANKI_TEST_LOGI("Small allocations from %u threads: shared chunks %fms, thread arenas %fms", kThreadCount,
+					   sharedTime * 1000.0, arenasTime * 1000.0);
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
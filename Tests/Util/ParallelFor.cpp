@@ -0,0 +1,145 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Util/ParallelFor.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+
+ANKI_TEST(Util, ParallelFor)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	for(ThreadHiveMode mode : {ThreadHiveMode::kSharedQueue, ThreadHiveMode::kWorkStealing})
+	{
+		ThreadHive hive(8, false, mode);
+
+		// Every element is visited exactly once
+		{
+			constexpr U32 kCount = 100000;
+			DynamicArray<U8> visited;
+			visited.resize(kCount, U8(0));
+
+			parallelFor(hive, 0, kCount, 16, [&](U32 begin, U32 end) {
+				for(U32 i = begin; i < end; ++i)
+				{
+					++visited[i];
+				}
+			});
+
+			for(U32 i = 0; i < kCount; ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(visited[i], 1);
+			}
+		}
+
+		// Empty and tiny ranges
+		{
+			U32 calls = 0;
+			parallelFor(hive, 10, 10, 1, [&]([[maybe_unused]] U32 begin, [[maybe_unused]] U32 end) {
+				++calls;
+			});
+			ANKI_TEST_EXPECT_EQ(calls, 0);
+
+			parallelFor(hive, 10, 13, 8, [&](U32 begin, U32 end) {
+				ANKI_TEST_EXPECT_EQ(begin, 10);
+				ANKI_TEST_EXPECT_EQ(end, 13);
+				++calls;
+			});
+			ANKI_TEST_EXPECT_EQ(calls, 1);
+		}
+
+		// Reduce
+		{
+			constexpr U32 kCount = 1000000;
+			const U64 sum = parallelReduce(
+				hive, 0, kCount, 128, U64(0),
+				[](U32 begin, U32 end) {
+					U64 s = 0;
+					for(U32 i = begin; i < end; ++i)
+					{
+						s += i;
+					}
+					return s;
+				},
+				[](U64 a, U64 b) {
+					return a + b;
+				});
+
+			ANKI_TEST_EXPECT_EQ(sum, U64(kCount) * (kCount - 1) / 2);
+		}
+
+		// Nested inside hive tasks
+		{
+			class Ctx
+			{
+			public:
+				Atomic<U64> m_sum = {0};
+			} ctx;
+
+			constexpr U32 kTaskCount = 16;
+			constexpr U32 kCount = 1000;
+			Array<ThreadHiveTask, kTaskCount> tasks;
+			for(ThreadHiveTask& task : tasks)
+			{
+				task.m_callback = [](void* arg, [[maybe_unused]] U32 threadId, ThreadHive& hive,
+									 [[maybe_unused]] ThreadHiveSemaphore* sem) {
+					Ctx& ctx = *static_cast<Ctx*>(arg);
+					parallelFor(hive, 0, kCount, 10, [&](U32 begin, U32 end) {
+						U64 s = 0;
+						for(U32 i = begin; i < end; ++i)
+						{
+							s += i;
+						}
+						ctx.m_sum.fetchAdd(s);
+					});
+				};
+				task.m_argument = &ctx;
+			}
+
+			hive.submitTasks(&tasks[0], kTaskCount);
+			hive.waitAllTasks();
+
+			ANKI_TEST_EXPECT_EQ(ctx.m_sum.getNonAtomically(), U64(kTaskCount) * kCount * (kCount - 1) / 2);
+		}
+
+		hive.waitAllTasks();
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Util, ParallelForBench)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(getCpuCoresCount(), true, ThreadHiveMode::kWorkStealing);
+
+		constexpr U32 kCount = 4 * 1024 * 1024;
+		DynamicArray<F32> values;
+		values.resize(kCount);
+
+		auto work = [&](U32 begin, U32 end) {
+			for(U32 i = begin; i < end; ++i)
+			{
+				values[i] = sqrt(F32(i)) * sin(F32(i));
+			}
+		};
+
+		const Second timeA = HighRezTimer::getCurrentTime();
+		work(0, kCount);
+		const Second timeB = HighRezTimer::getCurrentTime();
+		parallelFor(hive, 0, kCount, 1024, work);
+		const Second timeC = HighRezTimer::getCurrentTime();
+
+		ANKI_TEST_LOGI("Serial %fms, parallelFor with %u threads %fms", (timeB - timeA) * 1000.0,
+					   hive.getThreadCount() + 1, (timeC - timeB) * 1000.0);
+
+		hive.waitAllTasks();
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,142 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Util/RadixSort.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+#include <algorithm>
+
+using namespace anki;
+
+namespace {
+
+/// Big enough to make moving the elements around expensive.
+class RadixSortElement
+{
+public:
+	U64 m_key;
+	U32 m_originalIdx;
+	F32 m_distance;
+	Array<U8, 88> m_payload;
+};
+
+} // end anonymous namespace
+
+ANKI_TEST(Util, RadixSort)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadHive hive(8);
+
+		// Different sizes to hit the insertion sort, the serial and the parallel paths
+		for(U32 count : {0u, 1u, 13u, 1000u, 100000u})
+		{
+			for(Bool parallel : {false, true})
+			{
+				DynamicArray<RadixSortElement> elements;
+				elements.resize(count);
+				for(U32 i = 0; i < count; ++i)
+				{
+					// Few unique keys to test the stability
+					elements[i].m_key = (U64(getRandom() % 64) << 40u) | (getRandom() % 4);
+					elements[i].m_originalIdx = i;
+					elements[i].m_distance = getRandomRange(-1000.0f, 1000.0f);
+				}
+
+				DynamicArray<RadixSortElement> expected;
+				expected.resize(count);
+				std::copy(elements.getBegin(), elements.getEnd(), expected.getBegin());
+
+				std::stable_sort(expected.getBegin(), expected.getEnd(),
+								 [](const RadixSortElement& a, const RadixSortElement& b) {
+									 return a.m_key < b.m_key;
+								 });
+				radixSort(WeakArray<RadixSortElement>(elements), DefaultMemoryPool::getSingleton(),
+						  (parallel) ? &hive : nullptr, [](const RadixSortElement& el) {
+							  return el.m_key;
+						  });
+
+				for(U32 i = 0; i < count; ++i)
+				{
+					ANKI_TEST_EXPECT_EQ(elements[i].m_key, expected[i].m_key);
+					ANKI_TEST_EXPECT_EQ(elements[i].m_originalIdx, expected[i].m_originalIdx);
+				}
+
+				// Floats in descending order
+				radixSort(WeakArray<RadixSortElement>(elements), DefaultMemoryPool::getSingleton(),
+						  (parallel) ? &hive : nullptr, [](const RadixSortElement& el) {
+							  return ~floatToRadixKey(el.m_distance);
+						  });
+
+				for(U32 i = 1; i < count; ++i)
+				{
+					ANKI_TEST_EXPECT_GEQ(elements[i - 1].m_distance, elements[i].m_distance);
+				}
+			}
+		}
+
+		// Benchmark against std::sort
+		{
+			constexpr U32 kCount = 100000;
+			DynamicArray<RadixSortElement> elements;
+			elements.resize(kCount);
+			DynamicArray<RadixSortElement> copy;
+			copy.resize(kCount);
+			for(U32 i = 0; i < kCount; ++i)
+			{
+				elements[i].m_key = getRandom();
+				copy[i] = elements[i];
+			}
+
+			Second begin = HighRezTimer::getCurrentTime();
+			std::sort(copy.getBegin(), copy.getEnd(), [](const RadixSortElement& a, const RadixSortElement& b) {
+				return a.m_key < b.m_key;
+			});
+			const Second stdTime = HighRezTimer::getCurrentTime() - begin;
+
+			for(Bool parallel : {false, true})
+			{
+				for(U32 keyBits : {64u, 32u})
+				{
+					DynamicArray<RadixSortElement> elements2;
+					elements2.resize(kCount);
+
+					// Use a stack pool like the frame allocator. Run it twice, the 1st time warms up the pool's memory
+					StackMemoryPool framePool(allocAligned, nullptr, 32_MB);
+					Second radixTime = 0.0;
+					for(U32 run = 0; run < 2; ++run)
+					{
+						framePool.reset();
+						std::copy(elements.getBegin(), elements.getEnd(), elements2.getBegin());
+
+						begin = HighRezTimer::getCurrentTime();
+						if(keyBits == 64)
+						{
+							radixSort(WeakArray<RadixSortElement>(elements2), framePool, (parallel) ? &hive : nullptr,
+									  [](const RadixSortElement& el) {
+										  return el.m_key;
+									  });
+						}
+						else
+						{
+							radixSort(WeakArray<RadixSortElement>(elements2), framePool, (parallel) ? &hive : nullptr,
+									  [](const RadixSortElement& el) {
+										  return U32(el.m_key >> 32u);
+									  });
+						}
+						radixTime = HighRezTimer::getCurrentTime() - begin;
+					}
+
+					ANKI_TEST_LOGI("%u elements: std::sort %fms, %s radixSort with %u bit keys %fms", kCount,
+								   stdTime * 1000.0, (parallel) ? "parallel" : "serial", keyBits, radixTime * 1000.0);
+				}
+			}
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
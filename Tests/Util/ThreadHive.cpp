@@ -65,11 +65,10 @@ static void taskToWait(void* arg, [[maybe_unused]] U32 threadId, [[maybe_unused]
 
 } // namespace
 
-ANKI_TEST(Util, ThreadHive)
+static void testThreadHive(ThreadHiveMode mode)
 {
 	const U32 threadCount = 32;
-	HeapMemoryPool pool(allocAligned, nullptr);
-	ThreadHive hive(threadCount, &pool);
+	ThreadHive hive(threadCount, false, mode);
 
 	// Simple test
 	if(1)
@@ -131,6 +130,53 @@ ANKI_TEST(Util, ThreadHive)
 		ANKI_TEST_EXPECT_EQ(ctx.m_countAtomic.getNonAtomically(), DEP_TASKS * 2 + 10);
 	}
 
+	// Long dependency chain submitted in reverse order
+	if(1)
+	{
+		constexpr U32 kChainLength = 1000;
+
+		class ChainLink
+		{
+		public:
+			U32* m_counter;
+			U32 m_idx;
+			Bool m_inOrder;
+		};
+
+		U32 counter = 0;
+		Array<ChainLink, kChainLength> links;
+		Array<ThreadHiveTask, kChainLength> chainTasks;
+		for(U32 i = 0; i < kChainLength; ++i)
+		{
+			links[i].m_counter = &counter;
+			links[i].m_idx = i;
+			links[i].m_inOrder = false;
+
+			chainTasks[i].m_callback = [](void* arg, [[maybe_unused]] U32 threadId, [[maybe_unused]] ThreadHive& hive,
+										  [[maybe_unused]] ThreadHiveSemaphore* sem) {
+				ChainLink& link = *static_cast<ChainLink*>(arg);
+				link.m_inOrder = *link.m_counter == link.m_idx;
+				++(*link.m_counter);
+			};
+			chainTasks[i].m_argument = &links[i];
+			chainTasks[i].m_signalSemaphore = hive.newSemaphore(1);
+			chainTasks[i].m_waitSemaphore = (i > 0) ? chainTasks[i - 1].m_signalSemaphore : nullptr;
+		}
+
+		for(U32 i = kChainLength; i-- > 0;)
+		{
+			hive.submitTasks(&chainTasks[i], 1);
+		}
+
+		hive.waitAllTasks();
+
+		ANKI_TEST_EXPECT_EQ(counter, kChainLength);
+		for(const ChainLink& link : links)
+		{
+			ANKI_TEST_EXPECT_EQ(link.m_inOrder, true);
+		}
+	}
+
 	// Fuzzy test
 	if(1)
 	{
@@ -176,6 +222,14 @@ ANKI_TEST(Util, ThreadHive)
 	}
 }
 
+ANKI_TEST(Util, ThreadHive)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	testThreadHive(ThreadHiveMode::kSharedQueue);
+	testThreadHive(ThreadHiveMode::kWorkStealing);
+	DefaultMemoryPool::freeSingleton();
+}
+
 namespace {
 
 class FibTask
@@ -237,22 +291,132 @@ ANKI_TEST(Util, ThreadHiveBench)
 {
 	static const U FIB_N = 32;
 
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
 	const U32 threadCount = getCpuCoresCount();
-	HeapMemoryPool pool(allocAligned, nullptr);
-	ThreadHive hive(threadCount, true);
 
-	StackAllocator<U8> salloc(allocAligned, nullptr, 1024);
-	Atomic<U64> sum = {0};
-	FibTask task(&sum, salloc, FIB_N);
+	for(ThreadHiveMode mode : {ThreadHiveMode::kSharedQueue, ThreadHiveMode::kWorkStealing})
+	{
+		ThreadHive hive(threadCount, true, mode);
+
+		StackAllocator<U8> salloc(allocAligned, nullptr, 1024);
+		Atomic<U64> sum = {0};
+		FibTask task(&sum, salloc, FIB_N);
+
+		auto timeA = HighRezTimer::getCurrentTime();
+		hive.submitTask(FibTask::callback, &task);
+		hive.waitAllTasks();
+
+		auto timeB = HighRezTimer::getCurrentTime();
+		const U64 serialFib = fib(FIB_N);
+		auto timeC = HighRezTimer::getCurrentTime();
+
+		ANKI_TEST_LOGI("%s: Total time %fms. Ground truth %fms",
+					   (mode == ThreadHiveMode::kWorkStealing) ? "Work-stealing" : "Shared queue",
+					   (timeB - timeA) * 1000.0, (timeC - timeB) * 1000.0);
+		ANKI_TEST_EXPECT_EQ(sum.getNonAtomically(), serialFib);
+	}
 
-	auto timeA = HighRezTimer::getCurrentTime();
-	hive.submitTask(FibTask::callback, &task);
-	hive.waitAllTasks();
+	DefaultMemoryPool::freeSingleton();
+}
 
-	auto timeB = HighRezTimer::getCurrentTime();
-	const U64 serialFib = fib(FIB_N);
-	auto timeC = HighRezTimer::getCurrentTime();
+namespace {
+
+/// Mimics the visibility tests: a gather task that spawns many small test tasks and a combine task that waits on them.
+class ThroughputContext
+{
+public:
+	Atomic<U64> m_sum = {0};
+	ThreadHiveSemaphore* m_testsSem = nullptr;
+	U32 m_testTaskCount = 0;
+	U32 m_workPerTask = 0;
+
+	static void test(void* arg, [[maybe_unused]] U32 threadId, [[maybe_unused]] ThreadHive& hive,
+					 [[maybe_unused]] ThreadHiveSemaphore* sem)
+	{
+		ThroughputContext& self = *static_cast<ThroughputContext*>(arg);
+		U64 x = 0;
+		for(U32 i = 0; i < self.m_workPerTask; ++i)
+		{
+			x += i ^ (x >> 3);
+		}
+		self.m_sum.fetchAdd((x & 1) + 1);
+	}
+
+	static void gather(void* arg, [[maybe_unused]] U32 threadId, ThreadHive& hive,
+					   [[maybe_unused]] ThreadHiveSemaphore* sem)
+	{
+		ThroughputContext& self = *static_cast<ThroughputContext*>(arg);
+		for(U32 i = 0; i < self.m_testTaskCount; ++i)
+		{
+			ThreadHiveTask task;
+			task.m_callback = test;
+			task.m_argument = &self;
+			task.m_signalSemaphore = self.m_testsSem;
+			hive.submitTasks(&task, 1);
+		}
+	}
+
+	static void combine([[maybe_unused]] void* arg, [[maybe_unused]] U32 threadId,
+						[[maybe_unused]] ThreadHive& hive, [[maybe_unused]] ThreadHiveSemaphore* sem)
+	{
+	}
+};
+
+} // namespace
+
+ANKI_TEST(Util, ThreadHiveThroughputBench)
+{
+	const U32 threadCount = min(getCpuCoresCount(), ThreadHive::kMaxThreads);
+	constexpr U32 kFrameCount = 50;
+	constexpr U32 kGathersPerFrame = 8;
+	constexpr U32 kTestsPerGather = 256;
+
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	for(ThreadHiveMode mode : {ThreadHiveMode::kSharedQueue, ThreadHiveMode::kWorkStealing})
+	{
+		ThreadHive hive(threadCount, true, mode);
+		Array<ThroughputContext, kGathersPerFrame> ctxs;
+
+		const Second timeA = HighRezTimer::getCurrentTime();
+		for(U32 frame = 0; frame < kFrameCount; ++frame)
+		{
+			for(ThroughputContext& ctx : ctxs)
+			{
+				ctx.m_testTaskCount = kTestsPerGather;
+				ctx.m_workPerTask = 512;
+
+				ctx.m_testsSem = hive.newSemaphore(kTestsPerGather);
+
+				ThreadHiveTask gatherTask;
+				gatherTask.m_callback = ThroughputContext::gather;
+				gatherTask.m_argument = &ctx;
+
+				ThreadHiveTask combineTask;
+				combineTask.m_callback = ThroughputContext::combine;
+				combineTask.m_argument = &ctx;
+				combineTask.m_waitSemaphore = ctx.m_testsSem;
+
+				hive.submitTasks(&gatherTask, 1);
+				hive.submitTasks(&combineTask, 1);
+			}
+
+			hive.waitAllTasks();
+		}
+		const Second timeB = HighRezTimer::getCurrentTime();
+
+		U64 sum = 0;
+		for(ThroughputContext& ctx : ctxs)
+		{
+			sum += ctx.m_sum.getNonAtomically();
+		}
+		ANKI_TEST_EXPECT_GEQ(sum, U64(kFrameCount) * kTestsPerGather * kGathersPerFrame);
+
+		const U32 taskCount = kFrameCount * kGathersPerFrame * (kTestsPerGather + 2);
+		ANKI_TEST_LOGI("%s: %u threads, %u tasks in %fms (%f tasks/ms)",
+					   (mode == ThreadHiveMode::kWorkStealing) ? "Work-stealing" : "Shared queue", threadCount,
+					   taskCount, (timeB - timeA) * 1000.0, F64(taskCount) / ((timeB - timeA) * 1000.0));
+	}
 
-	ANKI_TEST_LOGI("Total time %fms. Ground truth %fms", (timeB - timeA) * 1000.0, (timeC - timeB) * 1000.0);
-	ANKI_TEST_EXPECT_EQ(sum.getNonAtomically(), serialFib);
+	DefaultMemoryPool::freeSingleton();
 }
@@ -7,6 +7,7 @@
 #include <AnKi/Util/Tracer.h>
 #include <AnKi/Core/CoreTracer.h>
 #include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Math/Functions.h>
 
 #if ANKI_ENABLE_TRACE
 ANKI_TEST(Util, Tracer)
@@ -55,3 +56,79 @@ ANKI_TEST(Util, Tracer)
 	CoreTracer::freeSingleton();
 }
 #endif
+
+ANKI_TEST(Util, TracerFlightRecorder)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	Tracer::allocateSingleton();
+	Tracer& tracer = Tracer::getSingleton();
+	tracer.setFlightRecorder(8_KB);
+	tracer.setEnabled(true);
+
+	// Write more than the ring buffer can hold
+	constexpr U32 kEventCount = 10000;
+	for(U32 i = 0; i < kEventCount; ++i)
+	{
+		// Nested events end in reverse order
+		tracer.addCustomEvent("tInner", 10.0 + Second(i) * 0.001 + 0.0002, 0.0005);
+		tracer.addCustomEvent("tOuter", 10.0 + Second(i) * 0.001, 0.0009);
+		tracer.incrementCounter("cCounter", i);
+	}
+
+	// Nothing is flushed in that mode
+	tracer.flush(
+		[](void*, ThreadId, ConstWeakArray<TracerEvent> events, ConstWeakArray<TracerCounter> counters) {
+			ANKI_TEST_EXPECT_EQ(events.getSize() + counters.getSize(), 0);
+		},
+		nullptr);
+
+	ANKI_TEST_EXPECT_NO_ERR(tracer.dumpFlightRecorder("./flight.ankitrace"));
+	Tracer::freeSingleton();
+
+	class Ctx
+	{
+	public:
+		U32 m_recordCount = 0;
+		U32 m_lastOuter = kMaxU32;
+		U64 m_lastCounterValue = kMaxU64;
+		Bool m_failed = false;
+	} ctx;
+
+	ANKI_TEST_EXPECT_NO_ERR(Tracer::readFlightRecorderDump(
+		"./flight.ankitrace",
+		[](void* ud, const TracerDumpRecord& record) {
+			Ctx& ctx = *static_cast<Ctx*>(ud);
+			++ctx.m_recordCount;
+
+			if(record.m_name == "tOuter")
+			{
+				const U32 i = U32((record.m_start - 10.0) * 1000.0 + 0.5);
+				ctx.m_failed = ctx.m_failed || absolute(record.m_duration - 0.0009) > 1e-8;
+				ctx.m_failed = ctx.m_failed || (ctx.m_lastOuter != kMaxU32 && i != ctx.m_lastOuter + 1);
+				ctx.m_lastOuter = i;
+			}
+			else if(record.m_name == "tInner")
+			{
+				ctx.m_failed = ctx.m_failed || absolute(record.m_duration - 0.0005) > 1e-8;
+			}
+			else if(record.m_name == "cCounter")
+			{
+				ctx.m_failed = ctx.m_failed || !record.m_isCounter;
+				ctx.m_lastCounterValue = record.m_counterValue;
+			}
+			else
+			{
+				ctx.m_failed = true;
+			}
+		},
+		&ctx));
+
+	// Only the latest records survived
+	ANKI_TEST_EXPECT_EQ(ctx.m_failed, false);
+	ANKI_TEST_EXPECT_GT(ctx.m_recordCount, 0);
+	ANKI_TEST_EXPECT_LT(ctx.m_recordCount, kEventCount * 3);
+	ANKI_TEST_EXPECT_EQ(ctx.m_lastOuter, kEventCount - 1);
+	ANKI_TEST_EXPECT_EQ(ctx.m_lastCounterValue, kEventCount - 1);
+
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,94 @@
+// Copyright (C) 2009-2023, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Util/Tracer.h>
+#include <AnKi/Util/File.h>
+
+using namespace anki;
+
+static const char* kUsage = R"(Convert a flight recorder dump of the tracer to Chrome's JSON trace format
+Perfetto can open the output as well
+Usage: %s input_flight_recorder_dump output_json
+)";
+
+class ConvertContext
+{
+public:
+	File m_file;
+	Error m_err = Error::kNone;
+	U32 m_eventCount = 0;
+	U32 m_counterCount = 0;
+};
+
+static void writeRecord(void* userData, const TracerDumpRecord& record)
+{
+	ConvertContext& ctx = *static_cast<ConvertContext*>(userData);
+	if(ctx.m_err)
+	{
+		return;
+	}
+
+	const F64 startMicroSec = record.m_start * 1000000.0;
+	if(record.m_isCounter)
+	{
+		ctx.m_err = ctx.m_file.writeTextf("{\"name\": \"%s\", \"cat\": \"PERF\", \"ph\": \"C\", "
+										  "\"pid\": 1, \"tid\": %" PRIu64 ", \"ts\": %.3f, "
+										  "\"args\": {\"value\": %" PRIu64 "}},\n",
+										  record.m_name.cstr(), record.m_tid, startMicroSec, record.m_counterValue);
+		++ctx.m_counterCount;
+	}
+	else
+	{
+		ctx.m_err = ctx.m_file.writeTextf("{\"name\": \"%s\", \"cat\": \"PERF\", \"ph\": \"X\", "
+										  "\"pid\": 1, \"tid\": %" PRIu64 ", \"ts\": %.3f, \"dur\": %.3f},\n",
+										  record.m_name.cstr(), record.m_tid, startMicroSec,
+										  record.m_duration * 1000000.0);
+		++ctx.m_eventCount;
+	}
+}
+
+static Error convert(CString inFilename, CString outFilename)
+{
+	ConvertContext ctx;
+	ANKI_CHECK(ctx.m_file.open(outFilename, FileOpenFlag::kWrite));
+	ANKI_CHECK(ctx.m_file.writeText("[\n"));
+
+	ANKI_CHECK(Tracer::readFlightRecorderDump(inFilename, writeRecord, &ctx));
+	ANKI_CHECK(ctx.m_err);
+
+	ANKI_CHECK(ctx.m_file.writeText("{}\n]\n"));
+
+	ANKI_LOGI("Wrote %u events and %u counters to: %s", ctx.m_eventCount, ctx.m_counterCount, outFilename.cstr());
+	return Error::kNone;
+}
+
+ANKI_MAIN_FUNCTION(myMain)
+int myMain(int argc, char** argv)
+{
+	class Dummy
+	{
+	public:
+		~Dummy()
+		{
+			DefaultMemoryPool::freeSingleton();
+		}
+	} dummy;
+
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	if(argc != 3)
+	{
+		ANKI_LOGE(kUsage, argv[0]);
+		return 1;
+	}
+
+	if(convert(argv[1], argv[2]))
+	{
+		ANKI_LOGE("Conversion failed");
+		return 1;
+	}
+
+	return 0;
+}